@@ -1,16 +1,26 @@
 #include "Buffer.h"
 #include "lang_var.h"
+#include "settings.h"
+#include <esp_timer.h>
+
+extern Settings settings_obj;
+
+#define BUF_FLUSH_MS 1000 // longest a part filled segment waits for the writer
+
+// Saves to main console UART, user-facing app will ignore these markers
+// Uses / and ] in markers as they are illegal characters for SSIDs
+static const char mark_begin[] = "[BUF/BEGIN]";
+static const char mark_close[] = "[BUF/CLOSE]";
+static const uint32_t MARK_LEN = sizeof(mark_begin) - 1;
 
 Buffer::Buffer(){
-  bufA = (uint8_t*)malloc(BUF_SIZE);
-  bufB = (uint8_t*)malloc(BUF_SIZE);
 }
 
 void Buffer::createFile(String name, bool is_pcap, bool is_gpx){
   int i=0;
   if (is_pcap) {
     do{
-      fileName = "/"+name+"_"+(String)i+".pcap";
+      fileName = "/"+name+"_"+(String)i+".pcapng";
       i++;
     } while(fs->exists(fileName));
   }
@@ -28,39 +38,75 @@ void Buffer::createFile(String name, bool is_pcap, bool is_gpx){
   }
 
   Serial.println(fileName);
-  
+
   file = fs->open(fileName, FILE_WRITE);
   file.close();
 }
 
 void Buffer::open(bool is_pcap){
-  bufSizeA = 0;
-  bufSizeB = 0;
+  portENTER_CRITICAL(&lock);
+  ring->reset();
+  this->is_pcap = is_pcap;
+  writing = true;
 
-  bufSizeB = 0;
+  if (is_pcap)
+    ring->addSectionHeader(); // Interfaces are described as their channels are first heard
+  portEXIT_CRITICAL(&lock);
 
-  writing = true;
+  bytes_saved = 0;
+  stats_bytes = 0;
+  stats_ms = millis();
+  bytes_per_sec = 0;
+}
 
-  if (is_pcap) {
-    write(uint32_t(0xa1b2c3d4)); // magic number
-    write(uint16_t(2)); // major version number
-    write(uint16_t(4)); // minor version number
-    write(int32_t(0)); // GMT to local correction
-    write(uint32_t(0)); // accuracy of timestamps
-    write(uint32_t(SNAP_LEN)); // max length of captured packets, in octets
-    write(uint32_t(105)); // data link type
-  }
+// Stop accepting writes, and wait for the writer to save what's already captured.
+// Returns false if the writer hasn't closed the file yet, it may still be saving from the ring
+bool Buffer::close(){
+  if (!ring || !writer)
+    return true;
+
+  writing = false;
+  close_file = true;
+  xTaskNotifyGive(writer);
+  for (int i = 0; close_file && i < 300; i++)
+    delay(10);
+  return !close_file;
 }
 
 void Buffer::openFile(String file_name, fs::FS* fs, bool serial, bool is_pcap, bool is_gpx) {
-  (void)file_name;
-  (void)fs;
-  (void)serial;
-  (void)is_pcap;
-  (void)is_gpx;
-  this->fs = NULL;
-  this->serial = false;
-  writing = false;
+  // The ring, file and destination all still belong to the writer until it acknowledges the close
+  if (!close()) {
+    Serial.println("Capture writer is stuck, not starting a new capture");
+    return;
+  }
+
+  bool save_pcap = settings_obj.loadSetting<bool>(text_table4[7]);
+  if (!save_pcap || (!fs && !serial)) {
+    this->fs = NULL;
+    this->serial = false;
+    return;
+  }
+
+  if (!ring) {
+    ring = new CaptureRing(BUF_SIZE, BUF_SEGMENTS, MARK_LEN, MARK_LEN);
+    if (!ring->ok()) {
+      Serial.println("Not enough memory for the capture buffer");
+      delete ring;
+      ring = NULL;
+      return;
+    }
+  }
+  if (!writer && xTaskCreate(&Buffer::writerTask, "buf_writer", 4096, this, 1, &writer) != pdPASS) {
+    writer = NULL;
+    Serial.println("Not enough memory for the capture writer");
+    return;
+  }
+
+  this->fs = fs;
+  this->serial = serial;
+  if (this->fs)
+    createFile(file_name, is_pcap, is_gpx);
+  open(is_pcap);
 }
 
 void Buffer::pcapOpen(String file_name, fs::FS* fs, bool serial) {
@@ -75,164 +121,111 @@ void Buffer::gpxOpen(String file_name, fs::FS* fs, bool serial) {
   openFile(file_name, fs, serial, false, true);
 }
 
-void Buffer::add(const uint8_t* buf, uint32_t len, bool is_pcap){
-  // buffer is full -> drop packet
-  if((useA && bufSizeA + len >= BUF_SIZE && bufSizeB > 0) || (!useA && bufSizeB + len >= BUF_SIZE && bufSizeA > 0)){
-    //Serial.print(";"); 
+// Called from the WiFi task. The lock is only held to copy the frame into the ring, a few microseconds
+void Buffer::append(wifi_promiscuous_pkt_t *packet, int len) {
+  if (!writing || !is_pcap || len <= 0)
     return;
-  }
-  
-  if(useA && bufSizeA + len + 16 >= BUF_SIZE && bufSizeB == 0){
-    useA = false;
-    //Serial.println("\nswitched to buffer B");
-  }
-  else if(!useA && bufSizeB + len + 16 >= BUF_SIZE && bufSizeA == 0){
-    useA = true;
-    //Serial.println("\nswitched to buffer A");
-  }
 
-  uint32_t microSeconds = micros(); // e.g. 45200400 => 45s 200ms 400us
-  uint32_t seconds = (microSeconds/1000)/1000; // e.g. 45200400/1000/1000 = 45200 / 1000 = 45s
+  portENTER_CRITICAL(&lock);
+  if (writing)
+    ring->addFrame(packet->payload, len, packet->rx_ctrl.channel, packet->rx_ctrl.rssi, esp_timer_get_time(), SNAP_LEN);
+  portEXIT_CRITICAL(&lock);
+  wakeWriter();
+}
+
+void Buffer::append(String log) {
+  if (!writing || is_pcap)
+    return;
+  add((const uint8_t*)log.c_str(), log.length());
+}
 
-  microSeconds -= seconds*1000*1000; // e.g. 45200400 - 45*1000*1000 = 45200400 - 45000000 = 400us (because we only need the offset)
-  
-  if (is_pcap) {
-    write(seconds); // ts_sec
-    write(microSeconds); // ts_usec
-    write(len); // incl_len
-    write(len); // orig_len
-  }
-  
-  write(buf, len); // packet payload
+void Buffer::add(const uint8_t* buf, uint32_t len){
+  portENTER_CRITICAL(&lock);
+  if (writing)
+    ring->add(buf, len);
+  portEXIT_CRITICAL(&lock);
+  wakeWriter();
 }
 
-void Buffer::append(wifi_promiscuous_pkt_t *packet, int len) {
-  (void)packet;
-  (void)len;
+// Only once a segment is full, otherwise the writer gets to it within BUF_FLUSH_MS
+void Buffer::wakeWriter(){
+  if (writer && ring->queued() > 0)
+    xTaskNotifyGive(writer);
 }
 
-void Buffer::append(String log) {
-  (void)log;
-}
-
-void Buffer::write(int32_t n){
-  uint8_t buf[4];
-  buf[0] = n;
-  buf[1] = n >> 8;
-  buf[2] = n >> 16;
-  buf[3] = n >> 24;
-  write(buf,4);
-}
-
-void Buffer::write(uint32_t n){
-  uint8_t buf[4];
-  buf[0] = n;
-  buf[1] = n >> 8;
-  buf[2] = n >> 16;
-  buf[3] = n >> 24;
-  write(buf,4);
-}
-
-void Buffer::write(uint16_t n){
-  uint8_t buf[2];
-  buf[0] = n;
-  buf[1] = n >> 8;
-  write(buf,2);
-}
-
-void Buffer::write(const uint8_t* buf, uint32_t len){
-  if(!writing) return;
-  while(saving) delay(10);
-  
-  if(useA){
-    memcpy(&bufA[bufSizeA], buf, len);
-    bufSizeA += len;
-  }else{
-    memcpy(&bufB[bufSizeB], buf, len);
-    bufSizeB += len;
+void Buffer::writerTask(void* arg){
+  Buffer* buffer = (Buffer*)arg;
+  for (;;) {
+    bool woken = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BUF_FLUSH_MS)) > 0;
+    buffer->drain(!woken);
   }
 }
 
-void Buffer::saveFs(){
-  file = fs->open(fileName, FILE_APPEND);
-  if (!file) {
-    Serial.println(text02+fileName+"'");
-    return;
+void Buffer::drain(bool seal){
+  // Read once, a close requested after this is seen on the next pass, so the segment it
+  // seals is always saved before the file is closed
+  bool closing = close_file;
+
+  if (seal || closing) {
+    portENTER_CRITICAL(&lock);
+    ring->seal();
+    portEXIT_CRITICAL(&lock);
   }
 
-  if(useA){
-    if(bufSizeB > 0){
-      file.write(bufB, bufSizeB);
-    }
-    if(bufSizeA > 0){
-      file.write(bufA, bufSizeA);
-    }
-  } else {
-    if(bufSizeA > 0){
-      file.write(bufA, bufSizeA);
-    }
-    if(bufSizeB > 0){
-      file.write(bufB, bufSizeB);
-    }
+  uint32_t len;
+  uint8_t* buf;
+  while ((buf = ring->front(&len)) != NULL) {
+    if (this->fs) saveFs(buf, len);
+    if (this->serial) saveSerial(buf, len);
+    ring->pop();
+    bytes_saved += len;
   }
 
-  file.close();
+  if (closing) {
+    if (file)
+      file.close();
+    close_file = false;
+  }
 }
 
-void Buffer::saveSerial() {
-  // Saves to main console UART, user-facing app will ignore these markers
-  // Uses / and ] in markers as they are illegal characters for SSIDs
-  const char* mark_begin = "[BUF/BEGIN]";
-  const size_t mark_begin_len = strlen(mark_begin);
-  const char* mark_close = "[BUF/CLOSE]";
-  const size_t mark_close_len = strlen(mark_close);
-
-  // Additional buffer and memcpy's so that a single Serial.write() is called
-  // This is necessary so that other console output isn't mixed into buffer stream
-  uint8_t* buf = (uint8_t*)malloc(mark_begin_len + bufSizeA + bufSizeB + mark_close_len);
-  uint8_t* it = buf;
-  memcpy(it, mark_begin, mark_begin_len);
-  it += mark_begin_len;
-
-  if(useA){
-    if(bufSizeB > 0){
-      memcpy(it, bufB, bufSizeB);
-      it += bufSizeB;
-    }
-    if(bufSizeA > 0){
-      memcpy(it, bufA, bufSizeA);
-      it += bufSizeA;
-    }
-  } else {
-    if(bufSizeA > 0){
-      memcpy(it, bufA, bufSizeA);
-      it += bufSizeA;
-    }
-    if(bufSizeB > 0){
-      memcpy(it, bufB, bufSizeB);
-      it += bufSizeB;
+// The file stays open while capturing, flushed after each segment so a capture survives losing power
+void Buffer::saveFs(uint8_t* buf, uint32_t len){
+  if (!file) {
+    file = fs->open(fileName, FILE_APPEND);
+    if (!file) {
+      Serial.println(text02+fileName+"'");
+      return;
     }
   }
 
-  memcpy(it, mark_close, mark_close_len);
-  it += mark_close_len;
-  Serial.write(buf, it - buf);
-  free(buf);
+  file.write(buf, len);
+  file.flush();
 }
 
-void Buffer::save() {
-  saving = true;
-
-  if((bufSizeA + bufSizeB) == 0){
-    saving = false;
-    return;
+void Buffer::saveSerial(uint8_t* buf, uint32_t len) {
+  // The ring leaves room either side of a segment for the markers, so a single Serial.write() is called
+  // This is necessary so that other console output isn't mixed into buffer stream
+  memcpy(buf - MARK_LEN, mark_begin, MARK_LEN);
+  memcpy(buf + len, mark_close, MARK_LEN);
+  Serial.write(buf - MARK_LEN, MARK_LEN + len + MARK_LEN);
+}
+
+Buffer::Stats Buffer::getStats() {
+  Stats stats = {};
+  if (!ring)
+    return stats;
+
+  uint32_t now = millis();
+  if (now - stats_ms >= 1000) {
+    uint32_t saved = bytes_saved;
+    bytes_per_sec = (uint64_t)(saved - stats_bytes) * 1000 / (now - stats_ms);
+    stats_bytes = saved;
+    stats_ms = now;
   }
 
-  if(this->fs) saveFs();
-  if(this->serial) saveSerial();
-
-  bufSizeA = 0;
-  bufSizeB = 0;
-
-  saving = false;
+  stats.dropped = ring->dropped();
+  stats.queued = ring->queued();
+  stats.segments = ring->numSegments();
+  stats.bytes_per_sec = bytes_per_sec;
+  return stats;
 }
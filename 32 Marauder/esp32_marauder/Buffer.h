@@ -7,47 +7,61 @@
 #include "FS.h"
 #include "esp_wifi_types.h"
 #include "configs.h"
+#include "CaptureRing.h"
 
 //#define BUF_SIZE 3 * 1024 // Had to reduce buffer size to save RAM. GG @spacehuhn
 //#define SNAP_LEN 2324 // max len of each recieved packet
 
 //extern bool useSD;
 
+// Captured frames and log lines go into a ring of BUF_SEGMENTS segments of BUF_SIZE bytes. A writer task saves the
+// segments to the file and/or serial as they fill, and at least once a second, so capturing never waits on the SD card.
 class Buffer {
   public:
+    struct Stats {
+      uint32_t dropped; // frames and lines which didn't fit while the writer was behind
+      uint8_t queued; // segments waiting for the writer
+      uint8_t segments;
+      uint32_t bytes_per_sec; // saved
+    };
+
     Buffer();
     void pcapOpen(String file_name, fs::FS* fs, bool serial);
     void logOpen(String file_name, fs::FS* fs, bool serial);
     void gpxOpen(String file_name, fs::FS* fs, bool serial);
     void append(wifi_promiscuous_pkt_t *packet, int len);
     void append(String log);
-    void save();
+    bool capturing() { return writing; }
+    Stats getStats();
   private:
     void createFile(String name, bool is_pcap, bool is_gpx = false);
     void open(bool is_pcap);
+    bool close();
     void openFile(String file_name, fs::FS* fs, bool serial, bool is_pcap, bool is_gpx = false);
-    void add(const uint8_t* buf, uint32_t len, bool is_pcap);
-    void write(int32_t n);
-    void write(uint32_t n);
-    void write(uint16_t n);
-    void write(const uint8_t* buf, uint32_t len);
-    void saveFs();
-    void saveSerial();
-    
-    uint8_t* bufA;
-    uint8_t* bufB;
-
-    uint32_t bufSizeA = 0;
-    uint32_t bufSizeB = 0;
-
-    bool writing = false; // acceppting writes to buffer
-    bool useA = true; // writing to bufA or bufB
-    bool saving = false; // currently saving onto the SD card
+    void add(const uint8_t* buf, uint32_t len);
+    void wakeWriter();
+    static void writerTask(void* arg);
+    void drain(bool seal);
+    void saveFs(uint8_t* buf, uint32_t len);
+    void saveSerial(uint8_t* buf, uint32_t len);
+
+    CaptureRing* ring = NULL;
+    TaskHandle_t writer = NULL;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED; // between whoever is adding to the ring, and sealing it
+
+    volatile bool writing = false; // acceppting writes to buffer
+    volatile bool is_pcap = false;
+    volatile bool close_file = false; // for the writer, once it has saved everything
+
+    volatile uint32_t bytes_saved = 0;
+    uint32_t stats_ms = 0;
+    uint32_t stats_bytes = 0;
+    uint32_t bytes_per_sec = 0;
 
     String fileName = "/0.pcap";
     File file;
-    fs::FS* fs;
-    bool serial;
+    fs::FS* fs = NULL;
+    bool serial = false;
 };
 
 #endif
@@ -0,0 +1,307 @@
+#pragma once
+
+#ifndef CaptureRing_h
+#define CaptureRing_h
+
+#include <atomic>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// No Arduino or ESP-IDF in here, so the capture format and the ring can be tested on the host
+
+// pcapng blocks, little endian. Frames get a radiotap header with their channel and RSSI, and each channel is
+// described as its own interface so Wireshark can filter on it
+namespace PcapNg {
+  const uint32_t SECTION_HEADER = 0x0A0D0D0A;
+  const uint32_t INTERFACE_DESCRIPTION = 1;
+  const uint32_t ENHANCED_PACKET = 6;
+  const uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+  const uint16_t LINKTYPE_IEEE802_11_RADIOTAP = 127;
+  const uint16_t OPT_ENDOFOPT = 0;
+  const uint16_t IF_NAME = 2;
+  const uint16_t EPB_DROPCOUNT = 4;
+
+  const uint32_t SECTION_HEADER_LEN = 28;
+  const uint32_t RADIOTAP_LEN = 13; // header, channel, antenna signal
+  const uint32_t RADIOTAP_PRESENT = (1 << 3) | (1 << 5); // channel, dBm antenna signal
+
+  inline uint32_t pad4(uint32_t n) {
+    return (n + 3) & ~3u;
+  }
+
+  inline uint8_t* put16(uint8_t* p, uint16_t n) {
+    p[0] = n;
+    p[1] = n >> 8;
+    return p + 2;
+  }
+
+  inline uint8_t* put32(uint8_t* p, uint32_t n) {
+    p[0] = n;
+    p[1] = n >> 8;
+    p[2] = n >> 16;
+    p[3] = n >> 24;
+    return p + 4;
+  }
+
+  inline uint16_t channelFreq(uint8_t channel) {
+    if (channel == 14)
+      return 2484;
+    if (channel < 14)
+      return 2407 + channel * 5;
+    return 5000 + channel * 5;
+  }
+
+  // Interfaces are named after their channel, "ch6"
+  inline uint32_t interfaceName(char* name, uint8_t channel) {
+    uint32_t len = 0;
+    name[len++] = 'c';
+    name[len++] = 'h';
+    if (channel >= 100)
+      name[len++] = '0' + channel / 100;
+    if (channel >= 10)
+      name[len++] = '0' + channel / 10 % 10;
+    name[len++] = '0' + channel % 10;
+    return len;
+  }
+
+  inline uint32_t sectionHeader(uint8_t* out) {
+    uint8_t* p = out;
+    p = put32(p, SECTION_HEADER);
+    p = put32(p, SECTION_HEADER_LEN);
+    p = put32(p, BYTE_ORDER_MAGIC);
+    p = put16(p, 1); // major version
+    p = put16(p, 0); // minor version
+    p = put32(p, 0xFFFFFFFF); // section length unknown, 64 bits
+    p = put32(p, 0xFFFFFFFF);
+    p = put32(p, SECTION_HEADER_LEN);
+    return p - out;
+  }
+
+  inline uint32_t interfaceDescriptionLen(uint8_t channel) {
+    char name[5];
+    return 16 + 4 + pad4(interfaceName(name, channel)) + 4 + 4;
+  }
+
+  inline uint32_t interfaceDescription(uint8_t* out, uint8_t channel, uint32_t snap_len) {
+    char name[5];
+    uint32_t name_len = interfaceName(name, channel);
+    uint32_t len = interfaceDescriptionLen(channel);
+    uint8_t* p = out;
+    p = put32(p, INTERFACE_DESCRIPTION);
+    p = put32(p, len);
+    p = put16(p, LINKTYPE_IEEE802_11_RADIOTAP);
+    p = put16(p, 0);
+    p = put32(p, snap_len + RADIOTAP_LEN);
+    p = put16(p, IF_NAME);
+    p = put16(p, name_len);
+    memset(p, 0, pad4(name_len));
+    memcpy(p, name, name_len);
+    p += pad4(name_len);
+    p = put16(p, OPT_ENDOFOPT);
+    p = put16(p, 0);
+    p = put32(p, len);
+    return p - out;
+  }
+
+  inline uint32_t enhancedPacketLen(uint32_t len, bool has_drops) {
+    return 28 + pad4(RADIOTAP_LEN + len) + (has_drops ? 16 : 0) + 4;
+  }
+
+  // A frame, with how many were dropped before it if any
+  inline uint32_t enhancedPacket(uint8_t* out, uint32_t interface_id, uint64_t ts_us, const uint8_t* frame, uint32_t len,
+                                 uint32_t orig_len, uint8_t channel, int8_t rssi, uint32_t drops) {
+    uint32_t block_len = enhancedPacketLen(len, drops > 0);
+    uint8_t* p = out;
+    p = put32(p, ENHANCED_PACKET);
+    p = put32(p, block_len);
+    p = put32(p, interface_id);
+    p = put32(p, ts_us >> 32);
+    p = put32(p, (uint32_t)ts_us);
+    p = put32(p, RADIOTAP_LEN + len);
+    p = put32(p, RADIOTAP_LEN + orig_len);
+
+    *p++ = 0; // radiotap version
+    *p++ = 0;
+    p = put16(p, RADIOTAP_LEN);
+    p = put32(p, RADIOTAP_PRESENT);
+    p = put16(p, channelFreq(channel));
+    p = put16(p, channel <= 14 ? 0x0080 : 0x0100); // 2 or 5 GHz
+    *p++ = (uint8_t)rssi;
+    memcpy(p, frame, len);
+    p += len;
+    uint32_t padding = pad4(RADIOTAP_LEN + len) - (RADIOTAP_LEN + len);
+    memset(p, 0, padding);
+    p += padding;
+
+    if (drops > 0) {
+      p = put16(p, EPB_DROPCOUNT);
+      p = put16(p, 8);
+      p = put32(p, drops);
+      p = put32(p, 0);
+      p = put16(p, OPT_ENDOFOPT);
+      p = put16(p, 0);
+    }
+    p = put32(p, block_len);
+    return p - out;
+  }
+}
+
+// Segments of captured bytes on their way to a writer. One producer fills the current segment and hands it over when
+// the next write won't fit; the writer takes handed over segments in order and gives them back once written. While the
+// writer is behind and every segment is waiting, writes are dropped and counted rather than blocking the producer.
+//
+// Producer calls must not overlap each other, and neither must the writer's. The two sides can run at the same time.
+class CaptureRing {
+  public:
+    // Each segment also has headroom bytes before it and tailroom after, which the writer may use to frame it in place
+    CaptureRing(uint32_t segment_size, uint8_t segments, uint32_t headroom = 0, uint32_t tailroom = 0)
+      : segment_size(segment_size), segments(segments), headroom(headroom),
+        stride(headroom + segment_size + tailroom) {
+      storage = (uint8_t*)malloc(stride * segments);
+      fill = (uint32_t*)calloc(segments, sizeof(uint32_t));
+      if (!storage || !fill) {
+        free(storage);
+        free(fill);
+        storage = NULL;
+        fill = NULL;
+      }
+      resetInterfaces();
+    }
+
+    ~CaptureRing() {
+      free(storage);
+      free(fill);
+    }
+
+    bool ok() const { return storage != NULL; }
+
+    // Start again from nothing, only while neither side is using the ring
+    void reset() {
+      if (!ok())
+        return;
+      head.store(0);
+      tail.store(0);
+      fill[0] = 0;
+      drops_since_frame = 0;
+      dropped_count.store(0);
+      resetInterfaces();
+    }
+
+    // Producer: raw bytes, for a file header or a line of a log
+    bool add(const uint8_t* buf, uint32_t len) {
+      uint8_t* out = reserve(len);
+      if (!out)
+        return drop();
+      memcpy(out, buf, len);
+      fill[head.load(std::memory_order_relaxed) % segments] += len;
+      return true;
+    }
+
+    bool addSectionHeader() {
+      uint8_t header[PcapNg::SECTION_HEADER_LEN];
+      PcapNg::sectionHeader(header);
+      return add(header, sizeof(header));
+    }
+
+    // Producer: a frame as a pcapng packet, after its interface's description the first time the channel is heard
+    bool addFrame(const uint8_t* frame, uint32_t len, uint8_t channel, int8_t rssi, uint64_t ts_us, uint32_t snap_len) {
+      uint32_t captured = len < snap_len ? len : snap_len;
+      bool new_interface = interface_ids[channel] == NO_INTERFACE;
+      uint32_t needed = PcapNg::enhancedPacketLen(captured, drops_since_frame > 0);
+      if (new_interface)
+        needed += PcapNg::interfaceDescriptionLen(channel);
+
+      uint8_t* out = reserve(needed);
+      if (!out)
+        return drop();
+      if (new_interface) {
+        out += PcapNg::interfaceDescription(out, channel, snap_len);
+        interface_ids[channel] = next_interface_id++;
+      }
+      PcapNg::enhancedPacket(out, interface_ids[channel], ts_us, frame, captured, len, channel, rssi, drops_since_frame);
+      drops_since_frame = 0;
+      fill[head.load(std::memory_order_relaxed) % segments] += needed;
+      return true;
+    }
+
+    // Producer: hand over the current segment even though it isn't full. False if the writer has no room to spare
+    bool seal() {
+      uint32_t h = head.load(std::memory_order_relaxed);
+      if (fill[h % segments] == 0)
+        return true;
+      if (h - tail.load(std::memory_order_acquire) >= (uint32_t)(segments - 1))
+        return false;
+      fill[(h + 1) % segments] = 0;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Writer: the oldest handed over segment, or NULL if there's none
+    uint8_t* front(uint32_t* len) {
+      uint32_t t = tail.load(std::memory_order_relaxed);
+      if (t == head.load(std::memory_order_acquire))
+        return NULL;
+      *len = fill[t % segments];
+      return segment(t % segments);
+    }
+
+    // Writer: done with front()
+    void pop() {
+      tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Segments handed over and waiting for the writer
+    uint8_t queued() const {
+      return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    uint8_t numSegments() const { return segments; }
+    uint32_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+  private:
+    static const uint8_t NO_INTERFACE = 0xFF;
+
+    uint8_t* storage = NULL;
+    uint32_t* fill = NULL; // bytes in each segment
+    uint32_t segment_size;
+    uint8_t segments;
+    uint32_t headroom;
+    uint32_t stride;
+
+    std::atomic<uint32_t> head{0}; // segment being filled, all before it back to tail are the writer's
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped_count{0};
+    uint32_t drops_since_frame = 0;
+
+    uint8_t interface_ids[256];
+    uint8_t next_interface_id = 0;
+
+    uint8_t* segment(uint32_t i) { return storage + i * stride + headroom; }
+
+    void resetInterfaces() {
+      memset(interface_ids, NO_INTERFACE, sizeof(interface_ids));
+      next_interface_id = 0;
+    }
+
+    bool drop() {
+      dropped_count.fetch_add(1, std::memory_order_relaxed);
+      drops_since_frame++;
+      return false;
+    }
+
+    // Room for len bytes in the current segment, moving on to the next one if they don't fit
+    uint8_t* reserve(uint32_t len) {
+      if (!storage || len > segment_size)
+        return NULL;
+      uint32_t h = head.load(std::memory_order_relaxed);
+      if (fill[h % segments] + len > segment_size) {
+        if (!seal())
+          return NULL;
+        h++;
+      }
+      return segment(h % segments) + fill[h % segments];
+    }
+};
+
+#endif
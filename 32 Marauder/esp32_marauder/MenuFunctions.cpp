@@ -1508,9 +1508,26 @@ void MenuFunctions::updateStatusBar()
     #endif
   }
 
-  // RAM Stuff
   wifi_scan_obj.freeRAM();
-  if ((wifi_scan_obj.free_ram != wifi_scan_obj.old_free_ram) || (status_changed)) {
+  // RAM Stuff, or capture stuff in its place while frames are being saved
+  // Q: segments waiting to be saved, D: frames dropped, then how fast they're being saved
+  if (buffer_obj.capturing() && wifi_scan_obj.scanning()) {
+    Buffer::Stats stats = buffer_obj.getStats();
+    String queue_str = "Q" + (String)stats.queued + "/" + (String)stats.segments + " D" + (String)stats.dropped;
+    String rate_str = (String)(stats.bytes_per_sec / 1024) + "KB/s";
+    wifi_scan_obj.old_free_ram = ""; // Redraw RAM once the capture is over
+    #ifdef HAS_FULL_SCREEN
+      display_obj.tft.fillRect(100, 0, 54, STATUS_BAR_WIDTH, STATUSBAR_COLOR);
+      display_obj.tft.drawString(queue_str, 100, 0, 1);
+      display_obj.tft.drawString(rate_str, 100, 8, 1);
+    #endif
+
+    #ifdef HAS_MINI_SCREEN
+      display_obj.tft.fillRect(TFT_WIDTH/1.75, 0, CHAR_WIDTH * 12, STATUS_BAR_WIDTH, STATUSBAR_COLOR);
+      display_obj.tft.drawString(queue_str + " " + rate_str, TFT_WIDTH/1.75, 0, 1);
+    #endif
+  }
+  else if ((wifi_scan_obj.free_ram != wifi_scan_obj.old_free_ram) || (status_changed)) {
     wifi_scan_obj.old_free_ram = wifi_scan_obj.free_ram;
     //display_obj.tft.fillRect(100, 0, 60, STATUS_BAR_WIDTH, STATUSBAR_COLOR);
     #ifdef HAS_FULL_SCREEN
@@ -1581,16 +1581,17 @@ String WiFiScan::freeRAM()
   return String(s);
 }
 
+// There's no SD card support in this build, so captures only go to serial, when asked for with -serial
 void WiFiScan::startPcap(String file_name) {
-  (void)file_name;
+  buffer_obj.pcapOpen(file_name, NULL, this->save_serial);
 }
 
 void WiFiScan::startLog(String file_name) {
-  (void)file_name;
+  buffer_obj.logOpen(file_name, NULL, this->save_serial);
 }
 
 void WiFiScan::startGPX(String file_name) {
-  (void)file_name;
+  buffer_obj.gpxOpen(file_name, NULL, this->save_serial);
 }
 
 void WiFiScan::parseBSSID(const char* bssidStr, uint8_t* bssid) {
@@ -2482,12 +2482,15 @@
   
   #ifdef HAS_PSRAM
     #define BUF_SIZE 8 * 1024 // Had to reduce buffer size to save RAM. GG @spacehuhn
+    #define BUF_SEGMENTS 8 // BUF_SIZE each, enough to ride out a slow SD write
     #define SNAP_LEN 1 * 4096 // max len of each recieved packet
   #elif !defined(HAS_ILI9341)
     #define BUF_SIZE 8 * 1024 // Had to reduce buffer size to save RAM. GG @spacehuhn
+    #define BUF_SEGMENTS 4
     #define SNAP_LEN 4096 // max len of each recieved packet
   #else
     #define BUF_SIZE 3 * 1024 // Had to reduce buffer size to save RAM. GG @spacehuhn
+    #define BUF_SEGMENTS 3
     #define SNAP_LEN 2324 // max len of each recieved packet
   #endif
 
@@ -304,9 +304,6 @@ void loop()
   #ifdef HAS_GPS
     gps_obj.main();
   #endif
-  
-  // Save buffer to SD and/or serial
-  buffer_obj.save();
 
   #ifdef HAS_BATTERY
     battery_obj.main(currentTime);
@@ -24,6 +24,7 @@
 #define MESHTASTIC_LOG_LEVEL_CRIT "CRIT "
 #define MESHTASTIC_LOG_LEVEL_TRACE "TRACE"
 
+#include "LogModule.h"
 #include "SerialConsole.h"
 
 // If defined we will include support for ARM ICE "semihosting" for a virtual
@@ -36,6 +37,28 @@
 
 #define DEBUG_PORT (*console) // Serial debug port
 
+// Lines less severe than this (one of the LOG_LEVEL_* in LogModule.h) are compiled out, arguments and all
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// Whether each source file gets its own runtime level (see LogModule), otherwise only LOG_MIN_LEVEL applies
+#ifndef LOG_MODULE_LEVELS
+#ifdef ARCH_PORTDUINO
+#define LOG_MODULE_LEVELS 1
+#else
+#define LOG_MODULE_LEVELS 0
+#endif
+#endif
+
+#if LOG_MODULE_LEVELS
+// __BASE_FILE__ is the .cpp being compiled, not this header
+static LogModule thisLogModule(__BASE_FILE__);
+#define LOG_ENABLED(level) ((level) >= LOG_MIN_LEVEL && thisLogModule.wants(level))
+#else
+#define LOG_ENABLED(level) ((level) >= LOG_MIN_LEVEL)
+#endif
+
 #ifdef USE_SEGGER
 // #undef DEBUG_PORT
 #define LOG_DEBUG(...) SEGGER_RTT_printf(0, __VA_ARGS__)
@@ -44,14 +67,23 @@
 #define LOG_ERROR(...) SEGGER_RTT_printf(0, __VA_ARGS__)
 #define LOG_CRIT(...) SEGGER_RTT_printf(0, __VA_ARGS__)
 #define LOG_TRACE(...) SEGGER_RTT_printf(0, __VA_ARGS__)
+#define LOG_DEBUG_DEFERRED(...) SEGGER_RTT_printf(0, __VA_ARGS__)
+#define LOG_TRACE_ENABLED() true
 #else
 #if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
-#define LOG_DEBUG(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__)
-#define LOG_INFO(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_INFO, __VA_ARGS__)
-#define LOG_WARN(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_WARN, __VA_ARGS__)
-#define LOG_ERROR(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__)
-#define LOG_CRIT(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__)
-#define LOG_TRACE(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_TRACE, __VA_ARGS__)
+// The level check comes first so a line nobody wants never evaluates its arguments
+#define LOG_AT(level, name, ...) (LOG_ENABLED(level) ? DEBUG_PORT.log(name, __VA_ARGS__) : (void)0)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, MESHTASTIC_LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, MESHTASTIC_LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_CRIT(...) LOG_AT(LOG_LEVEL_CRIT, MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__)
+// Trace lines may also be going to the trace file, whatever the console wants
+#define LOG_TRACE_ENABLED() (LOG_ENABLED(LOG_LEVEL_TRACE) || (LOG_MIN_LEVEL <= LOG_LEVEL_TRACE && RedirectablePrint::traceToFile))
+#define LOG_TRACE(...) (LOG_TRACE_ENABLED() ? DEBUG_PORT.logTrace(LOG_ENABLED(LOG_LEVEL_TRACE), __VA_ARGS__) : (void)0)
+// For hot paths, only takes integer arguments which the log ring stores as they are and formats later
+#define LOG_DEBUG_DEFERRED(...)                                                                                                  \
+    (LOG_ENABLED(LOG_LEVEL_DEBUG) ? DEBUG_PORT.logDeferred(MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__) : (void)0)
 #else
 #define LOG_DEBUG(...)
 #define LOG_INFO(...)
@@ -59,6 +91,8 @@
 #define LOG_ERROR(...)
 #define LOG_CRIT(...)
 #define LOG_TRACE(...)
+#define LOG_DEBUG_DEFERRED(...)
+#define LOG_TRACE_ENABLED() false
 #endif
 #endif
 
@@ -0,0 +1,60 @@
+#include "LogModule.h"
+
+#include <string.h>
+
+LogModule *LogModule::first;
+
+LogModule::LogModule(const char *_file) : file(_file)
+{
+    // Only ever called during static initialisation, so no locking
+    next = first;
+    first = this;
+}
+
+bool LogModule::isNamed(const char *name, size_t len) const
+{
+    const char *base = strrchr(file, '/');
+    base = base ? base + 1 : file;
+    const char *dot = strrchr(base, '.');
+    size_t baseLen = dot ? dot - base : strlen(base);
+    return baseLen == len && strncmp(base, name, len) == 0;
+}
+
+int LogModule::parseLevel(const char *name, size_t len)
+{
+    static const char *const names[] = {"trace", "debug", "info", "warn", "error", "crit"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strlen(names[i]) == len && strncmp(names[i], name, len) == 0)
+            return LOG_LEVEL_TRACE + i;
+    }
+    return -1;
+}
+
+bool LogModule::configure(uint8_t defaultLevel, const char *spec)
+{
+    for (LogModule *m = first; m; m = m->next)
+        m->threshold = defaultLevel;
+
+    bool ok = true;
+    for (const char *p = spec; p && *p;) {
+        const char *end = strchr(p, ',');
+        if (!end)
+            end = p + strlen(p);
+        const char *eq = (const char *)memchr(p, '=', end - p);
+        int level = eq ? parseLevel(eq + 1, end - eq - 1) : -1;
+        if (level < 0) {
+            ok = false;
+        } else {
+            bool found = false;
+            for (LogModule *m = first; m; m = m->next) {
+                if (m->isNamed(p, eq - p)) {
+                    m->threshold = level;
+                    found = true;
+                }
+            }
+            ok = ok && found;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return ok;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Log levels, least severe first
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_CRIT 5
+
+/**
+ * The runtime log level of one source file.  Every LOG_* checks it inline, before its arguments are evaluated, so a line that
+ * would be thrown away costs a load and a compare.
+ *
+ * DebugConfiguration.h gives every translation unit its own (thisLogModule), named after the file: src/mesh/Router.cpp is
+ * "Router".  They all start out letting everything through until configure() is called.
+ */
+class LogModule
+{
+  public:
+    explicit LogModule(const char *file);
+
+    /// Would a line at this LOG_LEVEL_* be logged?
+    bool wants(uint8_t level) const { return level >= threshold.load(std::memory_order_relaxed); }
+
+    /**
+     * Set every module to defaultLevel and then apply spec, a comma separated list of name=level pairs where level is trace,
+     * debug, info, warn, error or crit.  For example "Router=debug,PacketHistory=warn".
+     * @return false if some of spec couldn't be parsed, the pairs that could are still applied
+     */
+    static bool configure(uint8_t defaultLevel, const char *spec);
+
+    /// @return the LOG_LEVEL_* called name (trace, debug...), or -1
+    static int parseLevel(const char *name, size_t len);
+
+  private:
+    const char *file;
+    std::atomic<uint8_t> threshold = {LOG_LEVEL_TRACE};
+    LogModule *next;
+
+    static LogModule *first;
+
+    /// Does our file name, without directory or extension, match name?
+    bool isNamed(const char *name, size_t len) const;
+};
@@ -0,0 +1,82 @@
+#include "LogRing.h"
+
+#if LOG_RING_SLOTS
+
+#include <stdio.h>
+#include <string.h>
+
+LogRing::LogRing()
+{
+    // A slot is free for whoever claims position n when its sequence is n
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+LogRing::Record *LogRing::claim()
+{
+    uint32_t pos = writePos.load(std::memory_order_relaxed);
+    while (true) {
+        Record *r = &slots[pos & (LOG_RING_SLOTS - 1)];
+        int32_t diff = (int32_t)(r->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            // Free, try to take it.  On failure pos is reloaded for us
+            if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                r->pos = pos;
+                return r;
+            }
+        } else if (diff < 0) {
+            // Still holds the record from a lap ago, which the consumer hasn't got to
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = writePos.load(std::memory_order_relaxed); // another producer took it
+        }
+    }
+}
+
+void LogRing::publish(Record *r)
+{
+    r->sequence.store(r->pos + 1, std::memory_order_release);
+}
+
+LogRing::Record *LogRing::front()
+{
+    Record *r = &slots[readPos & (LOG_RING_SLOTS - 1)];
+    if (r->sequence.load(std::memory_order_acquire) != readPos + 1)
+        return nullptr; // not published yet
+    return r;
+}
+
+void LogRing::pop()
+{
+    Record *r = &slots[readPos & (LOG_RING_SLOTS - 1)];
+    r->sequence.store(readPos + LOG_RING_SLOTS, std::memory_order_release);
+    readPos++;
+}
+
+size_t LogRing::format(const Record &r, char *buf, size_t bufSize)
+{
+    if (bufSize < 2)
+        return 0;
+
+    int len;
+    if (r.format) {
+        // Unused arguments are harmless, the format only takes the ones it names
+        len = snprintf(buf, bufSize - 1, r.format, r.args[0], r.args[1], r.args[2], r.args[3], r.args[4], r.args[5]);
+        if (len < 0)
+            len = 0;
+        if ((size_t)len > bufSize - 2)
+            len = bufSize - 2;
+        buf[len++] = '\n';
+        buf[len] = '\0';
+    } else {
+        len = strnlen(r.text, sizeof(r.text));
+        if ((size_t)len > bufSize - 1)
+            len = bufSize - 1;
+        memcpy(buf, r.text, len);
+        buf[len] = '\0';
+    }
+    return len;
+}
+
+#endif
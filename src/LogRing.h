@@ -0,0 +1,83 @@
+#pragma once
+
+#include "configuration.h"
+
+#ifndef LOG_RING_SLOTS
+#ifdef ARCH_PORTDUINO
+#define LOG_RING_SLOTS 256
+#else
+#define LOG_RING_SLOTS 0 // Log lines are written out by whoever logs them
+#endif
+#endif
+
+#if LOG_RING_SLOTS
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LOG_RING_TEXT_SIZE
+#define LOG_RING_TEXT_SIZE 512
+#endif
+
+/**
+ * A bounded multi-producer, single-consumer queue of log records, so logging from a hot path costs a vsnprintf (or for a binary
+ * record a few stores) rather than however long the line takes to go out of the serial port, syslog and BLE.
+ *
+ * Any thread may push, nobody takes a lock.  Every slot carries a sequence number: a producer claims the slot at the write
+ * position by moving the position on with a compare and swap, fills it in and publishes it by bumping its sequence, and the
+ * consumer only takes a slot once it has been published.  When the ring is full the record is dropped and counted.
+ */
+class LogRing
+{
+  public:
+    static const uint8_t maxArgs = 6;
+
+    struct Record {
+        const char *level;  // one of the MESHTASTIC_LOG_LEVEL_* strings
+        const char *format; // binary records only, expanded by the consumer so it has to be a string literal
+        uint8_t numArgs;
+        uint32_t millis;
+        uint32_t rtcSec; // 0 if we didn't know the time
+        char thread[16]; // the OSThread that logged it, possibly truncated
+        union {
+            char text[LOG_RING_TEXT_SIZE]; // text records, already formatted and ending in a newline
+            uint32_t args[maxArgs];
+        };
+
+      private:
+        friend class LogRing;
+        std::atomic<uint32_t> sequence;
+        uint32_t pos;
+    };
+
+    LogRing();
+
+    /// Claim a slot for a new record.  @return nullptr if the ring is full, the record counts as dropped
+    Record *claim();
+
+    /// Hand a claimed record to the consumer
+    void publish(Record *r);
+
+    /// The oldest published record, or nullptr.  Consumer only
+    Record *front();
+
+    /// Free the record front() returned.  Consumer only
+    void pop();
+
+    /// Write out a record the way it was logged, newline included.  @return its length
+    static size_t format(const Record &r, char *buf, size_t bufSize);
+
+    /// Records lost because the ring was full
+    uint32_t numDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+  private:
+    static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+    Record slots[LOG_RING_SLOTS];
+    std::atomic<uint32_t> writePos = {0};
+    uint32_t readPos = 0;
+    std::atomic<uint32_t> dropped = {0};
+};
+
+#endif
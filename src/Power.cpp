@@ -765,6 +765,7 @@ void Power::readPowerStatus()
         LOG_DEBUG(threadlist.c_str());
         LOG_DEBUG("Heap status: %d/%d bytes free (%d), running %d/%d threads", memGet.getFreeHeap(), memGet.getHeapSize(),
                   memGet.getFreeHeap() - lastheap, running, concurrency::mainController.size(false));
+        concurrency::mainController.logStats();
         lastheap = memGet.getFreeHeap();
     }
 #ifdef DEBUG_HEAP_MQTT
@@ -118,7 +118,7 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
             Print::write("\u001b[35m", 5);
     }
 
-    uint32_t rtc_sec = getValidTime(RTCQuality::RTCQualityDevice, true); // display local time on logfile
+    uint32_t rtc_sec = logRtcSec(); // display local time on logfile
     if (rtc_sec > 0) {
         long hms = rtc_sec % SEC_PER_DAY;
         // hms += tz.tz_dsttime * SEC_PER_HOUR;
@@ -135,13 +135,13 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
         if (color) {
             ::printf("\u001b[0m");
         }
-        ::printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+        ::printf("| %02d:%02d:%02d %u ", hour, min, sec, logMillis() / 1000);
 #else
         printf("%s ", logLevel);
         if (color) {
             printf("\u001b[0m");
         }
-        printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+        printf("| %02d:%02d:%02d %u ", hour, min, sec, logMillis() / 1000);
 #endif
     } else {
 #ifdef ARCH_PORTDUINO
@@ -149,21 +149,19 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
         if (color) {
             ::printf("\u001b[0m");
         }
-        ::printf("| ??:??:?? %u ", millis() / 1000);
+        ::printf("| ??:??:?? %u ", logMillis() / 1000);
 #else
         printf("%s ", logLevel);
         if (color) {
             printf("\u001b[0m");
         }
-        printf("| ??:??:?? %u ", millis() / 1000);
+        printf("| ??:??:?? %u ", logMillis() / 1000);
 #endif
     }
-    auto thread = concurrency::OSThread::currentThread;
+    const char *thread = logThreadName();
     if (thread) {
         print("[");
-        // printf("%p ", thread);
-        // assert(thread->ThreadName.length());
-        print(thread->ThreadName);
+        print(thread);
         print("] ");
     }
     r += vprintf(logLevel, format, arg);
@@ -194,9 +192,9 @@ void RedirectablePrint::log_to_syslog(const char *logLevel, const char *format,
         default:
             ll = 0;
         }
-        auto thread = concurrency::OSThread::currentThread;
+        const char *thread = logThreadName();
         if (thread) {
-            syslog.vlogf(ll, thread->ThreadName.c_str(), format, arg);
+            syslog.vlogf(ll, thread, format, arg);
         } else {
             syslog.vlogf(ll, format, arg);
         }
@@ -226,13 +224,13 @@ void RedirectablePrint::log_to_ble(const char *logLevel, const char *format, va_
                 message = new char[len + 1];
                 vsnprintf(message, len + 1, format, arg);
             }
-            auto thread = concurrency::OSThread::currentThread;
+            const char *thread = logThreadName();
             meshtastic_LogRecord logRecord = meshtastic_LogRecord_init_zero;
             logRecord.level = getLogLevel(logLevel);
             strcpy(logRecord.message, message);
             if (thread)
-                strcpy(logRecord.source, thread->ThreadName.c_str());
-            logRecord.time = getValidTime(RTCQuality::RTCQualityDevice, true);
+                strcpy(logRecord.source, thread);
+            logRecord.time = logRtcSec();
 
             uint8_t *buffer = new uint8_t[meshtastic_LogRecord_size];
             size_t size = pb_encode_to_bytes(buffer, meshtastic_LogRecord_size, meshtastic_LogRecord_fields, &logRecord);
@@ -275,48 +273,126 @@ meshtastic_LogRecord_Level RedirectablePrint::getLogLevel(const char *logLevel)
     return ll;
 }
 
-void RedirectablePrint::log(const char *logLevel, const char *format, ...)
+const char *RedirectablePrint::logThreadName()
 {
+#if LOG_RING_SLOTS
+    if (draining)
+        return draining->thread[0] ? draining->thread : nullptr;
+#endif
+    auto thread = concurrency::OSThread::currentThread;
+    return thread ? thread->ThreadName.c_str() : nullptr;
+}
 
-    // append \n to format
-    size_t len = strlen(format);
-    char *newFormat = new char[len + 2];
-    strcpy(newFormat, format);
-    newFormat[len] = '\n';
-    newFormat[len + 1] = '\0';
+uint32_t RedirectablePrint::logRtcSec()
+{
+#if LOG_RING_SLOTS
+    if (draining)
+        return draining->rtcSec;
+#endif
+    return getValidTime(RTCQuality::RTCQualityDevice, true);
+}
+
+uint32_t RedirectablePrint::logMillis()
+{
+#if LOG_RING_SLOTS
+    if (draining)
+        return draining->millis;
+#endif
+    return millis();
+}
 
+bool RedirectablePrint::wantsLevel(const char *logLevel)
+{
+    // The levels themselves are checked by the LOG_* macros, before we're called
+#if ARCH_PORTDUINO && !LOG_MODULE_LEVELS
+    // unless they're built without per-file levels, then config.yaml's LogLevel still applies here
+    if ((settingsMap[logoutputlevel] < level_trace && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) ||
+        (settingsMap[logoutputlevel] < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) ||
+        (settingsMap[logoutputlevel] < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0) ||
+        (settingsMap[logoutputlevel] < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0))
+        return false;
+#endif
+    if (moduleConfig.serial.override_console_serial_port && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0)
+        return false;
+    return true;
+}
+
+void RedirectablePrint::writeLog(const char *logLevel, const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    log_to_serial(logLevel, format, arg);
+    va_end(arg);
+
+    va_start(arg, format);
+    log_to_syslog(logLevel, format, arg);
+    va_end(arg);
+
+    va_start(arg, format);
+    log_to_ble(logLevel, format, arg);
+    va_end(arg);
+}
+
+bool RedirectablePrint::traceToFile;
+
+void RedirectablePrint::logTrace(bool toConsole, const char *format, ...)
+{
 #if ARCH_PORTDUINO
-    // level trace is special, two possible ways to handle it.
-    if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
-        if (settingsStrings[traceFilename] != "") {
-            va_list arg;
-            va_start(arg, format);
-            try {
-                traceFile << va_arg(arg, char *) << std::endl;
-            } catch (const std::ios_base::failure &e) {
-            }
-            va_end(arg);
-        }
-        if (settingsMap[logoutputlevel] < level_trace && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
-            delete[] newFormat;
-            return;
+    if (traceToFile) {
+        va_list arg;
+        va_start(arg, format);
+        try {
+            traceFile << va_arg(arg, char *) << std::endl;
+        } catch (const std::ios_base::failure &e) {
         }
+        va_end(arg);
     }
-    if (settingsMap[logoutputlevel] < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
-        delete[] newFormat;
+#endif
+    if (!toConsole)
         return;
-    } else if (settingsMap[logoutputlevel] < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0) {
-        delete[] newFormat;
+
+    va_list arg;
+    va_start(arg, format);
+    vlog(MESHTASTIC_LOG_LEVEL_TRACE, format, arg);
+    va_end(arg);
+}
+
+void RedirectablePrint::log(const char *logLevel, const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    vlog(logLevel, format, arg);
+    va_end(arg);
+}
+
+void RedirectablePrint::vlog(const char *logLevel, const char *format, va_list arg)
+{
+    if (!wantsLevel(logLevel))
         return;
-    } else if (settingsMap[logoutputlevel] < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0) {
-        delete[] newFormat;
+
+#if LOG_RING_SLOTS
+    if (asyncLog.load(std::memory_order_relaxed)) {
+        LogRing::Record *r = claimRecord(logLevel);
+        if (r) {
+            int len = vsnprintf(r->text, sizeof(r->text) - 1, format, arg);
+            if (len < 0)
+                len = 0;
+            if ((size_t)len > sizeof(r->text) - 2)
+                len = sizeof(r->text) - 2;
+            r->text[len] = '\n';
+            r->text[len + 1] = '\0';
+            logRing.publish(r);
+        }
         return;
     }
 #endif
-    if (moduleConfig.serial.override_console_serial_port && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
-        delete[] newFormat;
-        return;
-    }
+
+    // append \n to format
+    size_t len = strlen(format);
+    char *newFormat = new char[len + 2];
+    strcpy(newFormat, format);
+    newFormat[len] = '\n';
+    newFormat[len + 1] = '\0';
 
 #ifdef HAS_FREE_RTOS
     if (inDebugPrint != nullptr && xSemaphoreTake(inDebugPrint, portMAX_DELAY) == pdTRUE) {
@@ -325,14 +401,18 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
         inDebugPrint = true;
 #endif
 
-        va_list arg;
-        va_start(arg, format);
+        va_list copy;
+        va_copy(copy, arg);
+        log_to_serial(logLevel, newFormat, copy);
+        va_end(copy);
 
-        log_to_serial(logLevel, newFormat, arg);
-        log_to_syslog(logLevel, newFormat, arg);
-        log_to_ble(logLevel, newFormat, arg);
+        va_copy(copy, arg);
+        log_to_syslog(logLevel, newFormat, copy);
+        va_end(copy);
 
-        va_end(arg);
+        va_copy(copy, arg);
+        log_to_ble(logLevel, newFormat, copy);
+        va_end(copy);
 #ifdef HAS_FREE_RTOS
         xSemaphoreGive(inDebugPrint);
 #else
@@ -344,6 +424,96 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
     return;
 }
 
+#if LOG_RING_SLOTS
+
+#define LOG_SINK_BATCH 32         // most lines written out per run, so a burst doesn't hold up the other threads
+#define LOG_SINK_INTERVAL_MSEC 20 // how often we look for lines when the ring was empty
+
+/**
+ * Writes out the lines queued in the console's log ring, on the main thread like everything else that touches the serial port,
+ * syslog or BLE.
+ */
+class LogSink : public concurrency::OSThread
+{
+  public:
+    explicit LogSink(RedirectablePrint *_print) : concurrency::OSThread("LogSink"), print(_print) {}
+
+  protected:
+    int32_t runOnce() override { return print->drainLog(LOG_SINK_BATCH) ? 0 : LOG_SINK_INTERVAL_MSEC; }
+
+  private:
+    RedirectablePrint *print;
+};
+
+void RedirectablePrint::startAsyncLog()
+{
+    if (asyncLog)
+        return;
+    new LogSink(this);
+    asyncLog = true;
+}
+
+LogRing::Record *RedirectablePrint::claimRecord(const char *logLevel)
+{
+    LogRing::Record *r = logRing.claim();
+    if (!r)
+        return nullptr;
+
+    r->level = logLevel;
+    r->format = nullptr;
+    r->numArgs = 0;
+    r->millis = millis();
+    r->rtcSec = getValidTime(RTCQuality::RTCQualityDevice, true);
+    auto thread = concurrency::OSThread::currentThread;
+    if (thread) {
+        strncpy(r->thread, thread->ThreadName.c_str(), sizeof(r->thread) - 1);
+        r->thread[sizeof(r->thread) - 1] = '\0';
+    } else {
+        r->thread[0] = '\0';
+    }
+    return r;
+}
+
+void RedirectablePrint::logBinary(const char *logLevel, const char *format, uint8_t numArgs, const uint32_t *args)
+{
+    if (!wantsLevel(logLevel))
+        return;
+
+    LogRing::Record *r = claimRecord(logLevel);
+    if (!r)
+        return;
+    r->format = format;
+    r->numArgs = numArgs;
+    for (uint8_t i = 0; i < LogRing::maxArgs; i++)
+        r->args[i] = i < numArgs ? args[i] : 0;
+    logRing.publish(r);
+}
+
+bool RedirectablePrint::drainLog(size_t maxRecords)
+{
+    static char line[LOG_RING_TEXT_SIZE];
+
+    uint32_t dropped = logRing.numDropped();
+    if (dropped != reportedDropped) {
+        writeLog(MESHTASTIC_LOG_LEVEL_WARN, "Log ring full, dropped %u lines\n", dropped - reportedDropped);
+        reportedDropped = dropped;
+    }
+
+    for (size_t n = 0; n < maxRecords; n++) {
+        const LogRing::Record *r = logRing.front();
+        if (!r)
+            return false;
+        LogRing::format(*r, line, sizeof(line));
+        draining = r;
+        writeLog(r->level, "%s", line);
+        draining = nullptr;
+        logRing.pop();
+    }
+    return logRing.front() != nullptr;
+}
+
+#endif
+
 void RedirectablePrint::hexDump(const char *logLevel, unsigned char *buf, uint16_t len)
 {
     const char alphabet[17] = "0123456789abcdef";
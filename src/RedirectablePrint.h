@@ -1,10 +1,12 @@
 #pragma once
 
 #include "../freertosinc.h"
+#include "LogRing.h"
 #include "mesh/generated/meshtastic/mesh.pb.h"
 #include <Print.h>
 #include <stdarg.h>
 #include <string>
+#include <type_traits>
 
 /**
  * A Printable that can be switched to squirt its bytes to a different sink.
@@ -21,6 +23,14 @@ class RedirectablePrint : public Print
 #else
     volatile bool inDebugPrint = false;
 #endif
+
+#if LOG_RING_SLOTS
+    LogRing logRing;
+    std::atomic<bool> asyncLog = {false};
+    const LogRing::Record *draining = nullptr; // the record being written out by drainLog()
+    uint32_t reportedDropped = 0;
+#endif
+
   public:
     explicit RedirectablePrint(Print *_dest) : dest(_dest) {}
 
@@ -41,6 +51,45 @@ class RedirectablePrint : public Print
      */
     void log(const char *logLevel, const char *format, ...) __attribute__((format(printf, 3, 4)));
 
+    /// log() for trace lines, which also go to the trace file if there is one.  toConsole false for the trace file only
+    void logTrace(bool toConsole, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+    /// Set when trace lines are also written to a file (native only), LOG_TRACE has to be called then whatever the log level
+    static bool traceToFile;
+
+    /**
+     * Like log(), for hot paths: the arguments must be integers of at most 32 bits and format a string literal.  With the log
+     * ring they are stored as they are and only formatted when the line is written out.
+     */
+    template <typename... Args> void logDeferred(const char *logLevel, const char *format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= 6, "too many arguments for a deferred log record");
+#if LOG_RING_SLOTS
+        if (asyncLog.load(std::memory_order_relaxed)) {
+            const uint32_t a[sizeof...(Args) + 1] = {logArg(args)...};
+            logBinary(logLevel, format, sizeof...(Args), a);
+            return;
+        }
+#endif
+        log(logLevel, format, logArg(args)...);
+    }
+
+#if LOG_RING_SLOTS
+    /**
+     * From now on queue log lines in our ring and write them out from the LogSink thread, rather than in the caller.  Call once
+     * the main loop is about to run, until then nothing would drain the ring.
+     */
+    void startAsyncLog();
+
+    /// Write out up to maxRecords queued lines, on the main thread.  @return true if there are more
+    bool drainLog(size_t maxRecords);
+
+    const LogRing &getLogRing() const { return logRing; }
+#endif
+
+    /// log() with a va_list
+    void vlog(const char *logLevel, const char *format, va_list arg);
+
     /** like printf but va_list based */
     size_t vprintf(const char *logLevel, const char *format, va_list arg);
 
@@ -53,7 +102,30 @@ class RedirectablePrint : public Print
     virtual void log_to_serial(const char *logLevel, const char *format, va_list arg);
     meshtastic_LogRecord_Level getLogLevel(const char *logLevel);
 
+    /// The thread, RTC time and millis() of the line being written out, which with the log ring isn't necessarily now
+    const char *logThreadName();
+    uint32_t logRtcSec();
+    uint32_t logMillis();
+
   private:
+    /// Check the level against the configured output level.  @return false if the line should be dropped
+    bool wantsLevel(const char *logLevel);
+
+    /// Send one line to the serial port, syslog and BLE
+    void writeLog(const char *logLevel, const char *format, ...);
+
+    template <typename T> static uint32_t logArg(T v)
+    {
+        static_assert((std::is_integral<T>::value || std::is_enum<T>::value) && sizeof(T) <= sizeof(uint32_t),
+                      "deferred log arguments must be integers of at most 32 bits");
+        return (uint32_t)v;
+    }
+
+#if LOG_RING_SLOTS
+    void logBinary(const char *logLevel, const char *format, uint8_t numArgs, const uint32_t *args);
+    LogRing::Record *claimRecord(const char *logLevel);
+#endif
+
     void log_to_syslog(const char *logLevel, const char *format, va_list arg);
     void log_to_ble(const char *logLevel, const char *format, va_list arg);
 };
\ No newline at end of file
@@ -15,13 +15,32 @@ BinarySemaphorePosix::~BinarySemaphorePosix() {}
  */
 bool BinarySemaphorePosix::take(uint32_t msec)
 {
+#ifdef ARCH_PORTDUINO
+    std::unique_lock<std::mutex> guard(lock);
+    bool taken = cond.wait_for(guard, std::chrono::milliseconds(msec), [this] { return given; });
+    given = false;
+    return taken;
+#else
     delay(msec); // FIXME
     return false;
+#endif
 }
 
-void BinarySemaphorePosix::give() {}
+void BinarySemaphorePosix::give()
+{
+#ifdef ARCH_PORTDUINO
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        given = true;
+    }
+    cond.notify_one();
+#endif
+}
 
-IRAM_ATTR void BinarySemaphorePosix::giveFromISR(BaseType_t *pxHigherPriorityTaskWoken) {}
+IRAM_ATTR void BinarySemaphorePosix::giveFromISR(BaseType_t *pxHigherPriorityTaskWoken)
+{
+    give();
+}
 
 } // namespace concurrency
 
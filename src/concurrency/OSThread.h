@@ -1,16 +1,17 @@
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <stdint.h>
 
 #include "Thread.h"
-#include "ThreadController.h"
 #include "concurrency/InterruptableDelay.h"
+#include "concurrency/Scheduler.h"
 
 namespace concurrency
 {
 
-extern ThreadController mainController, timerController;
+extern Scheduler mainController, timerController;
 extern InterruptableDelay mainDelay;
 
 #define RUN_SAME -1
@@ -30,7 +31,28 @@ extern InterruptableDelay mainDelay;
  */
 class OSThread : public Thread
 {
-    ThreadController *controller;
+  public:
+    /// How long runOnce() takes and how far behind its deadline we got to it, kept by the Scheduler
+    struct Stats {
+        uint32_t runs;
+        uint64_t runMicros;
+        uint32_t maxRunMicros;
+        uint64_t lateMsecs;
+        uint32_t maxLateMsecs;
+    };
+
+  private:
+    friend class Scheduler;
+
+    Scheduler *controller;
+
+    // Bookkeeping for our Scheduler
+    int64_t deadline = 0;    // when we are next due, in the scheduler's 64 bit clock
+    int16_t schedIndex = -1; // our index in the heap (or the parked list)
+    bool parked = false;     // on the parked list because we were disabled
+    std::atomic<bool> rescheduled = {false};
+    OSThread *nextRescheduled = nullptr;
+    Stats stats = {};
 
     /// Show debugging info for disabled threads
     static bool showDisabled;
@@ -45,7 +67,7 @@ class OSThread : public Thread
     /// For debug printing only (might be null)
     static const OSThread *currentThread;
 
-    OSThread(const char *name, uint32_t period = 0, ThreadController *controller = &mainController);
+    OSThread(const char *name, uint32_t period = 0, Scheduler *controller = &mainController);
 
     virtual ~OSThread();
 
@@ -55,11 +77,16 @@ class OSThread : public Thread
 
     virtual int32_t disable();
 
+    /// Like Thread::setInterval, but also tells our Scheduler that the deadline moved
+    virtual void setInterval(unsigned long _interval) override;
+
     /**
      * Wait a specified number msecs starting from the current time (rather than the last time we were run)
      */
     void setIntervalFromNow(unsigned long _interval);
 
+    const Stats &getStats() const { return stats; }
+
   protected:
     /**
      * The method that will be called each time our thread gets a chance to run
@@ -0,0 +1,244 @@
+#include "Scheduler.h"
+#include "OSThread.h"
+#include "configuration.h"
+#include <assert.h>
+
+namespace concurrency
+{
+
+bool Scheduler::add(OSThread *t)
+{
+    if (!ThreadController::add(t))
+        return false;
+
+    updateClock();
+    update(t);
+    return true;
+}
+
+void Scheduler::remove(OSThread *t)
+{
+    ThreadController::remove(t);
+
+    // Don't leave a dangling pointer on the rescheduled list
+    drainRescheduled();
+
+    if (t->parked)
+        unpark(t);
+    else if (t->schedIndex >= 0)
+        heapRemove(t->schedIndex);
+
+    for (OSThread *&d : due)
+        if (d == t)
+            d = nullptr;
+}
+
+IRAM_ATTR void Scheduler::reschedule(OSThread *t)
+{
+    if (t->rescheduled.exchange(true))
+        return; // already queued, the next pass reads its latest deadline anyway
+
+    OSThread *head = rescheduled.load();
+    do {
+        t->nextRescheduled = head;
+    } while (!rescheduled.compare_exchange_weak(head, t));
+}
+
+void Scheduler::drainRescheduled()
+{
+    // Only we take things off the list and we take all of it at once, so there is no ABA problem
+    OSThread *t = rescheduled.exchange(nullptr);
+    while (t) {
+        OSThread *next = t->nextRescheduled;
+        t->rescheduled = false; // before reading the deadline, so a change after this queues it again
+        update(t);
+        t = next;
+    }
+}
+
+void Scheduler::updateClock()
+{
+    uint32_t ms = millis();
+    now += (uint32_t)(ms - lastMillis);
+    lastMillis = ms;
+}
+
+/**
+ * Move a thread to where its current interval and enabled flag say it belongs
+ */
+void Scheduler::update(OSThread *t)
+{
+    if (!t->enabled) {
+        if (!t->parked) {
+            if (t->schedIndex >= 0)
+                heapRemove(t->schedIndex);
+            park(t);
+        }
+        return;
+    }
+
+    // Same sign test as Thread::shouldRun, a deadline more than INT32_MAX msecs ahead counts as already passed
+    t->deadline = now + (int32_t)(t->_cached_next_run - lastMillis);
+
+    if (t->parked)
+        unpark(t);
+    if (t->schedIndex < 0) {
+        heap.push_back(t);
+        heapSet(heap.size() - 1, t);
+        heapSiftUp(t->schedIndex);
+    } else {
+        heapSiftUp(t->schedIndex);
+        heapSiftDown(t->schedIndex);
+    }
+}
+
+int32_t Scheduler::runOrDelay()
+{
+    updateClock();
+    drainRescheduled();
+
+    // Pick up threads that were re-enabled by writing Thread::enabled directly
+    for (size_t i = 0; i < parked.size();) {
+        if (parked[i]->enabled)
+            update(parked[i]); // swaps something else into slot i
+        else
+            i++;
+    }
+
+    // Take everything that is due off the heap first, so a thread that keeps asking to run again right away can't starve the
+    // others (or the rest of loop())
+    due.clear();
+    while (!heap.empty() && heap[0]->deadline <= now) {
+        OSThread *t = heap[0];
+        heapRemove(0);
+        due.push_back(t);
+    }
+
+    for (size_t i = 0; i < due.size(); i++) {
+        OSThread *t = due[i];
+        if (!t)
+            continue; // deleted by a thread that ran before it
+
+        if (t->shouldRun(lastMillis)) {
+            uint32_t late = now - t->deadline;
+            uint32_t start = micros();
+            t->run();
+            if (!due[i])
+                continue; // it deleted itself
+
+            uint32_t took = micros() - start;
+            OSThread::Stats &s = t->stats;
+            s.runs++;
+            s.runMicros += took;
+            s.lateMsecs += late;
+            if (took > s.maxRunMicros)
+                s.maxRunMicros = took;
+            if (late > s.maxLateMsecs)
+                s.maxLateMsecs = late;
+        }
+        updateClock();
+        drainRescheduled();
+        update(t);
+    }
+    due.clear();
+
+    updateClock();
+    drainRescheduled();
+    while (!heap.empty() && !heap[0]->enabled) {
+        OSThread *t = heap[0];
+        heapRemove(0);
+        park(t);
+    }
+    if (heap.empty())
+        return INT32_MAX;
+
+    int64_t delay = heap[0]->deadline - now;
+    return delay <= 0 ? 0 : delay >= INT32_MAX ? INT32_MAX : (int32_t)delay;
+}
+
+void Scheduler::logStats()
+{
+    for (OSThread *t : heap) {
+        const OSThread::Stats &s = t->stats;
+        if (s.runs)
+            LOG_DEBUG("Thread %s: %u runs, avg %u us (max %u), avg %u ms late (max %u)", t->ThreadName.c_str(), s.runs,
+                      (uint32_t)(s.runMicros / s.runs), s.maxRunMicros, (uint32_t)(s.lateMsecs / s.runs), s.maxLateMsecs);
+    }
+    for (OSThread *t : parked) {
+        const OSThread::Stats &s = t->stats;
+        if (s.runs)
+            LOG_DEBUG("Thread %s (disabled): %u runs, avg %u us (max %u), avg %u ms late (max %u)", t->ThreadName.c_str(),
+                      s.runs, (uint32_t)(s.runMicros / s.runs), s.maxRunMicros, (uint32_t)(s.lateMsecs / s.runs),
+                      s.maxLateMsecs);
+    }
+}
+
+void Scheduler::heapSet(size_t i, OSThread *t)
+{
+    heap[i] = t;
+    t->schedIndex = i;
+}
+
+void Scheduler::heapSiftUp(size_t i)
+{
+    OSThread *t = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent]->deadline <= t->deadline)
+            break;
+        heapSet(i, heap[parent]);
+        i = parent;
+    }
+    heapSet(i, t);
+}
+
+void Scheduler::heapSiftDown(size_t i)
+{
+    OSThread *t = heap[i];
+    size_t n = heap.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && heap[child + 1]->deadline < heap[child]->deadline)
+            child++;
+        if (t->deadline <= heap[child]->deadline)
+            break;
+        heapSet(i, heap[child]);
+        i = child;
+    }
+    heapSet(i, t);
+}
+
+void Scheduler::heapRemove(size_t i)
+{
+    OSThread *t = heap[i];
+    OSThread *last = heap.back();
+    heap.pop_back();
+    t->schedIndex = -1;
+    if (t != last) {
+        heapSet(i, last);
+        heapSiftUp(i);
+        heapSiftDown(last->schedIndex);
+    }
+}
+
+void Scheduler::park(OSThread *t)
+{
+    assert(t->schedIndex < 0);
+    t->parked = true;
+    t->schedIndex = parked.size();
+    parked.push_back(t);
+}
+
+void Scheduler::unpark(OSThread *t)
+{
+    OSThread *last = parked.back();
+    parked[t->schedIndex] = last;
+    last->schedIndex = t->schedIndex;
+    parked.pop_back();
+    t->parked = false;
+    t->schedIndex = -1;
+}
+
+} // namespace concurrency
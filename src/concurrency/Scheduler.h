@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+#include "ThreadController.h"
+
+namespace concurrency
+{
+
+class OSThread;
+
+/**
+ * Runs OSThreads in deadline order.
+ *
+ * Plain ThreadController asks every thread whether it should run on each pass of the main loop, then walks them all again to
+ * find out how long we may sleep.  Here enabled threads live in a binary min-heap keyed by their next run time, so a pass only
+ * touches the threads that are actually due, a change of interval repositions one thread in O(log n), and the sleep time is read
+ * off the top of the heap.  Threads are still added to the ThreadController base so code that enumerates them keeps working.
+ * ThreadController::add/remove/run aren't virtual, so the base is protected: a thread can only be registered through our add and
+ * remove, which keep the heap in step, and only get() and size() are passed through.
+ *
+ * Interval changes reach us through OSThread::setInterval(), which NotifiedWorkerThread calls from ISRs, so all it does is push
+ * the thread on a lock-free list that the next pass drains.  Some code also writes Thread::enabled directly: a disabled thread is
+ * parked when it reaches the top of the heap, and parked threads are checked for being re-enabled on every pass (one bool read
+ * each).
+ */
+class Scheduler : protected ThreadController
+{
+  public:
+    using ThreadController::get;
+    using ThreadController::size;
+    using ThreadController::ThreadName;
+
+    bool add(OSThread *thread);
+    void remove(OSThread *thread);
+
+    /**
+     * Run every thread that is due
+     * @return msecs until the next thread is due, INT32_MAX if none are enabled
+     */
+    int32_t runOrDelay();
+
+    /// Note that a thread's interval or enabled flag changed.  Safe to call from an ISR.
+    void reschedule(OSThread *thread);
+
+    /// Log how long each thread takes to run and how late it was started
+    void logStats();
+
+  private:
+    std::vector<OSThread *> heap;   // enabled threads, earliest deadline at the front
+    std::vector<OSThread *> parked; // threads that were disabled last time we looked
+    std::vector<OSThread *> due;    // threads being run by the current pass
+    std::atomic<OSThread *> rescheduled = {nullptr};
+
+    uint32_t lastMillis = 0;
+    int64_t now = 0; // millis() widened to 64 bits, so deadlines never wrap
+
+    void updateClock();
+    void drainRescheduled();
+    void update(OSThread *t);
+
+    void heapSet(size_t i, OSThread *t);
+    void heapSiftUp(size_t i);
+    void heapSiftDown(size_t i);
+    void heapRemove(size_t i);
+    void park(OSThread *t);
+    void unpark(OSThread *t);
+};
+
+} // namespace concurrency
@@ -0,0 +1,141 @@
+#include "GlyphCache.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+
+// Layout of an OLEDDisplay font: a header, then a jump table of 4 bytes per character, then the glyph data
+static const uint8_t FONT_HEIGHT = 1;
+static const uint8_t FONT_FIRST_CHAR = 2;
+static const uint8_t FONT_CHAR_NUM = 3;
+static const uint8_t FONT_JUMPTABLE = 4;
+
+uint16_t GlyphCache::rasterize(const uint8_t *font, const char *text, std::vector<uint8_t> &bitmap)
+{
+    uint8_t height = pgm_read_byte(font + FONT_HEIGHT);
+    uint8_t firstChar = pgm_read_byte(font + FONT_FIRST_CHAR);
+    uint8_t numChars = pgm_read_byte(font + FONT_CHAR_NUM);
+    const uint8_t *glyphs = font + FONT_JUMPTABLE + numChars * 4;
+    uint8_t rasterHeight = (height + 7) / 8;
+
+    // Only what drawString would draw the same way without its UTF-8 lookup, and what has a width to add up
+    uint32_t width = 0;
+    for (const char *c = text; *c; c++) {
+        uint8_t code = *c;
+        if (code >= 0x80 || code < firstChar || code - firstChar >= numChars)
+            return 0;
+        width += pgm_read_byte(font + FONT_JUMPTABLE + (code - firstChar) * 4 + 3);
+    }
+    if (!width || width > UINT16_MAX)
+        return 0;
+
+    bitmap.assign(width * rasterHeight, 0);
+    uint8_t *column = bitmap.data();
+    for (const char *c = text; *c; c++) {
+        const uint8_t *jump = font + FONT_JUMPTABLE + ((uint8_t)*c - firstChar) * 4;
+        uint8_t msb = pgm_read_byte(jump), lsb = pgm_read_byte(jump + 1);
+        uint8_t size = pgm_read_byte(jump + 2), charWidth = pgm_read_byte(jump + 3);
+
+        // A glyph's bytes are already laid out column by column, trailing blank columns left off
+        if (!(msb == 0xFF && lsb == 0xFF)) {
+            const uint8_t *data = glyphs + ((msb << 8) | lsb);
+            for (uint8_t i = 0; i < size && i < charWidth * rasterHeight; i++)
+                column[i] = pgm_read_byte(data + i);
+        }
+        column += charWidth * rasterHeight;
+    }
+    return width;
+}
+
+void GlyphCache::findRuns(const std::vector<uint8_t> &bitmap, uint16_t width, std::vector<Run> &runs)
+{
+    size_t columnBytes = bitmap.size() / width;
+    runs.clear();
+
+    int32_t lastUsed = -1 - MIN_GAP; // column
+    for (uint16_t x = 0; x < width; x++) {
+        const uint8_t *column = &bitmap[x * columnBytes];
+        bool blank = true;
+        for (size_t i = 0; i < columnBytes; i++)
+            blank &= !column[i];
+        if (blank)
+            continue;
+
+        if (x - lastUsed > MIN_GAP)
+            runs.push_back({x, 1});
+        else
+            runs.back().width = x - runs.back().left + 1;
+        lastUsed = x;
+    }
+}
+
+bool GlyphCache::get(const uint8_t *font, const char *text, Bitmap &out)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const char *c = text; *c; c++)
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+
+    Entry *found = nullptr;
+    for (Entry &e : entries) {
+        if (e.hash == hash && e.font == font && e.text == text) {
+            found = &e;
+            break;
+        }
+    }
+
+    if (found) {
+        hits++;
+    } else {
+        Entry e;
+        e.width = rasterize(font, text, e.bitmap);
+        if (!e.width)
+            return false;
+        findRuns(e.bitmap, e.width, e.runs);
+        if (e.size() > maxBytes)
+            return false;
+        misses++;
+
+        evictFor(e.size());
+        e.font = font;
+        e.hash = hash;
+        e.text = text;
+        bytes += e.size();
+        entries.push_back(std::move(e));
+        found = &entries.back();
+    }
+
+    found->lastUsed = ++useCount;
+    out.data = found->bitmap.data();
+    out.width = found->width;
+    out.height = pgm_read_byte(font + FONT_HEIGHT);
+    out.columnBytes = found->bitmap.size() / found->width;
+    out.runs = found->runs.data();
+    out.numRuns = found->runs.size();
+    return true;
+}
+
+/// Drop the least recently used strings until needed more bytes fit
+void GlyphCache::evictFor(size_t needed)
+{
+    while (!entries.empty() && bytes + needed > maxBytes) {
+        size_t oldest = 0;
+        for (size_t i = 1; i < entries.size(); i++) {
+            if ((int32_t)(entries[i].lastUsed - entries[oldest].lastUsed) < 0)
+                oldest = i;
+        }
+        bytes -= entries[oldest].size();
+        if (oldest != entries.size() - 1)
+            entries[oldest] = std::move(entries.back());
+        entries.pop_back();
+    }
+}
+
+void GlyphCache::clear()
+{
+    entries.clear();
+    bytes = 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Whole strings, pre-rasterized from an OLEDDisplay font, so a frame that draws the same text tick after tick can blit it with a
+ * drawFastImage or two instead of looking up and drawing every glyph again.
+ *
+ * A string's bitmap is laid out like the glyphs in the font: column by column, each column (height + 7) / 8 bytes with bit 0 at
+ * the top.  Glyphs sit side by side, so drawing the bitmap at the string's position changes the same pixels as drawString,
+ * whatever the color.  Only the runs of columns with something in them are drawn: spaces and the gaps at either end would
+ * otherwise cost as much to draw as the glyphs.  Least recently used strings are dropped to stay within a byte budget.
+ */
+class GlyphCache
+{
+  public:
+    static const uint8_t MIN_GAP = 3; // blank columns worth skipping rather than drawing through
+
+    struct Run {
+        uint16_t left; // in columns from the start of the string
+        uint16_t width;
+    };
+
+    /// Valid until the next get()
+    struct Bitmap {
+        const uint8_t *data;
+        uint16_t width;
+        uint8_t height;
+        uint8_t columnBytes;
+        const Run *runs;
+        size_t numRuns;
+
+        const uint8_t *column(uint16_t x) const { return data + x * columnBytes; }
+    };
+
+    explicit GlyphCache(size_t maxBytes) : maxBytes(maxBytes) {}
+
+    /**
+     * Find or rasterize text
+     * @return false if text can't be cached: empty, more than one line, or a character outside ASCII or the font.  Draw it
+     * with drawString instead, which knows about UTF-8.
+     */
+    bool get(const uint8_t *font, const char *text, Bitmap &out);
+
+    /// Draw text into bitmap, @return its width in pixels, or 0 if it can't be cached
+    static uint16_t rasterize(const uint8_t *font, const char *text, std::vector<uint8_t> &bitmap);
+
+    /// Find the runs of columns which aren't blank
+    static void findRuns(const std::vector<uint8_t> &bitmap, uint16_t width, std::vector<Run> &runs);
+
+    void clear();
+
+    size_t numBytes() const { return bytes; }
+    uint32_t numHits() const { return hits; }
+    uint32_t numMisses() const { return misses; }
+
+  private:
+    struct Entry {
+        const uint8_t *font;
+        uint32_t hash;
+        std::string text;
+        uint16_t width;
+        std::vector<uint8_t> bitmap;
+        std::vector<Run> runs;
+        uint32_t lastUsed;
+
+        size_t size() const { return bitmap.size() + runs.size() * sizeof(Run); }
+    };
+    std::vector<Entry> entries;
+    size_t maxBytes;
+    size_t bytes = 0; // of all the entries' bitmaps and runs
+    uint32_t useCount = 0;
+    uint32_t hits = 0, misses = 0;
+
+    void evictFor(size_t needed);
+};
@@ -0,0 +1,91 @@
+#include "PageBufferDiff.h"
+#include <string.h>
+
+PageBufferDiff::PageBufferDiff(uint16_t width, uint16_t height) : w(width), h(height), diff(width), lines(2 * width) {}
+
+/// Fill diff for one page, @return false if nothing in it changed
+bool PageBufferDiff::diffPage(const uint8_t *page, const uint8_t *backPage, bool fromBlank, uint16_t &minX, uint16_t &maxX,
+                              uint8_t &rows)
+{
+    static const uint8_t blank[4] = {0};
+    bool changed = false;
+    rows = 0;
+
+    uint16_t x = 0;
+    for (; x + 4 <= w; x += 4) {
+        uint32_t a, b;
+        memcpy(&a, page + x, 4); // the buffer has no particular alignment
+        memcpy(&b, fromBlank ? blank : backPage + x, 4);
+        if (a == b) {
+            memset(&diff[x], 0, 4);
+            continue;
+        }
+        for (uint16_t i = x; i < x + 4; i++) {
+            diff[i] = page[i] ^ (fromBlank ? 0 : backPage[i]);
+            if (diff[i]) {
+                if (!changed)
+                    minX = i;
+                maxX = i;
+                changed = true;
+                rows |= diff[i];
+            }
+        }
+    }
+    for (; x < w; x++) {
+        diff[x] = page[x] ^ (fromBlank ? 0 : backPage[x]);
+        if (diff[x]) {
+            if (!changed)
+                minX = x;
+            maxX = x;
+            changed = true;
+            rows |= diff[x];
+        }
+    }
+    return changed;
+}
+
+uint32_t PageBufferDiff::update(const uint8_t *buffer, uint8_t *back, bool fromBlank, uint16_t onColor, uint16_t offColor,
+                                const PushSpan &push)
+{
+    uint32_t pushed = 0;
+
+    for (uint16_t p = 0; p * 8 < h; p++) {
+        const uint8_t *page = buffer + p * w;
+        uint8_t *backPage = back + p * w;
+        uint16_t minX, maxX;
+        uint8_t rows;
+        if (fromBlank)
+            memcpy(backPage, page, w); // back can differ anywhere, not just where the page is lit
+        if (!diffPage(page, backPage, fromBlank, minX, maxX, rows))
+            continue;
+
+        for (uint8_t bit = 0; bit < 8 && p * 8 + bit < h; bit++) {
+            uint8_t mask = 1 << bit;
+            if (!(rows & mask))
+                continue;
+
+            uint16_t x = minX;
+            while (x <= maxX) {
+                if (!(diff[x] & mask)) {
+                    x++;
+                    continue;
+                }
+                uint16_t start = x, end = x;
+                for (x++; x <= maxX && x - end - 1 <= MAX_GAP; x++) {
+                    if (diff[x] & mask)
+                        end = x;
+                }
+
+                uint16_t *line = &lines[nextLine ? w : 0];
+                nextLine = !nextLine;
+                for (uint16_t i = start; i <= end; i++)
+                    line[i - start] = (page[i] & mask) ? onColor : offColor;
+                push(start, p * 8 + bit, end - start + 1, line);
+                pushed += end - start + 1;
+            }
+        }
+        if (!fromBlank)
+            memcpy(backPage + minX, page + minX, maxX - minX + 1);
+    }
+    return pushed;
+}
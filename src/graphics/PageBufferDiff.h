@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Finds what changed between two frames of the 1 bit buffer OLEDDisplay draws into, and turns it into horizontal spans of RGB565
+ * pixels for a TFT.  Starting a span costs an address window, so spans are only split by more than MAX_GAP unchanged pixels.
+ *
+ * The buffer is page ordered: each byte is 8 pixels of a column, bit 0 at the top, and a page of width bytes covers 8 rows.
+ * Pages are compared a word at a time, and only rows and columns within what changed are looked at.
+ */
+class PageBufferDiff
+{
+  public:
+    static const uint16_t MAX_GAP = 8; // unchanged pixels worth sending rather than starting another span
+
+    /// pixels stay untouched until the call after next, so a span can be sent by DMA while the next one is filled in
+    typedef std::function<void(uint16_t x, uint16_t y, uint16_t width, const uint16_t *pixels)> PushSpan;
+
+    PageBufferDiff(uint16_t width, uint16_t height);
+
+    uint16_t width() const { return w; }
+    uint16_t height() const { return h; }
+
+    /**
+     * Push every span of buffer that differs from back, then bring back up to date
+     * @param fromBlank compare with a blank (all off) screen instead of back
+     * @return the number of pixels pushed
+     */
+    uint32_t update(const uint8_t *buffer, uint8_t *back, bool fromBlank, uint16_t onColor, uint16_t offColor,
+                    const PushSpan &push);
+
+  private:
+    uint16_t w, h;
+    std::vector<uint8_t> diff;    // changed bits of the page being looked at, by column
+    std::vector<uint16_t> lines;  // two lines of pixels, used in turn
+    bool nextLine = false;
+
+    bool diffPage(const uint8_t *page, const uint8_t *backPage, bool fromBlank, uint16_t &minX, uint16_t &maxX, uint8_t &rows);
+};
@@ -38,6 +38,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "error.h"
 #include "gps/GeoCoord.h"
 #include "gps/RTC.h"
+#include "graphics/GlyphCache.h"
 #include "graphics/ScreenFonts.h"
 #include "graphics/images.h"
 #include "graphics/SecretMenuImage.h"
@@ -91,6 +92,16 @@ namespace graphics
 // if defined a pixel will blink to show redraws
 // #define SHOW_REDRAWS
 
+// Log how long each frame callback takes to draw, once a minute
+#ifndef SCREEN_FRAME_TIMINGS
+#define SCREEN_FRAME_TIMINGS 0
+#endif
+
+// Memory for pre-rasterized strings, 0 to draw every string glyph by glyph
+#ifndef SCREEN_GLYPH_CACHE_BYTES
+#define SCREEN_GLYPH_CACHE_BYTES 2048
+#endif
+
 // A text message frame + debug frame + all the node infos
 FrameCallback *normalFrames;
 static uint32_t targetFramerate = IDLE_FRAMERATE;
@@ -117,6 +128,94 @@ std::vector<std::string> functionSymbol;
 // string displayed in bottom right corner of display. Created from elements in functionSymbol vector
 std::string functionSymbolString = "";
 
+#if SCREEN_GLYPH_CACHE_BYTES
+static GlyphCache glyphCache(SCREEN_GLYPH_CACHE_BYTES);
+#endif
+
+/// drawString for left aligned text which is usually the same as last tick: the string is drawn from a cached copy
+/// font must be the one the display is set to (OLEDDisplay can't tell us), it is what drawString falls back to
+static void drawCachedString(OLEDDisplay *display, int16_t x, int16_t y, const char *text, const uint8_t *font)
+{
+#if SCREEN_GLYPH_CACHE_BYTES
+    GlyphCache::Bitmap b;
+    if (glyphCache.get(font, text, b)) {
+        for (size_t i = 0; i < b.numRuns; i++) {
+            const GlyphCache::Run &r = b.runs[i];
+            display->drawFastImage(x + r.left, y, r.width, b.height, b.column(r.left));
+        }
+        return;
+    }
+#endif
+    display->drawString(x, y, text);
+}
+
+#if SCREEN_FRAME_TIMINGS
+// Time spent in each frame callback (or module, for module frames) since last logged
+struct FrameTiming {
+    const void *callback;
+    const char *name;
+    uint32_t draws;
+    uint32_t totalMicros;
+    uint32_t maxMicros;
+};
+static std::vector<FrameTiming> frameTimings;
+static uint32_t lastFrameTimingsLog = 0;
+
+static FrameTiming &getFrameTiming(const void *callback, const char *name)
+{
+    for (FrameTiming &t : frameTimings) {
+        if (t.callback == callback)
+            return t;
+    }
+    frameTimings.push_back({callback, name, 0, 0, 0});
+    return frameTimings.back();
+}
+
+static void addFrameTiming(const void *callback, const char *name, uint32_t took)
+{
+    FrameTiming &t = getFrameTiming(callback, name);
+    t.draws++;
+    t.totalMicros += took;
+    if (took > t.maxMicros)
+        t.maxMicros = took;
+}
+
+static void logFrameTimings()
+{
+    if (Throttle::isWithinTimespanMs(lastFrameTimingsLog, 60 * 1000))
+        return;
+    lastFrameTimingsLog = millis();
+
+    for (FrameTiming &t : frameTimings) {
+        if (t.draws)
+            LOG_DEBUG("Frame %s: %u draws, avg %u us (max %u)", t.name, t.draws, t.totalMicros / t.draws, t.maxMicros);
+        t.draws = t.totalMicros = t.maxMicros = 0;
+    }
+#if SCREEN_GLYPH_CACHE_BYTES
+    LOG_DEBUG("Glyph cache: %u hits, %u misses, %u bytes", glyphCache.numHits(), glyphCache.numMisses(),
+              (uint32_t)glyphCache.numBytes());
+#endif
+}
+
+template <FrameCallback draw> static void timedFrame(OLEDDisplay *display, OLEDDisplayUiState *state, int16_t x, int16_t y)
+{
+    uint32_t start = micros();
+    draw(display, state, x, y);
+    addFrameTiming((const void *)draw, "?", micros() - start);
+}
+
+template <FrameCallback draw> static FrameCallback timed(const char *name)
+{
+    getFrameTiming((const void *)draw, name);
+    return timedFrame<draw>;
+}
+
+// A frame callback which times itself, named after the one it wraps
+#define TIMED_FRAME(f) timed<f>(#f)
+#else
+#define TIMED_FRAME(f) (f)
+#endif
+
 #if HAS_SCREEN
 namespace
 {
@@ -543,7 +642,13 @@ static void drawModuleFrame(OLEDDisplay *display, OLEDDisplayUiState *state, int
     }
     // LOG_DEBUG("Draw Module Frame %d", module_frame);
     MeshModule &pi = *moduleFrames.at(module_frame);
+#if SCREEN_FRAME_TIMINGS
+    uint32_t start = micros();
+    pi.drawFrame(display, state, x, y);
+    addFrameTiming(&pi, pi.name, micros() - start);
+#else
     pi.drawFrame(display, state, x, y);
+#endif
 }
 
 static void drawFrameFirmware(OLEDDisplay *display, OLEDDisplayUiState *state, int16_t x, int16_t y)
@@ -1194,20 +1299,20 @@ static void drawTextMessageFrame(OLEDDisplay *display, OLEDDisplayUiState *state
     for (uint8_t xOff = 0; xOff <= (config.display.heading_bold ? 1 : 0); xOff++) {
         // Show a timestamp if received today, but longer than 15 minutes ago
         if (useTimestamp && minutes >= 15 && daysAgo == 0) {
-            display->drawStringf(xOff + x, 0 + y, tempBuf, "At %02hu:%02hu from %s", timestampHours, timestampMinutes,
-                                 (node && node->has_user) ? node->user.short_name : "???");
+            snprintf(tempBuf, sizeof(tempBuf), "At %02hu:%02hu from %s", timestampHours, timestampMinutes,
+                     (node && node->has_user) ? node->user.short_name : "???");
         }
         // Timestamp yesterday (if display is wide enough)
         else if (useTimestamp && daysAgo == 1 && display->width() >= 200) {
-            display->drawStringf(xOff + x, 0 + y, tempBuf, "Yesterday %02hu:%02hu from %s", timestampHours, timestampMinutes,
-                                 (node && node->has_user) ? node->user.short_name : "???");
+            snprintf(tempBuf, sizeof(tempBuf), "Yesterday %02hu:%02hu from %s", timestampHours, timestampMinutes,
+                     (node && node->has_user) ? node->user.short_name : "???");
         }
         // Otherwise, show a time delta
         else {
-            display->drawStringf(xOff + x, 0 + y, tempBuf, "%s ago from %s",
-                                 screen->drawTimeDelta(days, hours, minutes, seconds).c_str(),
-                                 (node && node->has_user) ? node->user.short_name : "???");
+            snprintf(tempBuf, sizeof(tempBuf), "%s ago from %s", screen->drawTimeDelta(days, hours, minutes, seconds).c_str(),
+                     (node && node->has_user) ? node->user.short_name : "???");
         }
+        drawCachedString(display, xOff + x, 0 + y, tempBuf, FONT_SMALL);
     }
 
     display->setColor(WHITE);
@@ -1292,9 +1397,9 @@ void Screen::drawColumns(OLEDDisplay *display, int16_t x, int16_t y, const char
     const char **f = fields;
     int xo = x, yo = y;
     while (*f) {
-        display->drawString(xo, yo, *f);
+        drawCachedString(display, xo, yo, *f, FONT_SMALL);
         if ((display->getColor() == BLACK) && config.display.heading_bold)
-            display->drawString(xo + 1, yo, *f);
+            drawCachedString(display, xo + 1, yo, *f, FONT_SMALL);
 
         display->setColor(WHITE);
         yo += FONT_HEIGHT_SMALL;
@@ -2171,6 +2276,9 @@ int32_t Screen::runOnce()
     // this must be before the frameState == FIXED check, because we always
     // want to draw at least one FIXED frame before doing forceDisplay
     ui->update();
+#if SCREEN_FRAME_TIMINGS
+    logFrameTimings();
+#endif
 
     // Switch to a low framerate (to save CPU) when we are not in transition
     // but we should only call setTargetFPS when framestate changes, because
@@ -2857,51 +2965,51 @@ void Screen::setFrames(FrameFocus focus)
     // If we have a critical fault, show it first
     fsi.positions.fault = numframes;
     if (error_code) {
-        normalFrames[numframes++] = drawCriticalFaultFrame;
+        normalFrames[numframes++] = TIMED_FRAME(drawCriticalFaultFrame);
         focus = FOCUS_FAULT; // Change our "focus" parameter, to ensure we show the fault frame
     }
 
 #if defined(DISPLAY_CLOCK_FRAME)
-    normalFrames[numframes++] = &Screen::drawDigitalClockFrame;
+    normalFrames[numframes++] = TIMED_FRAME(&Screen::drawDigitalClockFrame);
 #endif
 
     // If we have a text message - show it next, unless it's a phone message and we aren't using any special modules
     if (devicestate.has_rx_text_message && shouldDrawMessage(&devicestate.rx_text_message)) {
         fsi.positions.textMessage = numframes;
-        normalFrames[numframes++] = drawTextMessageFrame;
+        normalFrames[numframes++] = TIMED_FRAME(drawTextMessageFrame);
     }
 
     // then all the nodes
     // We only show a few nodes in our scrolling list - because meshes with many nodes would have too many screens
     size_t numToShow = min(numMeshNodes, 4U);
     for (size_t i = 0; i < numToShow; i++)
-        normalFrames[numframes++] = drawNodeInfo;
+        normalFrames[numframes++] = TIMED_FRAME(drawNodeInfo);
 
     // then the debug info
     //
     // Since frames are basic function pointers, we have to use a helper to
     // call a method on debugInfo object.
     fsi.positions.log = numframes;
-    normalFrames[numframes++] = &Screen::drawDebugInfoTrampoline;
+    normalFrames[numframes++] = TIMED_FRAME(&Screen::drawDebugInfoTrampoline);
 
     // call a method on debugInfoScreen object (for more details)
     fsi.positions.settings = numframes;
-    normalFrames[numframes++] = &Screen::drawDebugInfoSettingsTrampoline;
+    normalFrames[numframes++] = TIMED_FRAME(&Screen::drawDebugInfoSettingsTrampoline);
 
     fsi.positions.wifi = numframes;
 #if HAS_WIFI && !defined(ARCH_PORTDUINO)
     if (isWifiAvailable()) {
         // call a method on debugInfoScreen object (for more details)
-        normalFrames[numframes++] = &Screen::drawDebugInfoWiFiTrampoline;
+        normalFrames[numframes++] = TIMED_FRAME(&Screen::drawDebugInfoWiFiTrampoline);
     }
 #endif
     if (secretMenuVisible) {
         fsi.positions.secretMenu = numframes;
-        normalFrames[numframes++] = &Screen::drawSecretMenuFrame;
+        normalFrames[numframes++] = TIMED_FRAME(&Screen::drawSecretMenuFrame);
     }
     if (battMeterActive) {
         fsi.positions.battMeter = numframes;
-        normalFrames[numframes++] = &Screen::drawBattMeterFrame;
+        normalFrames[numframes++] = TIMED_FRAME(&Screen::drawBattMeterFrame);
     }
 
     fsi.frameCount = numframes; // Total framecount is used to apply FOCUS_PRESERVE
@@ -3217,7 +3325,7 @@ void DebugInfo::drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state, int16
 #endif
     display->setColor(WHITE);
     // Draw the channel name
-    display->drawString(x, y + FONT_HEIGHT_SMALL, channelStr);
+    drawCachedString(display, x, y + FONT_HEIGHT_SMALL, channelStr, FONT_SMALL);
     // Draw our hardware ID to assist with bluetooth pairing. Either prefix with Info or S&F Logo
     if (moduleConfig.store_forward.enabled) {
 #ifdef ARCH_ESP32
@@ -3262,7 +3370,7 @@ void DebugInfo::drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state, int16
 #endif
     }
 
-    display->drawString(x + SCREEN_WIDTH - display->getStringWidth(ourId), y + FONT_HEIGHT_SMALL, ourId);
+    drawCachedString(display, x + SCREEN_WIDTH - display->getStringWidth(ourId), y + FONT_HEIGHT_SMALL, ourId, FONT_SMALL);
 
     // Draw any log messages
     display->drawLogBuffer(x, y + (FONT_HEIGHT_SMALL * 2));
@@ -3346,9 +3454,9 @@ void DebugInfo::drawFrameWiFi(OLEDDisplay *display, OLEDDisplayUiState *state, i
     }
 #endif
 
-    display->drawString(x, y + FONT_HEIGHT_SMALL * 2, "SSID: " + String(wifiName));
+    drawCachedString(display, x, y + FONT_HEIGHT_SMALL * 2, ("SSID: " + String(wifiName)).c_str(), FONT_SMALL);
 
-    display->drawString(x, y + FONT_HEIGHT_SMALL * 3, "http://meshtastic.local");
+    drawCachedString(display, x, y + FONT_HEIGHT_SMALL * 3, "http://meshtastic.local", FONT_SMALL);
 
     /* Display a heartbeat pixel that blinks every time the frame is redrawn */
 #ifdef SHOW_REDRAWS
@@ -3380,9 +3488,9 @@ void DebugInfo::drawFrameSettings(OLEDDisplay *display, OLEDDisplayUiState *stat
                  powerStatus->getIsCharging() ? '+' : ' ', powerStatus->getHasUSB() ? 'U' : ' ');
 
         // Line 1
-        display->drawString(x, y, batStr);
+        drawCachedString(display, x, y, batStr, FONT_SMALL);
         if (config.display.heading_bold)
-            display->drawString(x + 1, y, batStr);
+            drawCachedString(display, x + 1, y, batStr, FONT_SMALL);
     } else {
         // Line 1
         display->drawString(x, y, String("USB"));
@@ -3410,9 +3518,9 @@ void DebugInfo::drawFrameSettings(OLEDDisplay *display, OLEDDisplayUiState *stat
     std::string uptime = screen->drawTimeDelta(days, hours, minutes, seconds);
 
     // Line 1 (Still)
-    display->drawString(x + SCREEN_WIDTH - display->getStringWidth(uptime.c_str()), y, uptime.c_str());
+    drawCachedString(display, x + SCREEN_WIDTH - display->getStringWidth(uptime.c_str()), y, uptime.c_str(), FONT_SMALL);
     if (config.display.heading_bold)
-        display->drawString(x - 1 + SCREEN_WIDTH - display->getStringWidth(uptime.c_str()), y, uptime.c_str());
+        drawCachedString(display, x - 1 + SCREEN_WIDTH - display->getStringWidth(uptime.c_str()), y, uptime.c_str(), FONT_SMALL);
 
     display->setColor(WHITE);
 
@@ -3457,7 +3565,7 @@ void DebugInfo::drawFrameSettings(OLEDDisplay *display, OLEDDisplayUiState *stat
     // Display Channel Utilization
     char chUtil[13];
     snprintf(chUtil, sizeof(chUtil), "ChUtil %2.0f%%", airTime->channelUtilizationPercent());
-    display->drawString(x + SCREEN_WIDTH - display->getStringWidth(chUtil), y + FONT_HEIGHT_SMALL * 1, chUtil);
+    drawCachedString(display, x + SCREEN_WIDTH - display->getStringWidth(chUtil), y + FONT_HEIGHT_SMALL * 1, chUtil, FONT_SMALL);
 
 #if HAS_GPS
     if (config.position.gps_mode == meshtastic_Config_PositionConfig_GpsMode_ENABLED) {
@@ -18,6 +18,11 @@ extern SX1509 gpioExtender;
 #define TFT_MESH COLOR565(0x67, 0xEA, 0x94)
 #endif
 
+// Send each span of a frame by DMA while the next is filled in.  LovyanGFX panels only, with a dma_channel on their bus.
+#ifndef TFT_USE_DMA
+#define TFT_USE_DMA 0
+#endif
+
 #if defined(ST7735S)
 #include <LovyanGFX.hpp> // Graphics and font library for ST7735 driver chip
 
@@ -1008,29 +1013,26 @@ void TFTDisplay::display(bool fromBlank)
     // tft->clear();
     concurrency::LockGuard g(spiLock);
 
-    uint16_t x, y;
-
-    for (y = 0; y < displayHeight; y++) {
-        for (x = 0; x < displayWidth; x++) {
-            auto isset = buffer[x + (y / 8) * displayWidth] & (1 << (y & 7));
-            if (!fromBlank) {
-                // get src pixel in the page based ordering the OLED lib uses FIXME, super inefficent
-                auto dblbuf_isset = buffer_back[x + (y / 8) * displayWidth] & (1 << (y & 7));
-                if (isset != dblbuf_isset) {
-                    tft->drawPixel(x, y, isset ? meshColor : TFT_BLACK);
-                }
-            } else if (isset) {
-                tft->drawPixel(x, y, meshColor);
-            }
-        }
-    }
-    // Copy the Buffer to the Back Buffer
-    for (y = 0; y < (displayHeight / 8); y++) {
-        for (x = 0; x < displayWidth; x++) {
-            uint16_t pos = x + y * displayWidth;
-            buffer_back[pos] = buffer[pos];
-        }
+    if (!spans || spans->width() != displayWidth || spans->height() != displayHeight) {
+        delete spans;
+        spans = new PageBufferDiff(displayWidth, displayHeight);
     }
+
+    // One transaction for the whole frame, and an address window per span rather than per pixel
+    tft->startWrite();
+    spans->update(buffer, buffer_back, fromBlank, meshColor, TFT_BLACK,
+                  [](uint16_t x, uint16_t y, uint16_t width, const uint16_t *pixels) {
+#if TFT_USE_DMA
+                      tft->waitDMA(); // the span before, its line is filled in again after we return
+                      tft->pushImageDMA(x, y, width, 1, pixels);
+#else
+                      tft->pushImage(x, y, width, 1, pixels);
+#endif
+                  });
+#if TFT_USE_DMA
+    tft->waitDMA();
+#endif
+    tft->endWrite();
 }
 
 // Send a command to the display (low level function)
@@ -1198,7 +1200,6 @@ bool TFTDisplay::connect()
     tft->setRotation(0);
 #elif defined(RAK14014)
     tft->setRotation(1);
-    tft->setSwapBytes(true);
     //    tft->fillScreen(TFT_BLACK);
     ft6336u.begin();
     pinMode(SCREEN_TOUCH_INT, INPUT_PULLUP);
@@ -1210,6 +1211,7 @@ bool TFTDisplay::connect()
 #else
     tft->setRotation(3); // Orient horizontal and wide underneath the silkscreen name label
 #endif
+    tft->setSwapBytes(true); // display() pushes spans of RGB565 in CPU byte order
     tft->fillScreen(TFT_BLACK);
 
     return true;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "PageBufferDiff.h"
 #include <GpioLogic.h>
 #include <OLEDDisplay.h>
 #if HAS_TFT
@@ -9,8 +10,9 @@
 /**
  * An adapter class that allows using the LovyanGFX library as if it was an OLEDDisplay implementation.
  *
+ * display() only sends what changed since the last frame, as horizontal spans (see PageBufferDiff).
+ *
  * Remaining TODO:
- * optimize display() to only draw changed pixels (see other OLED subclasses for examples)
  * Use the fast NRF52 SPI API rather than the slow standard arduino version
  *
  * turn radio back on - currently with both on spi bus is fucked? or are we leaving chip select asserted?
@@ -67,6 +69,9 @@ class TFTDisplay : public OLEDDisplay
   protected:
     static uint16_t meshColor;
 
+    // Spans that changed since the last display(), made when the geometry is known
+    PageBufferDiff *spans = nullptr;
+
     // the header size of the buffer used, e.g. for the SPI command header
     virtual int getBufferOffset(void) override { return 0; }
 
@@ -22,6 +22,17 @@ bool EInk::supports(UpdateTypes type)
         return false;
 }
 
+// Tell the driver which part of the image has changed since the previous update
+// Optional, and only a hint: drivers which can't make use of it will just send the whole image
+// Applies to the next call to update, and any after it, until set again
+void EInk::setUpdateRegion(uint16_t left, uint16_t top, uint16_t w, uint16_t h)
+{
+    regionLeft = left;
+    regionTop = top;
+    regionWidth = w;
+    regionHeight = h;
+}
+
 // Begins using the OSThread to detect when a display update is complete
 // This allows the refresh operation to run "asynchronously".
 // Rather than blocking execution waiting for the update to complete, we are periodically checking the hardware's BUSY pin
@@ -34,6 +34,9 @@ class EInk : private concurrency::OSThread
     bool supports(UpdateTypes type);                               // Can display perform a certain update type
     bool busy() { return updateRunning; }                          // Display able to update right now?
 
+    // Which part of the image will change at the next update. Optional
+    void setUpdateRegion(uint16_t left, uint16_t top, uint16_t w, uint16_t h);
+
     const uint16_t width; // Public so that NicheGraphics implementations can access. Safe because const.
     const uint16_t height;
 
@@ -43,6 +46,12 @@ class EInk : private concurrency::OSThread
     virtual void finalizeUpdate() {}                                 // Run any post-update code
     bool failed = false;                                             // If an error occurred during update
 
+    // As set by setUpdateRegion. Drivers may send only this part of the image, for a FAST update
+    uint16_t regionLeft = 0;
+    uint16_t regionTop = 0;
+    uint16_t regionWidth = 0; // Whole display, if 0
+    uint16_t regionHeight = 0;
+
   private:
     int32_t runOnce() override; // Repeated checking if update finished
 
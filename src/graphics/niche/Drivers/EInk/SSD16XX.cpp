@@ -173,6 +173,46 @@ void SSD16XX::configFullscreen()
     sendData(sy2);
 }
 
+// Decide whether to send the whole image, or only the part which changed
+// FULL updates always send everything, to both of the controller's memories
+// For FAST updates, the rest of the controller's memory still holds the previous image, so needs no change
+// Changed region is a hint from the UI (EInk::setUpdateRegion)
+void SSD16XX::decideWindow()
+{
+    windowed = (updateType == FAST) && regionWidth && regionHeight && (regionWidth < width || regionHeight < height) &&
+               (regionLeft + regionWidth <= width) && (regionTop + regionHeight <= height);
+
+    if (windowed) {
+        windowFirstByte = regionLeft / 8;
+        windowLastByte = (regionLeft + regionWidth - 1) / 8;
+        windowTop = regionTop;
+        windowBottom = regionTop + regionHeight - 1;
+    }
+}
+
+// Narrow the memory region selected by configFullscreen, to the part of the image which will be sent
+// The memory cursor wraps within this region, as it does for the whole screen
+void SSD16XX::configWindow()
+{
+    if (!windowed)
+        return;
+
+    sendCommand(0x44); // Memory X start - end
+    sendData(windowFirstByte + bufferOffsetX);
+    sendData(windowLastByte + bufferOffsetX);
+    sendCommand(0x45); // Memory Y start - end
+    sendData(windowTop & 0xFF);
+    sendData((windowTop >> 8) & 0xFF);
+    sendData(windowBottom & 0xFF);
+    sendData((windowBottom >> 8) & 0xFF);
+
+    sendCommand(0x4E); // Memory cursor X
+    sendData(windowFirstByte + bufferOffsetX);
+    sendCommand(0x4F); // Memory cursor y
+    sendData(windowTop & 0xFF);
+    sendData((windowTop >> 8) & 0xFF);
+}
+
 void SSD16XX::update(uint8_t *imageData, UpdateTypes type)
 {
     this->updateType = type;
@@ -180,7 +220,9 @@ void SSD16XX::update(uint8_t *imageData, UpdateTypes type)
 
     reset();
 
+    decideWindow();
     configFullscreen();
+    configWindow();
     configScanning(); // Virtual, unused by base class
     configVoltages(); // Virtual, unused by base class
     configWaveform(); // Virtual, unused by base class
@@ -214,14 +256,28 @@ void SSD16XX::configUpdateSequence()
 
 void SSD16XX::writeNewImage()
 {
-    sendCommand(0x24);
-    sendData(buffer, bufferSize);
+    writeImage(0x24);
 }
 
 void SSD16XX::writeOldImage()
 {
-    sendCommand(0x26);
-    sendData(buffer, bufferSize);
+    writeImage(0x26);
+}
+
+// Send image data to one of the controller's memories
+// If only part of the image changed, send just the window of it selected by configWindow, one row at a time
+void SSD16XX::writeImage(uint8_t command)
+{
+    sendCommand(command);
+
+    if (!windowed) {
+        sendData(buffer, bufferSize);
+        return;
+    }
+
+    uint8_t rowBytes = windowLastByte - windowFirstByte + 1;
+    for (uint16_t y = windowTop; y <= windowBottom; y++)
+        sendData(buffer + (y * bufferRowSize) + windowFirstByte, rowBytes);
 }
 
 void SSD16XX::detachFromUpdate()
@@ -33,13 +33,16 @@ class SSD16XX : public EInk
     virtual void sendData(const uint8_t data);
     virtual void sendData(const uint8_t *data, uint32_t size);
     virtual void configFullscreen();     // Select memory region on controller IC
+    virtual void configWindow();         // Narrow the memory region, if sending only part of the image
     virtual void configScanning() {}     // Optional. First & last gates, scan direction, etc
     virtual void configVoltages() {}     // Optional. Manual panel voltages, soft-start, etc
     virtual void configWaveform() {}     // Optional. LUT, panel border, temperature sensor, etc
     virtual void configUpdateSequence(); // Tell controller IC which operations to run
 
     virtual void writeNewImage();
-    virtual void writeOldImage(); // Image which can be used at *next* update for "differential refresh"
+    virtual void writeOldImage();     // Image which can be used at *next* update for "differential refresh"
+    void writeImage(uint8_t command); // All of the image, or the window of it which changed
+    void decideWindow();
 
     virtual void detachFromUpdate();
     virtual bool isUpdateDone() override;
@@ -53,6 +56,13 @@ class SSD16XX : public EInk
     uint8_t *buffer = nullptr;
     UpdateTypes updateType = UpdateTypes::UNSPECIFIED;
 
+    // Part of the image sent, when only some of it changed. Set by decideWindow
+    bool windowed = false;
+    uint8_t windowFirstByte = 0; // Of each row
+    uint8_t windowLastByte = 0;
+    uint16_t windowTop = 0;
+    uint16_t windowBottom = 0; // Inclusive
+
     uint8_t pin_dc = -1;
     uint8_t pin_cs = -1;
     uint8_t pin_busy = -1;
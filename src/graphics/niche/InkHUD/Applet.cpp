@@ -25,15 +25,90 @@ InkHUD::Applet::Applet() : GFX(0, 0)
 }
 
 // Draw a single pixel
-// The raw pixel output generated by AdafruitGFX drawing all passes through here
 // Hand off to the applet's tile, which will in-turn pass to the renderer
 void InkHUD::Applet::drawPixel(int16_t x, int16_t y, uint16_t color)
 {
+    // Anything drawn before this pixel must land first
+    flushRun();
+
     // Only render pixels if they fall within user's cropped region
     if (x >= cropLeft && x < (cropLeft + cropWidth) && y >= cropTop && y < (cropTop + cropHeight))
         assignedTile->handleAppletPixel(x, y, (Color)color);
 }
 
+// Pixel output from AdafruitGFX's text and line drawing
+// Neighbouring pixels along a row (most of a glyph's pixels) are joined into a run,
+// which is sent on as a rectangle once the row ends, or the drawing operation does (endWrite)
+void InkHUD::Applet::writePixel(int16_t x, int16_t y, uint16_t color)
+{
+    if (runWidth && y == runY && x == runX + runWidth && color == runColor) {
+        runWidth++;
+        return;
+    }
+
+    flushRun();
+    runX = x;
+    runY = y;
+    runWidth = 1;
+    runColor = color;
+}
+
+// AdafruitGFX calls this when a drawing operation (a glyph, a line) is complete
+void InkHUD::Applet::endWrite()
+{
+    flushRun();
+}
+
+// Send any pixels held back by writePixel
+void InkHUD::Applet::flushRun()
+{
+    if (!runWidth)
+        return;
+
+    int16_t w = runWidth;
+    runWidth = 0; // Before drawing: the methods below flush too
+    if (w == 1)
+        drawPixel(runX, runY, runColor);
+    else
+        fillRect(runX, runY, w, 1, runColor);
+}
+
+void InkHUD::Applet::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+    fillRect(x, y, w, 1, color);
+}
+
+void InkHUD::Applet::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+    fillRect(x, y, 1, h, color);
+}
+
+// Fill a rectangle
+// AdafruitGFX would otherwise break this down into individual pixels
+// Instead, it is cropped here, then handed to the tile and renderer as a single operation
+void InkHUD::Applet::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    flushRun();
+
+    // AdafruitGFX allows negative sizes, extending left / up from x, y
+    if (w < 0) {
+        x += w + 1;
+        w = -w;
+    }
+    if (h < 0) {
+        y += h + 1;
+        h = -h;
+    }
+
+    // Crop to the user's cropped region
+    int16_t x1 = (x > cropLeft) ? x : cropLeft;
+    int16_t y1 = (y > cropTop) ? y : cropTop;
+    int16_t x2 = (x + w < cropLeft + cropWidth) ? x + w : cropLeft + cropWidth;
+    int16_t y2 = (y + h < cropTop + cropHeight) ? y + h : cropTop + cropHeight;
+    if (x2 > x1 && y2 > y1)
+        assignedTile->handleAppletRect(x1, y1, x2 - x1, y2 - y1, (Color)color);
+}
+
 // Link our applet to a tile
 // This can only be called by Tile::assignApplet
 // The tile determines the applets dimensions
@@ -68,6 +143,7 @@ void InkHUD::Applet::render()
     updateDimensions();
     resetDrawingSpace();
     onRender(); // Derived applet's drawing takes place here
+    flushRun();
 
     // Handle "Tile Highlighting"
     // Some devices may use an auxiliary button to switch between tiles
@@ -229,6 +305,7 @@ bool InkHUD::Applet::isForeground()
 // Pixels outside this region will be discarded
 void InkHUD::Applet::setCrop(int16_t left, int16_t top, uint16_t width, uint16_t height)
 {
+    flushRun(); // Pending pixels were drawn under the old crop
     cropLeft = left;
     cropTop = top;
     cropWidth = width;
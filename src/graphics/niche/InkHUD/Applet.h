@@ -100,7 +100,12 @@ class Applet : public GFX
     const char *name = nullptr; // Shown in applet selection menu. Also used as an identifier by InkHUD::getSystemApplet
 
   protected:
-    void drawPixel(int16_t x, int16_t y, uint16_t color) override; // Place a single pixel. All drawing output passes through here
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;  // Place a single pixel
+    void writePixel(int16_t x, int16_t y, uint16_t color) override; // Pixel of GFX text or lines. Joined into runs along a row
+    void endWrite() override;                                        // End of a GFX drawing operation. Sends any pending run
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override; // Lines and fills end up here
 
     void requestUpdate(EInk::UpdateTypes type = EInk::UpdateTypes::UNSPECIFIED); // Ask WindowManager to schedule a display update
     void requestAutoshow();                                                      // Ask for applet to be moved to foreground
@@ -169,6 +174,14 @@ class Applet : public GFX
     int16_t cropTop = 0;
     uint16_t cropWidth = 0;
     uint16_t cropHeight = 0;
+
+    // Pixels passed to writePixel, held back while they continue along a row, then sent as a single rectangle
+    // Glyphs are drawn pixel by pixel, so this saves a trip to the renderer for most of them
+    void flushRun();
+    int16_t runX = 0;
+    int16_t runY = 0;
+    int16_t runWidth = 0; // Nothing pending, if 0
+    uint16_t runColor = 0;
 };
 
 }; // namespace NicheGraphics::InkHUD
@@ -0,0 +1,122 @@
+#if defined(MESHTASTIC_INCLUDE_INKHUD) || defined(PIO_UNIT_TESTING)
+
+#include "./Blitter.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace NicheGraphics;
+
+bool InkHUD::Region::intersects(const Region &r) const
+{
+    return !intersection(r).isEmpty();
+}
+
+InkHUD::Region InkHUD::Region::intersection(const Region &r) const
+{
+    int16_t l = std::max(left, r.left);
+    int16_t t = std::max(top, r.top);
+    int16_t rt = std::min(left + width, r.left + r.width);
+    int16_t b = std::min(top + height, r.top + r.height);
+    if (isEmpty() || r.isEmpty() || rt <= l || b <= t)
+        return Region();
+    return Region(l, t, rt - l, b - t);
+}
+
+void InkHUD::Region::add(const Region &r)
+{
+    if (r.isEmpty())
+        return;
+    if (isEmpty()) {
+        *this = r;
+        return;
+    }
+    int16_t rt = std::max(left + width, r.left + r.width);
+    int16_t b = std::max(top + height, r.top + r.height);
+    left = std::min(left, r.left);
+    top = std::min(top, r.top);
+    width = rt - left;
+    height = b - top;
+}
+
+void InkHUD::Blitter::setBuffer(uint8_t *buffer, uint16_t displayWidth, uint16_t displayHeight)
+{
+    this->buffer = buffer;
+    this->displayWidth = displayWidth;
+    this->displayHeight = displayHeight;
+
+    // Not all display widths are divisible by 8. Rows are padded to a whole byte.
+    rowBytes = ((displayWidth - 1) / 8) + 1;
+}
+
+void InkHUD::Blitter::setRotation(uint8_t rotation)
+{
+    this->rotation = rotation % 4;
+}
+
+// Rotating a rectangle by quarter turns gives another rectangle
+// Matches the per-pixel rotation in setPixel
+InkHUD::Region InkHUD::Blitter::toDisplay(const Region &r) const
+{
+    switch (rotation) {
+    case 1:
+        return Region(displayWidth - r.top - r.height, r.left, r.height, r.width);
+    case 2:
+        return Region(displayWidth - r.left - r.width, displayHeight - r.top - r.height, r.width, r.height);
+    case 3:
+        return Region(r.top, displayHeight - r.left - r.width, r.height, r.width);
+    default:
+        return r;
+    }
+}
+
+// Fill a rectangle one row of the buffer at a time: whole bytes by memset, with masks for the partial bytes at either end
+// Lines, rectangles and runs of glyph pixels all end up here, instead of going pixel by pixel
+void InkHUD::Blitter::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, bool white)
+{
+    // Crop to the display
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+    if (y < 0) {
+        h += y;
+        y = 0;
+    }
+    if (x + w > width())
+        w = width() - x;
+    if (y + h > height())
+        h = height() - y;
+    if (w <= 0 || h <= 0)
+        return;
+    pixelsTouched += (uint32_t)w * h;
+
+    Region r = toDisplay(Region(x, y, w, h));
+    uint8_t *row = buffer + (r.top * rowBytes);
+    uint16_t first = r.left / 8;
+    uint16_t last = (r.left + r.width - 1) / 8;
+    uint8_t firstMask = 0xFF >> (r.left % 8);
+    uint8_t lastMask = 0xFF << (7 - ((r.left + r.width - 1) % 8));
+
+    // Within a single byte of each row: a vertical line, or a horizontal one when the display is rotated
+    if (first == last) {
+        uint8_t mask = firstMask & lastMask;
+        for (uint8_t *b = row + first; r.height--; b += rowBytes)
+            *b = white ? (*b | mask) : (*b & ~mask);
+        return;
+    }
+
+    for (; r.height--; row += rowBytes) {
+        row[first] = white ? (row[first] | firstMask) : (row[first] & ~firstMask);
+        memset(row + first + 1, white ? 0xFF : 0x00, last - first - 1);
+        row[last] = white ? (row[last] | lastMask) : (row[last] & ~lastMask);
+    }
+}
+
+void InkHUD::Blitter::fill(bool white)
+{
+    memset(buffer, white ? 0xFF : 0x00, rowBytes * displayHeight);
+    pixelsTouched += (uint32_t)displayWidth * displayHeight;
+}
+
+#endif
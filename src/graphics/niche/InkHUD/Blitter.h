@@ -0,0 +1,102 @@
+#if defined(MESHTASTIC_INCLUDE_INKHUD) || defined(PIO_UNIT_TESTING)
+
+/*
+
+Places drawing output into the image buffer which is handed to the E-Ink driver
+
+- applies the display rotation
+- fills rectangles a row of bytes at a time: whichever way the display is rotated, a rectangle is still a rectangle
+- counts pixels touched, for benchmarking
+
+Knows nothing of applets or tiles, so it can be tested on its own.
+Image buffer format is that of the drivers: rows of 8 pixels per byte, leftmost pixel in the most significant bit, set for WHITE.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace NicheGraphics::InkHUD
+{
+
+// A rectangle of pixels. Empty if no width or height.
+struct Region {
+    int16_t left = 0;
+    int16_t top = 0;
+    int16_t width = 0;
+    int16_t height = 0;
+
+    Region() {}
+    Region(int16_t left, int16_t top, int16_t width, int16_t height) : left(left), top(top), width(width), height(height) {}
+
+    bool isEmpty() const { return width <= 0 || height <= 0; }
+    bool intersects(const Region &r) const;
+    Region intersection(const Region &r) const;
+    void add(const Region &r); // Grow to the bounding box of both
+    bool operator==(const Region &r) const
+    {
+        return left == r.left && top == r.top && width == r.width && height == r.height;
+    }
+};
+
+class Blitter
+{
+  public:
+    void setBuffer(uint8_t *buffer, uint16_t displayWidth, uint16_t displayHeight); // Dimensions as the driver sees them
+    void setRotation(uint8_t rotation);                                              // Quarter turns, as Persistence::Settings
+
+    // Size of the display, in context of current rotation
+    uint16_t width() const { return (rotation % 2) ? displayHeight : displayWidth; }
+    uint16_t height() const { return (rotation % 2) ? displayWidth : displayHeight; }
+
+    // Drawing, in context of current rotation. Anything off-display is ignored
+    inline void setPixel(int16_t x, int16_t y, bool white);
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, bool white);
+    void fillRect(const Region &r, bool white) { fillRect(r.left, r.top, r.width, r.height, white); }
+    void fill(bool white); // Whole display
+
+    Region toDisplay(const Region &r) const; // Un-rotate, to the region of the buffer which the driver will see
+
+    uint32_t pixelsTouched = 0; // Since last reset by caller
+
+  private:
+    uint8_t *buffer = nullptr;
+    uint16_t displayWidth = 0;
+    uint16_t displayHeight = 0;
+    uint16_t rowBytes = 0;
+    uint8_t rotation = 0;
+};
+
+// Every pixel drawn passes through here, so inline and without any virtual calls
+void Blitter::setPixel(int16_t x, int16_t y, bool white)
+{
+    if (x < 0 || y < 0 || x >= width() || y >= height())
+        return;
+
+    int16_t x1 = x;
+    int16_t y1 = y;
+    switch (rotation) {
+    case 1:
+        x1 = (displayWidth - 1) - y;
+        y1 = x;
+        break;
+    case 2:
+        x1 = (displayWidth - 1) - x;
+        y1 = (displayHeight - 1) - y;
+        break;
+    case 3:
+        x1 = y;
+        y1 = (displayHeight - 1) - x;
+        break;
+    }
+
+    uint8_t &byte = buffer[(y1 * rowBytes) + (x1 / 8)]; // X data is 8 pixels per byte
+    uint8_t mask = 0x80 >> (x1 % 8);                   // Leftmost bit (most significant) is leftmost pixel of byte
+    byte = white ? (byte | mask) : (byte & ~mask);
+    pixelsTouched++;
+}
+
+} // namespace NicheGraphics::InkHUD
+
+#endif
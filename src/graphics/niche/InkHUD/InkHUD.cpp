@@ -215,4 +215,12 @@ void InkHUD::InkHUD::drawPixel(int16_t x, int16_t y, Color c)
     renderer->handlePixel(x, y, c);
 }
 
+// Place a filled rectangle into the image buffer
+// As for drawPixel, the coordinates are in the context of the current display rotation
+// Lines, fills, and runs of glyph pixels take this path, so the renderer can fill whole bytes at a time
+void InkHUD::InkHUD::fillRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c)
+{
+    renderer->handleRect(x, y, w, h, c);
+}
+
 #endif
\ No newline at end of file
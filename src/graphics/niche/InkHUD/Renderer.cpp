@@ -42,6 +42,7 @@ void InkHUD::Renderer::setDriver(Drivers::EInk *driver)
 
     // Allocate the image buffer
     imageBuffer = new uint8_t[imageBufferWidth * imageBufferHeight];
+    blitter.setBuffer(imageBuffer, driver->width, driver->height);
 }
 
 // Set the target number of FAST display updates in a row, before a FULL update is used for display health
@@ -110,15 +111,17 @@ void InkHUD::Renderer::awaitUpdate()
 }
 
 // Set a ready-to-draw pixel into the image buffer
-// All rotations / translations have already taken place: this buffer data is formatted ready for the driver
+// All translations have already taken place. The blitter applies the rotation, formatting the buffer ready for the driver
 void InkHUD::Renderer::handlePixel(int16_t x, int16_t y, Color c)
 {
-    rotatePixelCoords(&x, &y);
-
-    uint32_t byteNum = (y * imageBufferWidth) + (x / 8); // X data is 8 pixels per byte
-    uint8_t bitNum = 7 - (x % 8); // Invert order: leftmost bit (most significant) is leftmost pixel of byte.
+    blitter.setPixel(x, y, c);
+}
 
-    bitWrite(imageBuffer[byteNum], bitNum, c);
+// Fill a rectangle of the image buffer
+// Lines, filled shapes, and runs of glyph pixels arrive here, rather than pixel by pixel
+void InkHUD::Renderer::handleRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c)
+{
+    blitter.fillRect(x, y, w, h, c);
 }
 
 // Width of the display, relative to rotation
@@ -157,37 +160,6 @@ int32_t InkHUD::Renderer::runOnce()
         return OSThread::disable();
 }
 
-// Applies the system-wide rotation to pixel positions
-// This step is applied to image data which has already been translated by a Tile object
-// This is the final step before the pixel is placed into the image buffer
-// No return: values of the *x and *y parameters are modified by the method
-void InkHUD::Renderer::rotatePixelCoords(int16_t *x, int16_t *y)
-{
-    // Apply a global rotation to pixel locations
-    int16_t x1 = 0;
-    int16_t y1 = 0;
-    switch (settings->rotation) {
-    case 0:
-        x1 = *x;
-        y1 = *y;
-        break;
-    case 1:
-        x1 = (driver->width - 1) - *y;
-        y1 = *x;
-        break;
-    case 2:
-        x1 = (driver->width - 1) - *x;
-        y1 = (driver->height - 1) - *y;
-        break;
-    case 3:
-        x1 = *y;
-        y1 = (driver->height - 1) - *x;
-        break;
-    }
-    *x = x1;
-    *y = y1;
-}
-
 // Make an attempt to gather image data from some / all applets, and update the display
 // Might not be possible right now, if update already is progress.
 void InkHUD::Renderer::render(bool async)
@@ -219,13 +191,29 @@ void InkHUD::Renderer::render(bool async)
         Drivers::EInk::UpdateTypes updateType = decideUpdateType();
 
         // Render the new image
-        clearBuffer();
-        renderUserApplets();
-        renderPlaceholders();
-        renderSystemApplets();
+        // If nothing has moved, only the applets which asked to update need redrawing
+        uint32_t start = millis();
+        blitter.pixelsTouched = 0;
+        if (canRenderPartial()) {
+            renderDamagedApplets();
+        } else {
+            blitter.setRotation(settings->rotation);
+            damage = Region(0, 0, width(), height());
+            clearBuffer();
+            renderUserApplets();
+            renderPlaceholders();
+            renderSystemApplets();
+        }
+        shown = getShown();
+        shownRotation = settings->rotation;
+        LOG_DEBUG("Rendered %dx%d region, %u px touched, in %ums", damage.width, damage.height, blitter.pixelsTouched,
+                  millis() - start);
 
         // Tell display to begin process of drawing new image
+        // Only the damaged region changed: drivers which can will send just that part
         LOG_INFO("Updating display");
+        Region window = blitter.toDisplay(damage);
+        driver->setUpdateRegion(window.left, window.top, window.width, window.height);
         driver->update(imageBuffer, updateType);
 
         // If not async, wait here until the update is complete
@@ -245,11 +233,10 @@ void InkHUD::Renderer::render(bool async)
 // Manually fill the image buffer with WHITE
 // Clears any old drawing
 // Note: benchmarking revealed that this is *much* faster than setting pixels individually
-// So much so that it's more efficient to re-render all applets,
-// rather than rendering selectively, and manually blanking a portion of the display
+// Blanking a single tile for a partial render (Blitter::fillRect) is similarly done a byte at a time
 void InkHUD::Renderer::clearBuffer()
 {
-    memset(imageBuffer, 0xFF, imageBufferHeight * imageBufferWidth);
+    blitter.fill(WHITE);
 }
 
 void InkHUD::Renderer::checkLocks()
@@ -304,6 +291,55 @@ bool InkHUD::Renderer::shouldUpdate()
     return should;
 }
 
+// Can we redraw only the applets which requested an update, leaving the rest of the previous image in place?
+// Only if every applet is exactly where it was last time, and nothing else needs the whole display redrawn
+bool InkHUD::Renderer::canRenderPartial()
+{
+    // Forced updates are typically for a reason outside of any applet (display health, layout changes, highlighting)
+    if (forced || lockRendering || Tile::highlightTarget)
+        return false;
+
+    // Nothing rendered yet, or rotation changed
+    if (shown.empty() || shownRotation != settings->rotation)
+        return false;
+
+    // System applets are drawn overtop of user applets: the user applets beneath them would need redrawing too
+    for (SystemApplet *sa : inkhud->systemApplets) {
+        if (sa->isForeground() && sa->wantsToRender())
+            return false;
+    }
+
+    return getShown() == shown;
+}
+
+// Which applets are shown, and where
+// Empty tiles are included (as nullptr), as their placeholders are part of the image
+std::vector<InkHUD::Renderer::Shown> InkHUD::Renderer::getShown()
+{
+    std::vector<Shown> result;
+
+    for (Applet *ua : inkhud->userApplets) {
+        if (ua && ua->isActive() && ua->isForeground())
+            result.push_back({ua, getRegion(ua->getTile())});
+    }
+    for (SystemApplet *sa : inkhud->systemApplets) {
+        if (sa->isForeground())
+            result.push_back({sa, getRegion(sa->getTile())});
+    }
+    for (Tile *t : inkhud->getEmptyTiles())
+        result.push_back({nullptr, getRegion(t)});
+
+    return result;
+}
+
+// The region of the display which a tile occupies, in context of rotation
+InkHUD::Region InkHUD::Renderer::getRegion(Tile *t)
+{
+    if (!t)
+        return Region();
+    return Region(t->getLeft(), t->getTop(), t->getWidth(), t->getHeight());
+}
+
 // Determine which type of E-Ink update the display will perform, to change the image.
 // Considers the needs of the various applets, then weighs against display health.
 // An update type specified by forceUpdate will be granted with no further questioning.
@@ -348,9 +384,33 @@ void InkHUD::Renderer::renderUserApplets()
     }
 }
 
+// Redraw only the user applets which requested an update
+// Each one's tile is blanked first, as the previous image is still in the buffer
+// System applets which overlap these tiles are then redrawn overtop, as they would be for a full render
+void InkHUD::Renderer::renderDamagedApplets()
+{
+    damage = Region();
+
+    for (Applet *ua : inkhud->userApplets) {
+        if (ua && ua->isActive() && ua->isForeground() && ua->wantsToRender()) {
+            Region r = getRegion(ua->getTile());
+            blitter.fillRect(r, WHITE);
+            damage.add(r);
+
+            uint32_t start = millis();
+            ua->render(); // Draw!
+            uint32_t stop = millis();
+            LOG_DEBUG("%s took %dms to render", ua->name, stop - start);
+        }
+    }
+
+    renderSystemApplets(&damage);
+}
+
 // Run the drawing operations of any system applets which are currently displayed
 // Pixel output is placed into the framebuffer, ready for handoff to the EInk driver
-void InkHUD::Renderer::renderSystemApplets()
+// If a region is given, only the system applets which overlap it are drawn
+void InkHUD::Renderer::renderSystemApplets(const Region *within)
 {
     SystemApplet *battery = inkhud->getSystemApplet("BatteryIcon");
     SystemApplet *menu = inkhud->getSystemApplet("Menu");
@@ -367,6 +427,10 @@ void InkHUD::Renderer::renderSystemApplets()
         if (lockRendering && lockRendering != sa)
             continue;
 
+        // Skip if outside the region being redrawn
+        if (within && !within->intersects(getRegion(sa->getTile())))
+            continue;
+
         // Don't draw the battery or notifications overtop the menu
         // Todo: smarter way to handle this
         if (menu->isForeground() && (sa == battery || sa == notifications))
@@ -8,17 +8,24 @@ Orchestrates updating of the display image
 - performs the various steps of the rendering operation
 - interfaces with the E-Ink driver
 
+If nothing has moved since the last render, only the tiles of applets which requested an update are redrawn,
+along with any system applets drawn over them. The region redrawn is passed to the driver,
+which may then send only that part of the image for a FAST update.
+
 */
 
 #pragma once
 
 #include "configuration.h"
 
+#include "./Blitter.h"
 #include "./DisplayHealth.h"
 #include "./InkHUD.h"
 #include "./Persistence.h"
 #include "graphics/niche/Drivers/EInk/EInk.h"
 
+#include <vector>
+
 namespace NicheGraphics::InkHUD
 {
 
@@ -46,6 +53,7 @@ class Renderer : protected concurrency::OSThread
 
     // Receives pixel output from an applet (via a tile, which translates the coordinates)
     void handlePixel(int16_t x, int16_t y, Color c);
+    void handleRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c); // Lines, fills, and runs of glyph pixels
 
     // Size of display, in context of current rotation
 
@@ -56,9 +64,6 @@ class Renderer : protected concurrency::OSThread
     // Make attemps to render / update, once triggered by requestUpdate or forceUpdate
     int32_t runOnce() override;
 
-    // Apply the display rotation to handled pixels
-    void rotatePixelCoords(int16_t *x, int16_t *y);
-
     // Execute the render process now, then hand off to driver for display update
     void render(bool async = true);
 
@@ -67,11 +72,23 @@ class Renderer : protected concurrency::OSThread
     void clearBuffer();
     void checkLocks();
     bool shouldUpdate();
+    bool canRenderPartial();
     Drivers::EInk::UpdateTypes decideUpdateType();
     void renderUserApplets();
-    void renderSystemApplets();
+    void renderDamagedApplets();
+    void renderSystemApplets(const Region *within = nullptr);
     void renderPlaceholders();
 
+    // Which applet was shown where, at the last render
+    // If any of this changes, the whole image must be redrawn
+    struct Shown {
+        Applet *applet;
+        Region region;
+        bool operator==(const Shown &s) const { return applet == s.applet && region == s.region; }
+    };
+    std::vector<Shown> getShown();
+    static Region getRegion(Tile *t);
+
     Drivers::EInk *driver = nullptr; // Interacts with your variants display hardware
     DisplayHealth displayHealth;     // Manages display health by controlling type of update
 
@@ -79,6 +96,11 @@ class Renderer : protected concurrency::OSThread
     uint16_t imageBufferHeight = 0;
     uint16_t imageBufferWidth = 0;
     uint32_t imageBufferSize = 0; // Bytes
+    Blitter blitter;              // Places drawing output into imageBuffer
+
+    Region damage;             // Redrawn by the current render, in context of rotation
+    std::vector<Shown> shown;  // As of the last render
+    uint8_t shownRotation = 0; // As of the last render
 
     SystemApplet *lockRendering = nullptr; // Render this applet *only*
     SystemApplet *lockRequests = nullptr;  // Honor update requests from this applet *only*
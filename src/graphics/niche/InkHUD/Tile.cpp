@@ -190,6 +190,38 @@ void InkHUD::Tile::handleAppletPixel(int16_t x, int16_t y, Color c)
     }
 }
 
+// Receive a filled rectangle from the assigned applet: a line, a fill, or a run of glyph pixels
+// Translated and cropped as for handleAppletPixel, then passed to the renderer as a single operation
+void InkHUD::Tile::handleAppletRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c)
+{
+    // Move from applet-space to tile-space
+    x += left;
+    y += top;
+
+    // Crop to tile borders
+    int16_t x1 = (x > left) ? x : left;
+    int16_t y1 = (y > top) ? y : top;
+    int16_t x2 = (x + w < left + width) ? x + w : left + width;
+    int16_t y2 = (y + h < top + height) ? y + h : top + height;
+    if (x2 > x1 && y2 > y1) {
+        // Pass to the renderer
+        inkhud->fillRect(x1, y1, x2 - x1, y2 - y1, c);
+    }
+}
+
+// Position of the tile's left edge on the display
+// Used by the renderer to find which region of the display an applet occupies
+int16_t InkHUD::Tile::getLeft()
+{
+    return left;
+}
+
+// Position of the tile's top edge on the display
+int16_t InkHUD::Tile::getTop()
+{
+    return top;
+}
+
 // Called by Applet base class, when setting applet dimensions, immediately before render
 uint16_t InkHUD::Tile::getWidth()
 {
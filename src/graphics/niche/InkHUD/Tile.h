@@ -26,9 +26,12 @@ class Tile
     Tile();
     Tile(int16_t left, int16_t top, uint16_t width, uint16_t height);
 
-    void setRegion(uint8_t layoutSize, uint8_t tileIndex);                      // Assign region automatically, based on layout
-    void setRegion(int16_t left, int16_t top, uint16_t width, uint16_t height); // Assign region manually
-    void handleAppletPixel(int16_t x, int16_t y, Color c);                      // Receive px output from assigned applet
+    void setRegion(uint8_t layoutSize, uint8_t tileIndex);                        // Assign region automatically, based on layout
+    void setRegion(int16_t left, int16_t top, uint16_t width, uint16_t height);   // Assign region manually
+    void handleAppletPixel(int16_t x, int16_t y, Color c);                        // Receive px output from assigned applet
+    void handleAppletRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c); // Receive a filled rectangle from applet
+    int16_t getLeft();
+    int16_t getTop();
     uint16_t getWidth();
     uint16_t getHeight();
     static uint16_t maxDisplayDimension(); // Largest possible width / height any tile may ever encounter
@@ -779,6 +779,11 @@ void setup()
     } else
         router = new ReliableRouter();
 
+#ifdef ARCH_PORTDUINO
+    if (settingsMap[decodeThreads] > 0)
+        router->startDecodePipeline(settingsMap[decodeThreads]);
+#endif
+
 #if HAS_BUTTON || defined(ARCH_PORTDUINO)
     // Buttons. Moved here cause we need NodeDB to be initialized
     buttonThread = new ButtonThread();
@@ -1308,6 +1313,11 @@ void setup()
     LOG_DEBUG("Free heap  : %7d bytes", ESP.getFreeHeap());
     LOG_DEBUG("Free PSRAM : %7d bytes", ESP.getFreePsram());
 #endif
+
+#if defined(DEBUG_PORT) && LOG_RING_SLOTS
+    // The main loop runs from here on, so log lines can be queued for it rather than written out by whoever logs them
+    DEBUG_PORT.startAsyncLog();
+#endif
 }
 
 #endif
@@ -1397,6 +1407,10 @@ void loop()
 {
     runASAP = false;
 
+#if defined(ARCH_PORTDUINO) && __has_include(<ulfius.h>)
+    std::unique_lock<std::mutex> webGuard(piwebMeshLock); // web API requests wait for the mesh to be idle
+#endif
+
 #ifdef ARCH_ESP32
     esp32Loop();
 #endif
@@ -1414,8 +1428,14 @@ void loop()
 #endif
 
     service->loop();
+#if ARCH_PORTDUINO
+    reloadLogLevelsIfRequested();
+#endif
 
     long delayMsec = mainController.runOrDelay();
+#if defined(ARCH_PORTDUINO) && __has_include(<ulfius.h>)
+    webGuard.unlock();
+#endif
 
     // We want to sleep as long as possible here - because it saves power
     if (!runASAP && loopCanSleep()) {
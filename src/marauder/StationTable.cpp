@@ -0,0 +1,194 @@
+#include "marauder/StationTable.h"
+
+#include <iterator>
+
+namespace marauder
+{
+
+StationTable::StationTable(size_t maxAps, size_t maxStations, uint32_t maxAgeMs)
+    : maxAps(maxAps), maxStations(maxStations), maxAgeMs(maxAgeMs)
+{
+    aps.reserve(maxAps);
+    stations.reserve(maxStations);
+    apIndexByKey.reserve(maxAps);
+    stationIndexByKey.reserve(maxStations);
+}
+
+uint64_t StationTable::macKey(const std::array<uint8_t, 6> &mac)
+{
+    uint64_t key = 0;
+    for (auto b : mac) {
+        key <<= 8;
+        key |= b;
+    }
+    return key;
+}
+
+size_t StationTable::findAccessPoint(const std::array<uint8_t, 6> &bssid) const
+{
+    auto it = apIndexByKey.find(macKey(bssid));
+    return it == apIndexByKey.end() ? SIZE_MAX : it->second;
+}
+
+size_t StationTable::findStation(const std::array<uint8_t, 6> &mac, const std::array<uint8_t, 6> &apBssid) const
+{
+    auto it = stationIndexByKey.find({macKey(mac), macKey(apBssid)});
+    return it == stationIndexByKey.end() ? SIZE_MAX : it->second;
+}
+
+void StationTable::add(const FrameRecord &r, uint32_t now)
+{
+    uint64_t apKey = macKey(r.bssid);
+    size_t apIndex;
+    auto apIt = apIndexByKey.find(apKey);
+    if (apIt != apIndexByKey.end()) {
+        apIndex = apIt->second;
+    } else {
+        if (aps.size() >= maxAps)
+            evictOldestAccessPoint();
+        TrackedAccessPoint ap;
+        ap.bssid = r.bssid;
+        ap.channel = r.channel;
+        apIndex = aps.size();
+        aps.push_back(std::move(ap));
+        apIndexByKey.emplace(apKey, apIndex);
+    }
+    aps[apIndex].lastSeen = now;
+    aps[apIndex].packets++;
+
+    StationKey key = {macKey(r.station), apKey};
+    size_t stationIndex;
+    auto staIt = stationIndexByKey.find(key);
+    if (staIt != stationIndexByKey.end()) {
+        stationIndex = staIt->second;
+    } else {
+        if (stations.size() >= maxStations)
+            evictOldestStation(); // Only renumbers stations, apIndex still holds
+        TrackedStation sta;
+        sta.mac = r.station;
+        sta.apBssid = r.bssid;
+        stationIndex = stations.size();
+        stations.push_back(sta);
+        stationIndexByKey.emplace(key, stationIndex);
+        aps[apIndex].stationIndices.push_back(stationIndex);
+    }
+    TrackedStation &sta = stations[stationIndex];
+    sta.rssi = r.rssi;
+    sta.channel = r.channel;
+    sta.lastSeen = now;
+    sta.packets++;
+}
+
+void StationTable::expire(uint32_t now)
+{
+    bool any = false;
+    dropAp.assign(aps.size(), false);
+    dropStation.assign(stations.size(), false);
+    for (size_t i = 0; i < aps.size(); i++) {
+        if (now - aps[i].lastSeen > maxAgeMs)
+            dropAp[i] = any = true;
+    }
+    for (size_t i = 0; i < stations.size(); i++) {
+        if (now - stations[i].lastSeen > maxAgeMs)
+            dropStation[i] = any = true;
+    }
+    if (any)
+        removeDropped();
+}
+
+void StationTable::clear()
+{
+    aps.clear();
+    stations.clear();
+    apIndexByKey.clear();
+    stationIndexByKey.clear();
+}
+
+// Timestamps wrap with millis(), so compare them by difference
+static bool heardBefore(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+void StationTable::evictOldestAccessPoint()
+{
+    size_t oldest = 0;
+    for (size_t i = 1; i < aps.size(); i++) {
+        if (heardBefore(aps[i].lastSeen, aps[oldest].lastSeen))
+            oldest = i;
+    }
+    dropAp.assign(aps.size(), false);
+    dropStation.assign(stations.size(), false);
+    dropAp[oldest] = true;
+    evicted++;
+    removeDropped();
+}
+
+void StationTable::evictOldestStation()
+{
+    size_t oldest = 0;
+    for (size_t i = 1; i < stations.size(); i++) {
+        if (heardBefore(stations[i].lastSeen, stations[oldest].lastSeen))
+            oldest = i;
+    }
+    dropAp.assign(aps.size(), false);
+    dropStation.assign(stations.size(), false);
+    dropStation[oldest] = true;
+    evicted++;
+    removeDropped();
+}
+
+/// Remove whatever dropAp and dropStation mark, keeping the order of the rest, then renumber the maps and each AP's stations
+/// in place.  Nothing is allocated, so making room costs a pass over the tables rather than rebuilding the maps.
+void StationTable::removeDropped()
+{
+    // A station goes with its AP
+    for (size_t i = 0; i < stations.size(); i++) {
+        size_t ap = findAccessPoint(stations[i].apBssid);
+        if (ap < aps.size() && dropAp[ap])
+            dropStation[i] = true;
+    }
+
+    apRemap.resize(aps.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < aps.size(); i++) {
+        apRemap[i] = dropAp[i] ? SIZE_MAX : kept;
+        if (!dropAp[i]) {
+            if (kept != i)
+                aps[kept] = std::move(aps[i]);
+            kept++;
+        }
+    }
+    aps.erase(aps.begin() + kept, aps.end());
+
+    stationRemap.resize(stations.size());
+    kept = 0;
+    for (size_t i = 0; i < stations.size(); i++) {
+        stationRemap[i] = dropStation[i] ? SIZE_MAX : kept;
+        if (!dropStation[i]) {
+            if (kept != i)
+                stations[kept] = stations[i];
+            kept++;
+        }
+    }
+    stations.erase(stations.begin() + kept, stations.end());
+
+    for (auto it = apIndexByKey.begin(); it != apIndexByKey.end();) {
+        it->second = apRemap[it->second];
+        it = (it->second == SIZE_MAX) ? apIndexByKey.erase(it) : std::next(it);
+    }
+    for (auto it = stationIndexByKey.begin(); it != stationIndexByKey.end();) {
+        it->second = stationRemap[it->second];
+        it = (it->second == SIZE_MAX) ? stationIndexByKey.erase(it) : std::next(it);
+    }
+    for (TrackedAccessPoint &ap : aps) {
+        size_t n = 0;
+        for (size_t index : ap.stationIndices) {
+            if (stationRemap[index] != SIZE_MAX)
+                ap.stationIndices[n++] = stationRemap[index];
+        }
+        ap.stationIndices.resize(n);
+    }
+}
+
+} // namespace marauder
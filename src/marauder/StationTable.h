@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace marauder
+{
+
+struct TrackedStation
+{
+    std::array<uint8_t, 6> mac{};
+    std::array<uint8_t, 6> apBssid{};
+    int32_t rssi = 0;
+    uint8_t channel = 0;
+    bool selected = false;
+    uint32_t lastSeen = 0; // millis
+    uint32_t packets = 0;
+};
+
+struct TrackedAccessPoint
+{
+    std::array<uint8_t, 6> bssid{};
+    std::string ssid;
+    uint8_t channel = 0;
+    bool selected = false;
+    std::vector<size_t> stationIndices;
+    uint32_t lastSeen = 0; // millis
+    uint32_t packets = 0;
+};
+
+/// What the promiscuous callback keeps of a frame
+struct FrameRecord
+{
+    std::array<uint8_t, 6> bssid;   // addr3
+    std::array<uint8_t, 6> station; // addr2
+    int8_t rssi;
+    uint8_t channel;
+};
+
+/**
+ * Fixed size single producer, single consumer queue of FrameRecords.  The WiFi driver's callback pushes without allocating or
+ * locking, the consumer drains it from the main loop.  When it is full, frames are dropped and counted.
+ */
+template <size_t Slots> class FrameRing
+{
+    static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+  public:
+    /// Producer only.  @return false if the ring was full
+    bool push(const FrameRecord &r)
+    {
+        uint32_t head = writePos.load(std::memory_order_relaxed);
+        if (head - readPos.load(std::memory_order_acquire) == Slots) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[head & (Slots - 1)] = r;
+        writePos.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer only.  @return false if there was nothing to take
+    bool pop(FrameRecord &r)
+    {
+        uint32_t tail = readPos.load(std::memory_order_relaxed);
+        if (tail == writePos.load(std::memory_order_acquire))
+            return false;
+        r = slots[tail & (Slots - 1)];
+        readPos.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer only, throw away whatever is waiting
+    void clear() { readPos.store(writePos.load(std::memory_order_acquire), std::memory_order_release); }
+
+    uint32_t numDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+  private:
+    FrameRecord slots[Slots];
+    std::atomic<uint32_t> writePos = {0};
+    std::atomic<uint32_t> readPos = {0};
+    std::atomic<uint32_t> dropped = {0};
+};
+
+/**
+ * The access points and stations heard, found by MAC through hash maps rather than searched for.
+ *
+ * Both tables are bounded: when one is full the entry heard from least recently makes room (an AP takes its stations with it),
+ * and expire() forgets anything not heard from in maxAgeMs.  Entries stay in the order they were first heard, so a list shown
+ * from them only shifts when something is forgotten.
+ */
+class StationTable
+{
+  public:
+    StationTable(size_t maxAps, size_t maxStations, uint32_t maxAgeMs);
+
+    /// Count a frame, adding its AP and station if new
+    void add(const FrameRecord &r, uint32_t now);
+
+    /// Forget APs and stations not heard from in maxAgeMs
+    void expire(uint32_t now);
+
+    void clear();
+
+    const std::vector<TrackedAccessPoint> &getAccessPoints() const { return aps; }
+    const std::vector<TrackedStation> &getStations() const { return stations; }
+
+    /// @return index into getAccessPoints() or getStations(), or SIZE_MAX if not there
+    size_t findAccessPoint(const std::array<uint8_t, 6> &bssid) const;
+    size_t findStation(const std::array<uint8_t, 6> &mac, const std::array<uint8_t, 6> &apBssid) const;
+
+    /// Entries dropped to make room for new ones, rather than for age
+    uint32_t numEvicted() const { return evicted; }
+
+  private:
+    struct StationKey {
+        uint64_t mac;
+        uint64_t apBssid;
+        bool operator==(const StationKey &k) const { return mac == k.mac && apBssid == k.apBssid; }
+    };
+    struct StationKeyHash {
+        size_t operator()(const StationKey &k) const { return std::hash<uint64_t>()(k.mac * 31 + k.apBssid); }
+    };
+
+    static uint64_t macKey(const std::array<uint8_t, 6> &mac);
+
+    size_t maxAps;
+    size_t maxStations;
+    uint32_t maxAgeMs;
+    std::vector<TrackedAccessPoint> aps;
+    std::vector<TrackedStation> stations;
+    std::unordered_map<uint64_t, size_t> apIndexByKey;
+    std::unordered_map<StationKey, size_t, StationKeyHash> stationIndexByKey;
+    uint32_t evicted = 0;
+
+    // Scratch space for removing entries, kept to save allocating it each time
+    std::vector<bool> dropAp, dropStation;
+    std::vector<size_t> apRemap, stationRemap;
+
+    void evictOldestAccessPoint();
+    void evictOldestStation();
+    void removeDropped();
+};
+
+} // namespace marauder
@@ -19,6 +19,8 @@ namespace
 constexpr uint8_t kFirstChannel = 1;
 constexpr uint8_t kLastChannel = 13;
 constexpr uint64_t kChannelHopIntervalUs = 400000; // 400 ms
+constexpr int32_t kDrainIntervalMs = 50;            // ring fills in no less than this at a busy site
+constexpr uint32_t kExpireIntervalMs = 1000;
 
 struct RawMacHeader
 {
@@ -37,16 +39,19 @@ StationTracker &StationTracker::instance()
     return tracker;
 }
 
-StationTracker::StationTracker() = default;
+StationTracker::StationTracker()
+    : concurrency::OSThread("StationTracker"),
+      table(STATION_TRACKER_MAX_APS, STATION_TRACKER_MAX_STATIONS, STATION_TRACKER_MAX_AGE_MS)
+{
+    setInterval(INT32_MAX);
+}
 
 void StationTracker::start()
 {
     if (running)
         return;
     ensureWifiReady();
-    aps.clear();
-    stations.clear();
-    selectedStation = SIZE_MAX;
+    clear();
     wifi_promiscuous_filter_t filter = {};
     filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA;
     esp_wifi_set_promiscuous_filter(&filter);
@@ -56,6 +61,8 @@ void StationTracker::start()
         LOG_WARN("Station tracker failed to start promiscuous mode (%d)", err);
     startChannelHopTimer();
     running = true;
+    lastExpireMs = millis();
+    setInterval(kDrainIntervalMs);
     LOG_INFO("Station tracker started");
 }
 
@@ -67,6 +74,7 @@ void StationTracker::stop()
     esp_wifi_set_promiscuous_rx_cb(nullptr);
     esp_wifi_set_promiscuous(false);
     running = false;
+    setInterval(INT32_MAX);
     if (restoreWifi) {
         if (isWifiAvailable()) {
             initWifi();
@@ -81,26 +89,60 @@ void StationTracker::stop()
 
 void StationTracker::clear()
 {
-    aps.clear();
-    stations.clear();
-    selectedStation = SIZE_MAX;
+    ring.clear();
+    table.clear();
+    hasSelectedStation = false;
+}
+
+int32_t StationTracker::runOnce()
+{
+    if (!running)
+        return INT32_MAX;
+
+    uint32_t now = millis();
+    FrameRecord r;
+    while (ring.pop(r))
+        table.add(r, now);
+
+    if (now - lastExpireMs >= kExpireIntervalMs) {
+        table.expire(now);
+        lastExpireMs = now;
+    }
+
+    uint32_t dropped = ring.numDropped();
+    if (dropped != reportedDropped) {
+        LOG_DEBUG("Station tracker dropped %u frames, ring full", static_cast<unsigned>(dropped - reportedDropped));
+        reportedDropped = dropped;
+    }
+    return kDrainIntervalMs;
 }
 
 void StationTracker::selectStation(size_t stationIndex)
 {
+    const auto &stations = table.getStations();
     if (stationIndex >= stations.size()) {
-        selectedStation = SIZE_MAX;
+        hasSelectedStation = false;
         return;
     }
-    selectedStation = stationIndex;
+    hasSelectedStation = true;
+    selectedMac = stations[stationIndex].mac;
+    selectedApBssid = stations[stationIndex].apBssid;
     LOG_INFO("Selected station index %u", static_cast<unsigned>(stationIndex));
 }
 
+size_t StationTracker::selectedStationIndex() const
+{
+    if (!hasSelectedStation)
+        return SIZE_MAX;
+    return table.findStation(selectedMac, selectedApBssid);
+}
+
 const TrackedStation *StationTracker::getSelectedStation() const
 {
-    if (selectedStation >= stations.size())
+    size_t index = selectedStationIndex();
+    if (index == SIZE_MAX)
         return nullptr;
-    return &stations[selectedStation];
+    return &table.getStations()[index];
 }
 
 void StationTracker::promiscuousCb(void *buf, wifi_promiscuous_pkt_type_t type)
@@ -109,6 +151,7 @@ void StationTracker::promiscuousCb(void *buf, wifi_promiscuous_pkt_type_t type)
     tracker->handlePacket(static_cast<wifi_promiscuous_pkt_t *>(buf), type);
 }
 
+// Runs in the WiFi driver's task: copy out what the table needs and leave the rest to runOnce()
 void StationTracker::handlePacket(const wifi_promiscuous_pkt_t *packet, wifi_promiscuous_pkt_type_t type)
 {
     if (!packet)
@@ -117,43 +160,16 @@ void StationTracker::handlePacket(const wifi_promiscuous_pkt_t *packet, wifi_pro
     if (type != WIFI_PKT_DATA && type != WIFI_PKT_MGMT)
         return;
 
-    const RawMacHeader *hdr = reinterpret_cast<const RawMacHeader *>(packet->payload);
-    if (!hdr)
+    if (packet->rx_ctrl.sig_len < sizeof(RawMacHeader))
         return;
+    const RawMacHeader *hdr = reinterpret_cast<const RawMacHeader *>(packet->payload);
 
-    std::array<uint8_t, 6> bssid{};
-    std::array<uint8_t, 6> station{};
-    std::copy(std::begin(hdr->addr3), std::end(hdr->addr3), bssid.begin());
-    std::copy(std::begin(hdr->addr2), std::end(hdr->addr2), station.begin());
-
-    auto nowAp = bssid;
-    auto apIt = std::find_if(aps.begin(), aps.end(), [&](const TrackedAccessPoint &ap) {
-        return ap.bssid == nowAp;
-    });
-    if (apIt == aps.end()) {
-        TrackedAccessPoint ap;
-        ap.bssid = nowAp;
-        ap.channel = packet->rx_ctrl.channel;
-        aps.push_back(ap);
-        apIt = std::prev(aps.end());
-    }
-
-    auto nowSta = station;
-    auto staIt = std::find_if(stations.begin(), stations.end(), [&](const TrackedStation &sta) {
-        return sta.mac == nowSta && sta.apBssid == nowAp;
-    });
-    if (staIt == stations.end()) {
-        TrackedStation sta;
-        sta.mac = nowSta;
-        sta.apBssid = nowAp;
-        sta.channel = packet->rx_ctrl.channel;
-        sta.rssi = packet->rx_ctrl.rssi;
-        stations.push_back(sta);
-        apIt->stationIndices.push_back(stations.size() - 1);
-    } else {
-        staIt->rssi = packet->rx_ctrl.rssi;
-        staIt->channel = packet->rx_ctrl.channel;
-    }
+    FrameRecord r;
+    std::copy(std::begin(hdr->addr3), std::end(hdr->addr3), r.bssid.begin());
+    std::copy(std::begin(hdr->addr2), std::end(hdr->addr2), r.station.begin());
+    r.rssi = packet->rx_ctrl.rssi;
+    r.channel = packet->rx_ctrl.channel;
+    ring.push(r);
 }
 
 void StationTracker::ensureWifiReady()
@@ -4,34 +4,37 @@
 
 #if HAS_WIFI && defined(ARCH_ESP32)
 
+#include "concurrency/OSThread.h"
+#include "marauder/StationTable.h"
 #include <array>
 #include <vector>
 
 #include <esp_timer.h>
 #include <esp_wifi.h>
 
-namespace marauder
-{
-
-struct TrackedStation
-{
-    std::array<uint8_t, 6> mac{};
-    std::array<uint8_t, 6> apBssid{};
-    int32_t rssi = 0;
-    uint8_t channel = 0;
-    bool selected = false;
-};
+#ifndef STATION_TRACKER_RING_SLOTS
+#define STATION_TRACKER_RING_SLOTS 128 // frames the WiFi callback can queue between runOnce()s, a power of two
+#endif
+#ifndef STATION_TRACKER_MAX_APS
+#define STATION_TRACKER_MAX_APS 64
+#endif
+#ifndef STATION_TRACKER_MAX_STATIONS
+#define STATION_TRACKER_MAX_STATIONS 256
+#endif
+#ifndef STATION_TRACKER_MAX_AGE_MS
+#define STATION_TRACKER_MAX_AGE_MS (5 * 60 * 1000) // forget what hasn't been heard from in this long
+#endif
 
-struct TrackedAccessPoint
+namespace marauder
 {
-    std::array<uint8_t, 6> bssid{};
-    std::string ssid;
-    uint8_t channel = 0;
-    bool selected = false;
-    std::vector<size_t> stationIndices;
-};
 
-class StationTracker
+/**
+ * Sniffs for access points and the stations talking to them, hopping channels.
+ *
+ * The promiscuous callback runs in the WiFi driver's task, so it only copies each frame's addresses into a ring.  runOnce()
+ * drains that into the tables from the main loop, the same loop the UI reads them from, so neither side needs a lock.
+ */
+class StationTracker : public concurrency::OSThread
 {
   public:
     static StationTracker &instance();
@@ -41,17 +44,20 @@ class StationTracker
     bool isRunning() const { return running; }
 
     void clear();
-    const std::vector<TrackedAccessPoint> &getAccessPoints() const { return aps; }
-    const std::vector<TrackedStation> &getStations() const { return stations; }
+    const std::vector<TrackedAccessPoint> &getAccessPoints() const { return table.getAccessPoints(); }
+    const std::vector<TrackedStation> &getStations() const { return table.getStations(); }
 
+    /// The selection follows the station while the table is renumbered, until it is forgotten
     void selectStation(size_t stationIndex);
-    bool hasSelection() const { return selectedStation < stations.size(); }
+    bool hasSelection() const { return selectedStationIndex() != SIZE_MAX; }
     const TrackedStation *getSelectedStation() const;
-    size_t selectedStationIndex() const { return selectedStation; }
+    size_t selectedStationIndex() const;
 
   private:
     StationTracker();
 
+    int32_t runOnce() override;
+
     static void promiscuousCb(void *buf, wifi_promiscuous_pkt_type_t type);
     void handlePacket(const wifi_promiscuous_pkt_t *packet, wifi_promiscuous_pkt_type_t type);
     void ensureWifiReady();
@@ -61,9 +67,13 @@ class StationTracker
     void hopChannel();
 
     bool running = false;
-    std::vector<TrackedAccessPoint> aps;
-    std::vector<TrackedStation> stations;
-    size_t selectedStation = SIZE_MAX;
+    FrameRing<STATION_TRACKER_RING_SLOTS> ring;
+    StationTable table;
+    uint32_t lastExpireMs = 0;
+    uint32_t reportedDropped = 0;
+    bool hasSelectedStation = false;
+    std::array<uint8_t, 6> selectedMac{};
+    std::array<uint8_t, 6> selectedApBssid{};
     bool restoreWifi = false;
     wifi_mode_t previousWifiMode = WIFI_MODE_NULL;
     esp_timer_handle_t hopTimer = nullptr;
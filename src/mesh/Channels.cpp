@@ -71,11 +71,21 @@ meshtastic_Channel &Channels::fixupChannel(ChannelIndex chIndex)
             *meshtastic_channelSettings.name = '\0';
     }
 
-    hashes[chIndex] = generateHash(chIndex);
+    setHash(chIndex, generateHash(chIndex));
 
     return ch;
 }
 
+void Channels::setHash(ChannelIndex i, int16_t hash)
+{
+    if (hashes[i] >= 0)
+        channelsByHash[hashes[i]] &= ~(1U << i);
+    hashes[i] = hash;
+    if (hash >= 0)
+        channelsByHash[hash] |= 1U << i;
+    generation++;
+}
+
 void Channels::initDefaultLoraConfig()
 {
     meshtastic_Config_LoRaConfig &loraConfig = config.lora;
@@ -28,6 +28,12 @@ class Channels
     /// the precomputed hashes for each of our channels, or -1 for invalid
     int16_t hashes[MAX_NUM_CHANNELS] = {};
 
+    /// The reverse of hashes: for each possible hash a bitmask of the channel indexes that produce it
+    uint8_t channelsByHash[256] = {};
+    static_assert(MAX_NUM_CHANNELS <= 8, "channelsByHash needs a wider mask");
+
+    uint32_t generation = 0;
+
   public:
     Channels() {}
 
@@ -75,6 +81,23 @@ class Channels
      */
     bool decryptForHash(ChannelIndex chIndex, ChannelHash channelHash);
 
+    /** Return a bitmask (bit n set for channel index n) of the channels whose hash matches, so the receive path only has to try
+     * the keys that could possibly decrypt a packet instead of every configured channel.
+     */
+    uint8_t getChannelsForHash(ChannelHash channelHash)
+    {
+        return channelsByHash[channelHash] & (uint8_t)((1U << getNumChannels()) - 1);
+    }
+
+    /** Bumped every time a channel hash is regenerated, lets work based on a copy of the channel keys notice it went stale */
+    uint32_t getGeneration() const { return generation; }
+
+    /**
+     * Return the key used for encrypting this channel (if channel is secondary and no key provided, use the primary channel's
+     * PSK)
+     */
+    CryptoKey getKey(ChannelIndex chIndex);
+
     /** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
      *
      * This method is called before encoding outbound packets
@@ -113,6 +136,9 @@ class Channels
 
     int16_t getHash(ChannelIndex i) { return hashes[i]; }
 
+    /// Store a freshly generated hash, keeping channelsByHash in step
+    void setHash(ChannelIndex i, int16_t hash);
+
     /**
      * Validate a channel, fixing any errors as needed
      */
@@ -127,12 +153,6 @@ class Channels
      * Write default channels defined in UserPrefs
      */
     void initDefaultChannel(ChannelIndex chIndex);
-
-    /**
-     * Return the key used for encrypting this channel (if channel is secondary and no key provided, use the primary channel's
-     * PSK)
-     */
-    CryptoKey getKey(ChannelIndex chIndex);
 };
 
 /// Singleton channel table
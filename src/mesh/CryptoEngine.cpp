@@ -32,6 +32,7 @@ void CryptoEngine::generateKeyPair(uint8_t *pubKey, uint8_t *privKey)
     CryptRNG.stir((uint8_t *)&noise, sizeof(noise));
 
     LOG_DEBUG("Generate Curve25519 keypair");
+    clearSharedKeyCache();
     Curve25519::dh1(public_key, private_key);
     memcpy(pubKey, public_key, sizeof(public_key));
     memcpy(privKey, private_key, sizeof(private_key));
@@ -52,6 +53,8 @@ bool CryptoEngine::regeneratePublicKey(uint8_t *pubKey, uint8_t *privKey)
             memset(pubKey, 0, 32);
             return false;
         }
+        if (memcmp(private_key, privKey, sizeof(private_key)) != 0)
+            clearSharedKeyCache();
         memcpy(private_key, privKey, sizeof(private_key));
         memcpy(public_key, pubKey, sizeof(public_key));
     } else {
@@ -65,6 +68,7 @@ void CryptoEngine::clearKeys()
 {
     memset(public_key, 0, sizeof(public_key));
     memset(private_key, 0, sizeof(private_key));
+    clearSharedKeyCache();
 }
 
 /**
@@ -92,10 +96,9 @@ bool CryptoEngine::encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtas
         LOG_DEBUG("Node %d or their public_key not found", toNode);
         return false;
     }
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!loadSharedKey(remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
     initNonce(fromNode, packetNum, extraNonceTmp);
 
     // Calculate the shared secret with the destination node and encrypt
@@ -134,10 +137,9 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
     }
 
     // Calculate the shared secret with the sending node and decrypt
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!loadSharedKey(remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
 
     initNonce(fromNode, packetNum, extraNonce);
     printBytes("Attempt decrypt with nonce: ", nonce, 13);
@@ -147,9 +149,61 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
 
 void CryptoEngine::setDHPrivateKey(uint8_t *_private_key)
 {
+    if (memcmp(private_key, _private_key, 32) != 0)
+        clearSharedKeyCache();
     memcpy(private_key, _private_key, 32);
 }
 
+/**
+ * Put the shared secret for remotePublic into shared_key.  Deriving it costs a Curve25519 scalar multiplication plus a SHA256,
+ * so results are kept in a small LRU cache.  Keys that fail the weak point check are never cached.
+ */
+bool CryptoEngine::loadSharedKey(const uint8_t *remotePublic)
+{
+    int victim = 0;
+    for (int i = 0; i < SHARED_KEY_CACHE_SIZE; i++) {
+        SharedKeyCacheEntry &e = sharedKeyCache[i];
+        if (e.lastUsed && memcmp(e.remotePublic, remotePublic, sizeof(e.remotePublic)) == 0) {
+            e.lastUsed = ++sharedKeyCacheClock;
+            memcpy(shared_key, e.sharedKey, sizeof(shared_key));
+            sharedKeyCacheHits++;
+            return true;
+        }
+        if (e.lastUsed < sharedKeyCache[victim].lastUsed)
+            victim = i;
+    }
+
+    sharedKeyCacheMisses++;
+    uint8_t remoteCopy[32];
+    memcpy(remoteCopy, remotePublic, sizeof(remoteCopy));
+    if (!setDHPublicKey(remoteCopy)) {
+        return false;
+    }
+    hash(shared_key, 32);
+
+    SharedKeyCacheEntry &e = sharedKeyCache[victim];
+    memcpy(e.remotePublic, remotePublic, sizeof(e.remotePublic));
+    memcpy(e.sharedKey, shared_key, sizeof(e.sharedKey));
+    e.lastUsed = ++sharedKeyCacheClock;
+    return true;
+}
+
+void CryptoEngine::forgetSharedKey(const uint8_t *remotePublic)
+{
+    for (SharedKeyCacheEntry &e : sharedKeyCache) {
+        if (e.lastUsed && memcmp(e.remotePublic, remotePublic, sizeof(e.remotePublic)) == 0) {
+            clean(&e, sizeof(e));
+            return;
+        }
+    }
+}
+
+void CryptoEngine::clearSharedKeyCache()
+{
+    clean(sharedKeyCache, sizeof(sharedKeyCache));
+    sharedKeyCacheClock = 0;
+}
+
 /**
  * Hash arbitrary data using SHA256.
  *
@@ -233,24 +287,88 @@ void CryptoEngine::decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes
     encryptPacket(fromNode, packetId, numBytes, bytes);
 }
 
+void CryptoEngine::decryptWithKey(const CryptoKey &k, uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes)
+{
+    if (k.length > 0) {
+        initNonce(fromNode, packetId);
+        encryptAESCtr(k, nonce, numBytes, bytes);
+    }
+}
+
 // Generic implementation of AES-CTR encryption.
 void CryptoEngine::encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numBytes, uint8_t *bytes)
 {
-    delete ctr;
-    ctr = nullptr;
-    if (_key.length == 16)
-        ctr = new CTR<AES128>();
+    if (_key.length <= 0)
+        return;
+    if (numBytes > MAX_BLOCKSIZE) {
+        LOG_ERROR("Packet too large for crypto engine: %d. noop encryption!", numBytes);
+        return;
+    }
+    int slot = getAESKeySlot(_key);
+
+    // Lay out every counter block the packet needs and encrypt them in one batch, the 32 bit block counter at the end of the
+    // nonce is big endian
+    uint8_t *keystream = ctrKeystream;
+    size_t numBlocks = (numBytes + 15) / 16;
+    uint32_t counter = ((uint32_t)_nonce[12] << 24) | ((uint32_t)_nonce[13] << 16) | ((uint32_t)_nonce[14] << 8) | _nonce[15];
+    for (size_t i = 0; i < numBlocks; i++, counter++) {
+        uint8_t *block = keystream + i * 16;
+        memcpy(block, _nonce, 12);
+        block[12] = counter >> 24;
+        block[13] = counter >> 16;
+        block[14] = counter >> 8;
+        block[15] = counter;
+    }
+    aesEncryptBlocks(slot, keystream, numBlocks);
+
+    for (size_t i = 0; i < numBytes; i++)
+        bytes[i] ^= keystream[i];
+}
+
+int CryptoEngine::getAESKeySlot(const CryptoKey &k)
+{
+    int victim = 0;
+    for (int i = 0; i < AES_KEY_CACHE_SIZE; i++) {
+        AESKeyCacheEntry &e = aesKeyCache[i];
+        if (e.lastUsed && e.key.length == k.length && memcmp(e.key.bytes, k.bytes, k.length) == 0) {
+            e.lastUsed = ++aesKeyCacheClock;
+            return i;
+        }
+        if (e.lastUsed < aesKeyCache[victim].lastUsed)
+            victim = i;
+    }
+
+    AESKeyCacheEntry &e = aesKeyCache[victim];
+    e.key = k;
+    e.lastUsed = ++aesKeyCacheClock;
+    aesKeyChanged(victim);
+    return victim;
+}
+
+void CryptoEngine::aesKeyChanged(int slot)
+{
+    AESKeyCacheEntry &e = aesKeyCache[slot];
+    delete e.cipher;
+    if (e.key.length == 16)
+        e.cipher = new AES128();
     else
-        ctr = new CTR<AES256>();
-    ctr->setKey(_key.bytes, _key.length);
-    static uint8_t scratch[MAX_BLOCKSIZE];
-    memcpy(scratch, bytes, numBytes);
-    memset(scratch + numBytes, 0,
-           sizeof(scratch) - numBytes); // Fill rest of buffer with zero (in case cypher looks at it)
-
-    ctr->setIV(_nonce, 16);
-    ctr->setCounterSize(4);
-    ctr->encrypt(bytes, scratch, numBytes);
+        e.cipher = new AES256();
+    e.cipher->setKey(e.key.bytes, e.key.length);
+}
+
+void CryptoEngine::aesEncryptBlocks(int slot, uint8_t *blocks, size_t numBlocks)
+{
+    BlockCipher *cipher = aesKeyCache[slot].cipher;
+    for (size_t i = 0; i < numBlocks; i++)
+        cipher->encryptBlock(blocks + i * 16, blocks + i * 16);
+}
+
+CryptoEngine::~CryptoEngine()
+{
+    for (AESKeyCacheEntry &e : aesKeyCache) {
+        delete e.cipher; // the cipher classes wipe their own schedule
+        memset(&e.key, 0, sizeof(e.key));
+    }
 }
 
 /**
@@ -1,6 +1,5 @@
 #pragma once
 #include "AES.h"
-#include "CTR.h"
 #include "concurrency/LockGuard.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
@@ -21,6 +20,16 @@ struct CryptoKey {
  */
 
 #define MAX_BLOCKSIZE 256
+
+// How many expanded AES keys to keep around, enough for a handful of busy channels without re-running the key schedule
+#ifndef AES_KEY_CACHE_SIZE
+#define AES_KEY_CACHE_SIZE 4
+#endif
+
+// How many PKI shared secrets to remember, each saves a Curve25519 scalar multiplication per DM to or from that node
+#ifndef SHARED_KEY_CACHE_SIZE
+#define SHARED_KEY_CACHE_SIZE 8
+#endif
 #define TEST_CURVE25519_FIELD_OPS // Exposes Curve25519::isWeakPoint() for testing keys
 
 class CryptoEngine
@@ -30,7 +39,7 @@ class CryptoEngine
     uint8_t public_key[32] = {0};
 #endif
 
-    virtual ~CryptoEngine() {}
+    virtual ~CryptoEngine();
 #if !(MESHTASTIC_EXCLUDE_PKI)
 #if !(MESHTASTIC_EXCLUDE_PKI_KEYGEN)
     virtual void generateKeyPair(uint8_t *pubKey, uint8_t *privKey);
@@ -46,6 +55,14 @@ class CryptoEngine
     virtual bool setDHPublicKey(uint8_t *publicKey);
     virtual void hash(uint8_t *bytes, size_t numBytes);
 
+    /// Drop the cached shared secret for this remote public key, call when a node's key is replaced or removed
+    void forgetSharedKey(const uint8_t *remotePublic);
+
+    /// Wipe every cached shared secret, needed whenever our own private key changes
+    void clearSharedKeyCache();
+
+    uint32_t sharedKeyCacheHits = 0, sharedKeyCacheMisses = 0;
+
     virtual void aesSetKey(const uint8_t *key, size_t key_len);
 
     virtual void aesEncrypt(uint8_t *in, uint8_t *out);
@@ -71,6 +88,12 @@ class CryptoEngine
      */
     virtual void encryptPacket(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
     virtual void decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
+
+    /**
+     * Decrypt a channel packet with an explicit key, leaving whatever setKey() chose alone.  Everything this touches belongs to
+     * this instance, so separate engines can decrypt on separate threads.
+     */
+    void decryptWithKey(const CryptoKey &k, uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
     virtual void encryptAESCtr(CryptoKey key, uint8_t *nonce, size_t numBytes, uint8_t *bytes);
 #ifndef PIO_UNIT_TESTING
   protected:
@@ -78,10 +101,42 @@ class CryptoEngine
     /** Our per packet nonce */
     uint8_t nonce[16] = {0};
     CryptoKey key = {};
-    CTRCommon *ctr = NULL;
+
+    /** Channel keys we have already run the AES key schedule for, most packets reuse one of these */
+    struct AESKeyCacheEntry {
+        CryptoKey key;
+        BlockCipher *cipher;
+        uint32_t lastUsed; // 0 marks an unused entry
+    };
+    AESKeyCacheEntry aesKeyCache[AES_KEY_CACHE_SIZE] = {};
+    uint32_t aesKeyCacheClock = 0;
+
+    /// Counter blocks, and then keystream, for the packet being encrypted
+    uint8_t ctrKeystream[MAX_BLOCKSIZE];
+
+    /// Find (or evict the least recently used entry to make) the cache slot holding this key
+    int getAESKeySlot(const CryptoKey &k);
+
+    /// Called when aesKeyCache[slot] has been given a new key, expand it so aesEncryptBlocks can use it
+    virtual void aesKeyChanged(int slot);
+
+    /// Encrypt numBlocks consecutive 16 byte blocks in place (ECB) with the key in aesKeyCache[slot]
+    virtual void aesEncryptBlocks(int slot, uint8_t *blocks, size_t numBlocks);
 #if !(MESHTASTIC_EXCLUDE_PKI)
     uint8_t shared_key[32] = {0};
     uint8_t private_key[32] = {0};
+
+    /** Shared secrets (SHA256 of the X25519 result) already derived with our current private key */
+    struct SharedKeyCacheEntry {
+        uint8_t remotePublic[32];
+        uint8_t sharedKey[32];
+        uint32_t lastUsed; // 0 marks an unused entry
+    };
+    SharedKeyCacheEntry sharedKeyCache[SHARED_KEY_CACHE_SIZE] = {};
+    uint32_t sharedKeyCacheClock = 0;
+
+    /// Fill shared_key for this remote public key, from the cache when we can
+    bool loadSharedKey(const uint8_t *remotePublic);
 #endif
     /**
      * Init our 128 bit nonce for a new packet
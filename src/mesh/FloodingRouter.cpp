@@ -25,10 +25,7 @@ bool FloodingRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
         printPacket("Ignore dupe incoming msg", p);
         rxDupe++;
 
-        /* If the original transmitter is doing retransmissions (hopStart equals hopLimit) for a reliable transmission, e.g., when
-        the ACK got lost, we will handle the packet again to make sure it gets an implicit ACK. */
-        bool isRepeated = p->hop_start > 0 && p->hop_start == p->hop_limit;
-        if (isRepeated) {
+        if (floodingDupeAction(p) == DUPE_RESEND) {
             LOG_DEBUG("Repeated reliable tx");
             // Check if it's still in the Tx queue, if not, we have to relay it again
             if (!findInTxQueue(p->from, p->id))
@@ -43,11 +40,22 @@ bool FloodingRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
     return Router::shouldFilterReceived(p);
 }
 
+FloodingRouter::DupeAction FloodingRouter::floodingDupeAction(const meshtastic_MeshPacket *p)
+{
+    /* If the original transmitter is doing retransmissions (hopStart equals hopLimit) for a reliable transmission, e.g., when
+    the ACK got lost, we will handle the packet again to make sure it gets an implicit ACK. */
+    return isRepeated(p) ? DUPE_RESEND : DUPE_CANCEL_RELAY;
+}
+
+bool FloodingRouter::isRouterRole(meshtastic_Config_DeviceConfig_Role role)
+{
+    return role == meshtastic_Config_DeviceConfig_Role_ROUTER || role == meshtastic_Config_DeviceConfig_Role_REPEATER ||
+           role == meshtastic_Config_DeviceConfig_Role_ROUTER_LATE;
+}
+
 void FloodingRouter::perhapsCancelDupe(const meshtastic_MeshPacket *p)
 {
-    if (config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER &&
-        config.device.role != meshtastic_Config_DeviceConfig_Role_REPEATER &&
-        config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER_LATE) {
+    if (!isRouterRole(config.device.role)) {
         // cancel rebroadcast of this message *if* there was already one, unless we're a router/repeater!
         if (Router::cancelSending(p->from, p->id))
             txRelayCanceled++;
@@ -59,45 +67,51 @@ void FloodingRouter::perhapsCancelDupe(const meshtastic_MeshPacket *p)
 
 bool FloodingRouter::isRebroadcaster()
 {
-    return config.device.role != meshtastic_Config_DeviceConfig_Role_CLIENT_MUTE &&
-           config.device.rebroadcast_mode != meshtastic_Config_DeviceConfig_RebroadcastMode_NONE;
+    return isRebroadcaster(config.device.role, config.device.rebroadcast_mode);
 }
 
-void FloodingRouter::perhapsRebroadcast(const meshtastic_MeshPacket *p)
+bool FloodingRouter::isRebroadcaster(meshtastic_Config_DeviceConfig_Role role,
+                                     meshtastic_Config_DeviceConfig_RebroadcastMode rebroadcastMode)
 {
-    if (!isToUs(p) && (p->hop_limit > 0) && !isFromUs(p)) {
-        if (p->id != 0) {
-            if (isRebroadcaster()) {
-                meshtastic_MeshPacket *tosend = packetPool.allocCopy(*p); // keep a copy because we will be sending it
+    return role != meshtastic_Config_DeviceConfig_Role_CLIENT_MUTE &&
+           rebroadcastMode != meshtastic_Config_DeviceConfig_RebroadcastMode_NONE;
+}
 
-                tosend->hop_limit--; // bump down the hop count
+void FloodingRouter::prepareRebroadcast(meshtastic_MeshPacket *tosend)
+{
+    tosend->hop_limit--; // bump down the hop count
 #if USERPREFS_EVENT_MODE
-                if (tosend->hop_limit > 2) {
-                    // if we are "correcting" the hop_limit, "correct" the hop_start by the same amount to preserve hops away.
-                    tosend->hop_start -= (tosend->hop_limit - 2);
-                    tosend->hop_limit = 2;
-                }
+    if (tosend->hop_limit > 2) {
+        // if we are "correcting" the hop_limit, "correct" the hop_start by the same amount to preserve hops away.
+        tosend->hop_start -= (tosend->hop_limit - 2);
+        tosend->hop_limit = 2;
+    }
 #endif
-                tosend->next_hop = NO_NEXT_HOP_PREFERENCE; // this should already be the case, but just in case
-
-                LOG_INFO("Rebroadcast received floodmsg");
-                // Note: we are careful to resend using the original senders node id
-                // We are careful not to call our hooked version of send() - because we don't want to check this again
-                Router::send(tosend);
-            } else {
-                LOG_DEBUG("No rebroadcast: Role = CLIENT_MUTE or Rebroadcast Mode = NONE");
-            }
+    tosend->next_hop = NO_NEXT_HOP_PREFERENCE; // this should already be the case, but just in case
+}
+
+void FloodingRouter::perhapsRebroadcast(const meshtastic_MeshPacket *p)
+{
+    if (shouldRebroadcast(p, isToUs(p), isFromUs(p))) {
+        if (isRebroadcaster()) {
+            meshtastic_MeshPacket *tosend = packetPool.allocCopy(*p); // keep a copy because we will be sending it
+            prepareRebroadcast(tosend);
+
+            LOG_INFO("Rebroadcast received floodmsg");
+            // Note: we are careful to resend using the original senders node id
+            // We are careful not to call our hooked version of send() - because we don't want to check this again
+            Router::send(tosend);
         } else {
-            LOG_DEBUG("Ignore 0 id broadcast");
+            LOG_DEBUG("No rebroadcast: Role = CLIENT_MUTE or Rebroadcast Mode = NONE");
         }
+    } else if (p->id == 0 && !isToUs(p)) {
+        LOG_DEBUG("Ignore 0 id broadcast");
     }
 }
 
 void FloodingRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Routing *c)
 {
-    bool isAckorReply = (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) &&
-                        (p->decoded.request_id != 0 || p->decoded.reply_id != 0);
-    if (isAckorReply && !isToUs(p) && !isBroadcast(p->to)) {
+    if (isAckOrReply(p) && !isToUs(p) && !isBroadcast(p->to)) {
         // do not flood direct message that is ACKed or replied to
         LOG_DEBUG("Rxd an ACK/reply not for me, cancel rebroadcast");
         Router::cancelSending(p->to, p->decoded.request_id); // cancel rebroadcast for this DM
@@ -45,6 +45,45 @@ class FloodingRouter : public Router
      */
     virtual ErrorCode send(meshtastic_MeshPacket *p) override;
 
+    /**
+     * The routing rules of this router and its subclasses, as functions of the packet and what a node knows about itself, so
+     * MeshSim can run them for each of its virtual nodes
+     */
+
+    /// What shouldFilterReceived() does about a dupe
+    enum DupeAction : uint8_t {
+        DUPE_IGNORE,
+        DUPE_CANCEL_RELAY,  // someone beat us to it, drop our own relay unless we're a router
+        DUPE_RESEND,        // relay again if it already left our TX queue
+        DUPE_RESEND_OR_ACK, // as DUPE_RESEND, and if we won't relay but it's for us and wants one, ACK again
+    };
+
+    static DupeAction floodingDupeAction(const meshtastic_MeshPacket *p);
+
+    /// The original transmitter is retransmitting a reliable packet, e.g. when the ACK got lost
+    static bool isRepeated(const meshtastic_MeshPacket *p) { return p->hop_start > 0 && p->hop_start == p->hop_limit; }
+
+    static bool isAckOrReply(const meshtastic_MeshPacket *p)
+    {
+        return p->which_payload_variant == meshtastic_MeshPacket_decoded_tag &&
+               (p->decoded.request_id != 0 || p->decoded.reply_id != 0);
+    }
+
+    /// Would we rebroadcast this flood, if we rebroadcast at all
+    static bool shouldRebroadcast(const meshtastic_MeshPacket *p, bool toUs, bool fromUs)
+    {
+        return !toUs && !fromUs && p->hop_limit > 0 && p->id != 0;
+    }
+
+    /// Turn our copy of a received flood into the one we rebroadcast
+    static void prepareRebroadcast(meshtastic_MeshPacket *tosend);
+
+    static bool isRebroadcaster(meshtastic_Config_DeviceConfig_Role role,
+                                meshtastic_Config_DeviceConfig_RebroadcastMode rebroadcastMode);
+
+    /// Roles that never cancel their relay because someone else relayed first
+    static bool isRouterRole(meshtastic_Config_DeviceConfig_Role role);
+
   protected:
     /**
      * Should this incoming filter be dropped?
@@ -2,11 +2,21 @@
 
 #include <Arduino.h>
 #include <assert.h>
+#include <atomic>
 #include <functional>
 #include <memory>
 
+#include "DebugConfiguration.h"
 #include "PointerQueue.h"
 
+/// Usage counters for an allocator, all zero for allocators that don't keep them
+struct AllocatorStats {
+    uint32_t capacity;      // buffers in the fixed slab
+    uint32_t inUse;         // buffers currently handed out, including heap fallbacks
+    uint32_t highWaterMark; // most buffers ever handed out at once
+    uint32_t exhausted;     // allocations that found the slab empty and fell back to the heap
+};
+
 template <class T> class Allocator
 {
 
@@ -65,6 +75,8 @@ template <class T> class Allocator
     /// Return a buffer for use by others
     virtual void release(T *p) = 0;
 
+    virtual AllocatorStats getStats() { return AllocatorStats(); }
+
   protected:
     // Alloc some storage
     virtual T *alloc(TickType_t maxWait) = 0;
@@ -96,3 +108,137 @@ template <class T> class MemoryDynamic : public Allocator<T>
         return p;
     }
 };
+
+/**
+ * An allocator that hands out buffers from a slab allocated once at construction, so steady state traffic never touches the
+ * heap.  Free buffers are kept on a lock-free stack (an index plus an ABA tag packed into one atomic word), which makes alloc
+ * and release safe to call from ISRs and other threads.  If the slab runs dry we fall back to malloc rather than failing, and
+ * count it so the capacity can be tuned for the build.
+ *
+ * Build with -DDEBUG_MEMORY_POOL to track the state of each slab buffer: releasing a buffer twice is caught and ignored, and
+ * released buffers are poisoned so writes after release are reported when the buffer is handed out again.
+ */
+template <class T> class MemoryPool : public Allocator<T>
+{
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    T *buf;
+    uint16_t maxElements;
+    std::atomic<uint16_t> *nextFree;
+    std::atomic<uint32_t> freeHead; // tag << 16 | index of first free buffer
+    std::atomic<uint32_t> inUse{0}, highWaterMark{0}, exhausted{0};
+
+#ifdef DEBUG_MEMORY_POOL
+    static constexpr uint8_t POISON = 0xA5;
+    enum SlotState : uint8_t { SLOT_FREE, SLOT_USED };
+    std::atomic<uint8_t> *state;
+#endif
+
+    bool owns(const T *p) const { return p >= buf && p < buf + maxElements; }
+
+    void push(uint16_t i)
+    {
+        uint32_t head = freeHead.load(std::memory_order_relaxed);
+        uint32_t next;
+        do {
+            nextFree[i].store(head & 0xFFFF, std::memory_order_relaxed);
+            next = ((head + 0x10000) & 0xFFFF0000) | i;
+        } while (!freeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    uint16_t pop()
+    {
+        uint32_t head = freeHead.load(std::memory_order_acquire);
+        uint32_t next;
+        do {
+            if ((head & 0xFFFF) == NONE)
+                return NONE;
+            next = ((head + 0x10000) & 0xFFFF0000) | nextFree[head & 0xFFFF].load(std::memory_order_relaxed);
+        } while (!freeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire));
+        return head & 0xFFFF;
+    }
+
+  public:
+    explicit MemoryPool(uint16_t _maxElements) : maxElements(_maxElements), freeHead(NONE)
+    {
+        assert(maxElements < NONE);
+        buf = (T *)calloc(maxElements, sizeof(T));
+        nextFree = new std::atomic<uint16_t>[maxElements];
+        assert(buf && nextFree);
+#ifdef DEBUG_MEMORY_POOL
+        state = new std::atomic<uint8_t>[maxElements];
+        memset(buf, POISON, maxElements * sizeof(T));
+#endif
+        for (int i = maxElements - 1; i >= 0; i--) {
+#ifdef DEBUG_MEMORY_POOL
+            state[i].store(SLOT_FREE);
+#endif
+            push(i);
+        }
+    }
+
+    ~MemoryPool()
+    {
+        free(buf);
+        delete[] nextFree;
+#ifdef DEBUG_MEMORY_POOL
+        delete[] state;
+#endif
+    }
+
+    /// Return a buffer for use by others
+    virtual void release(T *p) override
+    {
+        assert(p);
+        if (!owns(p)) {
+            free(p); // came from the heap because we were exhausted
+        } else {
+            uint16_t i = p - buf;
+            assert(p == buf + i); // must point at the start of a buffer
+#ifdef DEBUG_MEMORY_POOL
+            if (state[i].exchange(SLOT_FREE) == SLOT_FREE) {
+                LOG_ERROR("MemoryPool double free of buffer %u", i);
+                return; // pushing it again would corrupt the free list
+            }
+            memset(p, POISON, sizeof(T));
+#endif
+            push(i);
+        }
+        inUse.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    virtual AllocatorStats getStats() override
+    {
+        return AllocatorStats{maxElements, inUse.load(), highWaterMark.load(), exhausted.load()};
+    }
+
+  protected:
+    // Alloc some storage
+    virtual T *alloc(TickType_t maxWait) override
+    {
+        uint32_t used = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t high = highWaterMark.load(std::memory_order_relaxed);
+        while (used > high && !highWaterMark.compare_exchange_weak(high, used, std::memory_order_relaxed))
+            ;
+
+        uint16_t i = pop();
+        if (i == NONE) {
+            exhausted.fetch_add(1, std::memory_order_relaxed);
+            T *p = (T *)malloc(sizeof(T));
+            assert(p);
+            return p;
+        }
+
+#ifdef DEBUG_MEMORY_POOL
+        state[i].store(SLOT_USED);
+        const uint8_t *bytes = (const uint8_t *)&buf[i];
+        for (size_t b = 0; b < sizeof(T); b++) {
+            if (bytes[b] != POISON) {
+                LOG_ERROR("MemoryPool buffer %u was written after release (offset %u)", i, b);
+                break;
+            }
+        }
+#endif
+        return &buf[i];
+    }
+};
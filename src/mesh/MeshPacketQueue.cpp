@@ -5,34 +5,109 @@
 
 #include <algorithm>
 
-/// @return the priority of the specified packet
-inline uint32_t getPriority(const meshtastic_MeshPacket *p)
+/**
+ * Packets are sent in rank order.  Packets in the late transmit window go after all others, then higher priorities go first,
+ * and for equal priorities we prefer packets already on mesh over our own.
+ */
+uint16_t MeshPacketQueue::rankOf(const meshtastic_MeshPacket *p) const
 {
-    auto pri = p->priority;
-    return pri;
+    uint16_t pri = p->priority > meshtastic_MeshPacket_Priority_MAX ? meshtastic_MeshPacket_Priority_MAX : p->priority;
+    bool fromUs = ownerNodeNum ? (p->from == 0 || p->from == ownerNodeNum) : isFromUs(p);
+    return (p->tx_after ? LATE_RANK : 0) | ((meshtastic_MeshPacket_Priority_MAX - pri) << 1) | (fromUs ? 1 : 0);
 }
 
-/// @return "true" if "p1" is ordered before "p2"
-bool CompareMeshPacketFunc(const meshtastic_MeshPacket *p1, const meshtastic_MeshPacket *p2)
+MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen)
 {
-    assert(p1 && p2);
+    assert(maxLen < NONE);
+    entries.resize(maxLen);
+    freeEntries.reserve(maxLen);
+    for (size_t i = maxLen; i > 0; i--)
+        freeEntries.push_back(i - 1);
+    for (uint16_t r = 0; r < NUM_RANKS; r++)
+        rankHead[r] = NONE;
+
+    size_t hashSize = 8;
+    while (hashSize < maxLen)
+        hashSize <<= 1;
+    hashHeads.assign(hashSize, NONE);
+    hashMask = hashSize - 1;
+}
 
-    // If one packet is in the late transmit window, prefer the other one
-    if ((bool)p1->tx_after != (bool)p2->tx_after) {
-        return !p1->tx_after;
+bool MeshPacketQueue::empty()
+{
+    return count == 0;
+}
+
+void MeshPacketQueue::insertEntry(meshtastic_MeshPacket *p)
+{
+    uint16_t e = freeEntries.back();
+    freeEntries.pop_back();
+    count++;
+
+    Entry &entry = entries[e];
+    entry.p = p;
+    entry.seq = nextSeq++;
+    entry.rank = rankOf(p);
+
+    // Append to the tail of its rank's FIFO
+    uint16_t &head = rankHead[entry.rank];
+    if (head == NONE) {
+        head = entry.prev = entry.next = e;
+        rankBitmap[entry.rank / 32] |= 1UL << (entry.rank % 32);
+    } else {
+        uint16_t tail = entries[head].prev;
+        entry.prev = tail;
+        entry.next = head;
+        entries[tail].next = e;
+        entries[head].prev = e;
     }
 
-    auto p1p = getPriority(p1), p2p = getPriority(p2);
-    // If priorities differ, use that
-    // for equal priorities, prefer packets already on mesh.
-    return (p1p != p2p) ? (p1p > p2p) : (!isFromUs(p1) && isFromUs(p2));
+    uint16_t &chain = hashHeads[hashOf(getFrom(p), p->id)];
+    entry.hashNext = chain;
+    chain = e;
 }
 
-MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen) {}
+void MeshPacketQueue::removeEntry(uint16_t e)
+{
+    Entry &entry = entries[e];
+
+    uint16_t &head = rankHead[entry.rank];
+    if (entry.next == e) {
+        head = NONE;
+        rankBitmap[entry.rank / 32] &= ~(1UL << (entry.rank % 32));
+    } else {
+        entries[entry.prev].next = entry.next;
+        entries[entry.next].prev = entry.prev;
+        if (head == e)
+            head = entry.next;
+    }
 
-bool MeshPacketQueue::empty()
+    uint16_t *link = &hashHeads[hashOf(getFrom(entry.p), entry.p->id)];
+    while (*link != e)
+        link = &entries[*link].hashNext;
+    *link = entry.hashNext;
+
+    entry.p = NULL;
+    freeEntries.push_back(e);
+    count--;
+}
+
+uint16_t MeshPacketQueue::firstRank(uint16_t begin, uint16_t end) const
 {
-    return queue.empty();
+    for (uint16_t w = begin / 32; w < end / 32; w++) {
+        if (rankBitmap[w])
+            return w * 32 + __builtin_ctz(rankBitmap[w]);
+    }
+    return NONE;
+}
+
+uint16_t MeshPacketQueue::lastRank(uint16_t begin, uint16_t end) const
+{
+    for (uint16_t w = end / 32; w > begin / 32; w--) {
+        if (rankBitmap[w - 1])
+            return (w - 1) * 32 + 31 - __builtin_clz(rankBitmap[w - 1]);
+    }
+    return NONE;
 }
 
 /**
@@ -68,7 +143,7 @@ void fixPriority(meshtastic_MeshPacket *p)
 bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
 {
     // no space - try to replace a lower priority packet in the queue
-    if (queue.size() >= maxLen) {
+    if (count >= maxLen) {
         bool replaced = replaceLowerPriorityPacket(p);
         if (!replaced) {
             LOG_WARN("TX queue is full, and there is no lower-priority packet available to evict in favour of 0x%08x", p->id);
@@ -76,52 +151,60 @@ bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
         return replaced;
     }
 
-    // Find the correct position using upper_bound to maintain a stable order
-    auto it = std::upper_bound(queue.begin(), queue.end(), p, CompareMeshPacketFunc);
-    queue.insert(it, p); // Insert packet at the found position
+    insertEntry(p);
     return true;
 }
 
 meshtastic_MeshPacket *MeshPacketQueue::dequeue()
 {
-    if (empty()) {
+    uint16_t rank = firstRank(0, NUM_RANKS);
+    if (rank == NONE) {
         return NULL;
     }
 
-    auto *p = queue.front();
-    queue.erase(queue.begin()); // Remove the highest-priority packet
+    uint16_t e = rankHead[rank];
+    auto *p = entries[e].p;
+    removeEntry(e); // Remove the highest-priority packet
     return p;
 }
 
 meshtastic_MeshPacket *MeshPacketQueue::getFront()
 {
-    if (empty()) {
+    uint16_t rank = firstRank(0, NUM_RANKS);
+    if (rank == NONE) {
         return NULL;
     }
 
-    auto *p = queue.front();
-    return p;
+    return entries[rankHead[rank]].p;
 }
 
 /** Attempt to find and remove a packet from this queue.  Returns a pointer to the removed packet, or NULL if not found */
 meshtastic_MeshPacket *MeshPacketQueue::remove(NodeNum from, PacketId id, bool tx_normal, bool tx_late)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto p = (*it);
+    // Should there be several matches, remove the one that would have been sent first
+    uint16_t best = NONE;
+    for (uint16_t e = hashHeads[hashOf(from, id)]; e != NONE; e = entries[e].hashNext) {
+        auto p = entries[e].p;
         if (getFrom(p) == from && p->id == id && ((tx_normal && !p->tx_after) || (tx_late && p->tx_after))) {
-            queue.erase(it);
-            return p;
+            if (best == NONE || entries[e].rank < entries[best].rank ||
+                (entries[e].rank == entries[best].rank && (int32_t)(entries[e].seq - entries[best].seq) < 0))
+                best = e;
         }
     }
 
-    return NULL;
+    if (best == NONE)
+        return NULL;
+
+    auto p = entries[best].p;
+    removeEntry(best);
+    return p;
 }
 
 /* Attempt to find a packet from this queue. Return true if it was found. */
 bool MeshPacketQueue::find(NodeNum from, PacketId id)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto p = (*it);
+    for (uint16_t e = hashHeads[hashOf(from, id)]; e != NONE; e = entries[e].hashNext) {
+        auto p = entries[e].p;
         if (getFrom(p) == from && p->id == id) {
             return true;
         }
@@ -131,45 +214,33 @@ bool MeshPacketQueue::find(NodeNum from, PacketId id)
 }
 
 /**
- * Attempt to find a lower-priority packet in the queue and replace it with the provided one.
+ * Attempt to find a lower-priority packet in the queue and replace it with the provided one.  Only packets outside the late
+ * transmit window are candidates, and of those the one that would be sent last.
  * @return True if the replacement succeeded, false otherwise
  */
 bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
 {
 
-    if (queue.empty()) {
+    if (empty()) {
         return false; // No packets to replace
     }
 
-    // Check if the packet at the back has a lower priority than the new packet
-    auto *backPacket = queue.back();
-    if (!backPacket->tx_after && backPacket->priority < p->priority) {
-        LOG_WARN("Dropping packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x", backPacket->id, p->id);
-        // Remove the back packet
-        queue.pop_back();
-        packetPool.release(backPacket);
-        // Insert the new packet in the correct order
-        enqueue(p);
-        return true;
+    uint16_t rank = lastRank(0, LATE_RANK);
+    if (rank == NONE) {
+        return false; // Everything is in the late window
     }
 
-    if (backPacket->tx_after) {
-        // Check if there's a non-late packet with lower priority
-        auto it = queue.end();
-        auto refPacket = *--it;
-        for (; refPacket->tx_after && it != queue.begin(); refPacket = *--it)
-            ;
-        if (!refPacket->tx_after && refPacket->priority < p->priority) {
-            LOG_WARN("Dropping non-late packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x",
-                     refPacket->id, p->id);
-            queue.erase(it);
-            packetPool.release(refPacket);
-            // Insert the new packet in the correct order
-            enqueue(p);
-            return true;
-        }
+    uint16_t e = entries[rankHead[rank]].prev; // newest packet of the worst rank
+    auto *refPacket = entries[e].p;
+    if (refPacket->priority < p->priority) {
+        LOG_WARN("Dropping packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x", refPacket->id, p->id);
+        removeEntry(e);
+        (pool ? *pool : packetPool).release(refPacket);
+        // Insert the new packet in the correct order
+        insertEntry(p);
+        return true;
     }
 
     // If the back packet's priority is not lower, no replacement occurs
     return false;
-}
\ No newline at end of file
+}
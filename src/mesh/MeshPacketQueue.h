@@ -2,15 +2,51 @@
 
 #include "MeshTypes.h"
 
-#include <queue>
+#include <vector>
 
 /**
  * A priority queue of packets
+ *
+ * Packets are ordered by (late transmit window, priority, whether they came from us), and FIFO among equals.  Each distinct
+ * ordering key gets its own FIFO bucket and a bitmap tracks which buckets are non-empty, so enqueue, dequeue and removal never
+ * shift other packets around.  A (from, id) hash chain makes find and remove independent of the queue depth.
  */
 class MeshPacketQueue
 {
+    static constexpr uint16_t NONE = 0xFFFF;
+    static constexpr uint16_t NUM_RANKS = 512; // late bit, 7 priority bits, from us bit
+    static constexpr uint16_t LATE_RANK = 256; // first rank of the late transmit window
+
+    struct Entry {
+        meshtastic_MeshPacket *p;
+        uint32_t seq;        // enqueue order, breaks ties between packets of the same rank
+        uint16_t rank;       // lower ranks are sent first
+        uint16_t prev, next; // circular list of packets with the same rank, oldest first
+        uint16_t hashNext;   // next entry in the same (from, id) hash chain
+    };
+
     size_t maxLen;
-    std::vector<meshtastic_MeshPacket *> queue;
+    size_t count = 0;
+    uint32_t nextSeq = 0;
+    std::vector<Entry> entries;
+    std::vector<uint16_t> freeEntries;
+    uint16_t rankHead[NUM_RANKS];
+    uint32_t rankBitmap[NUM_RANKS / 32] = {0};
+    std::vector<uint16_t> hashHeads;
+    uint32_t hashMask;
+    NodeNum ownerNodeNum = 0;                        // 0 for nodeDB's
+    Allocator<meshtastic_MeshPacket> *pool = nullptr; // what dropped packets go back to, nullptr for packetPool
+
+    uint16_t rankOf(const meshtastic_MeshPacket *p) const;
+    uint32_t hashOf(NodeNum from, PacketId id) const { return ((from * 0x9E3779B1U) ^ id) & hashMask; }
+
+    void insertEntry(meshtastic_MeshPacket *p);
+    void removeEntry(uint16_t e);
+
+    /// @return lowest non-empty rank in [begin, end), or NONE
+    uint16_t firstRank(uint16_t begin, uint16_t end) const;
+    /// @return highest non-empty rank in [begin, end), or NONE
+    uint16_t lastRank(uint16_t begin, uint16_t end) const;
 
     /** Replace a lower priority package in the queue with 'mp' (provided there are lower pri packages). Return true if replaced.
      */
@@ -19,6 +55,13 @@ class MeshPacketQueue
   public:
     explicit MeshPacketQueue(size_t _maxLen);
 
+    /// For running many nodes in one process, as MeshSim does: whose queue this is, and the allocator its packets came from
+    void setOwner(NodeNum nodeNum, Allocator<meshtastic_MeshPacket> *_pool = nullptr)
+    {
+        ownerNodeNum = nodeNum;
+        pool = _pool;
+    }
+
     /** enqueue a packet, return false if full */
     bool enqueue(meshtastic_MeshPacket *p);
 
@@ -26,7 +69,7 @@ class MeshPacketQueue
     bool empty();
 
     /** return amount of free packets in Queue */
-    size_t getFree() { return maxLen - queue.size(); }
+    size_t getFree() { return maxLen - count; }
 
     /** return total size of the Queue */
     size_t getMaxLen() { return maxLen; }
@@ -40,4 +83,4 @@ class MeshPacketQueue
 
     /* Attempt to find a packet from this queue. Return true if it was found. */
     bool find(NodeNum from, PacketId id);
-};
\ No newline at end of file
+};
@@ -45,11 +45,13 @@ the new node can build its node db)
 
 MeshService *service;
 
-static MemoryDynamic<meshtastic_MqttClientProxyMessage> staticMqttClientProxyMessagePool;
+// Sized to match the toPhone queues below, overflow falls back to the heap.  Proxy messages are large and rarely queue up, so
+// only keep a few of those in the slab.
+static MemoryPool<meshtastic_MqttClientProxyMessage> staticMqttClientProxyMessagePool(POOL_RX_TOPHONE / 4);
 
-static MemoryDynamic<meshtastic_QueueStatus> staticQueueStatusPool;
+static MemoryPool<meshtastic_QueueStatus> staticQueueStatusPool(POOL_RX_TOPHONE);
 
-static MemoryDynamic<meshtastic_ClientNotification> staticClientNotificationPool;
+static MemoryPool<meshtastic_ClientNotification> staticClientNotificationPool(POOL_RX_TOPHONE / 2);
 
 Allocator<meshtastic_MqttClientProxyMessage> &mqttClientProxyMessagePool = staticMqttClientProxyMessagePool;
 
@@ -20,14 +20,19 @@ ErrorCode NextHopRouter::send(meshtastic_MeshPacket *p)
     p->next_hop = getNextHop(p->to, p->relay_node); // set the next hop
     LOG_DEBUG("Setting next hop for packet with dest %x to %x", p->to, p->next_hop);
 
-    // If it's from us, ReliableRouter already handles retransmissions if want_ack is set. If a next hop is set and hop limit is
-    // not 0 or want_ack is set, start retransmissions
-    if ((!isFromUs(p) || !p->want_ack) && p->next_hop != NO_NEXT_HOP_PREFERENCE && (p->hop_limit > 0 || p->want_ack))
+    if (shouldStartRetransmission(p, isFromUs(p)))
         startRetransmission(packetPool.allocCopy(*p)); // start retransmission for relayed packet
 
     return Router::send(p);
 }
 
+bool NextHopRouter::shouldStartRetransmission(const meshtastic_MeshPacket *p, bool fromUs)
+{
+    // If it's from us, ReliableRouter already handles retransmissions if want_ack is set. If a next hop is set and hop limit is
+    // not 0 or want_ack is set, start retransmissions
+    return (!fromUs || !p->want_ack) && p->next_hop != NO_NEXT_HOP_PREFERENCE && (p->hop_limit > 0 || p->want_ack);
+}
+
 bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 {
     bool wasFallback = false;
@@ -37,21 +42,22 @@ bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
         rxDupe++;
         stopRetransmission(p->from, p->id);
 
-        // If it was a fallback to flooding, try to relay again
-        if (wasFallback) {
+        switch (nextHopDupeAction(p, wasFallback, weWereNextHop)) {
+        case DUPE_RESEND:
             LOG_INFO("Fallback to flooding from relay_node=0x%x", p->relay_node);
             // Check if it's still in the Tx queue, if not, we have to relay it again
             if (!findInTxQueue(p->from, p->id))
                 perhapsRelay(p);
-        } else {
-            bool isRepeated = p->hop_start > 0 && p->hop_start == p->hop_limit;
-            // If repeated and not in Tx queue anymore, try relaying again, or if we are the destination, send the ACK again
-            if (isRepeated) {
-                if (!findInTxQueue(p->from, p->id) && !perhapsRelay(p) && isToUs(p) && p->want_ack)
-                    sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, p->channel, 0);
-            } else if (!weWereNextHop) {
-                perhapsCancelDupe(p); // If it's a dupe, cancel relay if we were not explicitly asked to relay
-            }
+            break;
+        case DUPE_RESEND_OR_ACK:
+            if (!findInTxQueue(p->from, p->id) && !perhapsRelay(p) && isToUs(p) && p->want_ack)
+                sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, p->channel, 0);
+            break;
+        case DUPE_CANCEL_RELAY:
+            perhapsCancelDupe(p);
+            break;
+        case DUPE_IGNORE:
+            break;
         }
         return true;
     }
@@ -59,22 +65,29 @@ bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
     return Router::shouldFilterReceived(p);
 }
 
+FloodingRouter::DupeAction NextHopRouter::nextHopDupeAction(const meshtastic_MeshPacket *p, bool wasFallback, bool weWereNextHop)
+{
+    // If it was a fallback to flooding, try to relay again
+    if (wasFallback)
+        return DUPE_RESEND;
+    // If repeated and not in Tx queue anymore, try relaying again, or if we are the destination, send the ACK again
+    if (isRepeated(p))
+        return DUPE_RESEND_OR_ACK;
+    // If it's a dupe, cancel relay if we were not explicitly asked to relay
+    return weWereNextHop ? DUPE_IGNORE : DUPE_CANCEL_RELAY;
+}
+
 void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Routing *c)
 {
     NodeNum ourNodeNum = getNodeNum();
     uint8_t ourRelayID = nodeDB->getLastByteOfNodeNum(ourNodeNum);
-    bool isAckorReply = (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) &&
-                        (p->decoded.request_id != 0 || p->decoded.reply_id != 0);
-    if (isAckorReply) {
+    if (isAckOrReply(p)) {
         // Update next-hop for the original transmitter of this successful transmission to the relay node, but ONLY if "from" is
         // not 0 (means implicit ACK) and original packet was also relayed by this node, or we sent it directly to the destination
         if (p->from != 0) {
             meshtastic_NodeInfoLite *origTx = nodeDB->getMeshNode(p->from);
             if (origTx) {
-                // Either relayer of ACK was also a relayer of the packet, or we were the relayer and the ACK came directly from
-                // the destination
-                if (wasRelayer(p->relay_node, p->decoded.request_id, p->to) ||
-                    (wasRelayer(ourRelayID, p->decoded.request_id, p->to) && p->hop_start != 0 && p->hop_start == p->hop_limit)) {
+                if (ackConfirmsNextHop(*this, p, ourRelayID)) {
                     if (origTx->next_hop != p->relay_node) { // Not already set
                         LOG_INFO("Update next hop of 0x%x to 0x%x based on ACK/reply", p->from, p->relay_node);
                         origTx->next_hop = p->relay_node;
@@ -95,28 +108,39 @@ void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtast
     Router::sniffReceived(p, c);
 }
 
+bool NextHopRouter::ackConfirmsNextHop(PacketHistory &history, const meshtastic_MeshPacket *p, uint8_t ourRelayID)
+{
+    // Either relayer of ACK was also a relayer of the packet, or we were the relayer and the ACK came directly from the
+    // destination
+    return history.wasRelayer(p->relay_node, p->decoded.request_id, p->to) ||
+           (history.wasRelayer(ourRelayID, p->decoded.request_id, p->to) && isRepeated(p));
+}
+
 /* Check if we should be relaying this packet if so, do so. */
 bool NextHopRouter::perhapsRelay(const meshtastic_MeshPacket *p)
 {
-    if (!isToUs(p) && !isFromUs(p) && p->hop_limit > 0) {
-        if (p->next_hop == NO_NEXT_HOP_PREFERENCE || p->next_hop == nodeDB->getLastByteOfNodeNum(getNodeNum())) {
-            if (isRebroadcaster()) {
-                meshtastic_MeshPacket *tosend = packetPool.allocCopy(*p); // keep a copy because we will be sending it
-                LOG_INFO("Relaying received message coming from %x", p->relay_node);
+    if (shouldRelay(p, isToUs(p), isFromUs(p), nodeDB->getLastByteOfNodeNum(getNodeNum()))) {
+        if (isRebroadcaster()) {
+            meshtastic_MeshPacket *tosend = packetPool.allocCopy(*p); // keep a copy because we will be sending it
+            LOG_INFO("Relaying received message coming from %x", p->relay_node);
 
-                tosend->hop_limit--; // bump down the hop count
-                NextHopRouter::send(tosend);
+            tosend->hop_limit--; // bump down the hop count
+            NextHopRouter::send(tosend);
 
-                return true;
-            } else {
-                LOG_DEBUG("Not rebroadcasting: Role = CLIENT_MUTE or Rebroadcast Mode = NONE");
-            }
+            return true;
+        } else {
+            LOG_DEBUG("Not rebroadcasting: Role = CLIENT_MUTE or Rebroadcast Mode = NONE");
         }
     }
 
     return false;
 }
 
+bool NextHopRouter::shouldRelay(const meshtastic_MeshPacket *p, bool toUs, bool fromUs, uint8_t ourRelayID)
+{
+    return !toUs && !fromUs && p->hop_limit > 0 && (p->next_hop == NO_NEXT_HOP_PREFERENCE || p->next_hop == ourRelayID);
+}
+
 /**
  * Get the next hop for a destination, given the relay node
  * @return the node number of the next hop, 0 if no preference (fallback to FloodingRouter)
@@ -128,15 +152,19 @@ uint8_t NextHopRouter::getNextHop(NodeNum to, uint8_t relay_node)
         return NO_NEXT_HOP_PREFERENCE;
 
     meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(to);
-    if (node && node->next_hop) {
-        // We are careful not to return the relay node as the next hop
-        if (node->next_hop != relay_node) {
-            // LOG_DEBUG("Next hop for 0x%x is 0x%x", to, node->next_hop);
-            return node->next_hop;
-        } else
-            LOG_WARN("Next hop for 0x%x is 0x%x, same as relayer; set no pref", to, node->next_hop);
-    }
-    return NO_NEXT_HOP_PREFERENCE;
+    uint8_t knownNextHop = node ? node->next_hop : NO_NEXT_HOP_PREFERENCE;
+    uint8_t nextHop = chooseNextHop(to, knownNextHop, relay_node);
+    if (knownNextHop != NO_NEXT_HOP_PREFERENCE && nextHop == NO_NEXT_HOP_PREFERENCE)
+        LOG_WARN("Next hop for 0x%x is 0x%x, same as relayer; set no pref", to, knownNextHop);
+    return nextHop;
+}
+
+uint8_t NextHopRouter::chooseNextHop(NodeNum to, uint8_t knownNextHop, uint8_t relayNode)
+{
+    if (isBroadcast(to))
+        return NO_NEXT_HOP_PREFERENCE;
+    // We are careful not to return the relay node as the next hop
+    return knownNextHop != relayNode ? knownNextHop : NO_NEXT_HOP_PREFERENCE;
 }
 
 PendingPacket *NextHopRouter::findPendingPacket(GlobalPacketId key)
@@ -162,18 +190,11 @@ bool NextHopRouter::stopRetransmission(GlobalPacketId key)
     auto old = findPendingPacket(key);
     if (old) {
         auto p = old->packet;
-        /* Only when we already transmitted a packet via LoRa, we will cancel the packet in the Tx queue
-          to avoid canceling a transmission if it was ACKed super fast via MQTT */
-        if (old->numRetransmissions < NUM_RELIABLE_RETX - 1) {
-            // We only cancel it if we are the original sender or if we're not a router(_late)/repeater
-            if (isFromUs(p) || (config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER &&
-                                config.device.role != meshtastic_Config_DeviceConfig_Role_REPEATER &&
-                                config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER_LATE)) {
-                // remove the 'original' (identified by originator and packet->id) from the txqueue and free it
-                cancelSending(getFrom(p), p->id);
-                // now free the pooled copy for retransmission too
-                packetPool.release(p);
-            }
+        if (cancelsOnStop(old->numRetransmissions, isFromUs(p), config.device.role)) {
+            // remove the 'original' (identified by originator and packet->id) from the txqueue and free it
+            cancelSending(getFrom(p), p->id);
+            // now free the pooled copy for retransmission too
+            packetPool.release(p);
         }
         auto numErased = pending.erase(key);
         assert(numErased == 1);
@@ -182,6 +203,14 @@ bool NextHopRouter::stopRetransmission(GlobalPacketId key)
         return false;
 }
 
+bool NextHopRouter::cancelsOnStop(uint8_t numRetransmissions, bool fromUs, meshtastic_Config_DeviceConfig_Role role)
+{
+    /* Only when we already transmitted a packet via LoRa, we will cancel the packet in the Tx queue
+      to avoid canceling a transmission if it was ACKed super fast via MQTT.
+      We only cancel it if we are the original sender or if we're not a router(_late)/repeater */
+    return numRetransmissions < NUM_RELIABLE_RETX - 1 && (fromUs || !isRouterRole(role));
+}
+
 /**
  * Add p to the list of packets to retransmit occasionally.  We will free it once we stop retransmitting.
  */
@@ -216,7 +245,8 @@ int32_t NextHopRouter::doRetransmissions()
 
         // FIXME, handle 51 day rolloever here!!!
         if (p.nextTxMsec <= now) {
-            if (p.numRetransmissions == 0) {
+            RetransmitAction action = retransmitAction(p.packet, p.numRetransmissions);
+            if (action == RETX_GIVE_UP) {
                 if (isFromUs(p.packet)) {
                     LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x", p.packet->from, p.packet->to,
                               p.packet->id);
@@ -229,20 +259,18 @@ int32_t NextHopRouter::doRetransmissions()
                 LOG_DEBUG("Sending retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d", p.packet->from, p.packet->to,
                           p.packet->id, p.numRetransmissions);
 
-                if (!isBroadcast(p.packet->to)) {
-                    if (p.numRetransmissions == 1) {
-                        // Last retransmission, reset next_hop (fallback to FloodingRouter)
-                        p.packet->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        // Also reset it in the nodeDB
-                        meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(p.packet->to);
-                        if (sentTo) {
-                            LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p.packet->to);
-                            sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        }
-                        FloodingRouter::send(packetPool.allocCopy(*p.packet));
-                    } else {
-                        NextHopRouter::send(packetPool.allocCopy(*p.packet));
+                if (action == RETX_FLOOD_FORGET_HOP) {
+                    // Last retransmission, reset next_hop (fallback to FloodingRouter)
+                    p.packet->next_hop = NO_NEXT_HOP_PREFERENCE;
+                    // Also reset it in the nodeDB
+                    meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(p.packet->to);
+                    if (sentTo) {
+                        LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p.packet->to);
+                        sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
                     }
+                    FloodingRouter::send(packetPool.allocCopy(*p.packet));
+                } else if (action == RETX_NEXT_HOP) {
+                    NextHopRouter::send(packetPool.allocCopy(*p.packet));
                 } else {
                     // Note: we call the superclass version because we don't want to have our version of send() add a new
                     // retransmission record
@@ -266,6 +294,15 @@ int32_t NextHopRouter::doRetransmissions()
     return d;
 }
 
+NextHopRouter::RetransmitAction NextHopRouter::retransmitAction(const meshtastic_MeshPacket *p, uint8_t numRetransmissions)
+{
+    if (numRetransmissions == 0)
+        return RETX_GIVE_UP;
+    if (isBroadcast(p->to))
+        return RETX_FLOOD;
+    return numRetransmissions == 1 ? RETX_FLOOD_FORGET_HOP : RETX_NEXT_HOP;
+}
+
 void NextHopRouter::setNextTx(PendingPacket *pending)
 {
     assert(iface);
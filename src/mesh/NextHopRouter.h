@@ -91,6 +91,27 @@ class NextHopRouter : public FloodingRouter
     // The number of retransmissions the original sender will do
     constexpr static uint8_t NUM_RELIABLE_RETX = 3;
 
+    /// How doRetransmissions() sends the next try of a pending packet
+    enum RetransmitAction : uint8_t {
+        RETX_GIVE_UP,          // out of tries, NAK it if it's ours
+        RETX_FLOOD,            // a broadcast
+        RETX_NEXT_HOP,         // via the next hop again
+        RETX_FLOOD_FORGET_HOP, // last try of a DM, fall back to flooding and forget the next hop
+    };
+
+    /** The routing rules of this router, shared with MeshSim as those of FloodingRouter are */
+    static DupeAction nextHopDupeAction(const meshtastic_MeshPacket *p, bool wasFallback, bool weWereNextHop);
+    static bool shouldRelay(const meshtastic_MeshPacket *p, bool toUs, bool fromUs, uint8_t ourRelayID);
+    /// @param knownNextHop the next_hop NodeDB has for the destination
+    static uint8_t chooseNextHop(NodeNum to, uint8_t knownNextHop, uint8_t relayNode);
+    /// Should send() keep a copy of this packet to retransmit
+    static bool shouldStartRetransmission(const meshtastic_MeshPacket *p, bool fromUs);
+    /// Does this ACK or reply show its relayer to be a good next hop towards its sender
+    static bool ackConfirmsNextHop(PacketHistory &history, const meshtastic_MeshPacket *p, uint8_t ourRelayID);
+    /// Should stopRetransmission() also take the packet out of the TX queue
+    static bool cancelsOnStop(uint8_t numRetransmissions, bool fromUs, meshtastic_Config_DeviceConfig_Role role);
+    static RetransmitAction retransmitAction(const meshtastic_MeshPacket *p, uint8_t numRetransmissions);
+
   protected:
     /**
      * Pending retransmissions
@@ -10,6 +10,7 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "NodeDBStore.h"
 #include "PacketHistory.h"
 #include "PowerFSM.h"
 #include "RTC.h"
@@ -191,6 +192,10 @@ uint32_t error_address = 0;
 
 static uint8_t ourMacAddr[6];
 
+#ifdef FSCom
+static NodeDBStore nodeDBStore(nodeDatabaseFileName, nodeJournalFileName);
+#endif
+
 NodeDB::NodeDB()
 {
     LOG_INFO("Init NodeDB");
@@ -478,6 +483,7 @@ void NodeDB::installDefaultNodeDatabase()
     nodeDatabase.nodes = std::vector<meshtastic_NodeInfoLite>(MAX_NUM_NODES);
     numMeshNodes = 0;
     meshNodes = &nodeDatabase.nodes;
+    rebuildNodeIndex();
 }
 
 void NodeDB::installDefaultConfig(bool preserveKey = false)
@@ -925,12 +931,24 @@ void NodeDB::installDefaultChannels()
     channelFile.version = DEVICESTATE_CUR_VER;
 }
 
+/// The node's public key is about to go away, make sure no shared secret derived from it stays cached
+static void forgetPublicKey(const meshtastic_NodeInfoLite &node)
+{
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    if (node.user.public_key.size == 32)
+        crypto->forgetSharedKey(node.user.public_key.bytes);
+#endif
+}
+
 void NodeDB::resetNodes()
 {
     if (!config.position.fixed_position)
         clearLocalPosition();
+    for (int i = 1; i < numMeshNodes; i++)
+        forgetPublicKey(meshNodes->at(i));
     numMeshNodes = 1;
     std::fill(nodeDatabase.nodes.begin() + 1, nodeDatabase.nodes.end(), meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     devicestate.has_rx_text_message = false;
     devicestate.has_rx_waypoint = false;
     saveNodeDatabaseToDisk();
@@ -943,14 +961,17 @@ void NodeDB::removeNodeByNum(NodeNum nodeNum)
 {
     int newPos = 0, removed = 0;
     for (int i = 0; i < numMeshNodes; i++) {
-        if (meshNodes->at(i).num != nodeNum)
+        if (meshNodes->at(i).num != nodeNum) {
             meshNodes->at(newPos++) = meshNodes->at(i);
-        else
+        } else {
+            forgetPublicKey(meshNodes->at(i));
             removed++;
+        }
     }
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + 1,
               meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Save changes", removed);
     saveNodeDatabaseToDisk();
 }
@@ -983,6 +1004,7 @@ void NodeDB::cleanupMeshDB()
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     LOG_DEBUG("cleanupMeshDB purged %d entries", removed);
 }
 
@@ -1116,8 +1138,12 @@ void NodeDB::loadFromDisk()
     }
 
 #endif
-    auto state = loadProto(nodeDatabaseFileName, getMaxNodesAllocatedSize(), sizeof(meshtastic_NodeDatabase),
-                           &meshtastic_NodeDatabase_msg, &nodeDatabase);
+#ifdef FSCom
+    nodeDBStore.load(nodeDatabase, getMaxNodesAllocatedSize());
+#else
+    loadProto(nodeDatabaseFileName, getMaxNodesAllocatedSize(), sizeof(meshtastic_NodeDatabase), &meshtastic_NodeDatabase_msg,
+              &nodeDatabase);
+#endif
     if (nodeDatabase.version < DEVICESTATE_MIN_VER) {
         LOG_WARN("NodeDatabase %d is old, discard", nodeDatabase.version);
         installDefaultNodeDatabase();
@@ -1132,10 +1158,11 @@ void NodeDB::loadFromDisk()
         numMeshNodes = MAX_NUM_NODES;
     }
     meshNodes->resize(MAX_NUM_NODES);
+    rebuildNodeIndex();
 
     // static DeviceState scratch; We no longer read into a tempbuf because this structure is 15KB of valuable RAM
-    state = loadProto(deviceStateFileName, meshtastic_DeviceState_size, sizeof(meshtastic_DeviceState),
-                      &meshtastic_DeviceState_msg, &devicestate);
+    auto state = loadProto(deviceStateFileName, meshtastic_DeviceState_size, sizeof(meshtastic_DeviceState),
+                           &meshtastic_DeviceState_msg, &devicestate);
 
     // See https://github.com/meshtastic/firmware/issues/4184#issuecomment-2269390786
     // It is very important to try and use the saved prefs even if we fail to read meshtastic_DeviceState.  Because most of our
@@ -1330,10 +1357,14 @@ bool NodeDB::saveNodeDatabaseToDisk()
     spiLock->lock();
     FSCom.mkdir("/prefs");
     spiLock->unlock();
-#endif
+
+    // Usually only appends the nodes that changed, see NodeDBStore
+    return nodeDBStore.save(nodeDatabase, numMeshNodes);
+#else
     size_t nodeDatabaseSize;
     pb_get_encoded_size(&nodeDatabaseSize, meshtastic_NodeDatabase_fields, &nodeDatabase);
     return saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false);
+#endif
 }
 
 bool NodeDB::saveToDiskNoRetry(int saveWhat)
@@ -1540,9 +1571,13 @@ void NodeDB::addFromContact(meshtastic_SharedContact contact)
         return;
     }
     info->num = contact.node_num;
-    info->last_heard = getValidTime(RTCQualityNTP);
+    uint32_t lastHeard = getValidTime(RTCQualityNTP);
+    meshtastic_UserLite user = TypeConversions::ConvertToUserLite(contact.user);
+    if (lastHeard < info->last_heard || (info->user.public_key.size && !user.public_key.size))
+        nodeEvictionKeyLowered();
+    info->last_heard = lastHeard;
     info->has_user = true;
-    info->user = TypeConversions::ConvertToUserLite(contact.user);
+    info->user = user;
     info->is_favorite = true;
     // Mark the node's key as manually verified to indicate trustworthiness.
     info->bitfield |= NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK;
@@ -1637,8 +1672,11 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
             return;
         }
 
-        if (mp.rx_time) // if the packet has a valid timestamp use it to update our last_heard
+        if (mp.rx_time) { // if the packet has a valid timestamp use it to update our last_heard
+            if (mp.rx_time < info->last_heard)
+                nodeEvictionKeyLowered(); // our clock was set back
             info->last_heard = mp.rx_time;
+        }
 
         if (mp.rx_snr)
             info->snr = mp.rx_snr; // keep the most recent SNR we received for this node.
@@ -1666,13 +1704,24 @@ uint8_t NodeDB::getMeshNodeChannel(NodeNum n)
 /// NOTE: This function might be called from an ISR
 meshtastic_NodeInfoLite *NodeDB::getMeshNode(NodeNum n)
 {
-    for (int i = 0; i < numMeshNodes; i++)
-        if (meshNodes->at(i).num == n)
-            return &meshNodes->at(i);
+    uint16_t i = nodeIndex.find(n);
+    if (i < numMeshNodes && meshNodes->at(i).num == n)
+        return &meshNodes->at(i);
 
     return NULL;
 }
 
+void NodeDB::rebuildNodeIndex()
+{
+    nodeIndex.reset(std::max<size_t>(MAX_NUM_NODES, numMeshNodes));
+    for (int i = 0; i < numMeshNodes; i++) {
+        // Keep the first match if the DB somehow holds duplicates, same as the old linear scan did
+        if (nodeIndex.find(meshNodes->at(i).num) == NodeNumIndex::NOT_FOUND)
+            nodeIndex.insert(meshNodes->at(i).num, i);
+    }
+    evictionQueue.rebuild(meshNodes->data(), numMeshNodes);
+}
+
 // returns true if the maximum number of nodes is reached or we are running low on memory
 bool NodeDB::isFull()
 {
@@ -1688,45 +1737,25 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
         if (isFull()) {
             LOG_INFO("Node database full with %i nodes and %u bytes free. Erasing oldest entry", numMeshNodes,
                      memGet.getFreeHeap());
-            // look for oldest node and erase it
-            uint32_t oldest = UINT32_MAX;
-            uint32_t oldestBoring = UINT32_MAX;
-            int oldestIndex = -1;
-            int oldestBoringIndex = -1;
-            for (int i = 1; i < numMeshNodes; i++) {
-                // Simply the oldest non-favorite, non-ignored, non-verified node
-                if (!meshNodes->at(i).is_favorite && !meshNodes->at(i).is_ignored &&
-                    !(meshNodes->at(i).bitfield & NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK) &&
-                    meshNodes->at(i).last_heard < oldest) {
-                    oldest = meshNodes->at(i).last_heard;
-                    oldestIndex = i;
-                }
-                // The oldest "boring" node
-                if (!meshNodes->at(i).is_favorite && !meshNodes->at(i).is_ignored && meshNodes->at(i).user.public_key.size == 0 &&
-                    meshNodes->at(i).last_heard < oldestBoring) {
-                    oldestBoring = meshNodes->at(i).last_heard;
-                    oldestBoringIndex = i;
-                }
-            }
-            // if we found a "boring" node, evict it
-            if (oldestBoringIndex != -1) {
-                oldestIndex = oldestBoringIndex;
-            }
-
-            if (oldestIndex != -1) {
-                // Shove the remaining nodes down the chain
-                for (int i = oldestIndex; i < numMeshNodes - 1; i++) {
-                    meshNodes->at(i) = meshNodes->at(i + 1);
-                }
-                (numMeshNodes)--;
+            // Recycle the slot of the oldest unpinned node, preferring ones without a public key
+            int32_t victim = evictionQueue.pickVictim(meshNodes->data(), numMeshNodes);
+            if (victim != -1) {
+                nodeIndex.erase(meshNodes->at(victim).num);
+                forgetPublicKey(meshNodes->at(victim));
+                lite = &meshNodes->at(victim);
             }
         }
-        // add the node at the end
-        lite = &meshNodes->at((numMeshNodes)++);
+        if (!lite) {
+            // add the node at the end
+            lite = &meshNodes->at((numMeshNodes)++);
+        }
 
         // everything is missing except the nodenum
         memset(lite, 0, sizeof(*lite));
         lite->num = n;
+        uint16_t slot = lite - meshNodes->data();
+        nodeIndex.insert(n, slot);
+        evictionQueue.add(meshNodes->data(), slot);
         LOG_INFO("Adding node to database with %i nodes and %u bytes free!", numMeshNodes, memGet.getFreeHeap());
     }
 
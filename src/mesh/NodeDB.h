@@ -8,6 +8,8 @@
 #include <vector>
 
 #include "MeshTypes.h"
+#include "NodeEvictionQueue.h"
+#include "NodeNumIndex.h"
 #include "NodeStatus.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
@@ -87,6 +89,7 @@ extern meshtastic_Position localPosition;
 static constexpr const char *deviceStateFileName = "/prefs/device.proto";
 static constexpr const char *legacyPrefFileName = "/prefs/db.proto";
 static constexpr const char *nodeDatabaseFileName = "/prefs/nodes.proto";
+static constexpr const char *nodeJournalFileName = "/prefs/nodes.journal";
 static constexpr const char *configFileName = "/prefs/config.proto";
 static constexpr const char *uiconfigFileName = "/prefs/uiconfig.proto";
 static constexpr const char *moduleConfigFileName = "/prefs/module.proto";
@@ -200,6 +203,9 @@ class NodeDB
 
     void initConfigIntervals(), initModuleConfigIntervals(), resetNodes(), removeNodeByNum(NodeNum nodeNum);
 
+    /// Call after moving a node's last_heard backwards or clearing its public key, so eviction still picks the right node
+    void nodeEvictionKeyLowered() { evictionQueue.markStale(); }
+
     bool factoryReset(bool eraseBleBonds = false);
 
     LoadFileResult loadProto(const char *filename, size_t protoSize, size_t objSize, const pb_msgdesc_t *fields,
@@ -261,6 +267,12 @@ class NodeDB
     bool duplicateWarned = false;
     uint32_t lastNodeDbSave = 0;    // when we last saved our db to flash
     uint32_t lastBackupAttempt = 0; // when we last tried a backup automatically or manually
+    NodeNumIndex nodeIndex;         // NodeNum -> position in meshNodes, must be kept in sync whenever entries move
+    NodeEvictionQueue evictionQueue; // which slot to recycle once the DB is full
+
+    /// Recompute nodeIndex and evictionQueue from scratch, call after anything that reorders or compacts meshNodes
+    void rebuildNodeIndex();
+
     /// Find a node in our DB, create an empty NodeInfoLite if missing
     meshtastic_NodeInfoLite *getOrCreateMeshNode(NodeNum n);
 
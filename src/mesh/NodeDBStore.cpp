@@ -0,0 +1,355 @@
+#include "NodeDBStore.h"
+
+#ifdef FSCom
+
+#include "SPILock.h"
+#include "SafeFile.h"
+#include "mesh-pb-constants.h"
+#include <ErriezCRC32.h>
+#include <algorithm>
+#include <pb_decode.h>
+#include <pb_encode.h>
+#include <string.h>
+
+// The journal may grow to half the snapshot plus this before the next save compacts it
+#define NODEDB_JOURNAL_SLACK 4096
+
+namespace
+{
+const uint32_t FNV_OFFSET = 2166136261u;
+
+uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+/// Passes writes through to the snapshot file, hashing them on the way
+class HashingPrint : public Print
+{
+  public:
+    explicit HashingPrint(Print &out) : out(out) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        hash = fnv1a(hash, buffer, size);
+        len += size;
+        return out.write(buffer, size);
+    }
+
+    Print &out;
+    uint32_t hash = FNV_OFFSET;
+    uint32_t len = 0;
+};
+
+struct HashingReader {
+    File *file;
+    uint32_t hash;
+    uint32_t len;
+};
+
+/// Like readcb, but hashes every byte, including the ones pb_decode skips
+bool hashingRead(pb_istream_t *stream, uint8_t *buf, size_t count)
+{
+    HashingReader *r = (HashingReader *)stream->state;
+    uint8_t skipped[32];
+    while (count) {
+        size_t n = buf ? count : std::min(count, sizeof(skipped));
+        uint8_t *dest = buf ? buf : skipped;
+        if (r->file->read(dest, n) != (int)n)
+            return false;
+        r->hash = fnv1a(r->hash, dest, n);
+        r->len += n;
+        count -= n;
+        if (buf)
+            buf += n;
+    }
+
+    if (r->file->available() == 0)
+        stream->bytes_left = 0;
+    return true;
+}
+} // namespace
+
+NodeDBStore::NodeDBStore(const char *snapshotFile, const char *journalFile) : snapshotFile(snapshotFile), journalFile(journalFile)
+{
+}
+
+bool NodeDBStore::load(meshtastic_NodeDatabase &db, size_t protoSize)
+{
+    db.version = 0;
+    db.nodes.clear();
+    saved.clear();
+    journalBytes = 0;
+    needSnapshot = true;
+
+    concurrency::LockGuard g(spiLock);
+    auto f = FSCom.open(snapshotFile, FILE_O_READ);
+    if (!f) {
+        LOG_ERROR("Could not open / read %s", snapshotFile);
+        return false;
+    }
+
+    LOG_INFO("Load %s", snapshotFile);
+    HashingReader reader = {&f, FNV_OFFSET, 0};
+    pb_istream_t stream = {&hashingRead, &reader, protoSize};
+    bool okay = pb_decode(&stream, meshtastic_NodeDatabase_fields, &db);
+    f.close();
+    if (!okay) {
+        LOG_ERROR("Error: can't decode protobuf %s", PB_GET_ERROR(&stream));
+        db.version = 0;
+        db.nodes.clear();
+        return false;
+    }
+    LOG_INFO("Loaded %s successfully", snapshotFile);
+
+    snapshotLen = reader.len;
+    snapshotHash = reader.hash;
+    savedVersion = db.version;
+    needSnapshot = false;
+    replayJournal(db.nodes);
+    saved = summarize(db.nodes, db.nodes.size());
+    return true;
+}
+
+void NodeDBStore::replayJournal(std::vector<meshtastic_NodeInfoLite> &nodes)
+{
+    if (!FSCom.exists(journalFile))
+        return;
+
+    uint8_t buf[sizeof(RecordHeader) + meshtastic_NodeInfoLite_size];
+    RecordHeader h;
+    uint32_t base[2] = {snapshotLen, snapshotHash};
+
+    // First find the end of the last save that made it to disk whole
+    auto f = FSCom.open(journalFile, FILE_O_READ);
+    if (!f)
+        return;
+    if (readRecord(f, buf, sizeof(buf), h) != READ_OK || h.type != RECORD_BASE || h.len != sizeof(base) ||
+        memcmp(buf + sizeof(h), base, sizeof(base)) != 0) {
+        f.close();
+        LOG_WARN("%s is not for this %s, ignore it", journalFile, snapshotFile);
+        needSnapshot = true;
+        return;
+    }
+    uint32_t pos = sizeof(h) + sizeof(base) + sizeof(uint32_t);
+    uint32_t committed = pos, pending = 0, numSaves = 0;
+    ReadResult r;
+    while ((r = readRecord(f, buf, sizeof(buf), h)) == READ_OK) {
+        pos += sizeof(h) + h.len + sizeof(uint32_t);
+        if (h.type == RECORD_PUT || h.type == RECORD_REMOVE) {
+            pending++;
+        } else if (h.type == RECORD_COMMIT && h.num == pending) {
+            committed = pos;
+            pending = 0;
+            numSaves++;
+        } else {
+            r = READ_BAD;
+            break;
+        }
+    }
+    f.close();
+    if (r != READ_END || pending) {
+        // Don't append after the damage, the next save rewrites the snapshot instead
+        LOG_WARN("%s ends with an unfinished save, drop it", journalFile);
+        needSnapshot = true;
+    }
+
+    // Then apply everything before that
+    f = FSCom.open(journalFile, FILE_O_READ);
+    if (!f)
+        return;
+    readRecord(f, buf, sizeof(buf), h);
+    pos = sizeof(h) + sizeof(base) + sizeof(uint32_t);
+    while (pos < committed && readRecord(f, buf, sizeof(buf), h) == READ_OK) {
+        pos += sizeof(h) + h.len + sizeof(uint32_t);
+        applyRecord(nodes, h, buf + sizeof(h));
+    }
+    f.close();
+
+    journalBytes = committed;
+    LOG_INFO("Replayed %u saves from %s", numSaves, journalFile);
+}
+
+void NodeDBStore::applyRecord(std::vector<meshtastic_NodeInfoLite> &nodes, const RecordHeader &h, const uint8_t *payload)
+{
+    auto found =
+        std::find_if(nodes.begin(), nodes.end(), [&](const meshtastic_NodeInfoLite &n) { return n.num == h.num && n.num; });
+
+    if (h.type == RECORD_REMOVE) {
+        // Leave the hole, cleanupMeshDB() drops nodes without a user
+        if (found != nodes.end())
+            *found = meshtastic_NodeInfoLite_init_zero;
+        return;
+    }
+    if (h.type != RECORD_PUT)
+        return;
+
+    meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_zero;
+    if (!pb_decode_from_bytes(payload, h.len, &meshtastic_NodeInfoLite_msg, &node))
+        return;
+    if (found == nodes.end() && nodes.size() > 1) // slot 0 is always our own node
+        found = std::find_if(nodes.begin() + 1, nodes.end(), [](const meshtastic_NodeInfoLite &n) { return n.num == 0; });
+    if (found == nodes.end())
+        nodes.push_back(node);
+    else
+        *found = node;
+}
+
+bool NodeDBStore::save(const meshtastic_NodeDatabase &db, size_t numNodes, bool forceSnapshot)
+{
+    std::vector<Entry> current = summarize(db.nodes, numNodes);
+#if NODEDB_JOURNAL
+    if (!forceSnapshot && !needSnapshot && db.version == savedVersion && appendJournal(db, current))
+        return true;
+#endif
+    return writeSnapshot(db, current);
+}
+
+bool NodeDBStore::writeSnapshot(const meshtastic_NodeDatabase &db, std::vector<Entry> &current)
+{
+    size_t protoSize;
+    pb_get_encoded_size(&protoSize, meshtastic_NodeDatabase_fields, &db);
+
+    auto f = SafeFile(snapshotFile, false);
+    LOG_INFO("Save %s", snapshotFile);
+    HashingPrint out(f);
+    pb_ostream_t stream = {&writecb, static_cast<Print *>(&out), protoSize};
+    bool okay = pb_encode(&stream, meshtastic_NodeDatabase_fields, &db);
+    if (!okay)
+        LOG_ERROR("Error: can't encode protobuf %s", PB_GET_ERROR(&stream));
+    okay = f.close() && okay;
+    stats.bytesWritten += out.len;
+
+    {
+        concurrency::LockGuard g(spiLock);
+        FSCom.remove(journalFile);
+    }
+    journalBytes = 0;
+
+    if (!okay) {
+        LOG_ERROR("Can't write prefs!");
+        needSnapshot = true;
+        return false;
+    }
+
+    snapshotLen = out.len;
+    snapshotHash = out.hash;
+    savedVersion = db.version;
+    saved.swap(current);
+    needSnapshot = false;
+    stats.snapshots++;
+    return true;
+}
+
+bool NodeDBStore::appendJournal(const meshtastic_NodeDatabase &db, const std::vector<Entry> &current)
+{
+    std::vector<uint8_t> out;
+    if (journalBytes == 0) {
+        uint32_t base[2] = {snapshotLen, snapshotHash};
+        addRecord(out, RECORD_BASE, 0, base, sizeof(base));
+    }
+
+    // Both lists are sorted by num, walk them together
+    uint32_t changes = 0;
+    uint8_t payload[meshtastic_NodeInfoLite_size];
+    auto was = saved.begin();
+    for (const Entry &now : current) {
+        for (; was != saved.end() && was->num < now.num; ++was, changes++)
+            addRecord(out, RECORD_REMOVE, was->num, nullptr, 0);
+        bool unchanged = false;
+        if (was != saved.end() && was->num == now.num)
+            unchanged = (was++)->hash == now.hash;
+        if (unchanged)
+            continue;
+
+        size_t len = pb_encode_to_bytes(payload, sizeof(payload), &meshtastic_NodeInfoLite_msg, &db.nodes[now.slot]);
+        if (!len)
+            return false;
+        addRecord(out, RECORD_PUT, now.num, payload, len);
+        changes++;
+    }
+    for (; was != saved.end(); ++was, changes++)
+        addRecord(out, RECORD_REMOVE, was->num, nullptr, 0);
+
+    if (!changes)
+        return true;
+    addRecord(out, RECORD_COMMIT, changes, nullptr, 0);
+
+    if (journalBytes + out.size() > snapshotLen / 2 + NODEDB_JOURNAL_SLACK) {
+        LOG_DEBUG("%s is getting long, compact it into %s", journalFile, snapshotFile);
+        return false;
+    }
+
+    concurrency::LockGuard g(spiLock);
+    // Somebody (a factory reset, say) removed our files, start over with a snapshot
+    if (!FSCom.exists(snapshotFile) || (journalBytes && !FSCom.exists(journalFile)))
+        return false;
+    if (!journalBytes)
+        FSCom.remove(journalFile);
+
+    auto f = FSCom.open(journalFile, FILE_O_APPEND);
+    if (!f) {
+        LOG_ERROR("Could not open %s", journalFile);
+        return false;
+    }
+    size_t written = f.write(out.data(), out.size());
+    f.close();
+    stats.bytesWritten += written;
+    if (written != out.size()) {
+        LOG_ERROR("Could only write %u of %u bytes to %s", (uint32_t)written, (uint32_t)out.size(), journalFile);
+        return false;
+    }
+
+    LOG_INFO("Save %u changed nodes to %s", changes, journalFile);
+    journalBytes += out.size();
+    saved = current;
+    stats.journalSaves++;
+    return true;
+}
+
+std::vector<NodeDBStore::Entry> NodeDBStore::summarize(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t numNodes)
+{
+    std::vector<Entry> entries;
+    numNodes = std::min(numNodes, nodes.size());
+    entries.reserve(numNodes);
+    for (size_t i = 0; i < numNodes; i++) {
+        if (nodes[i].num)
+            entries.push_back({nodes[i].num, fnv1a(FNV_OFFSET, (const uint8_t *)&nodes[i], sizeof(nodes[i])), (uint16_t)i});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.num < b.num; });
+    return entries;
+}
+
+void NodeDBStore::addRecord(std::vector<uint8_t> &out, RecordType type, uint32_t num, const void *payload, uint16_t len)
+{
+    RecordHeader h = {type, 0, len, num};
+    size_t start = out.size();
+    out.resize(start + sizeof(h) + len + sizeof(uint32_t));
+    memcpy(&out[start], &h, sizeof(h));
+    if (len)
+        memcpy(&out[start + sizeof(h)], payload, len);
+    uint32_t crc = crc32Buffer(&out[start], sizeof(h) + len);
+    memcpy(&out[start + sizeof(h) + len], &crc, sizeof(crc));
+}
+
+NodeDBStore::ReadResult NodeDBStore::readRecord(File &f, uint8_t *buf, size_t bufSize, RecordHeader &h)
+{
+    int got = f.read(buf, sizeof(h));
+    if (got == 0)
+        return READ_END;
+    if (got != (int)sizeof(h))
+        return READ_BAD;
+    memcpy(&h, buf, sizeof(h));
+    if (sizeof(h) + h.len > bufSize || f.read(buf + sizeof(h), h.len) != (int)h.len)
+        return READ_BAD;
+
+    uint32_t crc;
+    if (f.read((uint8_t *)&crc, sizeof(crc)) != (int)sizeof(crc) || crc != crc32Buffer(buf, sizeof(h) + h.len))
+        return READ_BAD;
+    return READ_OK;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "FSCommon.h"
+#include "configuration.h"
+#include "mesh/generated/meshtastic/deviceonly.pb.h"
+#include <vector>
+
+#ifdef FSCom
+
+// Save changed nodes to a journal between full snapshots, needs a filesystem that can append
+#ifndef NODEDB_JOURNAL
+#ifdef FILE_O_APPEND
+#define NODEDB_JOURNAL 1
+#else
+#define NODEDB_JOURNAL 0
+#endif
+#endif
+
+/**
+ * Keeps the NodeDB on disk as a snapshot plus a journal of the nodes that changed since it was written.
+ *
+ * The snapshot is the whole meshtastic_NodeDatabase, written through SafeFile exactly as it always was.  A save that finds
+ * only some nodes changed appends just those nodes (and the numbers of the ones that went away) to the journal, so with
+ * thousands of nodes a save costs a few hundred bytes instead of a rewrite of the lot.  Once the journal would grow past half
+ * the size of the snapshot the save writes a new snapshot instead and deletes the journal.
+ *
+ * The journal starts with a BASE record naming the snapshot it goes with, by length and hash.  Each save then adds a PUT
+ * (the encoded NodeInfoLite) or REMOVE record per changed node and a COMMIT.  Every record is
+ * [type u8][0][payload length u16][node num u32][payload][crc32 of all that].  Loading replays records only up to the last
+ * COMMIT that checks out, so a save cut short by a crash or power loss is dropped whole, and ignores a journal whose BASE
+ * doesn't match, which is what a crash between writing a snapshot and deleting the old journal leaves behind.
+ */
+class NodeDBStore
+{
+  public:
+    NodeDBStore(const char *snapshotFile, const char *journalFile);
+
+    /**
+     * Read the snapshot into db and replay the journal on top of it.  Nodes removed by the journal are left zeroed in place.
+     * @param protoSize the most bytes the snapshot could take
+     * @return false if the snapshot couldn't be read
+     */
+    bool load(meshtastic_NodeDatabase &db, size_t protoSize);
+
+    /**
+     * Save db, of which the first numNodes nodes are in use.  Writes nothing if no node changed since the last save.
+     * @param forceSnapshot write a full snapshot even if the journal would do
+     * @return true for success
+     */
+    bool save(const meshtastic_NodeDatabase &db, size_t numNodes, bool forceSnapshot = false);
+
+    /// Writes since boot
+    struct Stats {
+        uint32_t snapshots;
+        uint32_t journalSaves;
+        uint64_t bytesWritten;
+    };
+    const Stats &getStats() const { return stats; }
+
+  private:
+    enum RecordType : uint8_t { RECORD_BASE = 1, RECORD_PUT, RECORD_REMOVE, RECORD_COMMIT };
+
+    struct RecordHeader {
+        uint8_t type;
+        uint8_t reserved;
+        uint16_t len;
+        uint32_t num;
+    };
+
+    enum ReadResult { READ_OK, READ_END, READ_BAD };
+
+    /// The fingerprint of one node as last saved
+    struct Entry {
+        uint32_t num;
+        uint32_t hash;
+        uint16_t slot;
+    };
+
+    const char *snapshotFile, *journalFile;
+
+    std::vector<Entry> saved; // what is on disk, sorted by num
+    uint32_t savedVersion = 0;
+    uint32_t snapshotLen = 0, snapshotHash = 0;
+    uint32_t journalBytes = 0; // 0 if there is no journal yet for this snapshot
+    bool needSnapshot = true;  // the files on disk can't be added to
+    Stats stats = {};
+
+    bool writeSnapshot(const meshtastic_NodeDatabase &db, std::vector<Entry> &current);
+    bool appendJournal(const meshtastic_NodeDatabase &db, const std::vector<Entry> &current);
+    void replayJournal(std::vector<meshtastic_NodeInfoLite> &nodes);
+
+    static std::vector<Entry> summarize(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t numNodes);
+    static void addRecord(std::vector<uint8_t> &out, RecordType type, uint32_t num, const void *payload, uint16_t len);
+    static ReadResult readRecord(File &f, uint8_t *buf, size_t bufSize, RecordHeader &h);
+    static void applyRecord(std::vector<meshtastic_NodeInfoLite> &nodes, const RecordHeader &h, const uint8_t *payload);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "NodeEvictionQueue.h"
+#include "NodeDB.h"
+#include <algorithm>
+
+bool NodeEvictionQueue::isPinned(const meshtastic_NodeInfoLite &node)
+{
+    return node.is_favorite || node.is_ignored || (node.bitfield & NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK);
+}
+
+void NodeEvictionQueue::rebuild(const meshtastic_NodeInfoLite *nodes, size_t count)
+{
+    stale = false;
+    heap.clear();
+    heap.reserve(count);
+    for (size_t i = 1; i < count; i++)
+        heap.push_back(Entry{keyFor(nodes[i]), (uint16_t)i});
+    std::make_heap(heap.begin(), heap.end(), later);
+}
+
+void NodeEvictionQueue::add(const meshtastic_NodeInfoLite *nodes, uint16_t slot)
+{
+    if (slot == 0)
+        return;
+    heap.push_back(Entry{keyFor(nodes[slot]), slot});
+    std::push_heap(heap.begin(), heap.end(), later);
+}
+
+int32_t NodeEvictionQueue::pickVictim(const meshtastic_NodeInfoLite *nodes, size_t count)
+{
+    int32_t victim = -1;
+
+    if (stale)
+        rebuild(nodes, count);
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Entry top = heap.back();
+        heap.pop_back();
+
+        const meshtastic_NodeInfoLite &node = nodes[top.slot];
+        uint64_t key = keyFor(node);
+        if (key != top.key) {
+            // Stale, the node was heard from (or learned a key) since we last looked
+            top.key = key;
+            heap.push_back(top);
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else if (isPinned(node)) {
+            pinned.push_back(top);
+        } else {
+            victim = top.slot;
+            break;
+        }
+    }
+
+    // Pinned nodes stay tracked in case they get unpinned later
+    for (const Entry &e : pinned) {
+        heap.push_back(e);
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+    pinned.clear();
+
+    return victim;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "mesh/generated/meshtastic/deviceonly.pb.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Picks which NodeDB slot to recycle when the DB is full, without scanning every node.
+ *
+ * A min-heap over slots keyed on (has public key, last_heard), so "boring" keyless nodes go first and the oldest node of each
+ * kind goes before newer ones, matching what the old linear scan chose.  Node fields get changed all over the tree without
+ * telling NodeDB, so the heap is validated lazily: when an entry surfaces its key is recomputed from the live node, and if it
+ * no longer matches it is pushed back with the fresh key.  That only finds the true minimum while no stored key is larger than
+ * the live one, which normal traffic keeps true.  Anything that moves last_heard backwards (clock corrections) or drops a
+ * node's public key must call markStale(), and the next pickVictim() rebuilds from scratch.  Favorite, ignored and manually
+ * verified nodes are pinned and never chosen.
+ *
+ * Slot 0 always holds our own node and is never tracked.
+ */
+class NodeEvictionQueue
+{
+  public:
+    /// Track slots 1..count-1 of nodes, discarding anything tracked before
+    void rebuild(const meshtastic_NodeInfoLite *nodes, size_t count);
+
+    /// Start tracking a freshly filled slot
+    void add(const meshtastic_NodeInfoLite *nodes, uint16_t slot);
+
+    /// Note that some node's key went down, so lazy validation can no longer be trusted
+    void markStale() { stale = true; }
+
+    /**
+     * Remove and return the slot holding the best node to evict.  The caller is expected to reuse the slot and add() it back.
+     * @param count the number of slots in use, for rebuilding after markStale()
+     * @return the slot index, or -1 if every tracked node is pinned
+     */
+    int32_t pickVictim(const meshtastic_NodeInfoLite *nodes, size_t count);
+
+    size_t size() const { return heap.size(); }
+
+  private:
+    struct Entry {
+        uint64_t key;
+        uint16_t slot;
+    };
+
+    std::vector<Entry> heap;
+    std::vector<Entry> pinned; // scratch space for pickVictim, kept around to avoid reallocating
+    bool stale = false;
+
+    static uint64_t keyFor(const meshtastic_NodeInfoLite &node)
+    {
+        return ((uint64_t)(node.user.public_key.size != 0) << 32) | node.last_heard;
+    }
+
+    static bool isPinned(const meshtastic_NodeInfoLite &node);
+
+    /// std heap functions build a max-heap, so order "greater" entries first
+    static bool later(const Entry &a, const Entry &b) { return a.key != b.key ? a.key > b.key : a.slot > b.slot; }
+};
@@ -0,0 +1,36 @@
+#include "NodeInfoCache.h"
+
+#if PHONEAPI_NODEINFO_CACHE
+
+#include "TypeConversions.h"
+#include "concurrency/LockGuard.h"
+#include <string.h>
+
+NodeInfoCache nodeInfoCache;
+
+size_t NodeInfoCache::getFromRadio(size_t slot, const meshtastic_NodeInfoLite &node, uint8_t *buf)
+{
+    concurrency::LockGuard g(&lock);
+
+    if (slot >= entries.size())
+        entries.resize(slot + 1);
+    Entry &e = entries[slot];
+
+    if (!e.encoded.empty() && memcmp(&e.node, &node, sizeof(node)) == 0) {
+        hits++;
+    } else {
+        misses++;
+        meshtastic_FromRadio fromRadio = meshtastic_FromRadio_init_zero;
+        fromRadio.which_payload_variant = meshtastic_FromRadio_node_info_tag;
+        fromRadio.node_info = TypeConversions::ConvertToNodeInfo(&node);
+        size_t len = pb_encode_to_bytes(buf, meshtastic_FromRadio_size, &meshtastic_FromRadio_msg, &fromRadio);
+        memcpy(&e.node, &node, sizeof(node)); // padding too, for the memcmp above
+        e.encoded.assign(buf, len);
+        return len;
+    }
+
+    memcpy(buf, e.encoded.data(), e.encoded.size());
+    return e.encoded.size();
+}
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "concurrency/Lock.h"
+#include "mesh-pb-constants.h"
+#include <string>
+#include <vector>
+
+// Share encoded NodeInfo frames between all the PhoneAPI clients, costs a NodeInfoLite plus the encoded frame per node
+#ifndef PHONEAPI_NODEINFO_CACHE
+#ifdef ARCH_PORTDUINO
+#define PHONEAPI_NODEINFO_CACHE 1
+#else
+#define PHONEAPI_NODEINFO_CACHE 0
+#endif
+#endif
+
+#if PHONEAPI_NODEINFO_CACHE
+
+/**
+ * The FromRadio.node_info frames of a config download, as last encoded for each NodeDB slot.
+ *
+ * Every client downloading the DB gets the same bytes for the same node, so the first one to ask pays for the conversion and
+ * encoding and the rest copy the result.  Each entry keeps the NodeInfoLite it was made from, a change to the node (or another
+ * node moving into the slot) shows up as a mismatch and the entry is replaced on its next use, so there is nothing to invalidate
+ * by hand.
+ */
+class NodeInfoCache
+{
+  public:
+    /**
+     * Get the encoded FromRadio for a node other than our own
+     * @param slot the node's index in NodeDB::meshNodes
+     * @param buf at least meshtastic_FromRadio_size bytes
+     * @return the number of bytes written to buf
+     */
+    size_t getFromRadio(size_t slot, const meshtastic_NodeInfoLite &node, uint8_t *buf);
+
+    uint32_t numHits() const { return hits; }
+    uint32_t numMisses() const { return misses; }
+
+  private:
+    struct Entry {
+        meshtastic_NodeInfoLite node;
+        std::basic_string<uint8_t> encoded; // empty if not made yet
+    };
+    std::vector<Entry> entries;
+    concurrency::Lock lock; // BLE stacks call getFromRadio from their own task
+    uint32_t hits = 0, misses = 0;
+};
+
+extern NodeInfoCache nodeInfoCache;
+
+#endif
@@ -0,0 +1,75 @@
+#include "NodeNumIndex.h"
+
+void NodeNumIndex::reset(size_t maxEntries)
+{
+    size_t capacity = 16;
+    while (capacity < maxEntries * 2)
+        capacity <<= 1;
+
+    buckets.assign(capacity, Bucket{0, NOT_FOUND});
+    mask = capacity - 1;
+    count = 0;
+}
+
+void NodeNumIndex::insert(NodeNum n, uint16_t index)
+{
+    if (buckets.empty() || (count + 1) * 2 > buckets.size()) {
+        // Should only happen if MAX_NUM_NODES changed underneath us, grow and rehash the existing entries
+        std::vector<Bucket> old;
+        old.swap(buckets);
+        reset((count + 1) * 2);
+        for (const Bucket &b : old)
+            if (b.index != NOT_FOUND)
+                insert(b.num, b.index);
+    }
+
+    for (size_t i = hash(n) & mask;; i = (i + 1) & mask) {
+        Bucket &b = buckets[i];
+        if (b.index == NOT_FOUND) {
+            b.num = n;
+            b.index = index;
+            count++;
+            return;
+        }
+        if (b.num == n) {
+            b.index = index;
+            return;
+        }
+    }
+}
+
+void NodeNumIndex::erase(NodeNum n)
+{
+    if (buckets.empty())
+        return;
+
+    size_t i = hash(n) & mask;
+    while (buckets[i].num != n) {
+        if (buckets[i].index == NOT_FOUND)
+            return;
+        i = (i + 1) & mask;
+    }
+    if (buckets[i].index == NOT_FOUND)
+        return;
+
+    // Backward-shift deletion: pull later members of the probe chain into the hole so find() never needs tombstones
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; buckets[j].index != NOT_FOUND; j = (j + 1) & mask) {
+        size_t home = hash(buckets[j].num) & mask;
+        // Move j into the hole unless its home lies cyclically within (hole, j]
+        bool homeInRange = (hole <= j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!homeInRange) {
+            buckets[hole] = buckets[j];
+            hole = j;
+        }
+    }
+    buckets[hole].index = NOT_FOUND;
+    count--;
+}
+
+void NodeNumIndex::clear()
+{
+    for (Bucket &b : buckets)
+        b.index = NOT_FOUND;
+    count = 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * An open-addressing NodeNum -> slot index used by NodeDB so that getMeshNode() doesn't have to walk the whole node array.
+ *
+ * Linear probing with backward-shift deletion (no tombstones), so lookups stay short even after heavy churn. The table is
+ * sized to a power of two at least twice the number of nodes it has to hold, which keeps the load factor at or below 50%.
+ */
+class NodeNumIndex
+{
+  public:
+    /// Returned by find() when the node isn't present
+    static constexpr uint16_t NOT_FOUND = 0xFFFF;
+
+    /// Allocate room for at least maxEntries nodes and drop any existing entries
+    void reset(size_t maxEntries);
+
+    /// @return the slot index for n, or NOT_FOUND
+    uint16_t find(NodeNum n) const
+    {
+        if (buckets.empty())
+            return NOT_FOUND;
+        for (size_t i = hash(n) & mask;; i = (i + 1) & mask) {
+            const Bucket &b = buckets[i];
+            if (b.index == NOT_FOUND)
+                return NOT_FOUND;
+            if (b.num == n)
+                return b.index;
+        }
+    }
+
+    /// Map n to the given slot, replacing any previous mapping
+    void insert(NodeNum n, uint16_t index);
+
+    /// Forget n, if present
+    void erase(NodeNum n);
+
+    /// Drop all entries, keeping the current allocation
+    void clear();
+
+    size_t size() const { return count; }
+
+  private:
+    struct Bucket {
+        NodeNum num;
+        uint16_t index; // NOT_FOUND marks an empty bucket
+    };
+
+    std::vector<Bucket> buckets;
+    size_t mask = 0;
+    size_t count = 0;
+
+    /// NodeNums are usually derived from MAC addresses, so mix the bits to avoid clustering on the low byte
+    static size_t hash(NodeNum n)
+    {
+        n ^= n >> 16;
+        n *= 0x45d9f3bU;
+        n ^= n >> 16;
+        return n;
+    }
+};
@@ -5,12 +5,161 @@
 #ifdef ARCH_PORTDUINO
 #include "platform/portduino/PortduinoGlue.h"
 #endif
-#include "Throttle.h"
 
 PacketHistory::PacketHistory()
 {
-    recentPackets.reserve(MAX_NUM_NODES); // Prealloc the worst case # of records - to prevent heap fragmentation
-                                          // setup our periodic task
+    // Prealloc the worst case # of records - to prevent heap fragmentation
+    recentPacketsCapacity = PACKETHISTORY_MAX;
+    if (recentPacketsCapacity > EMPTY_SLOT - 1)
+        recentPacketsCapacity = EMPTY_SLOT - 1;
+    recentPackets = new PacketRecord[recentPacketsCapacity]();
+
+    // Keep the index at most half full so probe chains stay short
+    uint32_t indexSize = 16;
+    while (indexSize < recentPacketsCapacity * 2)
+        indexSize <<= 1;
+    recentPacketsIndex = new IndexEntry[indexSize];
+    for (uint32_t i = 0; i < indexSize; i++)
+        recentPacketsIndex[i].slot = EMPTY_SLOT;
+    recentPacketsIndexMask = indexSize - 1;
+}
+
+PacketHistory::~PacketHistory()
+{
+    delete[] recentPackets;
+    delete[] recentPacketsIndex;
+}
+
+uint32_t PacketHistory::hashRecord(NodeNum sender, PacketId id)
+{
+    uint32_t h = sender * 0x9E3779B1U ^ id;
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    return h;
+}
+
+PacketRecord *PacketHistory::find(NodeNum sender, PacketId id)
+{
+    uint32_t h = hashRecord(sender, id);
+    uint16_t tag = h >> 16;
+    for (uint32_t i = h & recentPacketsIndexMask; recentPacketsIndex[i].slot != EMPTY_SLOT; i = (i + 1) & recentPacketsIndexMask) {
+        if (recentPacketsIndex[i].tag != tag)
+            continue;
+        PacketRecord *r = &recentPackets[recentPacketsIndex[i].slot];
+        if (r->sender == sender && r->id == id)
+            return r;
+    }
+    return NULL;
+}
+
+uint32_t PacketHistory::indexOf(uint16_t slot)
+{
+    const PacketRecord &r = recentPackets[slot];
+    uint32_t i = hashRecord(r.sender, r.id) & recentPacketsIndexMask;
+    while (recentPacketsIndex[i].slot != slot) {
+        assert(recentPacketsIndex[i].slot != EMPTY_SLOT);
+        i = (i + 1) & recentPacketsIndexMask;
+    }
+    return i;
+}
+
+PacketRecord *PacketHistory::insert(const PacketRecord &r)
+{
+    if (recentPacketsCount == recentPacketsCapacity) {
+        // Make room from what is expired or erased before giving up a record that is still live
+        clearExpiredRecentPackets();
+        if (recentPacketsCount == recentPacketsCapacity)
+            compact();
+    }
+    if (recentPacketsCount == recentPacketsCapacity) {
+        // Full of live records, sacrifice the one heard from least recently, which the ring keeps at its head
+        popHead();
+    }
+
+    uint16_t slot = (recentPacketsHead + recentPacketsCount) % recentPacketsCapacity;
+    recentPacketsCount++;
+    recentPackets[slot] = r;
+
+    uint32_t h = hashRecord(r.sender, r.id);
+    uint32_t i = h & recentPacketsIndexMask;
+    while (recentPacketsIndex[i].slot != EMPTY_SLOT)
+        i = (i + 1) & recentPacketsIndexMask;
+    recentPacketsIndex[i].slot = slot;
+    recentPacketsIndex[i].tag = h >> 16;
+
+    return &recentPackets[slot];
+}
+
+void PacketHistory::erase(PacketRecord *r)
+{
+    uint16_t slot = r - recentPackets;
+    uint32_t i = indexOf(slot);
+
+    // Backward-shift deletion, so the index never needs tombstones
+    uint32_t hole = i;
+    for (uint32_t j = (i + 1) & recentPacketsIndexMask; recentPacketsIndex[j].slot != EMPTY_SLOT;
+         j = (j + 1) & recentPacketsIndexMask) {
+        const PacketRecord &moved = recentPackets[recentPacketsIndex[j].slot];
+        uint32_t home = hashRecord(moved.sender, moved.id) & recentPacketsIndexMask;
+        bool homeInRange = (hole <= j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!homeInRange) {
+            recentPacketsIndex[hole] = recentPacketsIndex[j];
+            hole = j;
+        }
+    }
+    recentPacketsIndex[hole].slot = EMPTY_SLOT;
+
+    r->id = 0; // Leave a hole, the ring head will skip over it
+    uint32_t offset = (slot + recentPacketsCapacity - recentPacketsHead) % recentPacketsCapacity;
+    if (offset < recentPacketsFirstHole)
+        recentPacketsFirstHole = offset;
+}
+
+/// Drop the head of the ring, whether a record or a hole
+void PacketHistory::popHead()
+{
+    uint32_t firstHole = recentPacketsFirstHole;
+    if (recentPackets[recentPacketsHead].id != 0)
+        erase(&recentPackets[recentPacketsHead]);
+    recentPacketsHead = (recentPacketsHead + 1) % recentPacketsCapacity;
+    recentPacketsCount--;
+    // If the head was the first hole the next one could be anywhere, so compact() will look from the head
+    recentPacketsFirstHole = firstHole > 0 ? firstHole - 1 : 0;
+}
+
+/// Close up the holes left by erase(), keeping the records in order.  Holes are mostly left by records heard again soon after
+/// they were inserted, near the tail, so this only moves the few records after the first of them.
+void PacketHistory::compact()
+{
+    uint32_t kept = recentPacketsFirstHole;
+    for (uint32_t n = recentPacketsFirstHole; n < recentPacketsCount; n++) {
+        uint16_t from = (recentPacketsHead + n) % recentPacketsCapacity;
+        if (recentPackets[from].id == 0)
+            continue;
+        uint16_t to = (recentPacketsHead + kept) % recentPacketsCapacity;
+        if (to != from) {
+            recentPacketsIndex[indexOf(from)].slot = to;
+            recentPackets[to] = recentPackets[from];
+            recentPackets[from].id = 0;
+        }
+        kept++;
+    }
+    recentPacketsCount = kept;
+    recentPacketsFirstHole = kept;
+}
+
+/// Move a record that was just heard again to the tail, so the ring stays in the order records were last heard
+PacketRecord *PacketHistory::refresh(PacketRecord *r)
+{
+    if (r == &recentPackets[(recentPacketsHead + recentPacketsCount - 1) % recentPacketsCapacity]) {
+        r->rxTimeMsec = nowMsec(); // Already the most recently heard
+        return r;
+    }
+    PacketRecord copy = *r;
+    copy.rxTimeMsec = nowMsec();
+    erase(r);
+    return insert(copy);
 }
 
 /**
@@ -23,32 +172,26 @@ bool PacketHistory::wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpd
         return false; // Not a floodable message ID, so we don't care
     }
 
-    PacketRecord r;
-    r.id = p->id;
-    r.sender = getFrom(p);
-    r.rxTimeMsec = millis();
-    r.next_hop = p->next_hop;
-    r.relayed_by[0] = p->relay_node;
-    // LOG_INFO("Add relayed_by 0x%x for id=0x%x", p->relay_node, r.id);
+    // Expiry is amortized over lookups, the ring keeps the records heard from least recently at its head
+    clearExpiredRecentPackets();
 
-    auto found = recentPackets.find(r);
-    bool seenRecently = (found != recentPackets.end()); // found not equal to .end() means packet was seen recently
+    PacketRecord *found = find(getFrom(p), p->id);
+    bool seenRecently = (found != NULL);
 
-    if (seenRecently &&
-        !Throttle::isWithinTimespanMs(found->rxTimeMsec, FLOOD_EXPIRE_TIME)) { // Check whether found packet has already expired
-        recentPackets.erase(found); // Erase and pretend packet has not been seen recently
-        found = recentPackets.end();
+    if (seenRecently && isExpired(*found)) { // Check whether found packet has already expired
+        erase(found); // Erase and pretend packet has not been seen recently
+        found = NULL;
         seenRecently = false;
     }
 
     if (seenRecently) {
-        LOG_DEBUG("Found existing packet record for fr=0x%x,to=0x%x,id=0x%x", p->from, p->to, p->id);
-        uint8_t ourRelayID = nodeDB->getLastByteOfNodeNum(nodeDB->getNodeNum());
+        LOG_DEBUG_DEFERRED("Found existing packet record for fr=0x%x,to=0x%x,id=0x%x", p->from, p->to, p->id);
+        uint8_t ourRelayID = nodeDB->getLastByteOfNodeNum(ourNodeNum());
         if (wasFallback) {
             // If it was seen with a next-hop not set to us and now it's NO_NEXT_HOP_PREFERENCE, and the relayer relayed already
             // before, it's a fallback to flooding. If we didn't already relay and the next-hop neither, we might need to handle
             // it now.
-            if (found->sender != nodeDB->getNodeNum() && found->next_hop != NO_NEXT_HOP_PREFERENCE &&
+            if (found->sender != ourNodeNum() && found->next_hop != NO_NEXT_HOP_PREFERENCE &&
                 found->next_hop != ourRelayID && p->next_hop == NO_NEXT_HOP_PREFERENCE && wasRelayer(p->relay_node, found) &&
                 !wasRelayer(ourRelayID, found) && !wasRelayer(found->next_hop, found)) {
                 *wasFallback = true;
@@ -62,44 +205,37 @@ bool PacketHistory::wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpd
     }
 
     if (withUpdate) {
-        if (found != recentPackets.end()) { // delete existing to updated timestamp and relayed_by (re-insert)
-            // Add the existing relayed_by to the new record
-            for (uint8_t i = 0; i < NUM_RELAYERS - 1; i++) {
-                if (found->relayed_by[i])
-                    r.relayed_by[i + 1] = found->relayed_by[i];
-            }
-            r.next_hop = found->next_hop; // keep the original next_hop (such that we check whether we were originally asked)
-            recentPackets.erase(found);   // as unsorted_set::iterator is const (can't update - so re-insert..)
+        if (found) {
+            // Push the new relayer in front of the ones we already know of, keeping the original next_hop (such that we check
+            // whether we were originally asked)
+            found = refresh(found);
+            for (uint8_t i = NUM_RELAYERS - 1; i > 0; i--)
+                found->relayed_by[i] = found->relayed_by[i - 1];
+            found->relayed_by[0] = p->relay_node;
+        } else {
+            PacketRecord r = {.sender = getFrom(p), .id = p->id, .rxTimeMsec = nowMsec(), .next_hop = p->next_hop};
+            r.relayed_by[0] = p->relay_node;
+            // LOG_INFO("Add relayed_by 0x%x for id=0x%x", p->relay_node, r.id);
+            insert(r);
         }
-        recentPackets.insert(r);
-        LOG_DEBUG("Add packet record fr=0x%x, id=0x%x", p->from, p->id);
-    }
-
-    // Capacity is reerved, so only purge expired packets if recentPackets fills past 90% capacity
-    // Expiry is normally dealt with after having searched/found a packet (above)
-    if (recentPackets.size() > (MAX_NUM_NODES * 0.9)) {
-        clearExpiredRecentPackets();
+        LOG_DEBUG_DEFERRED("Add packet record fr=0x%x, id=0x%x", p->from, p->id);
     }
 
     return seenRecently;
 }
 
 /**
- * Iterate through all recent packets, and remove all older than FLOOD_EXPIRE_TIME
+ * Pop holes and records older than FLOOD_EXPIRE_TIME off the head of the ring.  Records are moved to the tail whenever they are
+ * heard again, so once the head is still fresh nothing behind it has expired either.
  */
 void PacketHistory::clearExpiredRecentPackets()
 {
-    LOG_DEBUG("recentPackets size=%ld", recentPackets.size());
-
-    for (auto it = recentPackets.begin(); it != recentPackets.end();) {
-        if (!Throttle::isWithinTimespanMs(it->rxTimeMsec, FLOOD_EXPIRE_TIME)) {
-            it = recentPackets.erase(it); // erase returns iterator pointing to element immediately following the one erased
-        } else {
-            ++it;
-        }
+    while (recentPacketsCount > 0) {
+        const PacketRecord &oldest = recentPackets[recentPacketsHead];
+        if (oldest.id != 0 && !isExpired(oldest))
+            break;
+        popHead();
     }
-
-    LOG_DEBUG("recentPackets size=%ld (after clearing expired packets)", recentPackets.size());
 }
 
 /* Check if a certain node was a relayer of a packet in the history given an ID and sender
@@ -109,19 +245,18 @@ bool PacketHistory::wasRelayer(const uint8_t relayer, const uint32_t id, const N
     if (relayer == 0)
         return false;
 
-    PacketRecord r = {.sender = sender, .id = id, .rxTimeMsec = 0, .next_hop = 0};
-    auto found = recentPackets.find(r);
+    const PacketRecord *found = find(sender, id);
 
-    if (found == recentPackets.end()) {
+    if (found == NULL) {
         return false;
     }
 
     return wasRelayer(relayer, found);
 }
 
-/* Check if a certain node was a relayer of a packet in the history given iterator
+/* Check if a certain node was a relayer of a packet in the history given a record
  * @return true if node was indeed a relayer, false if not */
-bool PacketHistory::wasRelayer(const uint8_t relayer, std::unordered_set<PacketRecord, PacketRecordHashFunction>::iterator r)
+bool PacketHistory::wasRelayer(const uint8_t relayer, const PacketRecord *r)
 {
     for (uint8_t i = 0; i < NUM_RELAYERS; i++) {
         if (r->relayed_by[i] == relayer) {
@@ -134,25 +269,20 @@ bool PacketHistory::wasRelayer(const uint8_t relayer, std::unordered_set<PacketR
 // Remove a relayer from the list of relayers of a packet in the history given an ID and sender
 void PacketHistory::removeRelayer(const uint8_t relayer, const uint32_t id, const NodeNum sender)
 {
-    PacketRecord r = {.sender = sender, .id = id, .rxTimeMsec = 0, .next_hop = 0};
-    auto found = recentPackets.find(r);
+    PacketRecord *found = find(sender, id);
 
-    if (found == recentPackets.end()) {
+    if (found == NULL) {
         return;
     }
-    // Make a copy of the found record
-    r.next_hop = found->next_hop;
-    r.rxTimeMsec = found->rxTimeMsec;
 
-    // Only add the relayers that are not the one we want to remove
+    // Only keep the relayers that are not the one we want to remove
     uint8_t j = 0;
     for (uint8_t i = 0; i < NUM_RELAYERS; i++) {
         if (found->relayed_by[i] != relayer) {
-            r.relayed_by[j] = found->relayed_by[i];
+            found->relayed_by[j] = found->relayed_by[i];
             j++;
         }
     }
-
-    recentPackets.erase(found);
-    recentPackets.insert(r);
-}
\ No newline at end of file
+    while (j < NUM_RELAYERS)
+        found->relayed_by[j++] = 0;
+}
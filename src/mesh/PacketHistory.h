@@ -1,7 +1,6 @@
 #pragma once
 
 #include "NodeDB.h"
-#include <unordered_set>
 
 /// We clear our old flood record 10 minutes after we see the last of it
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
@@ -26,24 +25,71 @@ struct PacketRecord {
     bool operator==(const PacketRecord &p) const { return sender == p.sender && id == p.id; }
 };
 
-class PacketRecordHashFunction
-{
-  public:
-    size_t operator()(const PacketRecord &p) const { return (std::hash<NodeNum>()(p.sender)) ^ (std::hash<PacketId>()(p.id)); }
-};
+/// Number of packet records we keep, the least recently heard record is dropped when full.  Allocated once when the Router
+/// is created, so embedded targets keep the old MAX_NUM_NODES worst case, only Portduino can afford the extra headroom.
+#ifndef PACKETHISTORY_MAX
+#ifdef ARCH_PORTDUINO
+#define PACKETHISTORY_MAX (MAX_NUM_NODES * 2)
+#else
+#define PACKETHISTORY_MAX MAX_NUM_NODES
+#endif
+#endif
 
 /**
  * This is a mixin that adds a record of past packets we have seen
+ *
+ * Records are kept in a fixed ring in the order they were last heard, moving to the tail each time a packet is heard again, so
+ * expired records always collect at the head and can be dropped without scanning.  A small open-addressed (sender, id) index
+ * points into the ring.  Nothing is allocated after construction.
  */
 class PacketHistory
 {
   private:
-    std::unordered_set<PacketRecord, PacketRecordHashFunction> recentPackets;
+    /// One slot of the (sender, id) index, packed so that a cache line holds 16 of them
+    struct IndexEntry {
+        uint16_t slot; // position in recentPackets, EMPTY_SLOT if unused
+        uint16_t tag;  // upper hash bits, lets most probes skip touching the record itself
+    };
+    static constexpr uint16_t EMPTY_SLOT = 0xFFFF;
+
+    PacketRecord *recentPackets = NULL; // ring of records, a record with id 0 is a hole left by erase()
+    uint32_t recentPacketsCapacity = 0;
+    uint32_t recentPacketsHead = 0;  // oldest record in the ring
+    uint32_t recentPacketsCount = 0; // records between head and tail, including holes
+    uint32_t recentPacketsFirstHole = 0; // no hole before this many records from the head
+    IndexEntry *recentPacketsIndex = NULL;
+    uint32_t recentPacketsIndexMask = 0;
 
-    void clearExpiredRecentPackets(); // clear all recentPackets older than FLOOD_EXPIRE_TIME
+    NodeNum ownerNodeNum = 0;         // 0 for nodeDB's
+    const uint32_t *clockMsec = NULL; // NULL for millis()
+
+    static uint32_t hashRecord(NodeNum sender, PacketId id);
+
+    PacketRecord *find(NodeNum sender, PacketId id);
+    uint32_t indexOf(uint16_t slot);             // position in recentPacketsIndex of the record in slot
+    PacketRecord *insert(const PacketRecord &r); // add r at the tail, dropping the least recently heard record if full
+    void erase(PacketRecord *r);                 // forget r, leaving a hole in the ring
+    void popHead();                              // drop the head of the ring
+    void compact();                              // close up the holes in the ring
+    PacketRecord *refresh(PacketRecord *r);      // r was heard again, move it to the tail
+
+    void clearExpiredRecentPackets(); // drop holes and records older than FLOOD_EXPIRE_TIME from the head of the ring
+
+    NodeNum ourNodeNum() { return ownerNodeNum ? ownerNodeNum : nodeDB->getNodeNum(); }
+    uint32_t nowMsec() { return clockMsec ? *clockMsec : millis(); }
+    bool isExpired(const PacketRecord &r) { return nowMsec() - r.rxTimeMsec >= (uint32_t)FLOOD_EXPIRE_TIME; }
 
   public:
     PacketHistory();
+    ~PacketHistory();
+
+    /// For running many nodes in one process, as MeshSim does: whose history this is, and a clock to age records by instead of
+    /// millis()
+    void setOwner(NodeNum nodeNum, const uint32_t *clockMsec)
+    {
+        ownerNodeNum = nodeNum;
+        this->clockMsec = clockMsec;
+    }
 
     /**
      * Update recentBroadcasts and return true if we have already seen this packet
@@ -59,10 +105,10 @@ class PacketHistory
      * @return true if node was indeed a relayer, false if not */
     bool wasRelayer(const uint8_t relayer, const uint32_t id, const NodeNum sender);
 
-    /* Check if a certain node was a relayer of a packet in the history given iterator
+    /* Check if a certain node was a relayer of a packet in the history given a record
      * @return true if node was indeed a relayer, false if not */
-    bool wasRelayer(const uint8_t relayer, std::unordered_set<PacketRecord, PacketRecordHashFunction>::iterator r);
+    bool wasRelayer(const uint8_t relayer, const PacketRecord *r);
 
     // Remove a relayer from the list of relayers of a packet in the history given an ID and sender
     void removeRelayer(const uint8_t relayer, const uint32_t id, const NodeNum sender);
-};
\ No newline at end of file
+};
@@ -8,6 +8,7 @@
 #include "FSCommon.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "NodeInfoCache.h"
 #include "PacketHistory.h"
 #include "PhoneAPI.h"
 #include "PowerFSM.h"
@@ -69,6 +70,7 @@ void PhoneAPI::handleStartConfig()
 
     LOG_INFO("Start API client config");
     nodeInfoForPhone.num = 0; // Don't keep returning old nodeinfos
+    nodeSlotForPhone = -1;
     resetReadIndex();
 }
 
@@ -91,6 +93,7 @@ void PhoneAPI::close()
         fromRadioScratch = {};
         toRadioScratch = {};
         nodeInfoForPhone = {};
+        nodeSlotForPhone = -1;
         packetForPhone = NULL;
         filesManifest.clear();
         fromRadioNum = 0;
@@ -413,6 +416,21 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
 
     case STATE_SEND_OTHER_NODEINFOS: {
         LOG_DEBUG("Send known nodes");
+#if PHONEAPI_NODEINFO_CACHE
+        if (nodeSlotForPhone >= 0) {
+            // available() only noted which node is next, the frame itself comes from the cache shared by all clients
+            size_t slot = nodeSlotForPhone;
+            NodeNum num = nodeInfoForPhone.num;
+            nodeSlotForPhone = -1;
+            nodeInfoForPhone.num = 0;
+            if (slot < nodeDB->getNumMeshNodes() && nodeDB->getMeshNodeByIndex(slot)->num == num) {
+                const meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(slot);
+                LOG_INFO("nodeinfo: num=0x%x, lastseen=%u, name=%s", node->num, node->last_heard, node->user.long_name);
+                return nodeInfoCache.getFromRadio(slot, *node, buf);
+            }
+            return getFromRadio(buf); // the DB changed under us, go on with the next node
+        }
+#endif
         if (nodeInfoForPhone.num != 0) {
             LOG_INFO("nodeinfo: num=0x%x, lastseen=%u, id=%s, name=%s", nodeInfoForPhone.num, nodeInfoForPhone.last_heard,
                      nodeInfoForPhone.user.id, nodeInfoForPhone.user.long_name);
@@ -499,6 +517,22 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
     return 0;
 }
 
+size_t PhoneAPI::getFromRadioFramed(uint8_t *buf, size_t bufSize, size_t maxFrames)
+{
+    size_t used = 0;
+    for (size_t frames = 0; frames < maxFrames && used + 4 + meshtastic_FromRadio_size <= bufSize; frames++) {
+        size_t len = getFromRadio(buf + used + 4);
+        if (len == 0)
+            break;
+        buf[used] = 0x94;
+        buf[used + 1] = 0xc3;
+        buf[used + 2] = (len >> 8) & 0xff;
+        buf[used + 3] = len & 0xff;
+        used += 4 + len;
+    }
+    return used;
+}
+
 void PhoneAPI::sendConfigComplete()
 {
     LOG_INFO("Config Send Complete");
@@ -563,6 +597,13 @@ bool PhoneAPI::available()
     case STATE_SEND_OTHER_NODEINFOS:
         if (nodeInfoForPhone.num == 0) {
             auto nextNode = nodeDB->readNextMeshNode(readIndex);
+#if PHONEAPI_NODEINFO_CACHE
+            if (nextNode && nextNode->num != nodeDB->getNodeNum()) {
+                nodeInfoForPhone.num = nextNode->num;
+                nodeSlotForPhone = readIndex - 1;
+                return true;
+            }
+#endif
             if (nextNode) {
                 nodeInfoForPhone = TypeConversions::ConvertToNodeInfo(nextNode);
                 bool isUs = nodeInfoForPhone.num == nodeDB->getNodeNum();
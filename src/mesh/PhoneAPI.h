@@ -80,6 +80,9 @@ class PhoneAPI
     /// We temporarily keep the nodeInfo here between the call to available and getFromRadio
     meshtastic_NodeInfo nodeInfoForPhone = meshtastic_NodeInfo_init_default;
 
+    /// With the NodeInfo cache, available() only fills in nodeInfoForPhone.num and the node's NodeDB slot goes here (-1 if none)
+    int32_t nodeSlotForPhone = -1;
+
     meshtastic_ToRadio toRadioScratch = {
         0}; // this is a static scratch object, any data must be copied elsewhere before returning
 
@@ -120,6 +123,14 @@ class PhoneAPI
      */
     size_t getFromRadio(uint8_t *buf);
 
+    /**
+     * Get as many FromRadio packets as fit in buf, each preceded by the 4 byte header StreamAPI uses (0x94 0xc3, then the length
+     * as a big endian uint16), for transports that can carry several at once.
+     * @param maxFrames stop after this many
+     * @return the number of bytes written to buf, 0 if there was nothing to send
+     */
+    size_t getFromRadioFramed(uint8_t *buf, size_t bufSize, size_t maxFrames = SIZE_MAX);
+
     void sendConfigComplete();
 
     /**
@@ -199,6 +199,11 @@ separated by 2.16 MHz with respect to the adjacent channels. Channel zero starts
  * @return num msecs for the packet
  */
 uint32_t RadioInterface::getPacketTime(uint32_t pl)
+{
+    return getPacketTime(pl, sf, bw, cr, preambleLength);
+}
+
+uint32_t RadioInterface::getPacketTime(uint32_t pl, uint8_t sf, float bw, uint8_t cr, uint16_t preambleLength)
 {
     float bandwidthHz = bw * 1000.0f;
     bool headDisable = false; // we currently always use the header
@@ -234,9 +239,13 @@ uint32_t RadioInterface::getRetransmissionMsec(const meshtastic_MeshPacket *p)
 {
     size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
     uint32_t packetAirtime = getPacketTime(numbytes + sizeof(PacketHeader));
-    // Make sure enough time has elapsed for this packet to be sent and an ACK is received.
     // LOG_DEBUG("Waiting for flooding message with airtime %d and slotTime is %d", packetAirtime, slotTimeMsec);
-    float channelUtil = airTime->channelUtilizationPercent();
+    return getRetransmissionMsec(packetAirtime, airTime->channelUtilizationPercent(), slotTimeMsec);
+}
+
+uint32_t RadioInterface::getRetransmissionMsec(uint32_t packetAirtime, float channelUtil, uint32_t slotTimeMsec)
+{
+    // Make sure enough time has elapsed for this packet to be sent and an ACK is received.
     uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
     // Assuming we pick max. of CWsize and there will be a client with SNR at half the range
     return 2 * packetAirtime + (pow(2, CWsize) + 2 * CWmax + pow(2, int((CWmax + CWmin) / 2))) * slotTimeMsec +
@@ -249,20 +258,25 @@ uint32_t RadioInterface::getTxDelayMsec()
     /** We wait a random multiple of 'slotTimes' (see definition in header file) in order to avoid collisions.
     The pool to take a random multiple from is the contention window (CW), which size depends on the
     current channel utilization. */
-    float channelUtil = airTime->channelUtilizationPercent();
+    ContentionWindow cw = getTxWindow(airTime->channelUtilizationPercent());
+    return (cw.offset + random(0, cw.window)) * slotTimeMsec;
+}
+
+RadioInterface::ContentionWindow RadioInterface::getTxWindow(float channelUtil)
+{
     uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
     // LOG_DEBUG("Current channel utilization is %f so setting CWsize to %d", channelUtil, CWsize);
-    return random(0, pow(2, CWsize)) * slotTimeMsec;
+    return {0, (uint32_t)1 << CWsize};
 }
 
 /** The CW size to use when calculating SNR_based delays */
 uint8_t RadioInterface::getCWsize(float snr)
 {
     // The minimum value for a LoRa SNR
-    const uint32_t SNR_MIN = -20;
+    const int32_t SNR_MIN = -20;
 
     // The maximum value for a LoRa SNR
-    const uint32_t SNR_MAX = 10;
+    const int32_t SNR_MAX = 10;
 
     return map(snr, SNR_MIN, SNR_MAX, CWmin, CWmax);
 }
@@ -280,22 +294,27 @@ uint32_t RadioInterface::getTxDelayMsecWeighted(float snr)
 {
     //  high SNR = large CW size (Long Delay)
     //  low SNR = small CW size (Short Delay)
-    uint32_t delay = 0;
-    uint8_t CWsize = getCWsize(snr);
-    // LOG_DEBUG("rx_snr of %f so setting CWsize to:%d", snr, CWsize);
-    if (config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER ||
-        config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER) {
-        delay = random(0, 2 * CWsize) * slotTimeMsec;
+    bool isRouter = config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER ||
+                    config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER;
+    ContentionWindow cw = getTxWindowWeighted(snr, isRouter);
+    uint32_t delay = (cw.offset + random(0, cw.window)) * slotTimeMsec;
+    if (isRouter)
         LOG_DEBUG("rx_snr found in packet. Router: setting tx delay:%d", delay);
-    } else {
-        // offset the maximum delay for routers: (2 * CWmax * slotTimeMsec)
-        delay = (2 * CWmax * slotTimeMsec) + random(0, pow(2, CWsize)) * slotTimeMsec;
+    else
         LOG_DEBUG("rx_snr found in packet. Setting tx delay:%d", delay);
-    }
-
     return delay;
 }
 
+RadioInterface::ContentionWindow RadioInterface::getTxWindowWeighted(float snr, bool isRouter)
+{
+    uint8_t CWsize = getCWsize(snr);
+    // LOG_DEBUG("rx_snr of %f so setting CWsize to:%d", snr, CWsize);
+    if (isRouter)
+        return {0, 2u * CWsize};
+    // offset the maximum delay for routers: (2 * CWmax * slotTimeMsec)
+    return {2u * CWmax, (uint32_t)1 << CWsize};
+}
+
 void printPacket(const char *prefix, const meshtastic_MeshPacket *p)
 {
 #if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
@@ -587,11 +606,16 @@ void RadioInterface::applyModemConfig()
   - Tx/Rx turnaround time (maximum of SX126x and SX127x);
   - MAC processing time (measured on T-beam) */
 uint32_t RadioInterface::computeSlotTimeMsec()
+{
+    return computeSlotTimeMsec(sf, bw, myRegion->wideLora);
+}
+
+uint32_t RadioInterface::computeSlotTimeMsec(uint8_t sf, float bw, bool wideLora)
 {
     float sumPropagationTurnaroundMACTime = 0.2 + 0.4 + 7; // in milliseconds
     float symbolTime = pow(2, sf) / bw;                    // in milliseconds
 
-    if (myRegion->wideLora) {
+    if (wideLora) {
         // CAD duration derived from AN1200.22 of SX1280
         return (NUM_SYM_CAD_24GHZ + (2 * sf + 3) / 32) * symbolTime + sumPropagationTurnaroundMACTime;
     } else {
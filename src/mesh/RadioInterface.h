@@ -84,16 +84,18 @@ class RadioInterface
     uint8_t sf = 9;
     uint8_t cr = 5;
 
-    const uint8_t NUM_SYM_CAD = 2;       // Number of symbols used for CAD, 2 is the default since RadioLib 6.3.0 as per AN1200.48
-    const uint8_t NUM_SYM_CAD_24GHZ = 4; // Number of symbols used for CAD in 2.4 GHz, 4 is recommended in AN1200.22 of SX1280
+    // Number of symbols used for CAD, 2 is the default since RadioLib 6.3.0 as per AN1200.48
+    static constexpr uint8_t NUM_SYM_CAD = 2;
+    // Number of symbols used for CAD in 2.4 GHz, 4 is recommended in AN1200.22 of SX1280
+    static constexpr uint8_t NUM_SYM_CAD_24GHZ = 4;
     uint32_t slotTimeMsec = computeSlotTimeMsec();
     uint16_t preambleLength = 16;      // 8 is default, but we use longer to increase the amount of sleep time when receiving
     uint32_t preambleTimeMsec = 165;   // calculated on startup, this is the default for LongFast
     uint32_t maxPacketTimeMsec = 3246; // calculated on startup, this is the default for LongFast
-    const uint32_t PROCESSING_TIME_MSEC =
-        4500;                // time to construct, process and construct a packet again (empirically determined)
-    const uint8_t CWmin = 3; // minimum CWsize
-    const uint8_t CWmax = 8; // maximum CWsize
+    static constexpr uint32_t PROCESSING_TIME_MSEC =
+        4500;                           // time to construct, process and construct a packet again (empirically determined)
+    static constexpr uint8_t CWmin = 3; // minimum CWsize
+    static constexpr uint8_t CWmax = 8; // maximum CWsize
 
     meshtastic_MeshPacket *sendingPacket = NULL; // The packet we are currently sending
     uint32_t lastTxStart = 0L;
@@ -156,6 +158,24 @@ class RadioInterface
     /** Attempt to find a packet in the TxQueue. Returns true if the packet was found. */
     virtual bool findInTxQueue(NodeNum from, PacketId id) { return false; }
 
+    /// A delay of (offset + a random number below window) slot times
+    struct ContentionWindow {
+        uint32_t offset;
+        uint32_t window;
+    };
+
+    /**
+     * The timing rules behind the delays below, taking the modem settings and channel state as arguments instead of reading
+     * them from this radio, so MeshSim can apply them to each of its virtual nodes
+     */
+    static uint32_t getPacketTime(uint32_t totalPacketLen, uint8_t sf, float bw, uint8_t cr, uint16_t preambleLength);
+    static uint32_t computeSlotTimeMsec(uint8_t sf, float bw, bool wideLora);
+    static uint32_t getRetransmissionMsec(uint32_t packetAirtime, float channelUtil, uint32_t slotTimeMsec);
+    static ContentionWindow getTxWindow(float channelUtil);
+    static ContentionWindow getTxWindowWeighted(float snr, bool isRouter);
+    /** The CW to use when calculating SNR_based delays */
+    static uint8_t getCWsize(float snr);
+
     // methods from radiohead
 
     /// Initialise the Driver transport hardware and software.
@@ -174,9 +194,6 @@ class RadioInterface
     /** The delay to use when we want to send something */
     uint32_t getTxDelayMsec();
 
-    /** The CW to use when calculating SNR_based delays */
-    uint8_t getCWsize(float snr);
-
     /** The worst-case SNR_based packet delay */
     uint32_t getTxDelayMsecWeightedWorst(float snr);
 
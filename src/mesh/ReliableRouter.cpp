@@ -76,6 +76,19 @@ bool ReliableRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
     return isBroadcast(p->to) ? FloodingRouter::shouldFilterReceived(p) : NextHopRouter::shouldFilterReceived(p);
 }
 
+bool ReliableRouter::getAckHopLimit(const meshtastic_MeshPacket *p, uint8_t configuredHopLimit, uint8_t *hopLimit)
+{
+    // A response may be set to want_ack for retransmissions, but we don't need to ACK a response if it received an
+    // implicit ACK already. If we received it directly, only ACK with a hop limit of 0
+    if (!p->decoded.request_id)
+        *hopLimit = RoutingModule::getHopLimitForResponse(p->hop_start, p->hop_limit, configuredHopLimit);
+    else if (isRepeated(p))
+        *hopLimit = 0;
+    else
+        return false;
+    return true;
+}
+
 /**
  * If we receive a want_ack packet (do not check for wasSeenRecently), send back an ack (this might generate multiple ack sends in
  * case the our first ack gets lost)
@@ -95,13 +108,9 @@ void ReliableRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtas
             if (MeshModule::currentReply) {
                 LOG_DEBUG("Another module replied to this message, no need for 2nd ack");
             } else if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
-                // A response may be set to want_ack for retransmissions, but we don't need to ACK a response if it received an
-                // implicit ACK already. If we received it directly, only ACK with a hop limit of 0
-                if (!p->decoded.request_id)
-                    sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, p->channel,
-                               routingModule->getHopLimitForResponse(p->hop_start, p->hop_limit));
-                else if (p->hop_start > 0 && p->hop_start == p->hop_limit)
-                    sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, p->channel, 0);
+                uint8_t hopLimit;
+                if (getAckHopLimit(p, config.lora.hop_limit, &hopLimit))
+                    sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, p->channel, hopLimit);
             } else if (p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag && p->channel == 0 &&
                        (nodeDB->getMeshNode(p->from) == nullptr || nodeDB->getMeshNode(p->from)->user.public_key.size == 0)) {
                 LOG_INFO("PKI packet from unknown node, send PKI_UNKNOWN_PUBKEY");
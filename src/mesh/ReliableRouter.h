@@ -21,6 +21,13 @@ class ReliableRouter : public NextHopRouter
      */
     virtual ErrorCode send(meshtastic_MeshPacket *p) override;
 
+    /**
+     * Should we ACK this decoded want_ack packet to us, and with what hop limit.  A request gets an ACK that can reach its
+     * sender, a response only when it came straight from its sender, otherwise it got an implicit ACK already.  Shared with
+     * MeshSim.
+     */
+    static bool getAckHopLimit(const meshtastic_MeshPacket *p, uint8_t configuredHopLimit, uint8_t *hopLimit);
+
   protected:
     /**
      * Look for acks/naks or someone retransmitting us
@@ -16,6 +16,7 @@
 #endif
 #include "Default.h"
 #if ARCH_PORTDUINO
+#include "platform/portduino/DecodePipeline.h"
 #include "platform/portduino/PortduinoGlue.h"
 #endif
 #if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
@@ -27,17 +28,59 @@
 
 // I think this is right, one packet for each of the three fifos + one packet being currently assembled for TX or RX
 // And every TX packet might have a retransmission packet or an ack alive at any moment
+#ifndef MAX_PACKETS
 #define MAX_PACKETS                                                                                                              \
-    (MAX_RX_TOPHONE + MAX_RX_FROMRADIO + 2 * MAX_TX_QUEUE +                                                                      \
+    (POOL_RX_TOPHONE + MAX_RX_FROMRADIO + 2 * MAX_TX_QUEUE +                                                                      \
      2) // max number of packets which can be in flight (either queued from reception or queued for sending)
+#endif
 
-// static MemoryPool<MeshPacket> staticPool(MAX_PACKETS);
-static MemoryDynamic<meshtastic_MeshPacket> staticPool;
+// Anything beyond MAX_PACKETS falls back to the heap, see packetPool.getStats() if that happens a lot
+static MemoryPool<meshtastic_MeshPacket> staticPool(MAX_PACKETS);
 
 Allocator<meshtastic_MeshPacket> &packetPool = staticPool;
 
 static uint8_t bytes[MAX_LORA_PAYLOAD_LEN + 1] __attribute__((__aligned__));
 
+DecodeStats decodeStats;
+
+// The channel each sender was last decoded on, direct mapped by NodeNum and only ever used as a hint for which key to try first
+#define LAST_DECODE_CHANNEL_SLOTS 32
+static struct LastDecodeChannel {
+    NodeNum from;
+    ChannelIndex chIndex;
+} lastDecodeChannel[LAST_DECODE_CHANNEL_SLOTS];
+
+#if ARCH_PORTDUINO
+// What the decode pipeline worked out for the packet Router::runOnce is currently handling
+static PrecomputedDecode precomputedDecode;
+#endif
+
+/**
+ * Cheap check on freshly decrypted bytes before paying for a full pb_decode.  Every valid Data message starts with the key of
+ * one of its fields (nanopb writes portnum first, and portnum must be non zero for us to accept the packet), while a wrong key
+ * gives random bytes that pass this only about 1 time in 30.
+ */
+bool looksLikeData(const uint8_t *plaintext, size_t len)
+{
+    if (len < 2)
+        return false;
+    switch (plaintext[0]) {
+    case (meshtastic_Data_portnum_tag << 3) | PB_WT_VARINT:
+        return plaintext[1] != 0;
+    case (meshtastic_Data_payload_tag << 3) | PB_WT_STRING:
+    case (meshtastic_Data_want_response_tag << 3) | PB_WT_VARINT:
+    case (meshtastic_Data_dest_tag << 3) | PB_WT_32BIT:
+    case (meshtastic_Data_source_tag << 3) | PB_WT_32BIT:
+    case (meshtastic_Data_request_id_tag << 3) | PB_WT_32BIT:
+    case (meshtastic_Data_reply_id_tag << 3) | PB_WT_32BIT:
+    case (meshtastic_Data_emoji_tag << 3) | PB_WT_32BIT:
+    case (meshtastic_Data_bitfield_tag << 3) | PB_WT_VARINT:
+        return true;
+    default:
+        return false;
+    }
+}
+
 /**
  * Constructor
  *
@@ -64,15 +107,52 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
  */
 int32_t Router::runOnce()
 {
+#if ARCH_PORTDUINO
+    // Decode workers wake us from their own threads.  Go idle before looking at what they left rather than by returning
+    // INT32_MAX, which could overwrite a wake that came in meanwhile.  Pairs with the fence in DecodePipeline::workerLoop.
+    setInterval(INT32_MAX);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+
     meshtastic_MeshPacket *mp;
     while ((mp = fromRadioQueue.dequeuePtr(0)) != NULL) {
         // printPacket("handle fromRadioQ", mp);
         perhapsHandleReceived(mp);
     }
 
+#if ARCH_PORTDUINO
+    if (decodePipeline) {
+        while (decodePipeline->takeCompleted(precomputedDecode)) {
+            perhapsHandleReceived(const_cast<meshtastic_MeshPacket *>(precomputedDecode.packet));
+            precomputedDecode.packet = NULL;
+        }
+    }
+#endif
+
+    // Report pool pressure from here rather than from alloc(), which might be running in an ISR
+    AllocatorStats poolStats = packetPool.getStats();
+    if (poolStats.exhausted != lastPoolExhausted) {
+        LOG_WARN("Packet pool exhausted %u times, high water mark %u of %u", poolStats.exhausted, poolStats.highWaterMark,
+                 poolStats.capacity);
+        lastPoolExhausted = poolStats.exhausted;
+    }
+
+#if ARCH_PORTDUINO
+    return -1; // Already idle, unless something woke us while we ran
+#else
     // LOG_DEBUG("Sleep forever!");
     return INT32_MAX; // Wait a long time - until we get woken for the message queue
+#endif
+}
+
+#if ARCH_PORTDUINO
+void Router::startDecodePipeline(unsigned numThreads)
+{
+    LOG_INFO("Decode received packets on %u worker threads", numThreads);
+    decodePipeline = new DecodePipeline(numThreads);
+    decodePipeline->setReader(this);
 }
+#endif
 
 /**
  * RadioInterface calls this to queue up packets that have been received from the radio.  The router is now responsible for
@@ -80,6 +160,17 @@ int32_t Router::runOnce()
  */
 void Router::enqueueReceivedMessage(meshtastic_MeshPacket *p)
 {
+#if ARCH_PORTDUINO
+    if (decodePipeline && p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag) {
+        const LastDecodeChannel &last = lastDecodeChannel[p->from % LAST_DECODE_CHANNEL_SLOTS];
+        if (!decodePipeline->submit(p, last.from == p->from ? last.chIndex : -1)) {
+            printPacket("decode pipeline full, drop!", p);
+            packetPool.release(p);
+        }
+        setReceivedMessage();
+        return;
+    }
+#endif
     // Try enqueue until successful
     while (!fromRadioQueue.enqueue(p, 0)) {
         meshtastic_MeshPacket *old_p;
@@ -338,7 +429,7 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 
     if (config.device.rebroadcast_mode == meshtastic_Config_DeviceConfig_RebroadcastMode_KNOWN_ONLY &&
         (nodeDB->getMeshNode(p->from) == NULL || !nodeDB->getMeshNode(p->from)->has_user)) {
-        LOG_DEBUG("Node 0x%x not in nodeDB-> Rebroadcast mode KNOWN_ONLY will ignore packet", p->from);
+        LOG_DEBUG_DEFERRED("Node 0x%x not in nodeDB-> Rebroadcast mode KNOWN_ONLY will ignore packet", p->from);
         return DecodeState::DECODE_FAILURE;
     }
 
@@ -387,10 +478,38 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 
     // assert(p->which_payloadVariant == MeshPacket_encrypted_tag);
     if (!decrypted) {
-        // Try to find a channel that works with this hash
-        for (chIndex = 0; chIndex < channels.getNumChannels(); chIndex++) {
+        // Only channels whose hash matches can decrypt this, and the one that worked for this sender last time goes first
+        uint8_t candidates = channels.getChannelsForHash(p->channel);
+        LastDecodeChannel &last = lastDecodeChannel[p->from % LAST_DECODE_CHANNEL_SLOTS];
+        bool triedLast = last.from == p->from && (candidates & (1U << last.chIndex));
+
+#if ARCH_PORTDUINO
+        if (precomputedDecode.packet == p && precomputedDecode.channelsGeneration == channels.getGeneration()) {
+            // A pipeline worker already tried every candidate channel for us
+            decodeStats.attempts += precomputedDecode.attempts;
+            decodeStats.wasted += precomputedDecode.wasted;
+            decodeStats.rejectedEarly += precomputedDecode.rejectedEarly;
+            if (precomputedDecode.hintHit)
+                decodeStats.lastChannelHits++;
+            if (precomputedDecode.decoded) {
+                chIndex = precomputedDecode.chIndex;
+                p->decoded = precomputedDecode.data;
+                p->which_payload_variant = meshtastic_MeshPacket_decoded_tag; // change type to decoded
+                decrypted = true;
+                last.from = p->from;
+                last.chIndex = chIndex;
+            }
+            candidates = 0;
+        }
+#endif
+
+        while (candidates) {
+            chIndex = triedLast ? last.chIndex : __builtin_ctz(candidates);
+            candidates &= ~(1U << chIndex);
+
             // Try to use this hash/channel pair
             if (channels.decryptForHash(chIndex, p->channel)) {
+                decodeStats.attempts++;
                 // we have to copy into a scratch buffer, because these bytes are a union with the decoded protobuf. Create a
                 // fresh copy for each decrypt attempt.
                 memcpy(bytes, p->encrypted.bytes, rawSize);
@@ -402,7 +521,10 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
                 // Take those raw bytes and convert them back into a well structured protobuf we can understand
                 meshtastic_Data decodedtmp;
                 memset(&decodedtmp, 0, sizeof(decodedtmp));
-                if (!pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &decodedtmp)) {
+                if (!looksLikeData(bytes, rawSize)) {
+                    decodeStats.rejectedEarly++;
+                    LOG_ERROR("Invalid protobufs in received mesh packet id=0x%08x (bad psk?)!", p->id);
+                } else if (!pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &decodedtmp)) {
                     LOG_ERROR("Invalid protobufs in received mesh packet id=0x%08x (bad psk?)!", p->id);
                 } else if (decodedtmp.portnum == meshtastic_PortNum_UNKNOWN_APP) {
                     LOG_ERROR("Invalid portnum (bad psk?)!");
@@ -410,9 +532,15 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
                     p->decoded = decodedtmp;
                     p->which_payload_variant = meshtastic_MeshPacket_decoded_tag; // change type to decoded
                     decrypted = true;
+                    if (triedLast)
+                        decodeStats.lastChannelHits++;
+                    last.from = p->from;
+                    last.chIndex = chIndex;
                     break;
                 }
+                decodeStats.wasted++;
             }
+            triedLast = false;
         }
     }
     if (decrypted) {
@@ -445,7 +573,7 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 #if ENABLE_JSON_LOGGING
         LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
 #elif ARCH_PORTDUINO
-        if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
+        if (LOG_TRACE_ENABLED()) {
             LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
         }
 #endif
@@ -690,7 +818,7 @@ void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
     LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
 #elif ARCH_PORTDUINO
     // Even ignored packets get logged in the trace
-    if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
+    if (LOG_TRACE_ENABLED()) {
         p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
         LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
     }
@@ -9,6 +9,10 @@
 #include "RadioInterface.h"
 #include "concurrency/OSThread.h"
 
+#if ARCH_PORTDUINO
+class DecodePipeline;
+#endif
+
 /**
  * A mesh aware router that supports multiple interfaces.
  */
@@ -19,6 +23,14 @@ class Router : protected concurrency::OSThread, protected PacketHistory
     /// forwarded to the phone.
     PointerQueue<meshtastic_MeshPacket> fromRadioQueue;
 
+    /// packetPool exhaustion count we last warned about
+    uint32_t lastPoolExhausted = 0;
+
+#if ARCH_PORTDUINO
+    /// When set, received packets are decrypted on worker threads before we handle them
+    DecodePipeline *decodePipeline = NULL;
+#endif
+
   protected:
     RadioInterface *iface = NULL;
 
@@ -40,6 +52,11 @@ class Router : protected concurrency::OSThread, protected PacketHistory
      */
     virtual int32_t runOnce() override;
 
+#if ARCH_PORTDUINO
+    /// Decrypt received packets on this many worker threads, see DecodePipeline
+    void startDecodePipeline(unsigned numThreads);
+#endif
+
     /**
      * Works like send, but if we are sending to the local node, we directly put the message in the receive queue.
      * This is the primary method used for sending packets, because it handles both the remote and local cases.
@@ -149,6 +166,19 @@ enum DecodeState { DECODE_SUCCESS, DECODE_FAILURE, DECODE_FATAL };
  */
 DecodeState perhapsDecode(meshtastic_MeshPacket *p);
 
+/// How much channel decryption work perhapsDecode has done, and how much of it was spent on the wrong key
+struct DecodeStats {
+    uint32_t attempts;        // channel decrypts tried
+    uint32_t wasted;          // decrypts that did not yield a valid Data message
+    uint32_t rejectedEarly;   // wasted decrypts caught by the plaintext check, without running pb_decode
+    uint32_t lastChannelHits; // packets decoded on the first try using the channel remembered for their sender
+};
+
+extern DecodeStats decodeStats;
+
+/// Cheap check that decrypted bytes could be a Data protobuf, used to skip pb_decode for most wrong keys
+bool looksLikeData(const uint8_t *plaintext, size_t len);
+
 /** Return 0 for success or a Routing_Error code for failure
  */
 meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p);
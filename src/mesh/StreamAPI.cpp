@@ -11,9 +11,13 @@
 int32_t StreamAPI::runOncePart()
 {
     auto result = readStream();
-    writeStream();
+    bool more = writeStream();
     checkConnectionTimeout();
-    return result;
+#if STREAM_API_OUT_BUF_SIZE
+    if (more && outStalled)
+        return STREAM_API_STALL_MSEC; // Don't spin on a stream that isn't taking anything
+#endif
+    return more ? 0 : result;
 }
 
 /**
@@ -76,34 +80,121 @@ int32_t StreamAPI::readStream()
     }
 }
 
+static inline void writeHeader(uint8_t *buf, size_t len)
+{
+    buf[0] = START1;
+    buf[1] = START2;
+    buf[2] = (len >> 8) & 0xff;
+    buf[3] = len & 0xff;
+}
+
 /**
  * call getFromRadio() and deliver encapsulated packets to the Stream
  */
-void StreamAPI::writeStream()
+bool StreamAPI::writeStream()
 {
-    if (canWrite) {
-        uint32_t len;
-        do {
-            // Send every packet we can
-            len = getFromRadio(txBuf + HEADER_LEN);
-            emitTxBuffer(len);
-        } while (len);
+    if (!canWrite)
+        return false;
+
+#if STREAM_API_OUT_BUF_SIZE
+    // Finish what the stream didn't take last time before making more
+    if (outSent < outLen) {
+        outStalled = !flushOutBuf();
+        if (outSent < outLen)
+            return true;
     }
+    outLen = outSent = 0;
+    outStalled = false;
+
+    // Encode frames straight into place until the buffer is full, then write them all at once.  One buffer per call, so a
+    // client downloading thousands of nodes doesn't hold up the rest of the main loop (or the other clients).
+    bool full = false;
+    appendPendingFrame();
+    while (true) {
+        if (outLen + MAX_STREAM_BUF_SIZE > sizeof(outBuf)) {
+            full = true;
+            break;
+        }
+        encoding = true;
+        size_t len = getFromRadio(outBuf + outLen + HEADER_LEN);
+        encoding = false;
+        if (len != 0) {
+            writeHeader(outBuf + outLen, len);
+            outLen += HEADER_LEN + len;
+        }
+        appendPendingFrame(); // a log record printed while that frame was made
+        if (len == 0)
+            break;
+    }
+    if (outSent < outLen) {
+        outStalled = !flushOutBuf();
+        stream->flush();
+    }
+    return full || outSent < outLen;
+#else
+    uint32_t len;
+    do {
+        // Send every packet we can
+        len = getFromRadio(txBuf + HEADER_LEN);
+        emitTxBuffer(len);
+    } while (len);
+    return false;
+#endif
 }
 
+#if STREAM_API_OUT_BUF_SIZE
+bool StreamAPI::flushOutBuf()
+{
+    size_t n = stream->write(outBuf + outSent, outLen - outSent);
+    outSent += n;
+    return n > 0;
+}
+
+void StreamAPI::appendPendingFrame()
+{
+    if (pendingLen == 0 || outLen + pendingLen > sizeof(outBuf))
+        return;
+    memcpy(outBuf + outLen, pendingFrame, pendingLen);
+    outLen += pendingLen;
+    pendingLen = 0;
+}
+#endif
+
 /**
  * Send the current txBuffer over our stream
  */
 void StreamAPI::emitTxBuffer(size_t len)
 {
     if (len != 0) {
-        txBuf[0] = START1;
-        txBuf[1] = START2;
-        txBuf[2] = (len >> 8) & 0xff;
-        txBuf[3] = len & 0xff;
+        writeHeader(txBuf, len);
 
         auto totalLen = len + HEADER_LEN;
-        stream->write(txBuf, totalLen);
+#if STREAM_API_OUT_BUF_SIZE
+        // Never straight to the stream: the frames ahead of this one may not all have gone yet, and the stream may take only part
+        // of it, either of which would leave a frame split by another.  Queue it behind them instead, or drop it.
+        if (encoding) {
+            if (pendingLen == 0) {
+                memcpy(pendingFrame, txBuf, totalLen);
+                pendingLen = totalLen;
+            } else {
+                droppedFrames++;
+            }
+            return;
+        }
+        if (outSent == outLen)
+            outLen = outSent = 0;
+        appendPendingFrame();
+        if (pendingLen != 0 || outLen + totalLen > sizeof(outBuf)) {
+            droppedFrames++;
+            return;
+        }
+        memcpy(outBuf + outLen, txBuf, totalLen);
+        outLen += totalLen;
+        outStalled = !flushOutBuf();
+#else
+        if (stream->write(txBuf, totalLen) != totalLen)
+            droppedFrames++; // Nothing to keep the rest in, the client will resync on the next 0x94C3
+#endif
         stream->flush();
     }
 }
@@ -8,6 +8,21 @@
 // A To/FromRadio packet + our 32 bit header
 #define MAX_STREAM_BUF_SIZE (MAX_TO_FROM_RADIO_SIZE + sizeof(uint32_t))
 
+// Frames going to the client are packed into a buffer this big and written with one call, instead of one write per frame.  0 to
+// write each frame as it is made, which is all a serial port or a microcontroller's TCP stack can take at once anyway.
+#ifndef STREAM_API_OUT_BUF_SIZE
+#ifdef ARCH_PORTDUINO
+#define STREAM_API_OUT_BUF_SIZE (32 * 1024)
+#else
+#define STREAM_API_OUT_BUF_SIZE 0
+#endif
+#endif
+
+// How long to wait before trying again when the stream took none of what is waiting in the out buffer, a full socket
+#ifndef STREAM_API_STALL_MSEC
+#define STREAM_API_STALL_MSEC 5
+#endif
+
 /**
  * A version of our 'phone' API that talks over a Stream.  So therefore well suited to use with serial links
  * or TCP connections.
@@ -51,6 +66,9 @@ class StreamAPI : public PhoneAPI
      */
     virtual int32_t runOncePart();
 
+    /// Frames (log records, mostly) we had no room to queue, or that the stream only took part of
+    uint32_t getDroppedFrames() const { return droppedFrames; }
+
   private:
     /**
      * Read any rx chars from the link and call handleToRadio
@@ -59,8 +77,30 @@ class StreamAPI : public PhoneAPI
 
     /**
      * call getFromRadio() and deliver encapsulated packets to the Stream
+     * @return true if there is more to send than we wrote this time
      */
-    void writeStream();
+    bool writeStream();
+
+#if STREAM_API_OUT_BUF_SIZE
+    /// Framed FromRadios waiting to go out, outBuf[outSent, outLen) is what the stream hasn't taken yet.  While writeStream is
+    /// encoding, outBuf past outLen is the frame in progress, so nothing else may move or append to outBuf then
+    uint8_t outBuf[STREAM_API_OUT_BUF_SIZE];
+    size_t outLen = 0, outSent = 0;
+    bool outStalled = false; // the stream took nothing the last time we tried
+    bool encoding = false;
+
+    /// A frame emitted while writeStream was encoding, appended to outBuf once that frame is done
+    uint8_t pendingFrame[MAX_STREAM_BUF_SIZE];
+    size_t pendingLen = 0;
+
+    /// Hand as much of outBuf to the stream as it will take.  @return false if it took nothing
+    bool flushOutBuf();
+
+    /// Move pendingFrame to the end of outBuf if there is room for it
+    void appendPendingFrame();
+#endif
+
+    uint32_t droppedFrames = 0;
 
   protected:
     /**
@@ -57,8 +57,14 @@ template <class T, class U> int32_t APIServerPort<T, U>::runOnce()
     auto client = U::available();
 #endif
     if (client) {
-        // Close any previous connection (see FIXME in header file)
-        if (openAPI) {
+        // Take a free slot, or one whose client has gone, else close the open connections in turn
+        int slot = -1;
+        for (int i = 0; i < MAX_API_CLIENTS && slot < 0; i++)
+            if (!openAPIs[i] || !openAPIs[i]->checkIsConnected())
+                slot = i;
+
+        if (slot < 0) {
+            slot = nextReplaced;
 #if RAK_4631
             // RAK13800 Ethernet requests periodically take more time
             // This backoff addresses most cases keeping max wait < 1s
@@ -70,10 +76,12 @@ template <class T, class U> int32_t APIServerPort<T, U>::runOnce()
             }
 #endif
             LOG_INFO("Force close previous TCP connection");
-            delete openAPI;
+            nextReplaced = (nextReplaced + 1) % MAX_API_CLIENTS;
         }
+        if (openAPIs[slot])
+            delete openAPIs[slot];
 
-        openAPI = new T(client);
+        openAPIs[slot] = new T(client);
     }
 
 #if RAK_4631
@@ -4,6 +4,15 @@
 
 #define SERVER_API_DEFAULT_PORT 4403
 
+// How many TCP API clients can be connected at once, a new client beyond that replaces one of them
+#ifndef MAX_API_CLIENTS
+#ifdef ARCH_PORTDUINO
+#define MAX_API_CLIENTS 4
+#else
+#define MAX_API_CLIENTS 1
+#endif
+#endif
+
 /**
  * Provides both debug printing and, if the client starts sending protobufs to us, switches to send/receive protobufs
  * (and starts dropping debug printing - FIXME, eventually those prints should be encapsulated in protobufs).
@@ -21,15 +30,15 @@ template <class T> class ServerAPI : public StreamAPI, private concurrency::OSTh
     /// override close to also shutdown the TCP link
     virtual void close();
 
+    /// Check the current underlying physical link to see if the client is currently connected
+    virtual bool checkIsConnected() override;
+
   protected:
     /// We override this method to prevent publishing EVENT_SERIAL_CONNECTED/DISCONNECTED for wifi links (we want the board to
     /// stay in the POWERED state to prevent disabling wifi)
     virtual void onConnectionChanged(bool connected) override {}
 
     virtual int32_t runOnce() override; // Check for dropped client connections
-
-    /// Check the current underlying physical link to see if the client is currently connected
-    virtual bool checkIsConnected() override;
 };
 
 /**
@@ -37,12 +46,11 @@ template <class T> class ServerAPI : public StreamAPI, private concurrency::OSTh
  */
 template <class T, class U> class APIServerPort : public U, private concurrency::OSThread
 {
-    /** The currently open port
-     *
-     * FIXME: We currently only allow one open TCP connection at a time, because we depend on the loop() call in this class to
-     * delegate to the worker.  Once coroutines are implemented we can relax this restriction.
+    /** The currently open connections, each serviced by its own thread.  StreamAPI writes at most one buffer per wakeup, so a
+     * client downloading the node DB doesn't stall the others.
      */
-    T *openAPI = NULL;
+    T *openAPIs[MAX_API_CLIENTS] = {};
+    uint8_t nextReplaced = 0; // slot to replace when they are all in use
 #if defined(RAK_4631) || defined(RAK11310)
     // Track wait time for RAK13800 Ethernet requests
     int32_t waitTime = 100;
@@ -1,7 +1,9 @@
 #if !MESHTASTIC_EXCLUDE_WEBSERVER
+#include "CryptoEngine.h"
 #include "NodeDB.h"
 #include "PowerFSM.h"
 #include "RadioLibInterface.h"
+#include "Router.h"
 #include "airtime.h"
 #include "main.h"
 #include "mesh/http/ContentHelper.h"
@@ -13,6 +15,7 @@
 #include "SPILock.h"
 #include "power.h"
 #include "serialization/JSON.h"
+#include "serialization/JsonWriter.h"
 #include <FSCommon.h>
 #include <HTTPBodyParser.hpp>
 #include <HTTPMultipartBodyParser.hpp>
@@ -53,6 +56,9 @@ HTTPClient httpClient;
 
 #define DEST_FS_USES_LITTLEFS
 
+// Most bytes a batch=N /api/v1/fromradio response will carry
+#define FROMRADIO_BATCH_BYTES (8 * 1024)
+
 // We need to specify some content-type mapping, so the resources get delivered with the
 // right content type and are displayed correctly in the browser
 char contentTypes[][2][32] = {{".txt", "text/plain"},     {".html", "text/html"},
@@ -178,6 +184,23 @@ void handleAPIv1FromRadio(HTTPRequest *req, HTTPResponse *res)
     uint8_t txBuf[MAX_STREAM_BUF_SIZE];
     uint32_t len = 1;
 
+    // batch=N returns up to N protobufs (N <= 0 for as many as fit in FROMRADIO_BATCH_BYTES), each preceded by the same 4 byte
+    // header StreamAPI uses, so a client can fetch a whole config download in a few requests.  There is no long-poll (wait=) here
+    // like on native, this handler runs in the main loop and waiting would hold up the mesh.
+    std::string valueBatch;
+    if (params->getQueryParameter("batch", valueBatch)) {
+        int maxFrames = atoi(valueBatch.c_str());
+        size_t total = 0;
+        for (int frames = 0; maxFrames <= 0 || frames < maxFrames; frames++) {
+            if (total >= FROMRADIO_BATCH_BYTES || (len = webAPI.getFromRadioFramed(txBuf, sizeof(txBuf), 1)) == 0)
+                break;
+            res->write(txBuf, len);
+            total += len;
+        }
+        LOG_DEBUG("webAPI handleAPIv1FromRadio, batch len %u", total);
+        return;
+    }
+
     if (params->getQueryParameter("all", valueAll)) {
 
         // If all is true, return all the buffers we have available
@@ -610,90 +633,108 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
         res->println("<pre>");
     }
 
-    // data->airtime->tx_log
-    JSONArray txLogValues;
+    spiLock->lock();
+    int fsTotal = FSCom.totalBytes();
+    int fsUsed = FSCom.usedBytes();
+    spiLock->unlock();
+    AllocatorStats poolStats = packetPool.getStats();
+
+    // Keys are written in alphabetical order, the same order the JSONObject based version produced
+    JsonWriter json(*res);
+    json.beginObject();
+    json.key("data");
+    json.beginObject();
+
+    // data->airtime
+    json.key("airtime");
+    json.beginObject();
+    json.member("channel_utilization", airTime->channelUtilizationPercent());
+    json.member("periods_to_log", (int)airTime->getPeriodsToLog());
     uint32_t *logArray;
-    logArray = airTime->airtimeReport(TX_LOG);
+    json.key("rx_all_log");
+    json.beginArray();
+    logArray = airTime->airtimeReport(RX_ALL_LOG);
     for (int i = 0; i < airTime->getPeriodsToLog(); i++) {
-        txLogValues.push_back(new JSONValue((int)logArray[i]));
+        json.value((int)logArray[i]);
     }
-
-    // data->airtime->rx_log
-    JSONArray rxLogValues;
+    json.endArray();
+    json.key("rx_log");
+    json.beginArray();
     logArray = airTime->airtimeReport(RX_LOG);
     for (int i = 0; i < airTime->getPeriodsToLog(); i++) {
-        rxLogValues.push_back(new JSONValue((int)logArray[i]));
+        json.value((int)logArray[i]);
     }
-
-    // data->airtime->rx_all_log
-    JSONArray rxAllLogValues;
-    logArray = airTime->airtimeReport(RX_ALL_LOG);
+    json.endArray();
+    json.member("seconds_per_period", int(airTime->getSecondsPerPeriod()));
+    json.member("seconds_since_boot", int(airTime->getSecondsSinceBoot()));
+    json.key("tx_log");
+    json.beginArray();
+    logArray = airTime->airtimeReport(TX_LOG);
     for (int i = 0; i < airTime->getPeriodsToLog(); i++) {
-        rxAllLogValues.push_back(new JSONValue((int)logArray[i]));
+        json.value((int)logArray[i]);
     }
+    json.endArray();
+    json.member("utilization_tx", airTime->utilizationTXPercent());
+    json.endObject();
 
-    // data->airtime
-    JSONObject jsonObjAirtime;
-    jsonObjAirtime["tx_log"] = new JSONValue(txLogValues);
-    jsonObjAirtime["rx_log"] = new JSONValue(rxLogValues);
-    jsonObjAirtime["rx_all_log"] = new JSONValue(rxAllLogValues);
-    jsonObjAirtime["channel_utilization"] = new JSONValue(airTime->channelUtilizationPercent());
-    jsonObjAirtime["utilization_tx"] = new JSONValue(airTime->utilizationTXPercent());
-    jsonObjAirtime["seconds_since_boot"] = new JSONValue(int(airTime->getSecondsSinceBoot()));
-    jsonObjAirtime["seconds_per_period"] = new JSONValue(int(airTime->getSecondsPerPeriod()));
-    jsonObjAirtime["periods_to_log"] = new JSONValue(airTime->getPeriodsToLog());
-
-    // data->wifi
-    JSONObject jsonObjWifi;
-    jsonObjWifi["rssi"] = new JSONValue(WiFi.RSSI());
-    jsonObjWifi["ip"] = new JSONValue(WiFi.localIP().toString().c_str());
+    // data->device
+    json.key("device");
+    json.beginObject();
+    json.member("reboot_counter", (int)myNodeInfo.reboot_count);
+    json.endObject();
 
     // data->memory
-    JSONObject jsonObjMemory;
-    jsonObjMemory["heap_total"] = new JSONValue((int)memGet.getHeapSize());
-    jsonObjMemory["heap_free"] = new JSONValue((int)memGet.getFreeHeap());
-    jsonObjMemory["psram_total"] = new JSONValue((int)memGet.getPsramSize());
-    jsonObjMemory["psram_free"] = new JSONValue((int)memGet.getFreePsram());
-    spiLock->lock();
-    jsonObjMemory["fs_total"] = new JSONValue((int)FSCom.totalBytes());
-    jsonObjMemory["fs_used"] = new JSONValue((int)FSCom.usedBytes());
-    jsonObjMemory["fs_free"] = new JSONValue(int(FSCom.totalBytes() - FSCom.usedBytes()));
-    spiLock->unlock();
+    json.key("memory");
+    json.beginObject();
+    json.member("fs_free", int(fsTotal - fsUsed));
+    json.member("fs_total", fsTotal);
+    json.member("fs_used", fsUsed);
+    json.member("heap_free", (int)memGet.getFreeHeap());
+    json.member("heap_total", (int)memGet.getHeapSize());
+    json.member("packet_pool_capacity", (int)poolStats.capacity);
+    json.member("packet_pool_exhausted", (int)poolStats.exhausted);
+    json.member("packet_pool_high_water", (int)poolStats.highWaterMark);
+    json.member("packet_pool_in_use", (int)poolStats.inUse);
+    json.member("psram_free", (int)memGet.getFreePsram());
+    json.member("psram_total", (int)memGet.getPsramSize());
+    json.endObject();
 
     // data->power
-    JSONObject jsonObjPower;
-    jsonObjPower["battery_percent"] = new JSONValue(powerStatus->getBatteryChargePercent());
-    jsonObjPower["battery_voltage_mv"] = new JSONValue(powerStatus->getBatteryVoltageMv());
-    jsonObjPower["has_battery"] = new JSONValue(BoolToString(powerStatus->getHasBattery()));
-    jsonObjPower["has_usb"] = new JSONValue(BoolToString(powerStatus->getHasUSB()));
-    jsonObjPower["is_charging"] = new JSONValue(BoolToString(powerStatus->getIsCharging()));
-
-    // data->device
-    JSONObject jsonObjDevice;
-    jsonObjDevice["reboot_counter"] = new JSONValue((int)myNodeInfo.reboot_count);
+    json.key("power");
+    json.beginObject();
+    json.member("battery_percent", (int)powerStatus->getBatteryChargePercent());
+    json.member("battery_voltage_mv", (int)powerStatus->getBatteryVoltageMv());
+    json.member("has_battery", BoolToString(powerStatus->getHasBattery()));
+    json.member("has_usb", BoolToString(powerStatus->getHasUSB()));
+    json.member("is_charging", BoolToString(powerStatus->getIsCharging()));
+    json.endObject();
 
     // data->radio
-    JSONObject jsonObjRadio;
-    jsonObjRadio["frequency"] = new JSONValue(RadioLibInterface::instance->getFreq());
-    jsonObjRadio["lora_channel"] = new JSONValue((int)RadioLibInterface::instance->getChannelNum() + 1);
-
-    // collect data to inner data object
-    JSONObject jsonObjInner;
-    jsonObjInner["airtime"] = new JSONValue(jsonObjAirtime);
-    jsonObjInner["wifi"] = new JSONValue(jsonObjWifi);
-    jsonObjInner["memory"] = new JSONValue(jsonObjMemory);
-    jsonObjInner["power"] = new JSONValue(jsonObjPower);
-    jsonObjInner["device"] = new JSONValue(jsonObjDevice);
-    jsonObjInner["radio"] = new JSONValue(jsonObjRadio);
+    json.key("radio");
+    json.beginObject();
+    json.member("decrypt_attempts", (int)decodeStats.attempts);
+    json.member("decrypt_last_channel_hits", (int)decodeStats.lastChannelHits);
+    json.member("decrypt_rejected_early", (int)decodeStats.rejectedEarly);
+    json.member("decrypt_wasted", (int)decodeStats.wasted);
+    json.member("frequency", RadioLibInterface::instance->getFreq());
+    json.member("lora_channel", (int)RadioLibInterface::instance->getChannelNum() + 1);
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    json.member("pki_shared_key_hits", (int)crypto->sharedKeyCacheHits);
+    json.member("pki_shared_key_misses", (int)crypto->sharedKeyCacheMisses);
+#endif
+    json.endObject();
 
-    // create json output structure
-    JSONObject jsonObjOuter;
-    jsonObjOuter["data"] = new JSONValue(jsonObjInner);
-    jsonObjOuter["status"] = new JSONValue("ok");
-    // serialize and write it to the stream
-    JSONValue *value = new JSONValue(jsonObjOuter);
-    res->print(value->Stringify().c_str());
-    delete value;
+    // data->wifi
+    json.key("wifi");
+    json.beginObject();
+    json.member("ip", WiFi.localIP().toString().c_str());
+    json.member("rssi", (int)WiFi.RSSI());
+    json.endObject();
+
+    json.endObject();
+    json.member("status", "ok");
+    json.endObject();
+    json.finish();
 }
 
 void handleNodes(HTTPRequest *req, HTTPResponse *res)
@@ -714,57 +755,53 @@ void handleNodes(HTTPRequest *req, HTTPResponse *res)
         res->println("<pre>");
     }
 
-    JSONArray nodesArray;
+    JsonWriter json(*res);
+    json.beginObject();
+    json.key("data");
+    json.beginObject();
+    json.key("nodes");
+    json.beginArray();
 
     uint32_t readIndex = 0;
     const meshtastic_NodeInfoLite *tempNodeInfo = nodeDB->readNextMeshNode(readIndex);
     while (tempNodeInfo != NULL) {
         if (tempNodeInfo->has_user) {
-            JSONObject node;
-
             char id[16];
             snprintf(id, sizeof(id), "!%08x", tempNodeInfo->num);
-
-            node["id"] = new JSONValue(id);
-            node["snr"] = new JSONValue(tempNodeInfo->snr);
-            node["via_mqtt"] = new JSONValue(BoolToString(tempNodeInfo->via_mqtt));
-            node["last_heard"] = new JSONValue((int)tempNodeInfo->last_heard);
-            node["position"] = new JSONValue();
-
-            if (nodeDB->hasValidPosition(tempNodeInfo)) {
-                JSONObject position;
-                position["latitude"] = new JSONValue((float)tempNodeInfo->position.latitude_i * 1e-7);
-                position["longitude"] = new JSONValue((float)tempNodeInfo->position.longitude_i * 1e-7);
-                position["altitude"] = new JSONValue((int)tempNodeInfo->position.altitude);
-                node["position"] = new JSONValue(position);
-            }
-
-            node["long_name"] = new JSONValue(tempNodeInfo->user.long_name);
-            node["short_name"] = new JSONValue(tempNodeInfo->user.short_name);
             char macStr[18];
             snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X", tempNodeInfo->user.macaddr[0],
                      tempNodeInfo->user.macaddr[1], tempNodeInfo->user.macaddr[2], tempNodeInfo->user.macaddr[3],
                      tempNodeInfo->user.macaddr[4], tempNodeInfo->user.macaddr[5]);
-            node["mac_address"] = new JSONValue(macStr);
-            node["hw_model"] = new JSONValue(tempNodeInfo->user.hw_model);
 
-            nodesArray.push_back(new JSONValue(node));
+            json.beginObject();
+            json.member("hw_model", (int)tempNodeInfo->user.hw_model);
+            json.member("id", (const char *)id);
+            json.member("last_heard", (int)tempNodeInfo->last_heard);
+            json.member("long_name", (const char *)tempNodeInfo->user.long_name);
+            json.member("mac_address", (const char *)macStr);
+            json.key("position");
+            if (nodeDB->hasValidPosition(tempNodeInfo)) {
+                json.beginObject();
+                json.member("altitude", (int)tempNodeInfo->position.altitude);
+                json.member("latitude", (float)tempNodeInfo->position.latitude_i * 1e-7);
+                json.member("longitude", (float)tempNodeInfo->position.longitude_i * 1e-7);
+                json.endObject();
+            } else {
+                json.valueNull();
+            }
+            json.member("short_name", (const char *)tempNodeInfo->user.short_name);
+            json.member("snr", tempNodeInfo->snr);
+            json.member("via_mqtt", BoolToString(tempNodeInfo->via_mqtt));
+            json.endObject();
         }
         tempNodeInfo = nodeDB->readNextMeshNode(readIndex);
     }
 
-    // collect data to inner data object
-    JSONObject jsonObjInner;
-    jsonObjInner["nodes"] = new JSONValue(nodesArray);
-
-    // create json output structure
-    JSONObject jsonObjOuter;
-    jsonObjOuter["data"] = new JSONValue(jsonObjInner);
-    jsonObjOuter["status"] = new JSONValue("ok");
-    // serialize and write it to the stream
-    JSONValue *value = new JSONValue(jsonObjOuter);
-    res->print(value->Stringify().c_str());
-    delete value;
+    json.endArray();
+    json.endObject();
+    json.member("status", "ok");
+    json.endObject();
+    json.finish();
 }
 
 /*
@@ -18,6 +18,16 @@
 #define MAX_RX_TOPHONE 32
 #endif
 
+/// What the static MemoryPools are sized for.  They are built during static initialisation, and on portduino MAX_RX_TOPHONE is
+/// read from config.yaml much later than that, so there they use the default MaxMessageQueue.  Beyond it they use the heap.
+#ifndef POOL_RX_TOPHONE
+#ifdef ARCH_PORTDUINO
+#define POOL_RX_TOPHONE 100
+#else
+#define POOL_RX_TOPHONE MAX_RX_TOPHONE
+#endif
+#endif
+
 /// Verify baseline assumption of node size. If it increases, we need to reevaluate
 /// the impact of its memory footprint, notably on MAX_NUM_NODES.
 static_assert(sizeof(meshtastic_NodeInfoLite) <= 200, "NodeInfoLite size increased. Reconsider impact on MAX_NUM_NODES.");
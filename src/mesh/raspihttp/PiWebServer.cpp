@@ -56,6 +56,8 @@ mail:   marchammermann@googlemail.com
 #include <ulfius.h>
 #include <yder.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <string>
 
@@ -65,6 +67,11 @@ mail:   marchammermann@googlemail.com
 #define DEFAULT_REALM "default_realm"
 #define PREFIX ""
 
+// Limits for /api/v1/fromradio batches and long-polls
+#define FROMRADIO_BATCH_BYTES (64 * 1024)
+#define FROMRADIO_MAX_WAIT_MSEC 30000
+#define FROMRADIO_POLL_MSEC 100 // how often a long-poll looks for anything fromRadioReady isn't signalled for
+
 #define KEY_PATH settingsStrings[websslkeypath].c_str()
 #define CERT_PATH settingsStrings[websslcertpath].c_str()
 
@@ -86,6 +93,7 @@ volatile bool isWebServerReady;
 volatile bool isCertReady;
 
 PiWebServerThread *piwebServerThread;
+std::mutex piwebMeshLock;
 
 /**
  * Return the filename extension
@@ -248,6 +256,7 @@ int handleAPIv1ToRadio(const struct _u_request *req, struct _u_response *res, vo
     portduinoVFS->mountpoint(configWeb.rootPath);
 
     LOG_DEBUG("Received %d bytes from PUT request", s);
+    std::lock_guard<std::mutex> guard(piwebMeshLock);
     static_cast<HttpAPI *>(user_data)->handleToRadio(buffer, s);
     LOG_DEBUG("end web->radio  ");
     return U_CALLBACK_COMPLETE;
@@ -256,12 +265,15 @@ int handleAPIv1ToRadio(const struct _u_request *req, struct _u_response *res, vo
 /*
  * Adapt the radioapi to the Webservice handleAPIv1FromRadio
  * Trigger : WebGui(POLL)->handleAPIv1FromRadio->phoneapi->Meshtastic(Radio) events
+ *
+ * Query parameters:
+ *   all=true  every protobuf available right now, back to back
+ *   batch=N   up to N protobufs (N <= 0 for as many as fit in FROMRADIO_BATCH_BYTES), each preceded by the 4 byte StreamAPI header
+ *   wait=ms   long-poll, hold the request until there is something to send or ms (at most FROMRADIO_MAX_WAIT_MSEC) have passed
  */
 int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res, void *user_data)
 {
-
-    // LOG_DEBUG("handleAPIv1FromRadio radio -> web");
-    std::string valueAll;
+    HttpAPI *webAPI = static_cast<HttpAPI *>(user_data);
 
     // Status code is 200 OK by default.
     ulfius_add_header_to_response(res, "Content-Type", "application/x-protobuf");
@@ -275,30 +287,40 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
         return U_CALLBACK_COMPLETE;
     }
 
-    uint8_t txBuf[MAX_STREAM_BUF_SIZE];
-    uint32_t len = 1;
-
-    if (valueAll == "true") {
-        while (len) {
-            len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
-            ulfius_set_response_properties(res, U_OPT_STATUS, 200, U_OPT_BINARY_BODY, txBuf, len);
-            const char *tmpa = (const char *)txBuf;
-            ulfius_set_string_body_response(res, 200, tmpa);
-            // LOG_DEBUG("\n----webAPI response all:----");
-            // LOG_DEBUG(tmpa);
-            // LOG_DEBUG("");
+    const char *valueAll = u_map_get(req->map_url, "all");
+    const char *valueBatch = u_map_get(req->map_url, "batch");
+    const char *valueWait = u_map_get(req->map_url, "wait");
+
+    // We run in one of ulfius' threads, so waiting here doesn't hold up the mesh, the wait gives up piwebMeshLock
+    std::unique_lock<std::mutex> guard(piwebMeshLock);
+    if (valueWait) {
+        uint32_t wait = std::min<uint32_t>(std::max(atoi(valueWait), 0), FROMRADIO_MAX_WAIT_MSEC);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait);
+        while (!webAPI->available() && std::chrono::steady_clock::now() < deadline) {
+            auto poll = std::chrono::steady_clock::now() + std::chrono::milliseconds(FROMRADIO_POLL_MSEC);
+            webAPI->fromRadioReady.wait_until(guard, std::min(deadline, poll));
         }
-        // Otherwise, just return one protobuf
+    }
+
+    if (valueBatch) {
+        int maxFrames = atoi(valueBatch);
+        std::string body(FROMRADIO_BATCH_BYTES, '\0');
+        size_t len = webAPI->getFromRadioFramed((uint8_t *)&body[0], body.size(), maxFrames > 0 ? maxFrames : SIZE_MAX);
+        ulfius_set_binary_body_response(res, 200, body.data(), len);
+    } else if (valueAll && strcmp(valueAll, "true") == 0) {
+        std::string body;
+        uint8_t txBuf[MAX_STREAM_BUF_SIZE];
+        size_t len;
+        while ((len = webAPI->getFromRadio(txBuf)) != 0)
+            body.append((const char *)txBuf, len);
+        ulfius_set_binary_body_response(res, 200, body.data(), body.size());
     } else {
-        len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
-        const char *tmpa = (const char *)txBuf;
-        ulfius_set_binary_body_response(res, 200, tmpa, len);
-        // LOG_DEBUG("\n----webAPI response:");
-        // LOG_DEBUG(tmpa);
-        // LOG_DEBUG("");
+        // Otherwise, just return one protobuf
+        uint8_t txBuf[MAX_STREAM_BUF_SIZE];
+        size_t len = webAPI->getFromRadio(txBuf);
+        ulfius_set_binary_body_response(res, 200, (const char *)txBuf, len);
     }
 
-    // LOG_DEBUG("end radio->web", len);
     return U_CALLBACK_COMPLETE;
 }
 
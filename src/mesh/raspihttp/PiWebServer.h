@@ -5,7 +5,9 @@
 #include "ulfius-cfg.h"
 #include "ulfius.h"
 #include <Arduino.h>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 
 #define STATIC_FILE_CHUNK 256
 
@@ -23,11 +25,18 @@ struct _file_config {
     char *rootPath;
 };
 
+/**
+ * The mesh isn't thread safe, so the main loop holds this while it runs and the web server's threads only use the mesh, and
+ * webAPI, in between.
+ */
+extern std::mutex piwebMeshLock;
+
 class HttpAPI : public PhoneAPI
 {
 
   public:
-    // Nothing here yet
+    /// Signalled, with piwebMeshLock held, when there are new packets for the client
+    std::condition_variable fromRadioReady;
 
   private:
     // Nothing here yet
@@ -35,6 +44,8 @@ class HttpAPI : public PhoneAPI
   protected:
     /// Check the current underlying physical link to see if the client is currently connected
     virtual bool checkIsConnected() override { return true; } // FIXME, be smarter about this
+
+    virtual void onNowHasData(uint32_t fromRadioNum) override { fromRadioReady.notify_all(); }
 };
 
 class PiWebServerThread
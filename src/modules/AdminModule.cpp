@@ -316,8 +316,13 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
             node->is_ignored = true;
             node->has_device_metrics = false;
             node->has_position = false;
+#if !(MESHTASTIC_EXCLUDE_PKI)
+            if (node->user.public_key.size == 32)
+                crypto->forgetSharedKey(node->user.public_key.bytes);
+#endif
             node->user.public_key.size = 0;
             node->user.public_key.bytes[0] = 0;
+            nodeDB->nodeEvictionKeyLowered();
             saveChanges(SEGMENT_NODEDATABASE, false);
         }
         break;
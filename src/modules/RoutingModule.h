@@ -18,6 +18,8 @@ class RoutingModule : public ProtobufModule<meshtastic_Routing>
 
     // Given the hopStart and hopLimit upon reception of a request, return the hop limit to use for the response
     uint8_t getHopLimitForResponse(uint8_t hopStart, uint8_t hopLimit);
+    // As above, for a node whose configured hop limit is configuredHopLimit
+    static uint8_t getHopLimitForResponse(uint8_t hopStart, uint8_t hopLimit, uint8_t configuredHopLimit);
 
   protected:
     friend class Router;
@@ -0,0 +1,224 @@
+#include "StoreForwardHistory.h"
+#include <Arduino.h>
+#include <algorithm>
+
+#ifdef ARCH_PORTDUINO
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct StoreForwardHistory::FileHeader {
+    uint32_t magic;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint32_t head;
+};
+
+static const uint32_t HISTORY_FILE_MAGIC = 0x31484653; // "SFH1"
+
+StoreForwardHistory::~StoreForwardHistory()
+{
+    release();
+}
+
+void StoreForwardHistory::release()
+{
+#ifdef ARCH_PORTDUINO
+    if (header)
+        munmap(header, mappingSize);
+    else
+#endif
+        free(records);
+    records = nullptr;
+    header = nullptr;
+    capacity = head = lastTime = 0;
+    broadcasts.clear();
+    broadcastsFrom.clear();
+    directTo.clear();
+}
+
+bool StoreForwardHistory::begin(uint32_t capacity, bool indexed)
+{
+    release();
+#if defined(ARCH_ESP32)
+    records = static_cast<PacketHistoryStruct *>(ps_calloc(capacity, sizeof(PacketHistoryStruct)));
+#else
+    records = static_cast<PacketHistoryStruct *>(calloc(capacity, sizeof(PacketHistoryStruct)));
+#endif
+    if (!records)
+        return false;
+    this->capacity = capacity;
+    this->indexed = indexed;
+    return true;
+}
+
+#ifdef ARCH_PORTDUINO
+bool StoreForwardHistory::begin(uint32_t capacity, bool indexed, const char *path)
+{
+    release();
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR("S&F - Can't open %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    size_t fileSize = sizeof(FileHeader) + (size_t)capacity * sizeof(PacketHistoryStruct);
+    struct stat st;
+    bool fresh = fstat(fd, &st) != 0 || (size_t)st.st_size != fileSize;
+    if (fresh && ftruncate(fd, fileSize) != 0) {
+        LOG_ERROR("S&F - Can't size %s: %s", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("S&F - Can't map %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    header = static_cast<FileHeader *>(mapping);
+    mappingSize = fileSize;
+    if (header->magic != HISTORY_FILE_MAGIC || header->recordSize != sizeof(PacketHistoryStruct) ||
+        header->capacity != capacity) {
+        if (!fresh || header->magic)
+            LOG_WARN("S&F - %s was written for a different history, start over", path);
+        *header = {HISTORY_FILE_MAGIC, sizeof(PacketHistoryStruct), capacity, 0};
+    }
+    records = reinterpret_cast<PacketHistoryStruct *>(header + 1);
+    this->capacity = capacity;
+    this->indexed = indexed;
+    head = header->head;
+
+    if (indexed) {
+        for (uint32_t seq = tail(); seq != head; seq++)
+            indexRecord(records[seq % capacity], seq);
+    }
+    LOG_INFO("S&F - %u of %u records in %s", size(), capacity, path);
+    return true;
+}
+#endif
+
+void StoreForwardHistory::add(const PacketHistoryStruct &record)
+{
+    if (!capacity)
+        return;
+
+    PacketHistoryStruct &slot = records[head % capacity];
+    if (indexed && size() == capacity)
+        unindexRecord(slot, tail());
+    slot = record;
+    if (indexed)
+        indexRecord(slot, head);
+
+    head++;
+    if (header)
+        header->head = head; // only once the record is in place
+}
+
+void StoreForwardHistory::indexRecord(const PacketHistoryStruct &r, uint32_t seq)
+{
+    lastTime = std::max(lastTime, r.time);
+    IndexEntry e = {seq, lastTime};
+    if (r.to == NODENUM_BROADCAST) {
+        broadcasts.push_back(e);
+        broadcastsFrom[r.from].push_back(e);
+    } else if (r.to != r.from) { // nobody is sent their own messages
+        directTo[r.to].push_back(e);
+    }
+}
+
+/// Records are overwritten oldest first, so each one is at the front of its lists
+void StoreForwardHistory::unindexRecord(const PacketHistoryStruct &r, uint32_t seq)
+{
+    auto popFrom = [seq](std::unordered_map<NodeNum, IndexList> &lists, NodeNum n) {
+        auto it = lists.find(n);
+        if (it != lists.end() && !it->second.empty() && it->second.front().seq == seq) {
+            it->second.pop_front();
+            if (it->second.empty())
+                lists.erase(it);
+        }
+    };
+
+    if (r.to == NODENUM_BROADCAST) {
+        if (!broadcasts.empty() && broadcasts.front().seq == seq)
+            broadcasts.pop_front();
+        popFrom(broadcastsFrom, r.from);
+    } else {
+        popFrom(directTo, r.to);
+    }
+}
+
+const StoreForwardHistory::IndexList *StoreForwardHistory::find(const std::unordered_map<NodeNum, IndexList> &lists, NodeNum n)
+{
+    auto it = lists.find(n);
+    return it == lists.end() ? nullptr : &it->second;
+}
+
+/// Position of the first entry at or after record seq and newer than afterTime.  Both only go up along a list.
+size_t StoreForwardHistory::firstAfter(const IndexList &list, uint32_t seq, uint32_t afterTime)
+{
+    auto it = std::partition_point(list.begin(), list.end(),
+                                   [&](const IndexEntry &e) { return e.seq < seq || e.time <= afterTime; });
+    return it - list.begin();
+}
+
+bool StoreForwardHistory::wanted(const PacketHistoryStruct &r, NodeNum dest, uint32_t afterTime)
+{
+    return r.time && r.time > afterTime && r.from != dest && (r.to == NODENUM_BROADCAST || r.to == dest);
+}
+
+uint32_t StoreForwardHistory::count(NodeNum dest, uint32_t seq, uint32_t afterTime) const
+{
+    if (!indexed) {
+        uint32_t n = 0;
+        for (uint32_t s = std::max(seq, tail()); s < head; s++)
+            n += wanted(records[s % capacity], dest, afterTime);
+        return n;
+    }
+
+    // Every broadcast but dest's own, plus whatever was sent to dest
+    uint32_t n = broadcasts.size() - firstAfter(broadcasts, seq, afterTime);
+    if (const IndexList *own = find(broadcastsFrom, dest))
+        n -= own->size() - firstAfter(*own, seq, afterTime);
+    if (const IndexList *direct = find(directTo, dest))
+        n += direct->size() - firstAfter(*direct, seq, afterTime);
+    return n;
+}
+
+const PacketHistoryStruct *StoreForwardHistory::next(NodeNum dest, uint32_t &seq, uint32_t afterTime) const
+{
+    if (!indexed) {
+        for (uint32_t s = std::max(seq, tail()); s < head; s++) {
+            if (wanted(records[s % capacity], dest, afterTime)) {
+                seq = s;
+                return &records[s % capacity];
+            }
+        }
+        return nullptr;
+    }
+
+    size_t b = firstAfter(broadcasts, seq, afterTime);
+    // dest's own broadcasts are a subsequence of all broadcasts, step over any that come first
+    if (const IndexList *own = find(broadcastsFrom, dest)) {
+        for (size_t o = firstAfter(*own, seq, afterTime); b < broadcasts.size() && o < own->size(); b++, o++) {
+            if ((*own)[o].seq != broadcasts[b].seq)
+                break;
+        }
+    }
+    const IndexList *direct = find(directTo, dest);
+    size_t d = direct ? firstAfter(*direct, seq, afterTime) : 0;
+
+    bool haveBroadcast = b < broadcasts.size(), haveDirect = direct && d < direct->size();
+    if (!haveBroadcast && !haveDirect)
+        return nullptr;
+    if (haveBroadcast && (!haveDirect || broadcasts[b].seq < (*direct)[d].seq))
+        seq = broadcasts[b].seq;
+    else
+        seq = (*direct)[d].seq;
+    return &records[seq % capacity];
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "configuration.h"
+#include <deque>
+#include <unordered_map>
+
+// Index the history by recipient and by sender, so answering a client costs what it returns instead of a scan of the whole
+// history.  The index lives on the ordinary heap, which ESP32s holding their history in PSRAM can't spare.
+#ifndef STOREFORWARD_INDEX
+#ifdef ARCH_PORTDUINO
+#define STOREFORWARD_INDEX 1
+#else
+#define STOREFORWARD_INDEX 0
+#endif
+#endif
+
+struct PacketHistoryStruct {
+    uint32_t time;
+    uint32_t to;
+    uint32_t from;
+    uint32_t id;
+    uint8_t channel;
+    uint32_t reply_id;
+    bool emoji;
+    uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    pb_size_t payload_size;
+};
+
+/**
+ * The Store & Forward server's message history, a ring of records that overwrites the oldest once it is full.
+ *
+ * Records are numbered in the order they were added and clients are tracked by the number of the next record they haven't
+ * had, which stays valid as old records are overwritten.  A client is sent the records newer than some time that are either
+ * broadcast or addressed to it, leaving out its own.
+ *
+ * With the index, broadcasts and direct messages are kept in lists of (number, time) in the order they were added, one for all
+ * broadcasts, one per sender of broadcasts and one per recipient of direct messages, and a query binary searches them.  The
+ * times in the index never go backwards (a record stamped earlier than the one before it is indexed at that one's time), which
+ * is all that can differ from a scan.
+ */
+class StoreForwardHistory
+{
+  public:
+    ~StoreForwardHistory();
+
+    /**
+     * Make room for capacity records, in PSRAM on ESP32
+     * @param indexed keep the index, otherwise every query scans the history
+     */
+    bool begin(uint32_t capacity, bool indexed);
+
+#ifdef ARCH_PORTDUINO
+    /**
+     * Keep the records in a memory mapped file instead, so they survive a restart and can outgrow RAM.  The records already in
+     * the file are picked up, unless it was made for a different capacity or record layout, in which case it starts over empty.
+     */
+    bool begin(uint32_t capacity, bool indexed, const char *path);
+#endif
+
+    /// Add a record, overwriting the oldest if the history is full
+    void add(const PacketHistoryStruct &record);
+
+    /// How many records dest would be sent, starting from record number seq and newer than afterTime
+    uint32_t count(NodeNum dest, uint32_t seq, uint32_t afterTime) const;
+
+    /**
+     * Find the next record dest would be sent
+     * @param seq the record number to start from, set to the number of the record found
+     * @return the record, or nullptr if there are no more
+     */
+    const PacketHistoryStruct *next(NodeNum dest, uint32_t &seq, uint32_t afterTime) const;
+
+    /// Records held
+    uint32_t size() const { return head - tail(); }
+    uint32_t getCapacity() const { return capacity; }
+
+  private:
+    struct FileHeader;
+
+    struct IndexEntry {
+        uint32_t seq;
+        uint32_t time;
+    };
+    typedef std::deque<IndexEntry> IndexList;
+
+    PacketHistoryStruct *records = nullptr;
+    uint32_t capacity = 0;
+    uint32_t head = 0; // number of the next record to be added
+    FileHeader *header = nullptr;
+    size_t mappingSize = 0;
+
+    bool indexed = false;
+    IndexList broadcasts;
+    std::unordered_map<NodeNum, IndexList> broadcastsFrom, directTo;
+    uint32_t lastTime = 0;
+
+    uint32_t tail() const { return head > capacity ? head - capacity : 0; }
+    void release();
+    void indexRecord(const PacketHistoryStruct &r, uint32_t seq);
+    void unindexRecord(const PacketHistoryStruct &r, uint32_t seq);
+
+    static const IndexList *find(const std::unordered_map<NodeNum, IndexList> &lists, NodeNum n);
+    static size_t firstAfter(const IndexList &list, uint32_t seq, uint32_t afterTime);
+    static bool wanted(const PacketHistoryStruct &r, NodeNum dest, uint32_t afterTime);
+};
@@ -0,0 +1,135 @@
+#include "DiskQueue.h"
+
+#ifdef FSCom
+
+#include "SPILock.h"
+
+DiskQueue::DiskQueue(const char *_dir, uint32_t _segmentBytes, uint16_t _maxSegments)
+    : dir(_dir), segmentBytes(_segmentBytes), maxSegments(_maxSegments ? _maxSegments : 1)
+{
+    rmDir(dir.c_str()); // takes spiLock itself
+    concurrency::LockGuard g(spiLock);
+    FSCom.mkdir(dir.c_str());
+}
+
+DiskQueue::~DiskQueue()
+{
+    concurrency::LockGuard g(spiLock);
+    if (writeFile)
+        writeFile.close();
+    if (readFile)
+        readFile.close();
+}
+
+std::string DiskQueue::segmentName(uint32_t n) const
+{
+    return dir + "/" + std::to_string(n);
+}
+
+/**
+ * Forget the oldest segment and whatever is left in it.  Call with spiLock held.
+ */
+void DiskQueue::dropFirstSegment()
+{
+    if (segments.empty())
+        return;
+
+    if (readFile)
+        readFile.close();
+    if (segments.size() == 1 && writeFile)
+        writeFile.close();
+    count -= segments.front();
+    dropped += segments.front();
+    FSCom.remove(segmentName(firstSegment).c_str());
+    segments.pop_front();
+    firstSegment++;
+    readOffset = 0;
+}
+
+bool DiskQueue::push(const uint8_t *data, uint16_t len)
+{
+    concurrency::LockGuard g(spiLock);
+
+    if (writeFile && writeOffset + 2 + len > segmentBytes)
+        writeFile.close();
+
+    if (!writeFile) {
+        if (segments.size() >= maxSegments) {
+            LOG_WARN("%s is full, drop %u oldest records", dir.c_str(), segments.front());
+            dropFirstSegment();
+        }
+        uint32_t n = firstSegment + segments.size();
+        writeFile = FSCom.open(segmentName(n).c_str(), FILE_O_WRITE);
+        if (!writeFile) {
+            LOG_ERROR("Can't open %s", segmentName(n).c_str());
+            return false;
+        }
+        segments.push_back(0);
+        writeOffset = 0;
+    }
+
+    const uint8_t header[2] = {(uint8_t)len, (uint8_t)(len >> 8)};
+    if (writeFile.write(header, sizeof(header)) != sizeof(header) || writeFile.write(data, len) != len) {
+        // Seal the segment, the reader never looks past the records we counted in it
+        LOG_ERROR("Write to %s failed", dir.c_str());
+        writeFile.close();
+        return false;
+    }
+    writeOffset += sizeof(header) + len;
+    segments.back()++;
+    count++;
+    return true;
+}
+
+uint16_t DiskQueue::peek(uint8_t *buf, size_t bufSize)
+{
+    concurrency::LockGuard g(spiLock);
+
+    while (count) {
+        // Data isn't guaranteed to be readable until the writer has closed the file, so stop appending to the segment we need
+        if (segments.size() == 1 && writeFile)
+            writeFile.close();
+
+        if (!readFile)
+            readFile = FSCom.open(segmentName(firstSegment).c_str(), FILE_O_READ);
+
+        uint8_t header[2];
+        uint16_t len = 0;
+        bool ok = readFile && readFile.seek(readOffset) && readFile.read(header, sizeof(header)) == sizeof(header);
+        if (ok) {
+            len = header[0] | (header[1] << 8);
+            ok = len <= bufSize && readFile.read(buf, len) == len;
+        }
+        if (ok)
+            return len;
+
+        LOG_ERROR("Bad record in %s, drop segment", segmentName(firstSegment).c_str());
+        dropFirstSegment();
+    }
+    return 0;
+}
+
+void DiskQueue::pop()
+{
+    concurrency::LockGuard g(spiLock);
+
+    if (!count || !readFile)
+        return; // nothing peeked
+
+    uint8_t header[2];
+    if (!readFile.seek(readOffset) || readFile.read(header, sizeof(header)) != sizeof(header)) {
+        dropFirstSegment();
+        return;
+    }
+    readOffset += sizeof(header) + (header[0] | (header[1] << 8));
+    count--;
+    if (--segments.front() == 0) {
+        readFile.close();
+        FSCom.remove(segmentName(firstSegment).c_str());
+        segments.pop_front();
+        firstSegment++;
+        readOffset = 0;
+    }
+}
+
+#endif
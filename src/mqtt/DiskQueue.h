@@ -0,0 +1,62 @@
+#pragma once
+
+#include "FSCommon.h"
+#include "configuration.h"
+
+#ifdef FSCom
+
+#include <deque>
+#include <string>
+
+/**
+ * A bounded FIFO of byte records kept in a directory of the filesystem, for backlogs that don't fit in RAM.
+ *
+ * Records are appended to numbered segment files which are only ever written front to back and deleted once read (or when the
+ * queue is full, in which case the oldest segment is dropped whole), so this needs nothing more than sequential writes from the
+ * filesystem and spreads the flash wear.  The queue is emptied when it is created, it bridges outages rather than reboots.
+ */
+class DiskQueue
+{
+  public:
+    /**
+     * @param dir directory for the segment files, which is wiped
+     * @param segmentBytes size at which a segment is closed and the next one started
+     * @param maxSegments the most segments on disk at once, including the one being written
+     */
+    DiskQueue(const char *dir, uint32_t segmentBytes, uint16_t maxSegments);
+    ~DiskQueue();
+
+    /// Append a record, dropping the oldest segment if the queue is full.  @return false if it could not be written
+    bool push(const uint8_t *data, uint16_t len);
+
+    /**
+     * Read the oldest record without removing it
+     * @return its length, or 0 if the queue is empty or the record is bigger than bufSize
+     */
+    uint16_t peek(uint8_t *buf, size_t bufSize);
+
+    /// Remove the oldest record
+    void pop();
+
+    uint32_t size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+
+    /// Records lost because the queue was full
+    uint32_t numDropped() const { return dropped; }
+
+  private:
+    std::string dir;
+    const uint32_t segmentBytes;
+    const uint16_t maxSegments;
+
+    std::deque<uint32_t> segments; // records left in each segment on disk, oldest first
+    uint32_t firstSegment = 0;     // number of the oldest segment, the one being read
+    File writeFile, readFile;
+    uint32_t writeOffset = 0, readOffset = 0;
+    uint32_t count = 0, dropped = 0;
+
+    std::string segmentName(uint32_t n) const;
+    void dropFirstSegment();
+};
+
+#endif
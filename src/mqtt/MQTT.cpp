@@ -49,6 +49,36 @@ constexpr int reconnectMax = 5;
 // FIXME - this size calculation is super sloppy, but it will go away once we dynamically alloc meshpackets
 static uint8_t bytes[meshtastic_MqttClientProxyMessage_size + 30]; // 12 for channel name and 16 for nodeid
 
+#if !defined(ARCH_NRF52) || NRF52_USE_JSON
+// JSON uplink is rendered here, anything longer would not fit the 1024 byte PubSubClient buffer anyway
+static char jsonBuffer[1024];
+#endif
+
+#if defined(FSCom) && MQTT_BACKLOG_SEGMENTS
+// A queue entry as stored in the backlog: its four strings, each preceded by its 16 bit length
+static uint8_t backlogRecord[sizeof(bytes) + 1024 + 512];
+
+inline void appendField(std::basic_string<uint8_t> &record, const void *data, size_t len)
+{
+    record.push_back((uint8_t)len);
+    record.push_back((uint8_t)(len >> 8));
+    record.append((const uint8_t *)data, len);
+}
+
+template <typename S> inline bool takeField(const uint8_t *&p, const uint8_t *end, S &out)
+{
+    if (end - p < 2)
+        return false;
+    size_t len = p[0] | (p[1] << 8);
+    p += 2;
+    if ((size_t)(end - p) < len)
+        return false;
+    out.assign((const typename S::value_type *)p, len);
+    p += len;
+    return true;
+}
+#endif
+
 static bool isMqttServerAddressPrivate = false;
 
 inline void onReceiveProto(char *topic, byte *payload, size_t length)
@@ -377,9 +407,9 @@ void mqttInit()
 #if HAS_NETWORKING
 MQTT::MQTT() : MQTT(std::unique_ptr<MQTTClient>(new MQTTClient())) {}
 MQTT::MQTT(std::unique_ptr<MQTTClient> _mqttClient)
-    : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE), mqttClient(std::move(_mqttClient)), pubSub(*mqttClient)
+    : concurrency::OSThread("mqtt"), mqttClient(std::move(_mqttClient)), pubSub(*mqttClient)
 #else
-MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
+MQTT::MQTT() : concurrency::OSThread("mqtt")
 #endif
 {
     if (moduleConfig.mqtt.enabled) {
@@ -416,6 +446,10 @@ MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
         if (!moduleConfig.mqtt.proxy_to_client_enabled)
             pubSub.setCallback(mqttCallback);
 #endif
+#if defined(FSCom) && MQTT_BACKLOG_SEGMENTS
+        if (!moduleConfig.mqtt.proxy_to_client_enabled)
+            backlog.reset(new DiskQueue("/mqtt", MQTT_BACKLOG_SEGMENT_BYTES, MQTT_BACKLOG_SEGMENTS));
+#endif
 
         if (moduleConfig.mqtt.proxy_to_client_enabled) {
             LOG_INFO("MQTT configured to use client proxy");
@@ -593,6 +627,7 @@ int32_t MQTT::runOnce()
             pubSub.disconnect();
         }
 
+        publishQueuedMessages();
         powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // Suppress entering light sleep (because that would turn off bluetooth)
         return 20;
     }
@@ -645,39 +680,117 @@ void MQTT::publishNodeInfo()
 {
     // TODO: NodeInfo broadcast over MQTT only (NODENUM_BROADCAST_NO_LORA)
 }
-void MQTT::publishQueuedMessages()
+bool MQTT::publishQueueEntry(const QueueEntry &entry)
 {
-    if (mqttQueue.isEmpty())
-        return;
+    LOG_INFO("publish %s, %u bytes from queue", entry.topic.c_str(), entry.envBytes.size());
+    if (!publish(entry.topic.c_str(), entry.envBytes.data(), entry.envBytes.size(), false))
+        return false;
 
-    LOG_DEBUG("Publish enqueued MQTT message");
-    const std::unique_ptr<QueueEntry> entry(mqttQueue.dequeuePtr(0));
-    LOG_INFO("publish %s, %u bytes from queue", entry->topic.c_str(), entry->envBytes.size());
-    publish(entry->topic.c_str(), entry->envBytes.data(), entry->envBytes.size(), false);
+    if (!entry.jsonTopic.empty()) {
+        LOG_INFO("JSON publish message to %s, %u bytes: %s", entry.jsonTopic.c_str(), entry.json.size(), entry.json.c_str());
+        publish(entry.jsonTopic.c_str(), entry.json.c_str(), false);
+    }
+    return true;
+}
 
-#if !defined(ARCH_NRF52) ||                                                                                                      \
-    defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
-    if (!moduleConfig.mqtt.json_enabled)
+void MQTT::publishQueuedMessages()
+{
+#if defined(FSCom) && MQTT_BACKLOG_SEGMENTS
+    bool empty = mqttQueue.empty() && (!backlog || backlog->isEmpty());
+#else
+    bool empty = mqttQueue.empty();
+#endif
+    if (empty)
         return;
 
-    // handle json topic
-    const DecodedServiceEnvelope env(entry->envBytes.data(), entry->envBytes.size());
-    if (!env.validDecode || env.packet == NULL || env.channel_id == NULL)
-        return;
+    if (!queueStats.drainMessages && !queueStats.drainBytes)
+        queueStats.drainStart = millis();
+
+    // The client proxy hands messages to the phone through a small queue that drops the oldest, so go one at a time there
+    const uint32_t maxMessages = moduleConfig.mqtt.proxy_to_client_enabled ? 1 : UINT32_MAX;
+    const uint32_t start = millis();
+    uint32_t messages = 0, drainedBytes = 0;
+    while (messages < maxMessages && drainedBytes < MQTT_DRAIN_BYTES && millis() - start < MQTT_DRAIN_MSEC) {
+        size_t size;
+#if defined(FSCom) && MQTT_BACKLOG_SEGMENTS
+        // Everything in the backlog is older than what is still in RAM
+        if (backlog && !backlog->isEmpty()) {
+            uint16_t len = backlog->peek(backlogRecord, sizeof(backlogRecord));
+            if (!len)
+                continue; // it dropped what it couldn't read
+            QueueEntry entry;
+            const uint8_t *p = backlogRecord, *end = backlogRecord + len;
+            if (!takeField(p, end, entry.topic) || !takeField(p, end, entry.envBytes) || !takeField(p, end, entry.jsonTopic) ||
+                !takeField(p, end, entry.json)) {
+                LOG_ERROR("Bad MQTT backlog record, drop");
+                backlog->pop();
+                continue;
+            }
+            if (!publishQueueEntry(entry))
+                break; // try again once we are reconnected
+            backlog->pop();
+            size = entry.envBytes.size() + entry.json.size();
+        } else
+#endif
+        {
+            if (mqttQueue.empty())
+                break;
+            const QueueEntry &entry = *mqttQueue.front();
+            if (!publishQueueEntry(entry))
+                break;
+            size = entry.envBytes.size() + entry.json.size();
+            mqttQueue.pop_front();
+        }
+        messages++;
+        drainedBytes += size;
+    }
+    queueStats.published += messages;
+    queueStats.drainMessages += messages;
+    queueStats.drainBytes += drainedBytes;
 
-    auto jsonString = MeshPacketSerializer::JsonSerialize(env.packet);
-    if (jsonString.length() == 0)
-        return;
+#if defined(FSCom) && MQTT_BACKLOG_SEGMENTS
+    empty = mqttQueue.empty() && (!backlog || backlog->isEmpty());
+#else
+    empty = mqttQueue.empty();
+#endif
+    if (empty) {
+        uint32_t msecs = millis() - queueStats.drainStart;
+        LOG_INFO("MQTT queue drained, %u messages (%u bytes) in %u ms, %u msg/s. %u queued, %u spilled, %u dropped, %u published "
+                 "since boot",
+                 queueStats.drainMessages, queueStats.drainBytes, msecs,
+                 msecs ? (uint32_t)((uint64_t)queueStats.drainMessages * 1000 / msecs) : queueStats.drainMessages,
+                 queueStats.queued, queueStats.spilled, queueStats.dropped, queueStats.published);
+        queueStats.drainMessages = queueStats.drainBytes = 0;
+    }
+}
 
-    std::string topicJson;
-    if (env.packet->pki_encrypted) {
-        topicJson = jsonTopic + "PKI/" + owner.id;
-    } else {
-        topicJson = jsonTopic + env.channel_id + "/" + owner.id;
+void MQTT::enqueue(std::unique_ptr<QueueEntry> entry)
+{
+    queueStats.queued++;
+    if (mqttQueue.size() >= MAX_MQTT_QUEUE) {
+        const QueueEntry &oldest = *mqttQueue.front();
+        bool spilled = false;
+#if defined(FSCom) && MQTT_BACKLOG_SEGMENTS
+        if (backlog) {
+            std::basic_string<uint8_t> record;
+            appendField(record, oldest.topic.data(), oldest.topic.size());
+            appendField(record, oldest.envBytes.data(), oldest.envBytes.size());
+            appendField(record, oldest.jsonTopic.data(), oldest.jsonTopic.size());
+            appendField(record, oldest.json.data(), oldest.json.size());
+            uint32_t droppedBefore = backlog->numDropped();
+            spilled = record.size() <= sizeof(backlogRecord) && backlog->push(record.data(), record.size());
+            queueStats.dropped += backlog->numDropped() - droppedBefore;
+            if (spilled)
+                queueStats.spilled++;
+        }
+#endif
+        if (!spilled) {
+            LOG_WARN("MQTT queue is full, discard oldest");
+            queueStats.dropped++;
+        }
+        mqttQueue.pop_front();
     }
-    LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
-    publish(topicJson.c_str(), jsonString.c_str(), false);
-#endif // ARCH_NRF52 NRF52_USE_JSON
+    mqttQueue.push_back(std::move(entry));
 }
 
 void MQTT::onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &mp_decoded, ChannelIndex chIndex)
@@ -745,25 +858,29 @@ void MQTT::onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_Me
         if (!moduleConfig.mqtt.json_enabled)
             return;
         // handle json topic
-        auto jsonString = MeshPacketSerializer::JsonSerialize(&mp_decoded);
-        if (jsonString.length() == 0)
+        size_t jsonLength = MeshPacketSerializer::JsonSerialize(&mp_decoded, jsonBuffer, sizeof(jsonBuffer));
+        if (jsonLength == 0)
             return;
         std::string topicJson = jsonTopic + channelId + "/" + owner.id;
-        LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
-        publish(topicJson.c_str(), jsonString.c_str(), false);
+        LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonLength, jsonBuffer);
+        publish(topicJson.c_str(), jsonBuffer, false);
 #endif // ARCH_NRF52 NRF52_USE_JSON
     } else {
         LOG_INFO("MQTT not connected, queue packet");
-        QueueEntry *entry;
-        if (mqttQueue.numFree() == 0) {
-            LOG_WARN("MQTT queue is full, discard oldest");
-            entry = mqttQueue.dequeuePtr(0);
-        } else {
-            entry = new QueueEntry;
-        }
+        std::unique_ptr<QueueEntry> entry(new QueueEntry);
         entry->topic = std::move(topic);
         entry->envBytes.assign(bytes, numBytes);
-        assert(mqttQueue.enqueue(entry, 0));
+#if !defined(ARCH_NRF52) || defined(NRF52_USE_JSON)
+        // Render the JSON now, while we have the decoded packet, rather than decode the envelope again when it is published
+        if (moduleConfig.mqtt.json_enabled) {
+            size_t jsonLength = MeshPacketSerializer::JsonSerialize(&mp_decoded, jsonBuffer, sizeof(jsonBuffer), false);
+            if (jsonLength) {
+                entry->jsonTopic = jsonTopic + channelId + "/" + owner.id;
+                entry->json.assign(jsonBuffer, jsonLength);
+            }
+        }
+#endif
+        enqueue(std::move(entry));
     }
 }
 
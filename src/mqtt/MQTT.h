@@ -6,6 +6,7 @@
 #include "concurrency/OSThread.h"
 #include "mesh/Channels.h"
 #include "mesh/generated/meshtastic/mqtt.pb.h"
+#include "mqtt/DiskQueue.h"
 #if !defined(ARCH_NRF52) || NRF52_USE_JSON
 #include "serialization/JSON.h"
 #endif
@@ -23,8 +24,33 @@
 #include <PubSubClient.h>
 #include <memory>
 #endif
+#include <deque>
 
+// Packets kept in RAM while the server is unreachable
+#ifndef MAX_MQTT_QUEUE
 #define MAX_MQTT_QUEUE 16
+#endif
+
+// How much of the queue one runOnce may publish, once the server is back
+#ifndef MQTT_DRAIN_BYTES
+#define MQTT_DRAIN_BYTES 16384
+#endif
+#ifndef MQTT_DRAIN_MSEC
+#define MQTT_DRAIN_MSEC 50
+#endif
+
+// When the RAM queue is full the oldest packets spill to a backlog on the filesystem of up to this many segments (0 to drop them
+// instead).  Packets take a few hundred bytes each with their JSON, so the 4 MB default on native holds several thousand.
+#ifndef MQTT_BACKLOG_SEGMENTS
+#ifdef ARCH_PORTDUINO
+#define MQTT_BACKLOG_SEGMENTS 128
+#else
+#define MQTT_BACKLOG_SEGMENTS 0
+#endif
+#endif
+#ifndef MQTT_BACKLOG_SEGMENT_BYTES
+#define MQTT_BACKLOG_SEGMENT_BYTES (32 * 1024)
+#endif
 
 /**
  * Our wrapper/singleton for sending/receiving MQTT "udp" packets.  This object isolates the MQTT protocol implementation from
@@ -68,8 +94,22 @@ class MQTT : private concurrency::OSThread
     struct QueueEntry {
         std::string topic;
         std::basic_string<uint8_t> envBytes; // binary/pb_encode_to_bytes ServiceEnvelope
+        std::string jsonTopic;               // empty if there is no JSON to publish
+        std::string json;                    // rendered when queued, from the decoded packet
     };
-    PointerQueue<QueueEntry> mqttQueue;
+    std::deque<std::unique_ptr<QueueEntry>> mqttQueue; // newer than anything in the backlog
+#if defined(FSCom) && MQTT_BACKLOG_SEGMENTS
+    std::unique_ptr<DiskQueue> backlog;
+#endif
+
+    /// Counters for the queue, and for the drain in progress since the server came back
+    struct QueueStats {
+        uint32_t queued = 0;    // packets that had to wait for the server
+        uint32_t spilled = 0;   // of which went to the backlog on disk
+        uint32_t dropped = 0;   // of which were lost to a full queue
+        uint32_t published = 0; // of which were published in the end
+        uint32_t drainStart = 0, drainMessages = 0, drainBytes = 0;
+    } queueStats;
 
     int reconnectCount = 0;
     bool isConfiguredForDefaultServer = true;
@@ -127,8 +167,14 @@ class MQTT : private concurrency::OSThread
     /// Called when a new publish arrives from the MQTT server
     void onReceive(char *topic, byte *payload, size_t length);
 
+    void enqueue(std::unique_ptr<QueueEntry> entry);
+
+    /// Publish what was queued while disconnected, oldest first, until the queue is empty or the budget for one pass is spent
     void publishQueuedMessages();
 
+    /// Publish one queued entry, both its protobuf and JSON forms.  @return false if the server didn't take it
+    bool publishQueueEntry(const QueueEntry &entry);
+
     void publishNodeInfo();
 
     // Check if we should report unencrypted information about our node for consumption by a map
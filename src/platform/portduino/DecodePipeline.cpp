@@ -0,0 +1,150 @@
+#include "DecodePipeline.h"
+#include "Router.h"
+#include "configuration.h"
+#include "mesh-pb-constants.h"
+
+#include <pb_decode.h>
+#include <utility>
+
+DecodePipeline::DecodePipeline(unsigned numWorkers, size_t depth)
+{
+    size_t size = 1;
+    while (size < depth)
+        size <<= 1;
+    jobs = new Job[size]();
+    mask = size - 1;
+
+    for (unsigned i = 0; i < numWorkers; i++)
+        workers.emplace_back(&DecodePipeline::workerLoop, this);
+}
+
+DecodePipeline::~DecodePipeline()
+{
+    {
+        std::lock_guard<std::mutex> g(idleLock);
+        stopping = true;
+    }
+    idle.notify_all();
+    for (std::thread &t : workers)
+        t.join();
+
+    for (; head != tail; head++)
+        packetPool.release(jobs[head & mask].p);
+    delete[] jobs;
+}
+
+bool DecodePipeline::submit(meshtastic_MeshPacket *p, int hint)
+{
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t - head > mask)
+        return false;
+
+    // Workers must not look at Channels, so copy out every key that could decrypt this packet now
+    Job &job = jobs[t & mask];
+    job.p = p;
+    job.channelsGeneration = channels.getGeneration();
+    job.numKeys = 0;
+    if (p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag && p->encrypted.size <= MAX_LORA_PAYLOAD_LEN) {
+        uint8_t candidates = channels.getChannelsForHash(p->channel);
+        while (candidates) {
+            ChannelIndex chIndex = __builtin_ctz(candidates);
+            candidates &= ~(1U << chIndex);
+            CryptoKey k = channels.getKey(chIndex);
+            if (k.length < 0)
+                continue;
+            job.chIndexes[job.numKeys] = chIndex;
+            job.keys[job.numKeys++] = k;
+            if (chIndex == hint) { // Try it first
+                std::swap(job.chIndexes[0], job.chIndexes[job.numKeys - 1]);
+                std::swap(job.keys[0], job.keys[job.numKeys - 1]);
+            }
+        }
+    }
+    job.hint = hint;
+    job.done.store(false, std::memory_order_relaxed);
+    tail.store(t + 1, std::memory_order_release);
+
+    // Taking the lock orders this against a worker that is just about to go to sleep
+    idleLock.lock();
+    idleLock.unlock();
+    idle.notify_one();
+    return true;
+}
+
+bool DecodePipeline::takeCompleted(PrecomputedDecode &result)
+{
+    if (head == tail.load(std::memory_order_relaxed))
+        return false;
+    Job &job = jobs[head & mask];
+    if (!job.done.load(std::memory_order_acquire))
+        return false; // later packets may be done, but they have to wait their turn
+
+    result = job.result;
+    memset(job.keys, 0, sizeof(job.keys));
+    head++;
+    return true;
+}
+
+void DecodePipeline::workerLoop()
+{
+    PortduinoCryptoEngine engine;
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        uint32_t c = claimed.load(std::memory_order_relaxed);
+        if (c == tail.load(std::memory_order_acquire)) {
+            std::unique_lock<std::mutex> lock(idleLock);
+            idle.wait(lock, [&] { return stopping.load() || claimed.load() != tail.load(); });
+            continue;
+        }
+        if (!claimed.compare_exchange_weak(c, c + 1, std::memory_order_acq_rel))
+            continue;
+
+        Job &job = jobs[c & mask];
+        decode(job, engine);
+        job.done.store(true, std::memory_order_release);
+
+        // Pairs with the fence in Router::runOnce, either it sees this job done or we reschedule it after it went idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (reader) {
+            reader->setInterval(0);
+            concurrency::mainDelay.interrupt();
+        }
+    }
+}
+
+/**
+ * The channel half of perhapsDecode, minus anything that touches shared state (including logging)
+ */
+void DecodePipeline::decode(Job &job, CryptoEngine &engine)
+{
+    const meshtastic_MeshPacket *p = job.p;
+    PrecomputedDecode &r = job.result;
+    r.packet = p;
+    r.channelsGeneration = job.channelsGeneration;
+    r.decoded = false;
+    r.hintHit = false;
+    r.attempts = r.wasted = r.rejectedEarly = 0;
+
+    uint8_t plaintext[MAX_LORA_PAYLOAD_LEN + 1];
+    size_t rawSize = p->encrypted.size;
+    for (uint8_t i = 0; i < job.numKeys; i++) {
+        r.attempts++;
+        memcpy(plaintext, p->encrypted.bytes, rawSize);
+        engine.decryptWithKey(job.keys[i], p->from, p->id, rawSize, plaintext);
+
+        if (!looksLikeData(plaintext, rawSize)) {
+            r.rejectedEarly++;
+            r.wasted++;
+            continue;
+        }
+        memset(&r.data, 0, sizeof(r.data));
+        pb_istream_t stream = pb_istream_from_buffer(plaintext, rawSize);
+        if (pb_decode(&stream, &meshtastic_Data_msg, &r.data) && r.data.portnum != meshtastic_PortNum_UNKNOWN_APP) {
+            r.decoded = true;
+            r.chIndex = job.chIndexes[i];
+            r.hintHit = i == 0 && r.chIndex == job.hint;
+            return;
+        }
+        r.wasted++;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Channels.h"
+#include "MeshTypes.h"
+#include "PortduinoCryptoEngine.h"
+#include "concurrency/OSThread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// The result of decrypting a channel packet ahead of time, see DecodePipeline.  Consumed by perhapsDecode on the main thread.
+struct PrecomputedDecode {
+    const meshtastic_MeshPacket *packet; // the packet this result is for, NULL when there is none
+    uint32_t channelsGeneration;         // channels.getGeneration() when the keys were copied
+    bool decoded;                        // false means none of the candidate channels worked
+    bool hintHit;                        // decoded on the first try, with the channel hinted to submit()
+    ChannelIndex chIndex;
+    meshtastic_Data data;
+    uint8_t attempts, wasted, rejectedEarly; // folded into decodeStats by the main thread
+};
+
+/**
+ * Optional multi-core receive path for meshtasticd (General: DecodeThreads in config.yaml).
+ *
+ * Received packets are queued here instead of going straight to the Router; worker threads try the channel keys that match
+ * each packet's hash and decode the protobuf, and the Router picks the results up strictly in arrival order, so per (from, id)
+ * ordering is the same as without the pipeline.  The queue is a fixed ring: the main thread is its only producer and consumer,
+ * workers claim jobs with an atomic counter and publish results with a release store, so the queue itself takes no locks.
+ * Mutexes and condition variables are only used to park idle workers, and by mainDelay to wake the Router as results come in.
+ *
+ * Thread safety of what the receive path touches, and why only channel decryption moved off the main thread:
+ * - NodeDB: meshNodes, its NodeNumIndex and eviction queue are mutated by getOrCreateMeshNode/updateUser and friends without any
+ *   locking, so workers never read it.  The KNOWN_ONLY check and the PKI public key lookup stay in perhapsDecode.
+ * - Channels: channelFile can be rewritten by AdminModule at any time.  The candidate keys for a packet are copied on the main
+ *   thread when it is submitted, and results computed with keys from an older Channels generation are thrown away.
+ * - CryptoEngine: the global crypto holds the current key, nonce and PKI shared key, and aes-ccm.cpp always goes through the
+ *   global, so PKI decryption stays on the main thread under cryptLock.  Each worker owns a private PortduinoCryptoEngine.
+ * - MQTT and JSON: MeshPacketSerializer reads NodeDB and owner and logs as it goes, and the PubSubClient is not thread safe, so
+ *   uplink still runs on the main thread.
+ * - Logging: RedirectablePrint is not thread safe, workers never log.
+ * - packetPool: lock free since it became a MemoryPool, but workers neither allocate nor free packets, the pipeline owns a
+ *   packet from submit() until takeCompleted() hands it back.
+ */
+class DecodePipeline
+{
+  public:
+    DecodePipeline(unsigned numWorkers, size_t depth = 64);
+    ~DecodePipeline();
+
+    /**
+     * Queue a received packet for decoding.  Packets that are already decoded just keep their place in line.
+     * @param hint the channel to try first, or -1
+     * @return false if the pipeline is full, the caller still owns the packet
+     */
+    bool submit(meshtastic_MeshPacket *p, int hint = -1);
+
+    /**
+     * Fetch the oldest packet, if its decode has finished
+     * @return true if result was filled in, result.packet then belongs to the caller
+     */
+    bool takeCompleted(PrecomputedDecode &result);
+
+    /// Are any packets still queued or being decoded?
+    bool busy() const { return head != tail.load(std::memory_order_relaxed); }
+
+    /**
+     * Wake this thread, with setInterval(0) and mainDelay.interrupt(), each time a packet is done.  Like TypedQueue, nothing
+     * else about the thread is touched.
+     */
+    void setReader(concurrency::OSThread *t) { reader = t; }
+
+    unsigned getNumWorkers() const { return workers.size(); }
+
+  private:
+    struct Job {
+        meshtastic_MeshPacket *p;
+        uint32_t channelsGeneration;
+        uint8_t numKeys;
+        int hint; // channel tried first, or -1
+        ChannelIndex chIndexes[MAX_NUM_CHANNELS];
+        CryptoKey keys[MAX_NUM_CHANNELS];
+        PrecomputedDecode result;
+        std::atomic<bool> done;
+    };
+
+    Job *jobs;
+    size_t mask;
+
+    uint32_t head = 0;                  // next job to hand back, main thread only
+    std::atomic<uint32_t> tail = {0};   // next free slot, written by the main thread
+    std::atomic<uint32_t> claimed = {0}; // next job a worker will take
+    concurrency::OSThread *reader = NULL;
+
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping = {false};
+    std::mutex idleLock;
+    std::condition_variable idle;
+
+    void workerLoop();
+
+    static void decode(Job &job, CryptoEngine &engine);
+};
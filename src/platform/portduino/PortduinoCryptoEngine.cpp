@@ -0,0 +1,176 @@
+#include "PortduinoCryptoEngine.h"
+#include "configuration.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_AESNI 1
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#include <arm_neon.h>
+#define HAS_ARMV8_AES 1
+#endif
+
+#if HAS_AESNI || HAS_ARMV8_AES
+static const uint8_t sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa,
+    0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5,
+    0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15, 0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2,
+    0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
+    0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf, 0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45,
+    0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff,
+    0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73, 0x60, 0x81, 0x4f,
+    0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65,
+    0x7a, 0xae, 0x08, 0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e,
+    0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e,
+    0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf, 0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
+    0xb0, 0x54, 0xbb, 0x16};
+
+/**
+ * FIPS-197 key expansion, producing the encryption round keys as consecutive 16 byte blocks, which is the layout both AES-NI and
+ * the ARMv8 AESE instruction expect.
+ *
+ * @return the number of rounds (10 for AES128, 14 for AES256)
+ */
+static uint8_t expandKey(const uint8_t *key, size_t keyLen, uint8_t *roundKeys)
+{
+    const size_t nk = keyLen / 4;
+    const uint8_t rounds = nk + 6;
+    uint8_t rcon = 0x01;
+
+    memcpy(roundKeys, key, keyLen);
+    for (size_t i = nk; i < 4 * (rounds + 1u); i++) {
+        uint8_t t[4];
+        memcpy(t, roundKeys + (i - 1) * 4, 4);
+        if (i % nk == 0) {
+            uint8_t first = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[first];
+            rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x1b : 0);
+        } else if (nk > 6 && i % nk == 4) {
+            for (int j = 0; j < 4; j++)
+                t[j] = sbox[t[j]];
+        }
+        for (int j = 0; j < 4; j++)
+            roundKeys[i * 4 + j] = roundKeys[(i - nk) * 4 + j] ^ t[j];
+    }
+    return rounds;
+}
+#endif
+
+#if HAS_AESNI
+// Four blocks in flight hides the latency of the AESENC pipeline
+__attribute__((target("aes,sse2"))) static void encryptBlocksAESNI(const uint8_t *roundKeys, uint8_t rounds, uint8_t *blocks,
+                                                                   size_t numBlocks)
+{
+    __m128i k[15];
+    for (int r = 0; r <= rounds; r++)
+        k[r] = _mm_loadu_si128((const __m128i *)(roundKeys + r * 16));
+
+    size_t i = 0;
+    for (; i + 4 <= numBlocks; i += 4) {
+        __m128i *p = (__m128i *)(blocks + i * 16);
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128(p), k[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128(p + 1), k[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128(p + 2), k[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128(p + 3), k[0]);
+        for (int r = 1; r < rounds; r++) {
+            b0 = _mm_aesenc_si128(b0, k[r]);
+            b1 = _mm_aesenc_si128(b1, k[r]);
+            b2 = _mm_aesenc_si128(b2, k[r]);
+            b3 = _mm_aesenc_si128(b3, k[r]);
+        }
+        _mm_storeu_si128(p, _mm_aesenclast_si128(b0, k[rounds]));
+        _mm_storeu_si128(p + 1, _mm_aesenclast_si128(b1, k[rounds]));
+        _mm_storeu_si128(p + 2, _mm_aesenclast_si128(b2, k[rounds]));
+        _mm_storeu_si128(p + 3, _mm_aesenclast_si128(b3, k[rounds]));
+    }
+    for (; i < numBlocks; i++) {
+        __m128i *p = (__m128i *)(blocks + i * 16);
+        __m128i b = _mm_xor_si128(_mm_loadu_si128(p), k[0]);
+        for (int r = 1; r < rounds; r++)
+            b = _mm_aesenc_si128(b, k[r]);
+        _mm_storeu_si128(p, _mm_aesenclast_si128(b, k[rounds]));
+    }
+}
+#endif
+
+#if HAS_ARMV8_AES
+// AESE does AddRoundKey+SubBytes+ShiftRows and AESMC the MixColumns, so each round key is applied one step earlier than in
+// FIPS-197 and the last one is a plain xor
+static void encryptBlocksARMv8(const uint8_t *roundKeys, uint8_t rounds, uint8_t *blocks, size_t numBlocks)
+{
+    uint8x16_t k[15];
+    for (int r = 0; r <= rounds; r++)
+        k[r] = vld1q_u8(roundKeys + r * 16);
+
+    size_t i = 0;
+    for (; i + 4 <= numBlocks; i += 4) {
+        uint8_t *p = blocks + i * 16;
+        uint8x16_t b0 = vld1q_u8(p), b1 = vld1q_u8(p + 16), b2 = vld1q_u8(p + 32), b3 = vld1q_u8(p + 48);
+        for (int r = 0; r < rounds - 1; r++) {
+            b0 = vaesmcq_u8(vaeseq_u8(b0, k[r]));
+            b1 = vaesmcq_u8(vaeseq_u8(b1, k[r]));
+            b2 = vaesmcq_u8(vaeseq_u8(b2, k[r]));
+            b3 = vaesmcq_u8(vaeseq_u8(b3, k[r]));
+        }
+        vst1q_u8(p, veorq_u8(vaeseq_u8(b0, k[rounds - 1]), k[rounds]));
+        vst1q_u8(p + 16, veorq_u8(vaeseq_u8(b1, k[rounds - 1]), k[rounds]));
+        vst1q_u8(p + 32, veorq_u8(vaeseq_u8(b2, k[rounds - 1]), k[rounds]));
+        vst1q_u8(p + 48, veorq_u8(vaeseq_u8(b3, k[rounds - 1]), k[rounds]));
+    }
+    for (; i < numBlocks; i++) {
+        uint8_t *p = blocks + i * 16;
+        uint8x16_t b = vld1q_u8(p);
+        for (int r = 0; r < rounds - 1; r++)
+            b = vaesmcq_u8(vaeseq_u8(b, k[r]));
+        vst1q_u8(p, veorq_u8(vaeseq_u8(b, k[rounds - 1]), k[rounds]));
+    }
+}
+#endif
+
+PortduinoCryptoEngine::PortduinoCryptoEngine()
+{
+#if HAS_AESNI
+    __builtin_cpu_init(); // we may run as a static initializer, before libgcc has probed the CPU
+    hasAES = __builtin_cpu_supports("aes");
+#elif HAS_ARMV8_AES
+    hasAES = true;
+#endif
+}
+
+PortduinoCryptoEngine::~PortduinoCryptoEngine()
+{
+    memset(roundKeys, 0, sizeof(roundKeys));
+}
+
+void PortduinoCryptoEngine::aesKeyChanged(int slot)
+{
+#if HAS_AESNI || HAS_ARMV8_AES
+    if (hasAES) {
+        const CryptoKey &k = aesKeyCache[slot].key;
+        rounds[slot] = expandKey(k.bytes, k.length == 16 ? 16 : 32, roundKeys[slot]);
+        return;
+    }
+#endif
+    CryptoEngine::aesKeyChanged(slot);
+}
+
+void PortduinoCryptoEngine::aesEncryptBlocks(int slot, uint8_t *blocks, size_t numBlocks)
+{
+#if HAS_AESNI
+    if (hasAES) {
+        encryptBlocksAESNI(roundKeys[slot], rounds[slot], blocks, numBlocks);
+        return;
+    }
+#elif HAS_ARMV8_AES
+    if (hasAES) {
+        encryptBlocksARMv8(roundKeys[slot], rounds[slot], blocks, numBlocks);
+        return;
+    }
+#endif
+    CryptoEngine::aesEncryptBlocks(slot, blocks, numBlocks);
+}
+
+CryptoEngine *crypto = new PortduinoCryptoEngine();
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CryptoEngine.h"
+
+/**
+ * Native builds run the CTR keystream on the CPU's AES instructions when it has them (AES-NI on x86, checked at runtime, or the
+ * ARMv8 crypto extension when the build targets it).  Otherwise everything falls through to the generic software AES.
+ */
+class PortduinoCryptoEngine : public CryptoEngine
+{
+    bool hasAES = false;
+
+    /// Expanded round keys for each slot of aesKeyCache
+    uint8_t roundKeys[AES_KEY_CACHE_SIZE][15 * 16];
+    uint8_t rounds[AES_KEY_CACHE_SIZE] = {};
+
+  public:
+    PortduinoCryptoEngine();
+    ~PortduinoCryptoEngine();
+
+  protected:
+    virtual void aesKeyChanged(int slot) override;
+    virtual void aesEncryptBlocks(int slot, uint8_t *blocks, size_t numBlocks) override;
+};
@@ -18,8 +18,10 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <signal.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <vector>
 
 #ifdef PORTDUINO_LINUX_HARDWARE
 #include <cxxabi.h>
@@ -33,7 +35,15 @@ std::ofstream traceFile;
 Ch341Hal *ch341Hal = nullptr;
 char *configPath = nullptr;
 char *optionMac = nullptr;
+char *optionLogLevels = nullptr;
 bool forceSimulated = false;
+static std::string loadedConfigPath;
+static volatile sig_atomic_t logLevelsReloadRequested = 0;
+
+#define OPT_LOG_LEVELS 0x100 // long option only
+
+static void loadLoggingConfig(const YAML::Node &logging);
+static bool openTraceFile();
 
 // FIXME - move setBluetoothEnable into a HALPlatform class
 void setBluetoothEnable(bool enable)
@@ -68,6 +78,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case 'h':
         optionMac = arg;
         break;
+    case OPT_LOG_LEVELS:
+        optionLogLevels = arg;
+        break;
 
     case ARGP_KEY_ARG:
         return 0;
@@ -83,6 +96,8 @@ void portduinoCustomInit()
                                            {"config", 'c', "CONFIG_PATH", 0, "Full path of the .yaml config file to use."},
                                            {"hwid", 'h', "HWID", 0, "The mac address to assign to this virtual machine"},
                                            {"sim", 's', 0, 0, "Run in Simulated radio mode"},
+                                           {"log-levels", OPT_LOG_LEVELS, "MODULE=LEVEL,...", 0,
+                                            "Log levels for single source files, like Router=debug,PacketHistory=warn"},
                                            {0}};
     static void *childArguments;
     static char doc[] = "Meshtastic native build.";
@@ -194,6 +209,7 @@ void portduinoSetup()
         std::cout << "Running in simulated mode." << std::endl;
         settingsMap[maxnodes] = 200;               // Default to 200 nodes
         settingsMap[logoutputlevel] = level_debug; // Default to debug
+        applyLogLevels();
         // Set the random seed equal to TCPPort to have a different seed per instance
         randomSeed(TCPPort);
         return;
@@ -361,16 +377,92 @@ void portduinoSetup()
         }
         SPI.begin(settingsStrings[spidev].c_str());
     }
-    if (settingsStrings[traceFilename] != "") {
+    if (!openTraceFile())
+        exit(EXIT_FAILURE);
+    applyLogLevels();
+
+    // kill -HUP re-reads the Logging sections of config.yaml and config.d
+    signal(SIGHUP, [](int) { logLevelsReloadRequested = 1; });
+
+    return;
+}
+
+/**
+ * Give every source file its log level: LogLevel, unless ModuleLevels in the config file or --log-levels (which wins) say
+ * otherwise for it.
+ */
+void applyLogLevels()
+{
+    static const uint8_t levels[] = {LOG_LEVEL_ERROR, LOG_LEVEL_WARN, LOG_LEVEL_INFO, LOG_LEVEL_DEBUG, LOG_LEVEL_TRACE};
+    int level = settingsMap[logoutputlevel];
+    uint8_t defaultLevel = levels[level >= level_error && level <= level_trace ? level : level_info];
+
+    std::string spec = settingsStrings[logModuleLevels];
+    if (optionLogLevels && *optionLogLevels)
+        spec += (spec.empty() ? "" : ",") + std::string(optionLogLevels);
+    if (!LogModule::configure(defaultLevel, spec.c_str()))
+        std::cout << "Some of the module log levels '" << spec << "' are not valid or name no module" << std::endl;
+}
+
+/// Start (or stop) writing the trace to TraceFile, as the Logging config now says.  @return false if it can't be opened
+static bool openTraceFile()
+{
+    RedirectablePrint::traceToFile = false;
+    if (traceFile.is_open())
+        traceFile.close();
+    if (settingsStrings[traceFilename] == "")
+        return true;
+    try {
+        traceFile.open(settingsStrings[traceFilename], std::ios::out | std::ios::app);
+        RedirectablePrint::traceToFile = true;
+    } catch (std::ofstream::failure &e) {
+        std::cout << "*** traceFile Exception " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Re-read the Logging sections the same way as at startup: config.yaml, then each file in config.d on top of it, then
+ * reopen the trace file.  Simulated mode never merged config.d or opened a trace file, so only gets config.yaml.
+ */
+void reloadLogLevelsIfRequested()
+{
+    if (!logLevelsReloadRequested)
+        return;
+    logLevelsReloadRequested = 0;
+
+    if (loadedConfigPath.empty())
+        return;
+    std::vector<std::string> paths = {loadedConfigPath};
+    bool simulated = settingsMap[use_simradio];
+    if (!simulated && settingsStrings[config_directory] != "") {
         try {
-            traceFile.open(settingsStrings[traceFilename], std::ios::out | std::ios::app);
-        } catch (std::ofstream::failure &e) {
-            std::cout << "*** traceFile Exception " << e.what() << std::endl;
-            exit(EXIT_FAILURE);
+            for (const std::filesystem::directory_entry &entry :
+                 std::filesystem::directory_iterator{settingsStrings[config_directory]}) {
+                if (ends_with(entry.path().string(), ".yaml"))
+                    paths.push_back(entry.path().string());
+            }
+        } catch (std::filesystem::filesystem_error &e) {
+            LOG_ERROR("Can't list %s: %s", settingsStrings[config_directory].c_str(), e.what());
         }
     }
 
-    return;
+    settingsStrings[logModuleLevels] = ""; // as at startup, in case they were taken out of the config
+    for (const std::string &path : paths) {
+        try {
+            YAML::Node yamlConfig = YAML::LoadFile(path);
+            loadLoggingConfig(yamlConfig["Logging"]);
+        } catch (YAML::Exception &e) {
+            LOG_ERROR("Can't reload log levels from %s: %s", path.c_str(), e.what());
+        }
+    }
+    if (simulated)
+        settingsMap[logoutputlevel] = level_debug; // as at startup
+    else if (!openTraceFile())
+        LOG_ERROR("Can't open trace file %s", settingsStrings[traceFilename].c_str());
+    applyLogLevels();
+    LOG_INFO("Reloaded log levels from %s and %u more", loadedConfigPath.c_str(), (unsigned)(paths.size() - 1));
 }
 
 int initGPIOPin(int pinNum, const std::string gpioChipName, int line)
@@ -393,29 +485,51 @@ int initGPIOPin(int pinNum, const std::string gpioChipName, int line)
 #endif
 }
 
+static void loadLoggingConfig(const YAML::Node &logging)
+{
+    if (!logging)
+        return;
+
+    if (logging["LogLevel"].as<std::string>("info") == "trace") {
+        settingsMap[logoutputlevel] = level_trace;
+    } else if (logging["LogLevel"].as<std::string>("info") == "debug") {
+        settingsMap[logoutputlevel] = level_debug;
+    } else if (logging["LogLevel"].as<std::string>("info") == "info") {
+        settingsMap[logoutputlevel] = level_info;
+    } else if (logging["LogLevel"].as<std::string>("info") == "warn") {
+        settingsMap[logoutputlevel] = level_warn;
+    } else if (logging["LogLevel"].as<std::string>("info") == "error") {
+        settingsMap[logoutputlevel] = level_error;
+    }
+    settingsStrings[traceFilename] = logging["TraceFile"].as<std::string>("");
+    if (logging["AsciiLogs"]) {
+        // Default is !isatty(1) but can be set explicitly in config.yaml
+        settingsMap[ascii_logs] = logging["AsciiLogs"].as<bool>();
+    }
+
+    // Either a map (Router: debug) or a string like --log-levels takes. A Logging section without it, say in config.d,
+    // leaves the levels from config.yaml alone
+    const YAML::Node &moduleLevels = logging["ModuleLevels"];
+    if (moduleLevels) {
+        std::string spec;
+        if (moduleLevels.IsMap()) {
+            for (auto it : moduleLevels)
+                spec += (spec.empty() ? "" : ",") + it.first.as<std::string>() + "=" + it.second.as<std::string>();
+        } else {
+            spec = moduleLevels.as<std::string>("");
+        }
+        settingsStrings[logModuleLevels] = spec;
+    }
+}
+
 bool loadConfig(const char *configPath)
 {
     YAML::Node yamlConfig;
     try {
         yamlConfig = YAML::LoadFile(configPath);
-        if (yamlConfig["Logging"]) {
-            if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "trace") {
-                settingsMap[logoutputlevel] = level_trace;
-            } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "debug") {
-                settingsMap[logoutputlevel] = level_debug;
-            } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "info") {
-                settingsMap[logoutputlevel] = level_info;
-            } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "warn") {
-                settingsMap[logoutputlevel] = level_warn;
-            } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "error") {
-                settingsMap[logoutputlevel] = level_error;
-            }
-            settingsStrings[traceFilename] = yamlConfig["Logging"]["TraceFile"].as<std::string>("");
-            if (yamlConfig["Logging"]["AsciiLogs"]) {
-                // Default is !isatty(1) but can be set explicitly in config.yaml
-                settingsMap[ascii_logs] = yamlConfig["Logging"]["AsciiLogs"].as<bool>();
-            }
-        }
+        if (loadedConfigPath.empty())
+            loadedConfigPath = configPath; // the main config file, not one of config.d
+        loadLoggingConfig(yamlConfig["Logging"]);
         if (yamlConfig["Lora"]) {
             const struct {
                 configNames cfgName;
@@ -609,6 +723,8 @@ bool loadConfig(const char *configPath)
         if (yamlConfig["General"]) {
             settingsMap[maxnodes] = (yamlConfig["General"]["MaxNodes"]).as<int>(200);
             settingsMap[maxtophone] = (yamlConfig["General"]["MaxMessageQueue"]).as<int>(100);
+            settingsMap[decodeThreads] = (yamlConfig["General"]["DecodeThreads"]).as<int>(0);
+            settingsStrings[storeForwardFile] = (yamlConfig["General"]["StoreForwardFile"]).as<std::string>("");
             settingsStrings[config_directory] = (yamlConfig["General"]["ConfigDirectory"]).as<std::string>("");
             settingsStrings[available_directory] =
                 (yamlConfig["General"]["AvailableDirectory"]).as<std::string>("/etc/meshtasticd/available.d/");
@@ -89,6 +89,7 @@ enum configNames {
     keyboardDevice,
     pointerDevice,
     logoutputlevel,
+    logModuleLevels,
     traceFilename,
     webserver,
     webserverport,
@@ -97,6 +98,8 @@ enum configNames {
     websslcertpath,
     maxtophone,
     maxnodes,
+    decodeThreads,
+    storeForwardFile,
     ascii_logs,
     config_directory,
     available_directory,
@@ -115,6 +118,9 @@ extern std::ofstream traceFile;
 extern Ch341Hal *ch341Hal;
 int initGPIOPin(int pinNum, std::string gpioChipname, int line);
 bool loadConfig(const char *configPath);
+void applyLogLevels();
+/// Called from the main loop, picks up the Logging config (config.yaml and config.d, TraceFile too) again after a SIGHUP
+void reloadLogLevelsIfRequested();
 static bool ends_with(std::string_view str, std::string_view suffix);
 void getMacAddr(uint8_t *dmac);
 bool MAC_from_string(std::string mac_str, uint8_t *dmac);
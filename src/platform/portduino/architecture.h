@@ -22,4 +22,7 @@
 #endif
 #ifndef HAS_SENSOR
 #define HAS_SENSOR 1
+#endif
+#ifndef HAS_CUSTOM_CRYPTO_ENGINE
+#define HAS_CUSTOM_CRYPTO_ENGINE 1
 #endif
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "JsonWriter.h"
+#include "JSON.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char *_buf, size_t _size) : buf(_buf), size(_size)
+{
+    if (size)
+        buf[0] = 0;
+}
+
+JsonWriter::JsonWriter(Print &_out) : buf(chunk), size(sizeof(chunk)), out(&_out) {}
+
+void JsonWriter::put(const char *s, size_t n)
+{
+    while (n) {
+        // Keep one byte free for the terminating NUL in buffer mode
+        size_t room = out ? size - len : (size > len + 1 ? size - len - 1 : 0);
+        if (room == 0) {
+            if (!out) {
+                overflow = true;
+                return;
+            }
+            flush();
+            continue;
+        }
+        size_t take = n < room ? n : room;
+        memcpy(buf + len, s, take);
+        len += take;
+        s += take;
+        n -= take;
+    }
+    if (!out && size)
+        buf[len] = 0;
+}
+
+void JsonWriter::flush()
+{
+    if (out && len) {
+        out->write((const uint8_t *)buf, len);
+        flushed += len;
+        len = 0;
+    }
+}
+
+size_t JsonWriter::finish()
+{
+    flush();
+    return flushed + len;
+}
+
+/**
+ * Comma before any element of a container but the first, none straight after a key
+ */
+void JsonWriter::separate()
+{
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    uint32_t bit = 1UL << depth;
+    if (needComma & bit)
+        put(',');
+    needComma |= bit;
+}
+
+void JsonWriter::beginObject()
+{
+    separate();
+    put('{');
+    if (depth < MAX_DEPTH - 1)
+        depth++;
+    needComma &= ~(1UL << depth);
+}
+
+void JsonWriter::endObject()
+{
+    if (depth)
+        depth--;
+    put('}');
+}
+
+void JsonWriter::beginArray()
+{
+    separate();
+    put('[');
+    if (depth < MAX_DEPTH - 1)
+        depth++;
+    needComma &= ~(1UL << depth);
+}
+
+void JsonWriter::endArray()
+{
+    if (depth)
+        depth--;
+    put(']');
+}
+
+void JsonWriter::key(const char *k)
+{
+    separate();
+    string(k, strlen(k));
+    put(':');
+    afterKey = true;
+}
+
+/**
+ * Same escaping as JSONValue::StringifyString
+ */
+void JsonWriter::string(const char *s, size_t n)
+{
+    put('"');
+    size_t plain = 0; // run of characters that need no escaping, written in one go
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = s[i];
+        const char *esc = NULL;
+        char uesc[7];
+        switch (c) {
+        case '"':
+            esc = "\\\"";
+            break;
+        case '\\':
+            esc = "\\\\";
+            break;
+        case '/':
+            esc = "\\/";
+            break;
+        case '\b':
+            esc = "\\b";
+            break;
+        case '\f':
+            esc = "\\f";
+            break;
+        case '\n':
+            esc = "\\n";
+            break;
+        case '\r':
+            esc = "\\r";
+            break;
+        case '\t':
+            esc = "\\t";
+            break;
+        default:
+            if (c < 0x20 || c == 0x7F) {
+                snprintf(uesc, sizeof(uesc), "\\u%04x", c);
+                esc = uesc;
+            }
+            break;
+        }
+        if (esc) {
+            put(s + plain, i - plain);
+            put(esc, strlen(esc));
+            plain = i + 1;
+        }
+    }
+    put(s + plain, n - plain);
+    put('"');
+}
+
+void JsonWriter::value(const char *s)
+{
+    separate();
+    string(s, strlen(s));
+}
+
+void JsonWriter::value(bool b)
+{
+    separate();
+    if (b)
+        put("true", 4);
+    else
+        put("false", 5);
+}
+
+/**
+ * JSONValue prints numbers through a stringstream with precision 15, which is %.15g
+ */
+void JsonWriter::value(double d)
+{
+    separate();
+    if (isinf(d) || isnan(d)) {
+        put("null", 4);
+        return;
+    }
+    char s[32];
+    int n = snprintf(s, sizeof(s), "%.15g", d);
+    put(s, n);
+}
+
+void JsonWriter::value(int i)
+{
+    separate();
+    char s[12];
+    int n = snprintf(s, sizeof(s), "%d", i);
+    put(s, n);
+}
+
+void JsonWriter::value(unsigned int u)
+{
+    separate();
+    char s[12];
+    int n = snprintf(s, sizeof(s), "%u", u);
+    put(s, n);
+}
+
+void JsonWriter::valueNull()
+{
+    separate();
+    put("null", 4);
+}
+
+void JsonWriter::value(const JSONValue &v)
+{
+    if (v.IsNull()) {
+        valueNull();
+    } else if (v.IsString()) {
+        separate();
+        string(v.AsString().c_str(), v.AsString().length());
+    } else if (v.IsBool()) {
+        value(v.AsBool());
+    } else if (v.IsNumber()) {
+        value(v.AsNumber());
+    } else if (v.IsArray()) {
+        beginArray();
+        for (const JSONValue *child : v.AsArray())
+            value(*child);
+        endArray();
+    } else {
+        beginObject();
+        for (const auto &member : v.AsObject()) {
+            key(member.first.c_str());
+            value(*member.second);
+        }
+        endObject();
+    }
+}
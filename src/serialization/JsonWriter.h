@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Print.h>
+#include <stddef.h>
+#include <stdint.h>
+
+class JSONValue;
+
+/**
+ * Streaming JSON emitter, writes straight into a caller provided buffer or a Print sink (e.g. an HTTPResponse) without building
+ * a tree of JSONValues first.
+ *
+ * The output is byte for byte what JSONValue::Stringify() produces for the same data, as long as the caller writes object keys
+ * in ascending strcmp() order (JSONObject is a std::map, so that is the order Stringify uses) and passes numbers with the same
+ * types the JSONValue code did.  Strings are escaped the same way, except that bytes >= 0x80 are always passed through as UTF-8
+ * (JSONValue mangles them into \u escapes on targets where char is signed).
+ */
+class JsonWriter
+{
+  public:
+    /// Write into buf, which is always left NUL terminated.  Output that does not fit is dropped and overflowed() set.
+    JsonWriter(char *buf, size_t size);
+
+    /// Write to out, in chunks
+    explicit JsonWriter(Print &out);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    /// Start an object member, the next value() is its value
+    void key(const char *k);
+
+    void value(const char *s);
+    void value(bool b);
+    void value(double d);
+    void value(int i);
+    void value(unsigned int u);
+    void valueNull();
+
+    /// Write a parsed JSON document, e.g. from JSON::Parse
+    void value(const JSONValue &v);
+
+    template <typename T> void member(const char *k, T v)
+    {
+        key(k);
+        value(v);
+    }
+
+    /**
+     * Flush what is left to the Print sink
+     * @return the number of bytes written in total
+     */
+    size_t finish();
+
+    bool overflowed() const { return overflow; }
+
+  private:
+    static const int MAX_DEPTH = 32;
+
+    char chunk[64]; // staging buffer when writing to a Print
+    char *buf;
+    size_t size, len = 0;
+    size_t flushed = 0; // bytes already handed to out
+    Print *out = NULL;
+    bool overflow = false;
+
+    uint32_t needComma = 0; // bit n set once the container at depth n has an element
+    uint8_t depth = 0;
+    bool afterKey = false;
+
+    void put(const char *s, size_t n);
+    void put(char c) { put(&c, 1); }
+    void flush();
+    void separate();
+    void string(const char *s, size_t n);
+};
@@ -1,6 +1,7 @@
 #ifndef NRF52_USE_JSON
 #include "MeshPacketSerializer.h"
 #include "JSON.h"
+#include "JsonWriter.h"
 #include "NodeDB.h"
 #include "mesh/generated/meshtastic/mqtt.pb.h"
 #include "mesh/generated/meshtastic/telemetry.pb.h"
@@ -11,373 +12,464 @@
 #include "../mesh/generated/meshtastic/paxcount.pb.h"
 #endif
 #include "mesh/generated/meshtastic/remote_hardware.pb.h"
+#include <memory>
 #include <sys/types.h>
 
 static const char *errStr = "Error decoding proto for %s message!";
 
-std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog)
+/// Appends to a std::string, for the JsonSerialize variants that return one
+class StringPrint : public Print
 {
-    // the created jsonObj is immutable after creation, so
-    // we need to do the heavy lifting before assembling it.
-    std::string msgType;
-    JSONObject jsonObj;
+    std::string &str;
 
-    if (mp->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
-        JSONObject msgPayload;
-        switch (mp->decoded.portnum) {
-        case meshtastic_PortNum_TEXT_MESSAGE_APP: {
-            msgType = "text";
-            // convert bytes to string
-            if (shouldLog)
-                LOG_DEBUG("got text message of size %u", mp->decoded.payload.size);
+  public:
+    explicit StringPrint(std::string &_str) : str(_str) {}
+    size_t write(uint8_t c) override
+    {
+        str += (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        str.append((const char *)buffer, size);
+        return size;
+    }
+};
 
-            char payloadStr[(mp->decoded.payload.size) + 1];
-            memcpy(payloadStr, mp->decoded.payload.bytes, mp->decoded.payload.size);
-            payloadStr[mp->decoded.payload.size] = 0; // null terminated string
-            // check if this is a JSON payload
-            JSONValue *json_value = JSON::Parse(payloadStr);
-            if (json_value != NULL) {
-                if (shouldLog)
-                    LOG_INFO("text message payload is of type json");
+/**
+ * Write the JSON form of a decoded packet's payload, if we know how to.  Keys go out in alphabetical order, which is what the old
+ * std::map based JSONObject produced.
+ * @return the "type" for the envelope
+ */
+static const char *writePayload(JsonWriter &json, const meshtastic_MeshPacket *mp, bool shouldLog)
+{
+    const char *msgType = "";
 
-                // if it is, then we can just use the json object
-                jsonObj["payload"] = json_value;
-            } else {
-                // if it isn't, then we need to create a json object
-                // with the string as the value
-                if (shouldLog)
-                    LOG_INFO("text message payload is of type plaintext");
+    switch (mp->decoded.portnum) {
+    case meshtastic_PortNum_TEXT_MESSAGE_APP: {
+        msgType = "text";
+        // convert bytes to string
+        if (shouldLog)
+            LOG_DEBUG("got text message of size %u", mp->decoded.payload.size);
 
-                msgPayload["text"] = new JSONValue(payloadStr);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            }
-            break;
+        char payloadStr[(mp->decoded.payload.size) + 1];
+        memcpy(payloadStr, mp->decoded.payload.bytes, mp->decoded.payload.size);
+        payloadStr[mp->decoded.payload.size] = 0; // null terminated string
+        // check if this is a JSON payload
+        std::unique_ptr<JSONValue> json_value(JSON::Parse(payloadStr));
+        if (json_value != NULL) {
+            if (shouldLog)
+                LOG_INFO("text message payload is of type json");
+
+            // if it is, then we can just use the json object
+            json.key("payload");
+            json.value(*json_value);
+        } else {
+            // if it isn't, then we need to create a json object
+            // with the string as the value
+            if (shouldLog)
+                LOG_INFO("text message payload is of type plaintext");
+
+            json.key("payload");
+            json.beginObject();
+            json.member("text", (const char *)payloadStr);
+            json.endObject();
         }
-        case meshtastic_PortNum_TELEMETRY_APP: {
-            msgType = "telemetry";
-            meshtastic_Telemetry scratch;
-            meshtastic_Telemetry *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Telemetry_msg, &scratch)) {
-                decoded = &scratch;
-                if (decoded->which_variant == meshtastic_Telemetry_device_metrics_tag) {
-                    msgPayload["battery_level"] = new JSONValue((unsigned int)decoded->variant.device_metrics.battery_level);
-                    msgPayload["voltage"] = new JSONValue(decoded->variant.device_metrics.voltage);
-                    msgPayload["channel_utilization"] = new JSONValue(decoded->variant.device_metrics.channel_utilization);
-                    msgPayload["air_util_tx"] = new JSONValue(decoded->variant.device_metrics.air_util_tx);
-                    msgPayload["uptime_seconds"] = new JSONValue((unsigned int)decoded->variant.device_metrics.uptime_seconds);
-                } else if (decoded->which_variant == meshtastic_Telemetry_environment_metrics_tag) {
-                    msgPayload["temperature"] = new JSONValue(decoded->variant.environment_metrics.temperature);
-                    msgPayload["relative_humidity"] = new JSONValue(decoded->variant.environment_metrics.relative_humidity);
-                    msgPayload["barometric_pressure"] = new JSONValue(decoded->variant.environment_metrics.barometric_pressure);
-                    msgPayload["gas_resistance"] = new JSONValue(decoded->variant.environment_metrics.gas_resistance);
-                    msgPayload["voltage"] = new JSONValue(decoded->variant.environment_metrics.voltage);
-                    msgPayload["current"] = new JSONValue(decoded->variant.environment_metrics.current);
-                    msgPayload["lux"] = new JSONValue(decoded->variant.environment_metrics.lux);
-                    msgPayload["white_lux"] = new JSONValue(decoded->variant.environment_metrics.white_lux);
-                    msgPayload["iaq"] = new JSONValue((uint)decoded->variant.environment_metrics.iaq);
-                    msgPayload["wind_speed"] = new JSONValue(decoded->variant.environment_metrics.wind_speed);
-                    msgPayload["wind_direction"] = new JSONValue((uint)decoded->variant.environment_metrics.wind_direction);
-                    msgPayload["wind_gust"] = new JSONValue(decoded->variant.environment_metrics.wind_gust);
-                    msgPayload["wind_lull"] = new JSONValue(decoded->variant.environment_metrics.wind_lull);
-                    msgPayload["radiation"] = new JSONValue(decoded->variant.environment_metrics.radiation);
-                } else if (decoded->which_variant == meshtastic_Telemetry_air_quality_metrics_tag) {
-                    msgPayload["pm10"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm10_standard);
-                    msgPayload["pm25"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm25_standard);
-                    msgPayload["pm100"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm100_standard);
-                    msgPayload["pm10_e"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm10_environmental);
-                    msgPayload["pm25_e"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm25_environmental);
-                    msgPayload["pm100_e"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm100_environmental);
-                } else if (decoded->which_variant == meshtastic_Telemetry_power_metrics_tag) {
-                    msgPayload["voltage_ch1"] = new JSONValue(decoded->variant.power_metrics.ch1_voltage);
-                    msgPayload["current_ch1"] = new JSONValue(decoded->variant.power_metrics.ch1_current);
-                    msgPayload["voltage_ch2"] = new JSONValue(decoded->variant.power_metrics.ch2_voltage);
-                    msgPayload["current_ch2"] = new JSONValue(decoded->variant.power_metrics.ch2_current);
-                    msgPayload["voltage_ch3"] = new JSONValue(decoded->variant.power_metrics.ch3_voltage);
-                    msgPayload["current_ch3"] = new JSONValue(decoded->variant.power_metrics.ch3_current);
-                }
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
+        break;
+    }
+    case meshtastic_PortNum_TELEMETRY_APP: {
+        msgType = "telemetry";
+        meshtastic_Telemetry scratch;
+        meshtastic_Telemetry *decoded = NULL;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Telemetry_msg, &scratch)) {
+            decoded = &scratch;
+            json.key("payload");
+            json.beginObject();
+            if (decoded->which_variant == meshtastic_Telemetry_device_metrics_tag) {
+                const meshtastic_DeviceMetrics &m = decoded->variant.device_metrics;
+                json.member("air_util_tx", m.air_util_tx);
+                json.member("battery_level", (unsigned int)m.battery_level);
+                json.member("channel_utilization", m.channel_utilization);
+                json.member("uptime_seconds", (unsigned int)m.uptime_seconds);
+                json.member("voltage", m.voltage);
+            } else if (decoded->which_variant == meshtastic_Telemetry_environment_metrics_tag) {
+                const meshtastic_EnvironmentMetrics &m = decoded->variant.environment_metrics;
+                json.member("barometric_pressure", m.barometric_pressure);
+                json.member("current", m.current);
+                json.member("gas_resistance", m.gas_resistance);
+                json.member("iaq", (unsigned int)m.iaq);
+                json.member("lux", m.lux);
+                json.member("radiation", m.radiation);
+                json.member("relative_humidity", m.relative_humidity);
+                json.member("temperature", m.temperature);
+                json.member("voltage", m.voltage);
+                json.member("white_lux", m.white_lux);
+                json.member("wind_direction", (unsigned int)m.wind_direction);
+                json.member("wind_gust", m.wind_gust);
+                json.member("wind_lull", m.wind_lull);
+                json.member("wind_speed", m.wind_speed);
+            } else if (decoded->which_variant == meshtastic_Telemetry_air_quality_metrics_tag) {
+                const meshtastic_AirQualityMetrics &m = decoded->variant.air_quality_metrics;
+                json.member("pm10", (unsigned int)m.pm10_standard);
+                json.member("pm100", (unsigned int)m.pm100_standard);
+                json.member("pm100_e", (unsigned int)m.pm100_environmental);
+                json.member("pm10_e", (unsigned int)m.pm10_environmental);
+                json.member("pm25", (unsigned int)m.pm25_standard);
+                json.member("pm25_e", (unsigned int)m.pm25_environmental);
+            } else if (decoded->which_variant == meshtastic_Telemetry_power_metrics_tag) {
+                const meshtastic_PowerMetrics &m = decoded->variant.power_metrics;
+                json.member("current_ch1", m.ch1_current);
+                json.member("current_ch2", m.ch2_current);
+                json.member("current_ch3", m.ch3_current);
+                json.member("voltage_ch1", m.ch1_voltage);
+                json.member("voltage_ch2", m.ch2_voltage);
+                json.member("voltage_ch3", m.ch3_voltage);
             }
-            break;
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_NODEINFO_APP: {
-            msgType = "nodeinfo";
-            meshtastic_User scratch;
-            meshtastic_User *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_User_msg, &scratch)) {
-                decoded = &scratch;
-                msgPayload["id"] = new JSONValue(decoded->id);
-                msgPayload["longname"] = new JSONValue(decoded->long_name);
-                msgPayload["shortname"] = new JSONValue(decoded->short_name);
-                msgPayload["hardware"] = new JSONValue(decoded->hw_model);
-                msgPayload["role"] = new JSONValue((int)decoded->role);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
+        break;
+    }
+    case meshtastic_PortNum_NODEINFO_APP: {
+        msgType = "nodeinfo";
+        meshtastic_User scratch;
+        meshtastic_User *decoded = NULL;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_User_msg, &scratch)) {
+            decoded = &scratch;
+            json.key("payload");
+            json.beginObject();
+            json.member("hardware", (int)decoded->hw_model);
+            json.member("id", (const char *)decoded->id);
+            json.member("longname", (const char *)decoded->long_name);
+            json.member("role", (int)decoded->role);
+            json.member("shortname", (const char *)decoded->short_name);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_POSITION_APP: {
-            msgType = "position";
-            meshtastic_Position scratch;
-            meshtastic_Position *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Position_msg, &scratch)) {
-                decoded = &scratch;
-                if ((int)decoded->time) {
-                    msgPayload["time"] = new JSONValue((unsigned int)decoded->time);
-                }
-                if ((int)decoded->timestamp) {
-                    msgPayload["timestamp"] = new JSONValue((unsigned int)decoded->timestamp);
-                }
-                msgPayload["latitude_i"] = new JSONValue((int)decoded->latitude_i);
-                msgPayload["longitude_i"] = new JSONValue((int)decoded->longitude_i);
-                if ((int)decoded->altitude) {
-                    msgPayload["altitude"] = new JSONValue((int)decoded->altitude);
-                }
-                if ((int)decoded->ground_speed) {
-                    msgPayload["ground_speed"] = new JSONValue((unsigned int)decoded->ground_speed);
-                }
-                if (int(decoded->ground_track)) {
-                    msgPayload["ground_track"] = new JSONValue((unsigned int)decoded->ground_track);
-                }
-                if (int(decoded->sats_in_view)) {
-                    msgPayload["sats_in_view"] = new JSONValue((unsigned int)decoded->sats_in_view);
-                }
-                if ((int)decoded->PDOP) {
-                    msgPayload["PDOP"] = new JSONValue((int)decoded->PDOP);
-                }
-                if ((int)decoded->HDOP) {
-                    msgPayload["HDOP"] = new JSONValue((int)decoded->HDOP);
-                }
-                if ((int)decoded->VDOP) {
-                    msgPayload["VDOP"] = new JSONValue((int)decoded->VDOP);
-                }
-                if ((int)decoded->precision_bits) {
-                    msgPayload["precision_bits"] = new JSONValue((int)decoded->precision_bits);
-                }
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
+        break;
+    }
+    case meshtastic_PortNum_POSITION_APP: {
+        msgType = "position";
+        meshtastic_Position scratch;
+        meshtastic_Position *decoded = NULL;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Position_msg, &scratch)) {
+            decoded = &scratch;
+            json.key("payload");
+            json.beginObject();
+            if ((int)decoded->HDOP) {
+                json.member("HDOP", (int)decoded->HDOP);
+            }
+            if ((int)decoded->PDOP) {
+                json.member("PDOP", (int)decoded->PDOP);
+            }
+            if ((int)decoded->VDOP) {
+                json.member("VDOP", (int)decoded->VDOP);
+            }
+            if ((int)decoded->altitude) {
+                json.member("altitude", (int)decoded->altitude);
+            }
+            if ((int)decoded->ground_speed) {
+                json.member("ground_speed", (unsigned int)decoded->ground_speed);
             }
-            break;
+            if (int(decoded->ground_track)) {
+                json.member("ground_track", (unsigned int)decoded->ground_track);
+            }
+            json.member("latitude_i", (int)decoded->latitude_i);
+            json.member("longitude_i", (int)decoded->longitude_i);
+            if ((int)decoded->precision_bits) {
+                json.member("precision_bits", (int)decoded->precision_bits);
+            }
+            if (int(decoded->sats_in_view)) {
+                json.member("sats_in_view", (unsigned int)decoded->sats_in_view);
+            }
+            if ((int)decoded->time) {
+                json.member("time", (unsigned int)decoded->time);
+            }
+            if ((int)decoded->timestamp) {
+                json.member("timestamp", (unsigned int)decoded->timestamp);
+            }
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_WAYPOINT_APP: {
-            msgType = "waypoint";
-            meshtastic_Waypoint scratch;
-            meshtastic_Waypoint *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Waypoint_msg, &scratch)) {
-                decoded = &scratch;
-                msgPayload["id"] = new JSONValue((unsigned int)decoded->id);
-                msgPayload["name"] = new JSONValue(decoded->name);
-                msgPayload["description"] = new JSONValue(decoded->description);
-                msgPayload["expire"] = new JSONValue((unsigned int)decoded->expire);
-                msgPayload["locked_to"] = new JSONValue((unsigned int)decoded->locked_to);
-                msgPayload["latitude_i"] = new JSONValue((int)decoded->latitude_i);
-                msgPayload["longitude_i"] = new JSONValue((int)decoded->longitude_i);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
+        break;
+    }
+    case meshtastic_PortNum_WAYPOINT_APP: {
+        msgType = "waypoint";
+        meshtastic_Waypoint scratch;
+        meshtastic_Waypoint *decoded = NULL;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Waypoint_msg, &scratch)) {
+            decoded = &scratch;
+            json.key("payload");
+            json.beginObject();
+            json.member("description", (const char *)decoded->description);
+            json.member("expire", (unsigned int)decoded->expire);
+            json.member("id", (unsigned int)decoded->id);
+            json.member("latitude_i", (int)decoded->latitude_i);
+            json.member("locked_to", (unsigned int)decoded->locked_to);
+            json.member("longitude_i", (int)decoded->longitude_i);
+            json.member("name", (const char *)decoded->name);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
+        }
+        break;
+    }
+    case meshtastic_PortNum_NEIGHBORINFO_APP: {
+        msgType = "neighborinfo";
+        meshtastic_NeighborInfo scratch;
+        meshtastic_NeighborInfo *decoded = NULL;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_NeighborInfo_msg, &scratch)) {
+            decoded = &scratch;
+            json.key("payload");
+            json.beginObject();
+            json.member("last_sent_by_id", (unsigned int)decoded->last_sent_by_id);
+            json.key("neighbors");
+            json.beginArray();
+            for (uint8_t i = 0; i < decoded->neighbors_count; i++) {
+                json.beginObject();
+                json.member("node_id", (unsigned int)decoded->neighbors[i].node_id);
+                json.member("snr", (int)decoded->neighbors[i].snr);
+                json.endObject();
             }
-            break;
+            json.endArray();
+            json.member("neighbors_count", (int)decoded->neighbors_count);
+            json.member("node_broadcast_interval_secs", (unsigned int)decoded->node_broadcast_interval_secs);
+            json.member("node_id", (unsigned int)decoded->node_id);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_NEIGHBORINFO_APP: {
-            msgType = "neighborinfo";
-            meshtastic_NeighborInfo scratch;
-            meshtastic_NeighborInfo *decoded = NULL;
+        break;
+    }
+    case meshtastic_PortNum_TRACEROUTE_APP: {
+        if (mp->decoded.request_id) { // Only report the traceroute response
+            msgType = "traceroute";
+            meshtastic_RouteDiscovery scratch;
+            meshtastic_RouteDiscovery *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_NeighborInfo_msg,
+            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_RouteDiscovery_msg,
                                      &scratch)) {
                 decoded = &scratch;
-                msgPayload["node_id"] = new JSONValue((unsigned int)decoded->node_id);
-                msgPayload["node_broadcast_interval_secs"] = new JSONValue((unsigned int)decoded->node_broadcast_interval_secs);
-                msgPayload["last_sent_by_id"] = new JSONValue((unsigned int)decoded->last_sent_by_id);
-                msgPayload["neighbors_count"] = new JSONValue(decoded->neighbors_count);
-                JSONArray neighbors;
-                for (uint8_t i = 0; i < decoded->neighbors_count; i++) {
-                    JSONObject neighborObj;
-                    neighborObj["node_id"] = new JSONValue((unsigned int)decoded->neighbors[i].node_id);
-                    neighborObj["snr"] = new JSONValue((int)decoded->neighbors[i].snr);
-                    neighbors.push_back(new JSONValue(neighborObj));
-                }
-                msgPayload["neighbors"] = new JSONValue(neighbors);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
-        }
-        case meshtastic_PortNum_TRACEROUTE_APP: {
-            if (mp->decoded.request_id) { // Only report the traceroute response
-                msgType = "traceroute";
-                meshtastic_RouteDiscovery scratch;
-                meshtastic_RouteDiscovery *decoded = NULL;
-                memset(&scratch, 0, sizeof(scratch));
-                if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_RouteDiscovery_msg,
-                                         &scratch)) {
-                    decoded = &scratch;
-                    JSONArray route;      // Route this message took
-                    JSONArray routeBack;  // Route this message took back
-                    JSONArray snrTowards; // Snr for forward route
-                    JSONArray snrBack;    // Snr for reverse route
 
-                    // Lambda function for adding a long name to the route
-                    auto addToRoute = [](JSONArray *route, NodeNum num) {
-                        char long_name[40] = "Unknown";
-                        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(num);
-                        bool name_known = node ? node->has_user : false;
-                        if (name_known)
-                            memcpy(long_name, node->user.long_name, sizeof(long_name));
-                        route->push_back(new JSONValue(long_name));
-                    };
-                    addToRoute(&route, mp->to); // Started at the original transmitter (destination of response)
-                    for (uint8_t i = 0; i < decoded->route_count; i++) {
-                        addToRoute(&route, decoded->route[i]);
-                    }
-                    addToRoute(&route, mp->from); // Ended at the original destination (source of response)
+                // Lambda function for adding a long name to the route
+                auto addToRoute = [&json](NodeNum num) {
+                    char long_name[40] = "Unknown";
+                    meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(num);
+                    bool name_known = node ? node->has_user : false;
+                    if (name_known)
+                        memcpy(long_name, node->user.long_name, sizeof(long_name));
+                    json.value((const char *)long_name);
+                };
 
-                    addToRoute(&routeBack, mp->from); // Started at the original destination (source of response)
-                    for (uint8_t i = 0; i < decoded->route_back_count; i++) {
-                        addToRoute(&routeBack, decoded->route_back[i]);
-                    }
-                    addToRoute(&routeBack, mp->to); // Ended at the original transmitter (destination of response)
+                json.key("payload");
+                json.beginObject();
 
-                    for (uint8_t i = 0; i < decoded->snr_back_count; i++) {
-                        snrBack.push_back(new JSONValue((float)decoded->snr_back[i] / 4));
-                    }
+                // Route this message took
+                json.key("route");
+                json.beginArray();
+                addToRoute(mp->to); // Started at the original transmitter (destination of response)
+                for (uint8_t i = 0; i < decoded->route_count; i++) {
+                    addToRoute(decoded->route[i]);
+                }
+                addToRoute(mp->from); // Ended at the original destination (source of response)
+                json.endArray();
 
-                    for (uint8_t i = 0; i < decoded->snr_towards_count; i++) {
-                        snrTowards.push_back(new JSONValue((float)decoded->snr_towards[i] / 4));
-                    }
+                // Route this message took back
+                json.key("route_back");
+                json.beginArray();
+                addToRoute(mp->from); // Started at the original destination (source of response)
+                for (uint8_t i = 0; i < decoded->route_back_count; i++) {
+                    addToRoute(decoded->route_back[i]);
+                }
+                addToRoute(mp->to); // Ended at the original transmitter (destination of response)
+                json.endArray();
+
+                // Snr for reverse route
+                json.key("snr_back");
+                json.beginArray();
+                for (uint8_t i = 0; i < decoded->snr_back_count; i++) {
+                    json.value((float)decoded->snr_back[i] / 4);
+                }
+                json.endArray();
 
-                    msgPayload["route"] = new JSONValue(route);
-                    msgPayload["route_back"] = new JSONValue(routeBack);
-                    msgPayload["snr_back"] = new JSONValue(snrBack);
-                    msgPayload["snr_towards"] = new JSONValue(snrTowards);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
-                } else if (shouldLog) {
-                    LOG_ERROR(errStr, msgType.c_str());
+                // Snr for forward route
+                json.key("snr_towards");
+                json.beginArray();
+                for (uint8_t i = 0; i < decoded->snr_towards_count; i++) {
+                    json.value((float)decoded->snr_towards[i] / 4);
                 }
+                json.endArray();
+
+                json.endObject();
+            } else if (shouldLog) {
+                LOG_ERROR(errStr, msgType);
             }
-            break;
-        }
-        case meshtastic_PortNum_DETECTION_SENSOR_APP: {
-            msgType = "detection";
-            char payloadStr[(mp->decoded.payload.size) + 1];
-            memcpy(payloadStr, mp->decoded.payload.bytes, mp->decoded.payload.size);
-            payloadStr[mp->decoded.payload.size] = 0; // null terminated string
-            msgPayload["text"] = new JSONValue(payloadStr);
-            jsonObj["payload"] = new JSONValue(msgPayload);
-            break;
         }
+        break;
+    }
+    case meshtastic_PortNum_DETECTION_SENSOR_APP: {
+        msgType = "detection";
+        char payloadStr[(mp->decoded.payload.size) + 1];
+        memcpy(payloadStr, mp->decoded.payload.bytes, mp->decoded.payload.size);
+        payloadStr[mp->decoded.payload.size] = 0; // null terminated string
+        json.key("payload");
+        json.beginObject();
+        json.member("text", (const char *)payloadStr);
+        json.endObject();
+        break;
+    }
 #ifdef ARCH_ESP32
-        case meshtastic_PortNum_PAXCOUNTER_APP: {
-            msgType = "paxcounter";
-            meshtastic_Paxcount scratch;
-            meshtastic_Paxcount *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Paxcount_msg, &scratch)) {
-                decoded = &scratch;
-                msgPayload["wifi_count"] = new JSONValue((unsigned int)decoded->wifi);
-                msgPayload["ble_count"] = new JSONValue((unsigned int)decoded->ble);
-                msgPayload["uptime"] = new JSONValue((unsigned int)decoded->uptime);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
+    case meshtastic_PortNum_PAXCOUNTER_APP: {
+        msgType = "paxcounter";
+        meshtastic_Paxcount scratch;
+        meshtastic_Paxcount *decoded = NULL;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Paxcount_msg, &scratch)) {
+            decoded = &scratch;
+            json.key("payload");
+            json.beginObject();
+            json.member("ble_count", (unsigned int)decoded->ble);
+            json.member("uptime", (unsigned int)decoded->uptime);
+            json.member("wifi_count", (unsigned int)decoded->wifi);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
+        break;
+    }
 #endif
-        case meshtastic_PortNum_REMOTE_HARDWARE_APP: {
-            meshtastic_HardwareMessage scratch;
-            meshtastic_HardwareMessage *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_HardwareMessage_msg,
-                                     &scratch)) {
-                decoded = &scratch;
-                if (decoded->type == meshtastic_HardwareMessage_Type_GPIOS_CHANGED) {
-                    msgType = "gpios_changed";
-                    msgPayload["gpio_value"] = new JSONValue((unsigned int)decoded->gpio_value);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
-                } else if (decoded->type == meshtastic_HardwareMessage_Type_READ_GPIOS_REPLY) {
-                    msgType = "gpios_read_reply";
-                    msgPayload["gpio_value"] = new JSONValue((unsigned int)decoded->gpio_value);
-                    msgPayload["gpio_mask"] = new JSONValue((unsigned int)decoded->gpio_mask);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
-                }
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, "RemoteHardware");
+    case meshtastic_PortNum_REMOTE_HARDWARE_APP: {
+        meshtastic_HardwareMessage scratch;
+        meshtastic_HardwareMessage *decoded = NULL;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_HardwareMessage_msg,
+                                 &scratch)) {
+            decoded = &scratch;
+            if (decoded->type == meshtastic_HardwareMessage_Type_GPIOS_CHANGED) {
+                msgType = "gpios_changed";
+                json.key("payload");
+                json.beginObject();
+                json.member("gpio_value", (unsigned int)decoded->gpio_value);
+                json.endObject();
+            } else if (decoded->type == meshtastic_HardwareMessage_Type_READ_GPIOS_REPLY) {
+                msgType = "gpios_read_reply";
+                json.key("payload");
+                json.beginObject();
+                json.member("gpio_mask", (unsigned int)decoded->gpio_mask);
+                json.member("gpio_value", (unsigned int)decoded->gpio_value);
+                json.endObject();
             }
-            break;
-        }
-        // add more packet types here if needed
-        default:
-            break;
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, "RemoteHardware");
         }
+        break;
+    }
+    // add more packet types here if needed
+    default:
+        break;
+    }
+
+    return msgType;
+}
+
+void MeshPacketSerializer::writeJson(JsonWriter &json, const meshtastic_MeshPacket *mp, bool shouldLog)
+{
+    bool hasHops = mp->hop_start != 0 && mp->hop_limit <= mp->hop_start;
+    const char *msgType = "";
+
+    json.beginObject();
+    json.member("channel", (unsigned int)mp->channel);
+    json.member("from", (unsigned int)mp->from);
+    if (hasHops) {
+        json.member("hop_start", (unsigned int)(mp->hop_start));
+        json.member("hops_away", (unsigned int)(mp->hop_start - mp->hop_limit));
+    }
+    json.member("id", (unsigned int)mp->id);
+
+    if (mp->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
+        msgType = writePayload(json, mp, shouldLog);
     } else if (shouldLog) {
         LOG_WARN("Couldn't convert encrypted payload of MeshPacket to JSON");
     }
 
-    jsonObj["id"] = new JSONValue((unsigned int)mp->id);
-    jsonObj["timestamp"] = new JSONValue((unsigned int)mp->rx_time);
-    jsonObj["to"] = new JSONValue((unsigned int)mp->to);
-    jsonObj["from"] = new JSONValue((unsigned int)mp->from);
-    jsonObj["channel"] = new JSONValue((unsigned int)mp->channel);
-    jsonObj["type"] = new JSONValue(msgType.c_str());
-    jsonObj["sender"] = new JSONValue(owner.id);
     if (mp->rx_rssi != 0)
-        jsonObj["rssi"] = new JSONValue((int)mp->rx_rssi);
+        json.member("rssi", (int)mp->rx_rssi);
+    json.member("sender", (const char *)owner.id);
     if (mp->rx_snr != 0)
-        jsonObj["snr"] = new JSONValue((float)mp->rx_snr);
-    if (mp->hop_start != 0 && mp->hop_limit <= mp->hop_start) {
-        jsonObj["hops_away"] = new JSONValue((unsigned int)(mp->hop_start - mp->hop_limit));
-        jsonObj["hop_start"] = new JSONValue((unsigned int)(mp->hop_start));
-    }
+        json.member("snr", (float)mp->rx_snr);
+    json.member("timestamp", (unsigned int)mp->rx_time);
+    json.member("to", (unsigned int)mp->to);
+    json.member("type", msgType);
+    json.endObject();
+}
 
-    // serialize and write it to the stream
-    JSONValue *value = new JSONValue(jsonObj);
-    std::string jsonStr = value->Stringify();
+std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog)
+{
+    std::string jsonStr;
+    StringPrint out(jsonStr);
+    JsonWriter json(out);
+    writeJson(json, mp, shouldLog);
+    json.finish();
 
     if (shouldLog)
         LOG_INFO("serialized json message: %s", jsonStr.c_str());
 
-    delete value;
     return jsonStr;
 }
 
-std::string MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp)
+size_t MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, char *buf, size_t bufSize, bool shouldLog)
 {
-    JSONObject jsonObj;
+    JsonWriter json(buf, bufSize);
+    writeJson(json, mp, shouldLog);
+    if (json.overflowed()) {
+        if (shouldLog)
+            LOG_ERROR("JSON for packet id=0x%08x does not fit in %u bytes", mp->id, (unsigned int)bufSize);
+        buf[0] = 0;
+        return 0;
+    }
 
-    jsonObj["id"] = new JSONValue((unsigned int)mp->id);
-    jsonObj["time_ms"] = new JSONValue((double)millis());
-    jsonObj["timestamp"] = new JSONValue((unsigned int)mp->rx_time);
-    jsonObj["to"] = new JSONValue((unsigned int)mp->to);
-    jsonObj["from"] = new JSONValue((unsigned int)mp->from);
-    jsonObj["channel"] = new JSONValue((unsigned int)mp->channel);
-    jsonObj["want_ack"] = new JSONValue(mp->want_ack);
+    if (shouldLog)
+        LOG_INFO("serialized json message: %s", buf);
 
-    if (mp->rx_rssi != 0)
-        jsonObj["rssi"] = new JSONValue((int)mp->rx_rssi);
-    if (mp->rx_snr != 0)
-        jsonObj["snr"] = new JSONValue((float)mp->rx_snr);
+    return json.finish();
+}
+
+std::string MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp)
+{
+    std::string jsonStr;
+    StringPrint out(jsonStr);
+    JsonWriter json(out);
+
+    json.beginObject();
+    json.key("bytes");
+    json.value(bytesToHex(mp->encrypted.bytes, mp->encrypted.size).c_str());
+    json.member("channel", (unsigned int)mp->channel);
+    json.member("from", (unsigned int)mp->from);
     if (mp->hop_start != 0 && mp->hop_limit <= mp->hop_start) {
-        jsonObj["hops_away"] = new JSONValue((unsigned int)(mp->hop_start - mp->hop_limit));
-        jsonObj["hop_start"] = new JSONValue((unsigned int)(mp->hop_start));
+        json.member("hop_start", (unsigned int)(mp->hop_start));
+        json.member("hops_away", (unsigned int)(mp->hop_start - mp->hop_limit));
     }
-    jsonObj["size"] = new JSONValue((unsigned int)mp->encrypted.size);
-    auto encryptedStr = bytesToHex(mp->encrypted.bytes, mp->encrypted.size);
-    jsonObj["bytes"] = new JSONValue(encryptedStr.c_str());
-
-    // serialize and write it to the stream
-    JSONValue *value = new JSONValue(jsonObj);
-    std::string jsonStr = value->Stringify();
+    json.member("id", (unsigned int)mp->id);
+    if (mp->rx_rssi != 0)
+        json.member("rssi", (int)mp->rx_rssi);
+    json.member("size", (unsigned int)mp->encrypted.size);
+    if (mp->rx_snr != 0)
+        json.member("snr", (float)mp->rx_snr);
+    json.member("time_ms", (double)millis());
+    json.member("timestamp", (unsigned int)mp->rx_time);
+    json.member("to", (unsigned int)mp->to);
+    json.member("want_ack", mp->want_ack);
+    json.endObject();
+    json.finish();
 
-    delete value;
     return jsonStr;
 }
-#endif
\ No newline at end of file
+#endif
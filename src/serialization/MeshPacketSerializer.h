@@ -1,15 +1,27 @@
 #include <meshtastic/mesh.pb.h>
 #include <string>
 
+class JsonWriter;
+
 static const char hexChars[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
 
 class MeshPacketSerializer
 {
   public:
     static std::string JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog = true);
+
+    /**
+     * Serialize into buf without touching the heap
+     * @return the length of the JSON, 0 if it did not fit
+     */
+    static size_t JsonSerialize(const meshtastic_MeshPacket *mp, char *buf, size_t bufSize, bool shouldLog = true);
     static std::string JsonSerializeEncrypted(const meshtastic_MeshPacket *mp);
 
   private:
+#ifndef NRF52_USE_JSON
+    static void writeJson(JsonWriter &json, const meshtastic_MeshPacket *mp, bool shouldLog);
+#endif
+
     static std::string bytesToHex(const uint8_t *bytes, int len)
     {
         std::string result = "";
@@ -322,6 +322,17 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
     return jsonStr;
 }
 
+size_t MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, char *buf, size_t bufSize, bool shouldLog)
+{
+    std::string jsonStr = JsonSerialize(mp, shouldLog);
+    if (jsonStr.length() >= bufSize) {
+        buf[0] = 0;
+        return 0;
+    }
+    memcpy(buf, jsonStr.c_str(), jsonStr.length() + 1);
+    return jsonStr.length();
+}
+
 std::string MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp)
 {
     jsonObj.clear();
@@ -1,7 +1,9 @@
 // trunk-ignore-all(gitleaks): These are dummy values. Not real secrets.
 #include "CryptoEngine.h"
 
+#include "CTR.h"
 #include "TestUtil.h"
+#include <chrono>
 #include <unity.h>
 
 void HexToBytes(uint8_t *result, const std::string hex, size_t len = 0)
@@ -178,6 +180,150 @@ void test_AES_CTR(void)
     TEST_ASSERT_EQUAL_MEMORY(expected, plain, 16);
 }
 
+void test_PKC_shared_key_cache(void)
+{
+    uint8_t private_key[32];
+    uint8_t other_private_key[32];
+    meshtastic_UserLite_public_key_t public_key;
+    uint8_t expected_shared[32];
+    uint8_t radioBytes[128] __attribute__((__aligned__));
+    uint8_t decrypted[128] __attribute__((__aligned__));
+
+    uint32_t fromNode = 0x0929;
+    uint64_t packetNum = 0x13b2d662;
+    HexToBytes(public_key.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    public_key.size = 32;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    HexToBytes(other_private_key, "4852834d9d6b77dadeabaaf2e11dca66d19fe74993a7bec36c6e16a0983feaba");
+    HexToBytes(expected_shared, "777b1545c9d6f9a2");
+    HexToBytes(radioBytes, "8c646d7a2909000062d6b2136b00000040df24abfcc30a17a3d9046726099e796a1c036a792b");
+
+    crypto->setDHPrivateKey(private_key);
+    crypto->clearSharedKeyCache();
+    uint32_t hits = crypto->sharedKeyCacheHits, misses = crypto->sharedKeyCacheMisses;
+
+    // The first DM derives the secret, the next ones reuse it
+    TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_MEMORY(expected_shared, crypto->shared_key, 8);
+    TEST_ASSERT_EQUAL(misses + 1, crypto->sharedKeyCacheMisses);
+    TEST_ASSERT_EQUAL(hits + 1, crypto->sharedKeyCacheHits);
+
+    // Forgetting the node's key forces a fresh derivation
+    crypto->forgetSharedKey(public_key.bytes);
+    TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL(misses + 2, crypto->sharedKeyCacheMisses);
+
+    // Rotating our own key must not leave the old secret behind
+    crypto->setDHPrivateKey(other_private_key);
+    TEST_ASSERT_FALSE(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL(misses + 3, crypto->sharedKeyCacheMisses);
+    crypto->setDHPrivateKey(private_key);
+    TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_MEMORY(expected_shared, crypto->shared_key, 8);
+}
+
+void test_PKC_benchmark(void)
+{
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t public_key;
+    uint8_t radioBytes[128] __attribute__((__aligned__));
+    uint8_t decrypted[128] __attribute__((__aligned__));
+    const int dms = 200;
+
+    HexToBytes(public_key.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    public_key.size = 32;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    HexToBytes(radioBytes, "8c646d7a2909000062d6b2136b00000040df24abfcc30a17a3d9046726099e796a1c036a792b");
+    crypto->setDHPrivateKey(private_key);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < dms; i++) {
+        crypto->clearSharedKeyCache();
+        TEST_ASSERT(crypto->decryptCurve25519(0x0929, public_key, 0x13b2d662, 22, radioBytes + 16, decrypted));
+    }
+    auto uncached = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < dms; i++)
+        TEST_ASSERT(crypto->decryptCurve25519(0x0929, public_key, 0x13b2d662, 22, radioBytes + 16, decrypted));
+    auto cached = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("PKI DMs from one node: %.0f/s deriving the shared key each time, %.0f/s cached\n", dms / uncached, dms / cached);
+}
+
+// What encryptAESCtr used to do: build a fresh CTR cipher and run the key schedule for every packet
+static void referenceAESCtr(const CryptoKey &k, const uint8_t *nonce, size_t numBytes, uint8_t *bytes)
+{
+    CTRCommon *ctr;
+    if (k.length == 16)
+        ctr = new CTR<AES128>();
+    else
+        ctr = new CTR<AES256>();
+    ctr->setKey(k.bytes, k.length);
+    ctr->setIV(nonce, 16);
+    ctr->setCounterSize(4);
+    ctr->encrypt(bytes, bytes, numBytes);
+    delete ctr;
+}
+
+void test_AES_CTR_multiblock(void)
+{
+    CryptoKey keys[AES_KEY_CACHE_SIZE + 2];
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        keys[i].length = (i & 1) ? 16 : 32;
+        for (size_t j = 0; j < sizeof(keys[i].bytes); j++)
+            keys[i].bytes[j] = random(256);
+    }
+
+    // More keys than cache slots, every length up to a full packet, and nonces whose block counter wraps mid packet
+    for (int iter = 0; iter < 2000; iter++) {
+        const CryptoKey &k = keys[iter % (sizeof(keys) / sizeof(keys[0]))];
+        uint8_t nonce[16];
+        for (size_t j = 0; j < sizeof(nonce); j++)
+            nonce[j] = random(256);
+        if (iter % 5 == 0)
+            memset(nonce + 12, 0xff, 4);
+        size_t numBytes = iter % (MAX_BLOCKSIZE + 1);
+
+        uint8_t plain[MAX_BLOCKSIZE], expected[MAX_BLOCKSIZE];
+        for (size_t j = 0; j < numBytes; j++)
+            plain[j] = expected[j] = random(256);
+
+        referenceAESCtr(k, nonce, numBytes, expected);
+        crypto->encryptAESCtr(k, nonce, numBytes, plain);
+        TEST_ASSERT_EQUAL_MEMORY(expected, plain, numBytes);
+    }
+}
+
+void test_AES_CTR_benchmark(void)
+{
+    CryptoKey k;
+    k.length = 32;
+    for (size_t j = 0; j < sizeof(k.bytes); j++)
+        k.bytes[j] = j;
+    uint8_t nonce[16] = {0};
+    uint8_t packet[237] = {0}; // a full size LoRa payload
+    const int packets = 20000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < packets; i++) {
+        nonce[0] = i;
+        referenceAESCtr(k, nonce, sizeof(packet), packet);
+    }
+    auto before = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < packets; i++) {
+        nonce[0] = i;
+        crypto->encryptAESCtr(k, nonce, sizeof(packet), packet);
+    }
+    auto after = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("AES256-CTR %u byte packets: %.0f packets/s per packet key schedule, %.0f packets/s cached\n", (unsigned)sizeof(packet),
+           packets / before, packets / after);
+}
+
 void setup()
 {
     // NOTE!!! Wait for >2 secs
@@ -191,7 +337,11 @@ void setup()
     RUN_TEST(test_ECB_AES256);
     RUN_TEST(test_DH25519);
     RUN_TEST(test_AES_CTR);
+    RUN_TEST(test_AES_CTR_multiblock);
+    RUN_TEST(test_AES_CTR_benchmark);
     RUN_TEST(test_PKC);
+    RUN_TEST(test_PKC_shared_key_cache);
+    RUN_TEST(test_PKC_benchmark);
     exit(UNITY_END()); // stop unit testing
 }
 
@@ -0,0 +1,229 @@
+#include "Channels.h"
+#include "CryptoEngine.h"
+#include "MeshTypes.h"
+#include "NodeDB.h"
+#include "Router.h"
+#include "TestUtil.h"
+#include "mesh-pb-constants.h"
+#include <unity.h>
+
+#if ARCH_PORTDUINO
+#include "platform/portduino/DecodePipeline.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace
+{
+// perhapsDecode looks senders up in the NodeDB, a default one is all it needs
+class MockNodeDB : public NodeDB
+{
+};
+
+const uint32_t NUM_SENDERS = 16;
+
+// A primary channel on the default key and a secondary one on key #2, so packets hash to different channels
+void setupChannels()
+{
+    channels.initDefaults();
+    meshtastic_Channel &secondary = channels.getByIndex(1);
+    secondary.has_settings = true;
+    secondary.role = meshtastic_Channel_Role_SECONDARY;
+    strcpy(secondary.settings.name, "Second");
+    secondary.settings.psk.size = 1;
+    secondary.settings.psk.bytes[0] = 2;
+    channels.onConfigChanged();
+}
+
+// Encrypt a text message the same way perhapsEncode does for packets going out over the air
+meshtastic_MeshPacket *makeEncrypted(NodeNum from, PacketId id, ChannelIndex chIndex)
+{
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = from;
+    p->to = NODENUM_BROADCAST;
+    p->id = id;
+
+    meshtastic_Data data = meshtastic_Data_init_zero;
+    data.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    data.payload.size = snprintf((char *)data.payload.bytes, sizeof(data.payload.bytes), "message %u from 0x%x", id, from);
+
+    uint8_t plaintext[MAX_LORA_PAYLOAD_LEN + 1];
+    size_t numBytes = pb_encode_to_bytes(plaintext, sizeof(plaintext), &meshtastic_Data_msg, &data);
+    p->channel = channels.setActiveByIndex(chIndex);
+    crypto->encryptPacket(from, id, numBytes, plaintext);
+    memcpy(p->encrypted.bytes, plaintext, numBytes);
+    p->encrypted.size = numBytes;
+    p->which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    return p;
+}
+
+std::vector<meshtastic_MeshPacket *> makeStream(size_t count)
+{
+    std::vector<meshtastic_MeshPacket *> stream;
+    for (size_t i = 0; i < count; i++)
+        stream.push_back(makeEncrypted(0x1000 + i % NUM_SENDERS, i + 1, i % 3 == 0 ? 1 : 0));
+    return stream;
+}
+
+// Run a stream through the pipeline and check every packet comes back decoded, in the order it went in
+void checkPipeline(unsigned numWorkers, size_t count)
+{
+    DecodePipeline pipeline(numWorkers, 16);
+    std::vector<meshtastic_MeshPacket *> stream = makeStream(count);
+
+    size_t submitted = 0, taken = 0;
+    PrecomputedDecode result;
+    while (taken < count) {
+        while (submitted < count && pipeline.submit(stream[submitted]))
+            submitted++;
+        while (pipeline.takeCompleted(result)) {
+            TEST_ASSERT_EQUAL_PTR(stream[taken], result.packet);
+            TEST_ASSERT_TRUE(result.decoded);
+            TEST_ASSERT_EQUAL(taken % 3 == 0 ? 1 : 0, result.chIndex);
+            TEST_ASSERT_EQUAL(meshtastic_PortNum_TEXT_MESSAGE_APP, result.data.portnum);
+            TEST_ASSERT_EQUAL_UINT32(channels.getGeneration(), result.channelsGeneration);
+            packetPool.release((meshtastic_MeshPacket *)result.packet);
+            taken++;
+        }
+    }
+    TEST_ASSERT_FALSE(pipeline.busy());
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_singleWorker(void)
+{
+    checkPipeline(1, 200);
+}
+
+void test_orderPreservedAcrossWorkers(void)
+{
+    checkPipeline(4, 2000);
+}
+
+// A packet no channel key fits still comes back, undecoded, so the Router can log and drop it as before
+void test_wrongKeyComesBackUndecoded(void)
+{
+    DecodePipeline pipeline(2);
+    meshtastic_MeshPacket *p = makeEncrypted(0x1234, 42, 0);
+    p->encrypted.bytes[0] ^= 0xff;
+    TEST_ASSERT_TRUE(pipeline.submit(p));
+
+    PrecomputedDecode result;
+    while (!pipeline.takeCompleted(result))
+        ;
+    TEST_ASSERT_EQUAL_PTR(p, result.packet);
+    TEST_ASSERT_FALSE(result.decoded);
+    TEST_ASSERT_GREATER_THAN(0, result.attempts);
+    TEST_ASSERT_EQUAL(result.attempts, result.wasted);
+    packetPool.release(p);
+}
+
+// The channel remembered for a sender is tried first, and a packet it decodes counts as a hit like it does in perhapsDecode
+void test_hintTriedFirst(void)
+{
+    DecodePipeline pipeline(1);
+    meshtastic_MeshPacket *hinted = makeEncrypted(0x1234, 1, 1);
+    meshtastic_MeshPacket *unhinted = makeEncrypted(0x1234, 2, 1);
+    meshtastic_MeshPacket *wrongHint = makeEncrypted(0x1234, 3, 1);
+    TEST_ASSERT_TRUE(pipeline.submit(hinted, 1));
+    TEST_ASSERT_TRUE(pipeline.submit(unhinted));
+    TEST_ASSERT_TRUE(pipeline.submit(wrongHint, 0));
+
+    const bool expected[] = {true, false, false};
+    for (bool hit : expected) {
+        PrecomputedDecode result;
+        while (!pipeline.takeCompleted(result))
+            ;
+        TEST_ASSERT_TRUE(result.decoded);
+        TEST_ASSERT_EQUAL(1, result.chIndex);
+        TEST_ASSERT_EQUAL(hit, result.hintHit);
+        packetPool.release((meshtastic_MeshPacket *)result.packet);
+    }
+}
+
+void test_fullPipelineRejects(void)
+{
+    DecodePipeline pipeline(0, 4); // no workers, so nothing ever completes
+    std::vector<meshtastic_MeshPacket *> stream = makeStream(5);
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(pipeline.submit(stream[i]));
+    TEST_ASSERT_FALSE(pipeline.submit(stream[4]));
+    packetPool.release(stream[4]);
+
+    PrecomputedDecode result;
+    TEST_ASSERT_FALSE(pipeline.takeCompleted(result));
+    TEST_ASSERT_TRUE(pipeline.busy());
+    // The destructor hands the queued packets back to the pool
+}
+
+// Received packets per second through perhapsDecode on the main thread, versus the pipeline with more and more workers
+void test_benchmark(void)
+{
+    const size_t count = 20000;
+
+    std::vector<meshtastic_MeshPacket *> stream = makeStream(count);
+    auto start = std::chrono::steady_clock::now();
+    for (meshtastic_MeshPacket *p : stream) {
+        TEST_ASSERT_EQUAL(DecodeState::DECODE_SUCCESS, perhapsDecode(p));
+        packetPool.release(p);
+    }
+    double inlineSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("inline perhapsDecode: %.0f packets/s\n", count / inlineSecs);
+
+    for (unsigned numWorkers : {1, 2, 4}) {
+        DecodePipeline pipeline(numWorkers);
+        stream = makeStream(count);
+
+        start = std::chrono::steady_clock::now();
+        size_t submitted = 0, taken = 0;
+        PrecomputedDecode result;
+        while (taken < count) {
+            while (submitted < count && pipeline.submit(stream[submitted]))
+                submitted++;
+            while (pipeline.takeCompleted(result)) {
+                packetPool.release((meshtastic_MeshPacket *)result.packet);
+                taken++;
+            }
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("pipeline, %u workers: %.0f packets/s\n", numWorkers, count / secs);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    const std::unique_ptr<MockNodeDB> mockNodeDB(new MockNodeDB());
+    nodeDB = mockNodeDB.get();
+    setupChannels();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_singleWorker);
+    RUN_TEST(test_orderPreservedAcrossWorkers);
+    RUN_TEST(test_wrongKeyComesBackUndecoded);
+    RUN_TEST(test_hintTriedFirst);
+    RUN_TEST(test_fullPipelineRejects);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
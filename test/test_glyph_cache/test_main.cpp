@@ -0,0 +1,206 @@
+#include "TestUtil.h"
+#include "graphics/GlyphCache.h"
+#include "graphics/fonts/OLEDDisplayFontsRU.h"
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+const uint8_t *font = ArialMT_Plain_10_RU; // Same layout as the library's fonts, and in the tree
+
+// A 128x64 OLEDDisplay buffer, with its drawInternal and drawString (white, left aligned) as the reference
+struct Screen {
+    static const int16_t WIDTH = 128, HEIGHT = 64;
+    uint8_t buffer[WIDTH * HEIGHT / 8];
+
+    Screen() { memset(buffer, 0, sizeof(buffer)); }
+
+    void drawInternal(int16_t xMove, int16_t yMove, int16_t width, int16_t height, const uint8_t *data, uint16_t offset,
+                      uint16_t bytesInData)
+    {
+        if (yMove + height < 0 || yMove > HEIGHT || xMove + width < 0 || xMove > WIDTH)
+            return;
+        uint8_t rasterHeight = 1 + ((height - 1) >> 3);
+        int8_t yOffset = yMove & 7;
+        bytesInData = bytesInData == 0 ? width * rasterHeight : bytesInData;
+
+        for (uint16_t i = 0; i < bytesInData; i++) {
+            uint8_t currentByte = data[offset + i];
+            int16_t xPos = xMove + (i / rasterHeight);
+            int16_t dataPos = xPos + ((yMove >> 3) + (i % rasterHeight)) * WIDTH;
+            if (dataPos >= 0 && dataPos < (int16_t)sizeof(buffer) && xPos >= 0 && xPos < WIDTH) {
+                buffer[dataPos] |= currentByte << yOffset;
+                if (yOffset && dataPos < (int16_t)sizeof(buffer) - WIDTH)
+                    buffer[dataPos + WIDTH] |= currentByte >> (8 - yOffset);
+            }
+        }
+    }
+
+    // OLEDDisplay::drawString, for a const char *: a String is made, strdup'd and split into lines, and each line is measured
+    // (for alignment) then drawn one glyph at a time, every character passing through the font table lookup
+    void drawString(int16_t x, int16_t y, const char *text)
+    {
+        std::string str(text);
+        char *copy = strdup(str.c_str());
+        for (char *line = strtok(copy, "\n"); line; line = strtok(nullptr, "\n"), y += font[1]) {
+            uint16_t length = strlen(line);
+            textWidth = getStringWidth(line, length);
+            drawStringInternal(x, y, line, length);
+        }
+        free(copy);
+    }
+
+    uint16_t textWidth;
+    char (*lookup)(const uint8_t) = fontTableLookup;
+
+    static char fontTableLookup(const uint8_t ch) { return ch; } // Screen::customFontTableLookup, for ASCII
+
+    uint16_t getStringWidth(const char *text, uint16_t length)
+    {
+        uint16_t width = 0;
+        for (uint16_t i = 0; i < length; i++) {
+            uint8_t code = lookup(text[i]);
+            if (code)
+                width += font[4 + (code - font[2]) * 4 + 3];
+        }
+        return width;
+    }
+
+    void drawStringInternal(int16_t x, int16_t y, const char *text, uint16_t length)
+    {
+        uint8_t height = font[1], firstChar = font[2];
+        uint16_t jumpTable = font[3] * 4;
+        for (uint16_t i = 0; i < length; i++) {
+            uint8_t code = lookup(text[i]);
+            if (code < firstChar)
+                continue;
+            const uint8_t *jump = font + 4 + (code - firstChar) * 4;
+            if (!(jump[0] == 255 && jump[1] == 255))
+                drawInternal(x, y, jump[3], height, font, 4 + jumpTable + ((jump[0] << 8) + jump[1]), jump[2]);
+            x += jump[3];
+        }
+    }
+
+    // What Screen's drawCachedString does instead, with a drawFastImage for each run
+    void blit(int16_t x, int16_t y, const GlyphCache::Bitmap &b)
+    {
+        for (size_t i = 0; i < b.numRuns; i++) {
+            const GlyphCache::Run &r = b.runs[i];
+            drawInternal(x + r.left, y, r.width, b.height, b.column(r.left), 0, 0);
+        }
+    }
+};
+
+// Node list fields, as drawNodeInfo draws them every tick
+const char *fields[] = {"Meshtastic 1a2b", "5 minutes ago", "Signal: 85%", "1.2km   270"};
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+// Blitting a cached string must set the same pixels as drawing it glyph by glyph, wherever it is drawn
+void test_cachedMatchesDrawString(void)
+{
+    GlyphCache cache(4096);
+    const int16_t positions[][2] = {{0, 0}, {3, 5}, {-7, 13}, {100, 59}, {20, -4}};
+
+    for (const char *text : fields) {
+        for (auto &p : positions) {
+            Screen expected, actual;
+            expected.drawString(p[0], p[1], text);
+
+            GlyphCache::Bitmap b;
+            TEST_ASSERT_TRUE(cache.get(font, text, b));
+            actual.blit(p[0], p[1], b);
+            TEST_ASSERT_EQUAL_MEMORY(expected.buffer, actual.buffer, sizeof(expected.buffer));
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, cache.numMisses());
+}
+
+// Anything drawString treats specially is left to it
+void test_uncacheableText(void)
+{
+    GlyphCache cache(4096);
+    GlyphCache::Bitmap b;
+    TEST_ASSERT_FALSE(cache.get(font, "", b));
+    TEST_ASSERT_FALSE(cache.get(font, "two\nlines", b));
+    TEST_ASSERT_FALSE(cache.get(font, "1.2km 270\xC2\xB0", b)); // UTF-8
+    TEST_ASSERT_EQUAL_UINT32(0, cache.numBytes());
+}
+
+void test_leastRecentlyUsedEvicted(void)
+{
+    GlyphCache::Bitmap b;
+    GlyphCache sizer(4096);
+    sizer.get(font, "AAAA", b);
+    size_t each = sizer.numBytes(); // Same for BBBB and so on: one run, and the same width
+    GlyphCache cache(each * 3);
+
+    cache.get(font, "AAAA", b);
+    cache.get(font, "BBBB", b);
+    cache.get(font, "CCCC", b);
+    cache.get(font, "AAAA", b); // Now BBBB is the oldest
+    cache.get(font, "DDDD", b);
+    TEST_ASSERT_LESS_OR_EQUAL(each * 3, cache.numBytes());
+
+    uint32_t misses = cache.numMisses();
+    cache.get(font, "AAAA", b);
+    cache.get(font, "DDDD", b);
+    TEST_ASSERT_EQUAL_UINT32(misses, cache.numMisses());
+    cache.get(font, "BBBB", b);
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, cache.numMisses());
+}
+
+// Not a pass/fail test, prints what drawing the node list costs, glyph by glyph and from the cache
+void test_benchmark(void)
+{
+    const int TICKS = 20000;
+    Screen screen;
+    GlyphCache cache(2048);
+
+    for (int mode = 0; mode < 2; mode++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < TICKS; tick++) {
+            memset(screen.buffer, 0, sizeof(screen.buffer));
+            for (int i = 0; i < 4; i++) {
+                int16_t y = i * 13;
+                if (mode == 0) {
+                    screen.drawString(0, y, fields[i]);
+                } else {
+                    GlyphCache::Bitmap b;
+                    cache.get(font, fields[i], b);
+                    screen.blit(0, y, b);
+                }
+            }
+        }
+        double usec = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        printf("%-16s %5.2f us/tick\n", mode ? "cached" : "glyph by glyph", usec / TICKS);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_cachedMatchesDrawString);
+    RUN_TEST(test_uncacheableText);
+    RUN_TEST(test_leastRecentlyUsedEvicted);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
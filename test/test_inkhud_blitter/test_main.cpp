@@ -0,0 +1,219 @@
+#include "TestUtil.h"
+#include "graphics/niche/InkHUD/Blitter.h"
+#include <unity.h>
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+using namespace NicheGraphics::InkHUD;
+
+namespace
+{
+// A 2.13" panel, as the driver sees it. Width not a multiple of 8, so rows are padded
+const uint16_t DISPLAY_WIDTH = 122;
+const uint16_t DISPLAY_HEIGHT = 250;
+const uint16_t ROW_BYTES = (DISPLAY_WIDTH + 7) / 8;
+
+bool pixelAt(const std::vector<uint8_t> &buffer, uint16_t x, uint16_t y)
+{
+    return buffer[y * ROW_BYTES + x / 8] & (0x80 >> (x % 8));
+}
+
+// Mimics what AdafruitGFX hands an applet for one line of text: glyph rows, which Applet::writePixel joins into runs
+// A made-up 5x8 font, each character's bits taken from its code
+template <typename DrawRun> void drawText(int16_t x, int16_t y, const char *text, DrawRun drawRun)
+{
+    for (const char *c = text; *c; c++, x += 6) {
+        for (int16_t row = 0; row < 8; row++) {
+            uint8_t bits = (uint8_t)(*c * (row + 3)) >> 3;
+            int16_t runStart = -1;
+            for (int16_t col = 0; col <= 5; col++) {
+                bool set = col < 5 && (bits & (0x10 >> col));
+                if (set && runStart < 0)
+                    runStart = col;
+                if (!set && runStart >= 0) {
+                    drawRun(x + runStart, y + row, col - runStart);
+                    runStart = -1;
+                }
+            }
+        }
+    }
+}
+
+// One applet of a four tile layout: header, divider, a few lines of text and a signal bar
+template <typename DrawRun, typename FillRect>
+void drawApplet(const Region &tile, int frame, DrawRun drawRun, FillRect fillRect)
+{
+    char line[32];
+    snprintf(line, sizeof(line), "NODE %04d", frame % 10000);
+    drawText(tile.left + 2, tile.top + 1, line, drawRun);
+    fillRect(tile.left, tile.top + 10, tile.width, 1); // Header divider
+    for (int i = 0; i < 4; i++) {
+        snprintf(line, sizeof(line), "MSG %d: HELLO %d", i, frame + i);
+        drawText(tile.left + 2, tile.top + 14 + i * 10, line, drawRun);
+    }
+    fillRect(tile.left + 2, tile.top + tile.height - 8, (frame * 7) % (tile.width - 4) + 1, 6); // Signal bar
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_regionArithmetic(void)
+{
+    Region a(0, 0, 10, 10);
+    Region b(5, 8, 10, 10);
+    TEST_ASSERT_TRUE(a.intersects(b));
+    TEST_ASSERT_TRUE(a.intersection(b) == Region(5, 8, 5, 2));
+    TEST_ASSERT_FALSE(a.intersects(Region(10, 0, 5, 5))); // Touching edges don't overlap
+
+    Region u;
+    u.add(a);
+    u.add(b);
+    TEST_ASSERT_TRUE(u == Region(0, 0, 15, 18));
+    u.add(Region()); // Empty changes nothing
+    TEST_ASSERT_TRUE(u == Region(0, 0, 15, 18));
+}
+
+// Filling a rectangle must give the same image as setting its pixels one at a time, in every rotation
+void test_fillRectMatchesPixels(void)
+{
+    std::mt19937 rng(5);
+    std::vector<uint8_t> spans(ROW_BYTES * DISPLAY_HEIGHT), pixels(ROW_BYTES * DISPLAY_HEIGHT);
+    Blitter bySpans, byPixels;
+    bySpans.setBuffer(spans.data(), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    byPixels.setBuffer(pixels.data(), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    for (uint8_t rotation = 0; rotation < 4; rotation++) {
+        bySpans.setRotation(rotation);
+        byPixels.setRotation(rotation);
+        bySpans.fill(true);
+        byPixels.fill(true);
+
+        for (int i = 0; i < 200; i++) {
+            // Some partly off-display
+            int16_t x = (int16_t)(rng() % (bySpans.width() + 20)) - 10;
+            int16_t y = (int16_t)(rng() % (bySpans.height() + 20)) - 10;
+            int16_t w = rng() % 40 + 1;
+            int16_t h = rng() % 20 + 1;
+            bool white = rng() & 1;
+
+            bySpans.fillRect(x, y, w, h, white);
+            for (int16_t py = y; py < y + h; py++)
+                for (int16_t px = x; px < x + w; px++)
+                    byPixels.setPixel(px, py, white);
+        }
+        TEST_ASSERT_EQUAL_MEMORY(pixels.data(), spans.data(), spans.size());
+        TEST_ASSERT_EQUAL_UINT32(byPixels.pixelsTouched, bySpans.pixelsTouched);
+    }
+}
+
+// The region passed to the driver must cover exactly the pixels drawn
+void test_toDisplayCoversDrawnPixels(void)
+{
+    std::vector<uint8_t> buffer(ROW_BYTES * DISPLAY_HEIGHT);
+    Blitter blitter;
+    blitter.setBuffer(buffer.data(), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    Region r(20, 30, 17, 9);
+
+    for (uint8_t rotation = 0; rotation < 4; rotation++) {
+        blitter.setRotation(rotation);
+        blitter.fill(true);
+        blitter.fillRect(r, false);
+        Region d = blitter.toDisplay(r);
+
+        uint32_t black = 0;
+        for (uint16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+            for (uint16_t x = 0; x < DISPLAY_WIDTH; x++) {
+                bool inside = x >= d.left && x < d.left + d.width && y >= d.top && y < d.top + d.height;
+                TEST_ASSERT_EQUAL(inside, !pixelAt(buffer, x, y));
+                black += inside;
+            }
+        }
+        TEST_ASSERT_EQUAL_UINT32(17 * 9, black);
+    }
+}
+
+// Not a pass/fail test, prints what redrawing a four tile layout costs
+// Before: clear the buffer, then redraw every tile pixel by pixel. After: blank and redraw only the tile which changed, by spans
+void test_benchmark(void)
+{
+    const int FRAMES = 2000;
+    std::vector<uint8_t> buffer(ROW_BYTES * DISPLAY_HEIGHT);
+    Blitter blitter;
+    blitter.setBuffer(buffer.data(), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    blitter.setRotation(1); // Landscape, so every row of a tile is a column of the buffer
+
+    // Four tiles, as Tile::setRegion would place them
+    const uint16_t spacing = 4;
+    uint16_t w = (blitter.width() / 2) - (spacing / 2), h = (blitter.height() / 2) - (spacing / 2);
+    Region tiles[4] = {Region(0, 0, w, h), Region(w - 1 + spacing, 0, w, h), Region(0, h - 1 + spacing, w, h),
+                       Region(w - 1 + spacing, h - 1 + spacing, w, h)};
+
+    // Drawing output reaches the renderer through calls which can't be inlined (Applet::drawPixel is virtual)
+    // Before, that was once per pixel. Now it is once per run or rectangle
+    std::function<void(int16_t, int16_t)> sendPixel = [&](int16_t x, int16_t y) { blitter.setPixel(x, y, false); };
+    std::function<void(int16_t, int16_t, int16_t, int16_t)> sendRect = [&](int16_t x, int16_t y, int16_t rw, int16_t rh) {
+        blitter.fillRect(x, y, rw, rh, false);
+    };
+
+    auto perPixelRun = [&](int16_t x, int16_t y, int16_t len) {
+        for (int16_t i = 0; i < len; i++)
+            sendPixel(x + i, y);
+    };
+    auto perPixelRect = [&](int16_t x, int16_t y, int16_t rw, int16_t rh) {
+        for (int16_t py = y; py < y + rh; py++)
+            perPixelRun(x, py, rw);
+    };
+    auto spanRun = [&](int16_t x, int16_t y, int16_t len) { sendRect(x, y, len, 1); };
+    auto spanRect = [&](int16_t x, int16_t y, int16_t rw, int16_t rh) { sendRect(x, y, rw, rh); };
+
+    for (int mode = 0; mode < 3; mode++) {
+        blitter.pixelsTouched = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < FRAMES; frame++) {
+            if (mode == 0) {
+                blitter.fill(true);
+                for (const Region &t : tiles)
+                    drawApplet(t, frame, perPixelRun, perPixelRect);
+            } else if (mode == 1) {
+                blitter.fill(true);
+                for (const Region &t : tiles)
+                    drawApplet(t, frame, spanRun, spanRect);
+            } else {
+                const Region &t = tiles[frame % 4]; // One applet asked to update
+                blitter.fillRect(t, true);
+                drawApplet(t, frame, spanRun, spanRect);
+            }
+        }
+        double usec = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        const char *names[] = {"all tiles, per pixel", "all tiles, spans", "one tile, spans"};
+        printf("%-22s %7.1f us/frame, %6u px touched/frame\n", names[mode], usec / FRAMES,
+               (unsigned)(blitter.pixelsTouched / FRAMES));
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_regionArithmetic);
+    RUN_TEST(test_fillRectMatchesPixels);
+    RUN_TEST(test_toDisplayCoversDrawnPixels);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,435 @@
+#include "NodeDB.h"
+#include "TestUtil.h"
+#include "mesh-pb-constants.h"
+#include "serialization/JSON.h"
+#include "serialization/JsonWriter.h"
+#include "serialization/MeshPacketSerializer.h"
+#include <unity.h>
+
+#include <chrono>
+#include <memory>
+#include <new>
+#include <string.h>
+#include <string>
+
+// Count heap allocations, so the benchmark can report them per packet
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+class MockNodeDB : public NodeDB
+{
+};
+
+// Collects what JsonWriter sends to a Print sink
+class StringSink : public Print
+{
+  public:
+    std::string str;
+    size_t writes = 0;
+    size_t write(uint8_t c) override
+    {
+        str += (char)c;
+        writes++;
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        str.append((const char *)buffer, size);
+        writes++;
+        return size;
+    }
+};
+
+std::string stringify(JSONValue *value)
+{
+    std::string s = value->Stringify();
+    delete value;
+    return s;
+}
+
+meshtastic_MeshPacket makePacket(meshtastic_PortNum port, const pb_msgdesc_t *fields, const void *payload)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x12345678;
+    p.to = 0xffffffff;
+    p.id = 0xdeadbeef;
+    p.channel = 1;
+    p.rx_time = 1700000000;
+    p.rx_rssi = -97;
+    p.rx_snr = 6.25;
+    p.hop_start = 3;
+    p.hop_limit = 1;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = port;
+    p.decoded.payload.size =
+        pb_encode_to_bytes(p.decoded.payload.bytes, sizeof(p.decoded.payload.bytes), fields, payload);
+    return p;
+}
+
+meshtastic_MeshPacket makeText(const char *text)
+{
+    meshtastic_MeshPacket p = makePacket(meshtastic_PortNum_TEXT_MESSAGE_APP, &meshtastic_Data_msg, NULL);
+    p.decoded.payload.size = strlen(text);
+    memcpy(p.decoded.payload.bytes, text, p.decoded.payload.size);
+    return p;
+}
+
+// The envelope as the JSONObject based serializer built it
+void addEnvelope(JSONObject &jsonObj, const meshtastic_MeshPacket &mp, const char *msgType)
+{
+    jsonObj["id"] = new JSONValue((unsigned int)mp.id);
+    jsonObj["timestamp"] = new JSONValue((unsigned int)mp.rx_time);
+    jsonObj["to"] = new JSONValue((unsigned int)mp.to);
+    jsonObj["from"] = new JSONValue((unsigned int)mp.from);
+    jsonObj["channel"] = new JSONValue((unsigned int)mp.channel);
+    jsonObj["type"] = new JSONValue(msgType);
+    jsonObj["sender"] = new JSONValue(owner.id);
+    if (mp.rx_rssi != 0)
+        jsonObj["rssi"] = new JSONValue((int)mp.rx_rssi);
+    if (mp.rx_snr != 0)
+        jsonObj["snr"] = new JSONValue((float)mp.rx_snr);
+    if (mp.hop_start != 0 && mp.hop_limit <= mp.hop_start) {
+        jsonObj["hops_away"] = new JSONValue((unsigned int)(mp.hop_start - mp.hop_limit));
+        jsonObj["hop_start"] = new JSONValue((unsigned int)(mp.hop_start));
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_escapingMatchesJSONValue(void)
+{
+    const char *strings[] = {"plain", "quote\" back\\slash /slash", "\b\f\n\r\t", "\x01\x1f\x7f", ""};
+    for (const char *s : strings) {
+        char buf[128];
+        JsonWriter json(buf, sizeof(buf));
+        json.value(s);
+        json.finish();
+        TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(s)).c_str(), buf);
+    }
+}
+
+// Where char is signed JSONValue escapes UTF-8 as \uffff-style garbage, we pass it through untouched
+void test_utf8PassedThrough(void)
+{
+    const char *s = "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x93\xa1";
+    char buf[64];
+    JsonWriter json(buf, sizeof(buf));
+    json.value(s);
+    json.finish();
+    std::string expected = std::string("\"") + s + "\"";
+    TEST_ASSERT_EQUAL(expected.size(), strlen(buf));
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), buf, expected.size());
+}
+
+void test_numbersMatchJSONValue(void)
+{
+    const double doubles[] = {0, -0.5, 3.7f, 1e-7, 123456789.125, 1e20, -273.15, 6.25f / 4};
+    for (double d : doubles) {
+        char buf[64];
+        JsonWriter json(buf, sizeof(buf));
+        json.value(d);
+        json.finish();
+        TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(d)).c_str(), buf);
+    }
+
+    const unsigned int uints[] = {0, 1, 0x7fffffff, 0xdeadbeef, 0xffffffff};
+    for (unsigned int u : uints) {
+        char buf[64];
+        JsonWriter json(buf, sizeof(buf));
+        json.value(u);
+        json.finish();
+        TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(u)).c_str(), buf);
+    }
+
+    const int ints[] = {0, -1, -97, 2147483647, -2147483647 - 1};
+    for (int i : ints) {
+        char buf[64];
+        JsonWriter json(buf, sizeof(buf));
+        json.value(i);
+        json.finish();
+        TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(i)).c_str(), buf);
+    }
+}
+
+void test_nesting(void)
+{
+    char buf[128];
+    JsonWriter json(buf, sizeof(buf));
+    json.beginObject();
+    json.key("a");
+    json.beginArray();
+    json.value(1);
+    json.beginObject();
+    json.endObject();
+    json.beginArray();
+    json.endArray();
+    json.valueNull();
+    json.endArray();
+    json.member("b", true);
+    json.endObject();
+    TEST_ASSERT_EQUAL(strlen(buf), json.finish());
+    TEST_ASSERT_EQUAL_STRING("{\"a\":[1,{},[],null],\"b\":true}", buf);
+}
+
+void test_bufferOverflow(void)
+{
+    char buf[8];
+    JsonWriter json(buf, sizeof(buf));
+    json.value("0123456789");
+    TEST_ASSERT_TRUE(json.overflowed());
+    TEST_ASSERT_EQUAL(7, strlen(buf)); // truncated, but still terminated
+}
+
+// Output larger than the staging chunk reaches the Print sink whole, in a few writes
+void test_printSink(void)
+{
+    std::string longText(500, 'x');
+    StringSink sink;
+    JsonWriter json(sink);
+    json.beginObject();
+    json.member("text", longText.c_str());
+    json.endObject();
+    TEST_ASSERT_EQUAL(longText.length() + 11, json.finish());
+    TEST_ASSERT_EQUAL_STRING(("{\"text\":\"" + longText + "\"}").c_str(), sink.str.c_str());
+    TEST_ASSERT_TRUE(sink.writes < 20);
+}
+
+void test_textPacket(void)
+{
+    meshtastic_MeshPacket mp = makeText("Hello \"mesh\"\n");
+    JSONObject payload, jsonObj;
+    payload["text"] = new JSONValue("Hello \"mesh\"\n");
+    jsonObj["payload"] = new JSONValue(payload);
+    addEnvelope(jsonObj, mp, "text");
+    TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(jsonObj)).c_str(), MeshPacketSerializer::JsonSerialize(&mp, false).c_str());
+
+    // Text that is itself JSON is embedded as is
+    mp = makeText("{\"b\": [1, 2.5, \"x\"], \"a\": null}");
+    jsonObj.clear();
+    jsonObj["payload"] = JSON::Parse("{\"b\": [1, 2.5, \"x\"], \"a\": null}");
+    addEnvelope(jsonObj, mp, "text");
+    TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(jsonObj)).c_str(), MeshPacketSerializer::JsonSerialize(&mp, false).c_str());
+}
+
+void test_telemetryPacket(void)
+{
+    meshtastic_Telemetry t = meshtastic_Telemetry_init_zero;
+    t.which_variant = meshtastic_Telemetry_environment_metrics_tag;
+    t.variant.environment_metrics.temperature = 21.3f;
+    t.variant.environment_metrics.relative_humidity = 45.5f;
+    t.variant.environment_metrics.barometric_pressure = 1013.25f;
+    t.variant.environment_metrics.iaq = 50;
+    t.variant.environment_metrics.wind_direction = 270;
+    meshtastic_MeshPacket mp = makePacket(meshtastic_PortNum_TELEMETRY_APP, &meshtastic_Telemetry_msg, &t);
+
+    const meshtastic_EnvironmentMetrics &m = t.variant.environment_metrics;
+    JSONObject payload, jsonObj;
+    payload["temperature"] = new JSONValue(m.temperature);
+    payload["relative_humidity"] = new JSONValue(m.relative_humidity);
+    payload["barometric_pressure"] = new JSONValue(m.barometric_pressure);
+    payload["gas_resistance"] = new JSONValue(m.gas_resistance);
+    payload["voltage"] = new JSONValue(m.voltage);
+    payload["current"] = new JSONValue(m.current);
+    payload["lux"] = new JSONValue(m.lux);
+    payload["white_lux"] = new JSONValue(m.white_lux);
+    payload["iaq"] = new JSONValue((uint)m.iaq);
+    payload["wind_speed"] = new JSONValue(m.wind_speed);
+    payload["wind_direction"] = new JSONValue((uint)m.wind_direction);
+    payload["wind_gust"] = new JSONValue(m.wind_gust);
+    payload["wind_lull"] = new JSONValue(m.wind_lull);
+    payload["radiation"] = new JSONValue(m.radiation);
+    jsonObj["payload"] = new JSONValue(payload);
+    addEnvelope(jsonObj, mp, "telemetry");
+    TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(jsonObj)).c_str(), MeshPacketSerializer::JsonSerialize(&mp, false).c_str());
+
+    t.which_variant = meshtastic_Telemetry_air_quality_metrics_tag;
+    t.variant.air_quality_metrics.pm10_standard = 10;
+    t.variant.air_quality_metrics.pm25_standard = 25;
+    t.variant.air_quality_metrics.pm100_standard = 100;
+    t.variant.air_quality_metrics.pm10_environmental = 11;
+    t.variant.air_quality_metrics.pm25_environmental = 26;
+    t.variant.air_quality_metrics.pm100_environmental = 101;
+    mp = makePacket(meshtastic_PortNum_TELEMETRY_APP, &meshtastic_Telemetry_msg, &t);
+    const meshtastic_AirQualityMetrics &q = t.variant.air_quality_metrics;
+    payload.clear();
+    jsonObj.clear();
+    payload["pm10"] = new JSONValue((unsigned int)q.pm10_standard);
+    payload["pm25"] = new JSONValue((unsigned int)q.pm25_standard);
+    payload["pm100"] = new JSONValue((unsigned int)q.pm100_standard);
+    payload["pm10_e"] = new JSONValue((unsigned int)q.pm10_environmental);
+    payload["pm25_e"] = new JSONValue((unsigned int)q.pm25_environmental);
+    payload["pm100_e"] = new JSONValue((unsigned int)q.pm100_environmental);
+    jsonObj["payload"] = new JSONValue(payload);
+    addEnvelope(jsonObj, mp, "telemetry");
+    TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(jsonObj)).c_str(), MeshPacketSerializer::JsonSerialize(&mp, false).c_str());
+}
+
+void test_positionPacket(void)
+{
+    meshtastic_Position pos = meshtastic_Position_init_zero;
+    pos.latitude_i = 525200000;
+    pos.longitude_i = 134050000;
+    pos.altitude = 34;
+    pos.time = 1700000000;
+    pos.sats_in_view = 9;
+    pos.PDOP = 120;
+    pos.HDOP = 80;
+    pos.precision_bits = 32;
+    meshtastic_MeshPacket mp = makePacket(meshtastic_PortNum_POSITION_APP, &meshtastic_Position_msg, &pos);
+
+    JSONObject payload, jsonObj;
+    payload["time"] = new JSONValue((unsigned int)pos.time);
+    payload["latitude_i"] = new JSONValue((int)pos.latitude_i);
+    payload["longitude_i"] = new JSONValue((int)pos.longitude_i);
+    payload["altitude"] = new JSONValue((int)pos.altitude);
+    payload["sats_in_view"] = new JSONValue((unsigned int)pos.sats_in_view);
+    payload["PDOP"] = new JSONValue((int)pos.PDOP);
+    payload["HDOP"] = new JSONValue((int)pos.HDOP);
+    payload["precision_bits"] = new JSONValue((int)pos.precision_bits);
+    jsonObj["payload"] = new JSONValue(payload);
+    addEnvelope(jsonObj, mp, "position");
+    TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(jsonObj)).c_str(), MeshPacketSerializer::JsonSerialize(&mp, false).c_str());
+}
+
+void test_neighborInfoPacket(void)
+{
+    meshtastic_NeighborInfo ni = meshtastic_NeighborInfo_init_zero;
+    ni.node_id = 0x12345678;
+    ni.last_sent_by_id = 0x87654321;
+    ni.node_broadcast_interval_secs = 900;
+    ni.neighbors_count = 2;
+    ni.neighbors[0].node_id = 0x11111111;
+    ni.neighbors[0].snr = 7.5;
+    ni.neighbors[1].node_id = 0x22222222;
+    ni.neighbors[1].snr = -3;
+    meshtastic_MeshPacket mp = makePacket(meshtastic_PortNum_NEIGHBORINFO_APP, &meshtastic_NeighborInfo_msg, &ni);
+
+    JSONObject payload, jsonObj;
+    payload["node_id"] = new JSONValue((unsigned int)ni.node_id);
+    payload["node_broadcast_interval_secs"] = new JSONValue((unsigned int)ni.node_broadcast_interval_secs);
+    payload["last_sent_by_id"] = new JSONValue((unsigned int)ni.last_sent_by_id);
+    payload["neighbors_count"] = new JSONValue(ni.neighbors_count);
+    JSONArray neighbors;
+    for (uint8_t i = 0; i < ni.neighbors_count; i++) {
+        JSONObject neighborObj;
+        neighborObj["node_id"] = new JSONValue((unsigned int)ni.neighbors[i].node_id);
+        neighborObj["snr"] = new JSONValue((int)ni.neighbors[i].snr);
+        neighbors.push_back(new JSONValue(neighborObj));
+    }
+    payload["neighbors"] = new JSONValue(neighbors);
+    jsonObj["payload"] = new JSONValue(payload);
+    addEnvelope(jsonObj, mp, "neighborinfo");
+    TEST_ASSERT_EQUAL_STRING(stringify(new JSONValue(jsonObj)).c_str(), MeshPacketSerializer::JsonSerialize(&mp, false).c_str());
+}
+
+void test_bufferVariant(void)
+{
+    meshtastic_MeshPacket mp = makeText("hello");
+    std::string expected = MeshPacketSerializer::JsonSerialize(&mp, false);
+
+    char buf[1024];
+    TEST_ASSERT_EQUAL(expected.length(), MeshPacketSerializer::JsonSerialize(&mp, buf, sizeof(buf), false));
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), buf);
+
+    // Too small a buffer gives nothing rather than truncated JSON
+    TEST_ASSERT_EQUAL(0, MeshPacketSerializer::JsonSerialize(&mp, buf, 32, false));
+    TEST_ASSERT_EQUAL_STRING("", buf);
+}
+
+// Bytes per second and allocations per packet, building a JSONValue tree versus streaming into a buffer
+void test_benchmark(void)
+{
+    meshtastic_Telemetry t = meshtastic_Telemetry_init_zero;
+    t.which_variant = meshtastic_Telemetry_device_metrics_tag;
+    t.variant.device_metrics.battery_level = 87;
+    t.variant.device_metrics.voltage = 4.05f;
+    t.variant.device_metrics.channel_utilization = 12.5f;
+    t.variant.device_metrics.air_util_tx = 1.25f;
+    t.variant.device_metrics.uptime_seconds = 123456;
+    meshtastic_MeshPacket mp = makePacket(meshtastic_PortNum_TELEMETRY_APP, &meshtastic_Telemetry_msg, &t);
+    const meshtastic_DeviceMetrics &m = t.variant.device_metrics;
+    const int count = 20000;
+
+    size_t bytes = 0;
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        JSONObject payload, jsonObj;
+        payload["battery_level"] = new JSONValue((unsigned int)m.battery_level);
+        payload["voltage"] = new JSONValue(m.voltage);
+        payload["channel_utilization"] = new JSONValue(m.channel_utilization);
+        payload["air_util_tx"] = new JSONValue(m.air_util_tx);
+        payload["uptime_seconds"] = new JSONValue((unsigned int)m.uptime_seconds);
+        jsonObj["payload"] = new JSONValue(payload);
+        addEnvelope(jsonObj, mp, "telemetry");
+        bytes += stringify(new JSONValue(jsonObj)).length();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("JSONValue tree: %.1f MB/s, %.1f allocations per packet\n", bytes / secs / 1e6,
+           (double)(allocations - before) / count);
+
+    char buf[1024];
+    bytes = 0;
+    before = allocations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+        bytes += MeshPacketSerializer::JsonSerialize(&mp, buf, sizeof(buf), false);
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t streamingAllocations = allocations - before;
+    printf("JsonWriter: %.1f MB/s, %.1f allocations per packet\n", bytes / secs / 1e6, (double)streamingAllocations / count);
+    TEST_ASSERT_EQUAL(0, streamingAllocations);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    const std::unique_ptr<MockNodeDB> mockNodeDB(new MockNodeDB());
+    nodeDB = mockNodeDB.get();
+    strcpy(owner.id, "!12345678");
+
+    UNITY_BEGIN();
+    RUN_TEST(test_escapingMatchesJSONValue);
+    RUN_TEST(test_utf8PassedThrough);
+    RUN_TEST(test_numbersMatchJSONValue);
+    RUN_TEST(test_nesting);
+    RUN_TEST(test_bufferOverflow);
+    RUN_TEST(test_printSink);
+    RUN_TEST(test_textPacket);
+    RUN_TEST(test_telemetryPacket);
+    RUN_TEST(test_positionPacket);
+    RUN_TEST(test_neighborInfoPacket);
+    RUN_TEST(test_bufferVariant);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
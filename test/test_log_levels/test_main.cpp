@@ -0,0 +1,103 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include <chrono>
+#include <string>
+
+#if LOG_MODULE_LEVELS
+
+namespace
+{
+int evaluated;
+
+// Stands in for an argument that is expensive to work out, like a packet serialized to JSON
+const char *expensive()
+{
+    evaluated++;
+    return "x";
+}
+} // namespace
+
+void setUp(void)
+{
+    evaluated = 0;
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_disabledLinesSkipTheirArguments(void)
+{
+    LogModule::configure(LOG_LEVEL_INFO, "");
+    LOG_DEBUG("Not wanted %s", expensive());
+    LOG_TRACE("Not wanted %s", expensive());
+    TEST_ASSERT_EQUAL(0, evaluated);
+
+    LOG_INFO("Wanted %s", expensive());
+    TEST_ASSERT_EQUAL(1, evaluated);
+}
+
+// This file is the module test_main
+void test_moduleLevels(void)
+{
+    TEST_ASSERT_TRUE(LogModule::configure(LOG_LEVEL_INFO, "test_main=warn"));
+    TEST_ASSERT_FALSE(LOG_ENABLED(LOG_LEVEL_INFO));
+    TEST_ASSERT_TRUE(LOG_ENABLED(LOG_LEVEL_WARN));
+
+    TEST_ASSERT_TRUE(LogModule::configure(LOG_LEVEL_WARN, "test_main=trace"));
+    TEST_ASSERT_TRUE(LOG_ENABLED(LOG_LEVEL_TRACE));
+
+    // Going back to the defaults drops the override
+    TEST_ASSERT_TRUE(LogModule::configure(LOG_LEVEL_WARN, ""));
+    TEST_ASSERT_FALSE(LOG_ENABLED(LOG_LEVEL_TRACE));
+}
+
+void test_badSpecs(void)
+{
+    TEST_ASSERT_FALSE(LogModule::configure(LOG_LEVEL_INFO, "test_main=loud"));
+    TEST_ASSERT_FALSE(LogModule::configure(LOG_LEVEL_INFO, "NoSuchFile=debug"));
+    TEST_ASSERT_FALSE(LogModule::configure(LOG_LEVEL_INFO, "test_main"));
+
+    // The good parts still apply
+    TEST_ASSERT_FALSE(LogModule::configure(LOG_LEVEL_INFO, "NoSuchFile=debug,test_main=error"));
+    TEST_ASSERT_FALSE(LOG_ENABLED(LOG_LEVEL_WARN));
+    TEST_ASSERT_TRUE(LOG_ENABLED(LOG_LEVEL_ERROR));
+
+    TEST_ASSERT_EQUAL(LOG_LEVEL_CRIT, LogModule::parseLevel("crit", 4));
+    TEST_ASSERT_EQUAL(-1, LogModule::parseLevel("critical", 8));
+}
+
+// What a LOG_DEBUG nobody wants costs now that it is turned away before its arguments are worked out
+void test_benchmark(void)
+{
+    LogModule::configure(LOG_LEVEL_INFO, "");
+    const int n = 10000000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        LOG_DEBUG("Packet %s, hops %d", std::to_string(i).c_str(), i);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Disabled LOG_DEBUG: %.2f ns per call\n", secs / n * 1e9);
+}
+
+#endif
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+#if LOG_MODULE_LEVELS
+    RUN_TEST(test_disabledLinesSkipTheirArguments);
+    RUN_TEST(test_moduleLevels);
+    RUN_TEST(test_badSpecs);
+    RUN_TEST(test_benchmark);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
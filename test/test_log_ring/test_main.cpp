@@ -0,0 +1,232 @@
+#include "DebugConfiguration.h"
+#include "LogRing.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#if LOG_RING_SLOTS
+
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+void pushText(LogRing &ring, const char *text)
+{
+    LogRing::Record *r = ring.claim();
+    TEST_ASSERT_NOT_NULL(r);
+    r->format = nullptr;
+    snprintf(r->text, sizeof(r->text), "%s\n", text);
+    ring.publish(r);
+}
+
+std::string popLine(LogRing &ring)
+{
+    char buf[LOG_RING_TEXT_SIZE];
+    LogRing::Record *r = ring.front();
+    TEST_ASSERT_NOT_NULL(r);
+    LogRing::format(*r, buf, sizeof(buf));
+    ring.pop();
+    return buf;
+}
+
+// Keeps the benchmarked log lines off the console
+class MuteStdout
+{
+  public:
+    MuteStdout()
+    {
+        fflush(stdout);
+        saved = dup(1);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, 1);
+        close(devNull);
+    }
+    ~MuteStdout()
+    {
+        fflush(stdout);
+        dup2(saved, 1);
+        close(saved);
+    }
+
+  private:
+    int saved;
+};
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_fifoOrder(void)
+{
+    std::unique_ptr<LogRing> ring(new LogRing());
+    TEST_ASSERT_NULL(ring->front());
+
+    // Go round the ring a few times
+    for (int lap = 0; lap < 3; lap++) {
+        for (int i = 0; i < LOG_RING_SLOTS; i++)
+            pushText(*ring, std::to_string(lap * LOG_RING_SLOTS + i).c_str());
+        for (int i = 0; i < LOG_RING_SLOTS; i++)
+            TEST_ASSERT_EQUAL_STRING((std::to_string(lap * LOG_RING_SLOTS + i) + "\n").c_str(), popLine(*ring).c_str());
+        TEST_ASSERT_NULL(ring->front());
+    }
+    TEST_ASSERT_EQUAL(0, ring->numDropped());
+}
+
+void test_overflowIsCounted(void)
+{
+    std::unique_ptr<LogRing> ring(new LogRing());
+    for (int i = 0; i < LOG_RING_SLOTS; i++)
+        pushText(*ring, "x");
+    TEST_ASSERT_NULL(ring->claim());
+    TEST_ASSERT_NULL(ring->claim());
+    TEST_ASSERT_EQUAL(2, ring->numDropped());
+
+    // A free slot can be claimed again
+    popLine(*ring);
+    TEST_ASSERT_NOT_NULL(ring->claim());
+}
+
+void test_binaryRecords(void)
+{
+    std::unique_ptr<LogRing> ring(new LogRing());
+    LogRing::Record *r = ring->claim();
+    r->format = "Add packet record fr=0x%x, id=0x%08x, hops %d";
+    r->numArgs = 3;
+    r->args[0] = 0x1234abcd;
+    r->args[1] = 0x42;
+    r->args[2] = (uint32_t)-1;
+    ring->publish(r);
+    TEST_ASSERT_EQUAL_STRING("Add packet record fr=0x1234abcd, id=0x00000042, hops -1\n", popLine(*ring).c_str());
+
+    // Lines that don't fit are cut short but still end in a newline
+    r = ring->claim();
+    r->format = nullptr;
+    memset(r->text, 'a', sizeof(r->text) - 2);
+    r->text[sizeof(r->text) - 2] = '\n';
+    r->text[sizeof(r->text) - 1] = '\0';
+    ring->publish(r);
+    char small[16];
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, LogRing::format(*ring->front(), small, sizeof(small)));
+    ring->pop();
+}
+
+// Every record from every producer comes out once, in the order that producer pushed them, unless it was dropped
+void test_multipleProducers(void)
+{
+    std::unique_ptr<LogRing> ring(new LogRing());
+    const uint32_t numProducers = 4, perProducer = 100000;
+    std::atomic<uint32_t> finished = {0};
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < numProducers; p++) {
+        producers.emplace_back([&, p]() {
+            for (uint32_t i = 0; i < perProducer; i++) {
+                LogRing::Record *r = ring->claim();
+                if (!r)
+                    continue;
+                r->format = "%u %u";
+                r->args[0] = p;
+                r->args[1] = i;
+                ring->publish(r);
+            }
+            finished++;
+        });
+    }
+
+    std::vector<int64_t> last(numProducers, -1);
+    uint32_t received = 0;
+    bool inOrder = true;
+    while (true) {
+        LogRing::Record *r = ring->front();
+        if (!r) {
+            if (finished == numProducers && !ring->front())
+                break;
+            continue;
+        }
+        uint32_t p = r->args[0], i = r->args[1];
+        inOrder = inOrder && p < numProducers && (int64_t)i > last[p];
+        if (p < numProducers)
+            last[p] = i;
+        ring->pop();
+        received++;
+    }
+    for (auto &t : producers)
+        t.join();
+
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_EQUAL(numProducers * perProducer, received + ring->numDropped());
+    printf("%u records from %u threads, %u dropped\n", numProducers * perProducer, numProducers, ring->numDropped());
+}
+
+// What a LOG_DEBUG costs the thread that logs it: written out there and then, queued as text, or queued as a binary record
+void test_benchmark(void)
+{
+    const int rounds = 20, perRound = LOG_RING_SLOTS;
+    double syncSecs = 0, textSecs = 0, binarySecs = 0, sinkSecs = 0;
+    {
+        MuteStdout mute;
+
+        for (int i = 0; i < rounds * perRound; i++) {
+            auto start = std::chrono::steady_clock::now();
+            LOG_DEBUG("Add packet record fr=0x%x, id=0x%x", i, i * 7);
+            syncSecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        DEBUG_PORT.startAsyncLog();
+        for (int round = 0; round < rounds * 2; round++) {
+            bool binary = round % 2;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < perRound; i++) {
+                if (binary)
+                    LOG_DEBUG_DEFERRED("Add packet record fr=0x%x, id=0x%x", i, i * 7);
+                else
+                    LOG_DEBUG("Add packet record fr=0x%x, id=0x%x", i, i * 7);
+            }
+            auto mid = std::chrono::steady_clock::now();
+            (binary ? binarySecs : textSecs) += std::chrono::duration<double>(mid - start).count();
+            while (DEBUG_PORT.drainLog(SIZE_MAX))
+                ;
+            sinkSecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - mid).count();
+        }
+    }
+
+    const int n = rounds * perRound;
+    TEST_ASSERT_EQUAL(0, DEBUG_PORT.getLogRing().numDropped());
+    printf("LOG_DEBUG per call: %.0f ns written out, %.0f ns queued as text, %.0f ns queued binary, %.0f ns in the sink\n",
+           syncSecs / n * 1e9, textSecs / n * 1e9, binarySecs / n * 1e9, sinkSecs / (2 * n) * 1e9);
+}
+
+#endif
+
+void setup()
+{
+    initializeTestEnvironment();
+    LogModule::configure(LOG_LEVEL_DEBUG, "");
+
+    UNITY_BEGIN();
+#if LOG_RING_SLOTS
+    RUN_TEST(test_fifoOrder);
+    RUN_TEST(test_overflowIsCounted);
+    RUN_TEST(test_binaryRecords);
+    RUN_TEST(test_multipleProducers);
+    RUN_TEST(test_benchmark);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,225 @@
+#include "TestUtil.h"
+#include <unity.h>
+
+// The Marauder sketch isn't part of this build, but its capture ring has no Arduino dependencies
+#include "../../32 Marauder/esp32_marauder/CaptureRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct RecordedFrame {
+    std::vector<uint8_t> data;
+    uint8_t channel;
+    int8_t rssi;
+    uint64_t ts;
+};
+
+// A survey's worth of frames: mostly short management and control frames with some full sized data, across the channels
+std::vector<RecordedFrame> record(size_t count)
+{
+    std::vector<RecordedFrame> frames;
+    uint32_t seed = 1;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t n = seed >> 8;
+        RecordedFrame f;
+        size_t len = (n % 8 == 0) ? 1400 + n % 900 : 24 + n % 300;
+        for (size_t b = 0; b < len; b++)
+            f.data.push_back((uint8_t)(i + b * 7));
+        f.channel = 1 + (n / 8) % 13;
+        f.rssi = -30 - (int8_t)(n % 60);
+        f.ts = 1000000ull * 3600 * 2 + i * 250; // past where a 32 bit micros() wraps
+        frames.push_back(f);
+    }
+    return frames;
+}
+
+const uint32_t SNAP_LEN = 2324;
+
+// What the ring should have produced for the frames it took, built separately from the ring
+std::vector<uint8_t> expectedCapture(const std::vector<RecordedFrame> &frames, const std::vector<bool> &taken)
+{
+    std::vector<uint8_t> out(PcapNg::SECTION_HEADER_LEN);
+    PcapNg::sectionHeader(out.data());
+
+    int interfaces[256];
+    for (int &i : interfaces)
+        i = -1;
+    int next = 0;
+    uint32_t drops = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const RecordedFrame &f = frames[i];
+        if (!taken[i]) {
+            drops++;
+            continue;
+        }
+        if (interfaces[f.channel] < 0) {
+            size_t at = out.size();
+            out.resize(at + PcapNg::interfaceDescriptionLen(f.channel));
+            PcapNg::interfaceDescription(&out[at], f.channel, SNAP_LEN);
+            interfaces[f.channel] = next++;
+        }
+        uint32_t len = f.data.size() < SNAP_LEN ? f.data.size() : SNAP_LEN;
+        size_t at = out.size();
+        out.resize(at + PcapNg::enhancedPacketLen(len, drops > 0));
+        PcapNg::enhancedPacket(&out[at], interfaces[f.channel], f.ts, f.data.data(), len, f.data.size(), f.channel, f.rssi,
+                               drops);
+        drops = 0;
+    }
+    return out;
+}
+
+// The writer's side, as the Buffer's writer task does it
+void drain(CaptureRing &ring, std::vector<uint8_t> &out)
+{
+    uint32_t len;
+    while (uint8_t *buf = ring.front(&len)) {
+        out.insert(out.end(), buf, buf + len);
+        ring.pop();
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+// The blocks written out by hand from the pcapng and radiotap specs
+void test_blocks(void)
+{
+    uint8_t shb[PcapNg::SECTION_HEADER_LEN];
+    const uint8_t expectedShb[] = {0x0A, 0x0D, 0x0D, 0x0A, 28,   0,    0,    0,    0x4D, 0x3C, 0x2B, 0x1A, 1, 0,
+                                   0,    0,    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 28,   0,    0, 0};
+    TEST_ASSERT_EQUAL(sizeof(expectedShb), PcapNg::sectionHeader(shb));
+    TEST_ASSERT_EQUAL_MEMORY(expectedShb, shb, sizeof(shb));
+
+    uint8_t idb[64];
+    const uint8_t expectedIdb[] = {1, 0, 0, 0, 32, 0, 0, 0, 127, 0, 0, 0, 0x21, 0x09, 0, 0, // snap 2324 + radiotap
+                                   2, 0, 4, 0, 'c', 'h', '1', '1', 0, 0, 0, 0, 32, 0, 0, 0};
+    TEST_ASSERT_EQUAL(sizeof(expectedIdb), PcapNg::interfaceDescription(idb, 11, 2324));
+    TEST_ASSERT_EQUAL_MEMORY(expectedIdb, idb, sizeof(expectedIdb));
+
+    uint8_t epb[96];
+    const uint8_t frame[] = {0x80, 0x00, 0xAA};
+    const uint8_t expectedEpb[] = {6, 0, 0, 0, 64, 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 5, 0, 0, 0, // interface 2, ts 2^32 + 5
+                                   16, 0, 0, 0, 20, 0, 0, 0,                                     // 3 of 7 bytes
+                                   0, 0, 13, 0, 0x28, 0, 0, 0, 0x85, 0x09, 0x80, 0x00, (uint8_t)-60, 0x80, 0x00, 0xAA,
+                                   4, 0, 8, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 3 dropped, end of options
+                                   64, 0, 0, 0};
+    TEST_ASSERT_EQUAL(sizeof(expectedEpb), PcapNg::enhancedPacket(epb, 2, (1ull << 32) + 5, frame, 3, 7, 6, -60, 3));
+    TEST_ASSERT_EQUAL_MEMORY(expectedEpb, epb, sizeof(expectedEpb));
+}
+
+// With the writer keeping up, every frame is saved, each channel's interface described once
+void test_lossless(void)
+{
+    std::vector<RecordedFrame> frames = record(5000);
+    CaptureRing ring(3 * 1024, 3);
+    std::vector<uint8_t> out;
+    ring.addSectionHeader();
+    for (const RecordedFrame &f : frames) {
+        TEST_ASSERT_TRUE(ring.addFrame(f.data.data(), f.data.size(), f.channel, f.rssi, f.ts, SNAP_LEN));
+        drain(ring, out);
+    }
+    ring.seal();
+    drain(ring, out);
+
+    TEST_ASSERT_EQUAL_UINT32(0, ring.dropped());
+    std::vector<uint8_t> expected = expectedCapture(frames, std::vector<bool>(frames.size(), true));
+    TEST_ASSERT_EQUAL(expected.size(), out.size());
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), out.data(), expected.size());
+}
+
+// A stalled writer costs frames, not blocking, and the next frame saved says how many
+void test_stalledWriterDrops(void)
+{
+    std::vector<RecordedFrame> frames = record(200);
+    CaptureRing ring(3 * 1024, 3);
+    std::vector<uint8_t> out;
+    std::vector<bool> taken;
+    ring.addSectionHeader();
+    for (size_t i = 0; i < frames.size(); i++) {
+        const RecordedFrame &f = frames[i];
+        taken.push_back(ring.addFrame(f.data.data(), f.data.size(), f.channel, f.rssi, f.ts, SNAP_LEN));
+        if (i % 50 == 49)
+            drain(ring, out);
+    }
+    ring.seal();
+    drain(ring, out);
+
+    uint32_t dropped = std::count(taken.begin(), taken.end(), false);
+    TEST_ASSERT_GREATER_THAN(0, dropped);
+    TEST_ASSERT_EQUAL_UINT32(dropped, ring.dropped());
+    std::vector<uint8_t> expected = expectedCapture(frames, taken);
+    TEST_ASSERT_EQUAL(expected.size(), out.size());
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), out.data(), expected.size());
+}
+
+// The producer feeding frames at a busy 2.4 GHz channel's rate while a writer thread saves them. Whatever the ring took must
+// come out exactly as encoded, in order, and whatever it didn't take must be counted
+void test_lineRate(void)
+{
+    const double LINE_RATE = 72e6 / 8; // bytes per second, 802.11n at 72 Mbit/s
+    std::vector<RecordedFrame> frames = record(20000);
+    CaptureRing ring(8 * 1024, 4);
+    std::vector<bool> taken(frames.size());
+    std::vector<uint8_t> out;
+    out.reserve(frames.size() * 512);
+    std::atomic<bool> done{false};
+
+    std::thread writer([&] {
+        while (!done.load()) {
+            drain(ring, out);
+            std::this_thread::yield();
+        }
+        drain(ring, out);
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    double sent = 0;
+    ring.addSectionHeader();
+    for (size_t i = 0; i < frames.size(); i++) {
+        const RecordedFrame &f = frames[i];
+        while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < sent / LINE_RATE)
+            std::this_thread::yield();
+        taken[i] = ring.addFrame(f.data.data(), f.data.size(), f.channel, f.rssi, f.ts, SNAP_LEN);
+        sent += f.data.size();
+    }
+    while (!ring.seal())
+        std::this_thread::yield();
+    done.store(true);
+    writer.join();
+
+    uint32_t dropped = std::count(taken.begin(), taken.end(), false);
+    TEST_ASSERT_EQUAL_UINT32(dropped, ring.dropped());
+    std::vector<uint8_t> expected = expectedCapture(frames, taken);
+    TEST_ASSERT_EQUAL(expected.size(), out.size());
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), out.data(), expected.size());
+    printf("%zu frames, %.1f MB at %.1f MB/s, %u dropped\n", frames.size(), sent / 1e6, LINE_RATE / 1e6, dropped);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_blocks);
+    RUN_TEST(test_lossless);
+    RUN_TEST(test_stalledWriterDrops);
+    RUN_TEST(test_lineRate);
+    exit(UNITY_END());
+}
+
+void loop() {}
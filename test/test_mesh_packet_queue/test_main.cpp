@@ -0,0 +1,192 @@
+#include "MeshPacketQueue.h"
+#include "MeshTypes.h"
+#include "NodeDB.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+// Minimal NodeDB, the queue only needs our own node number from it.
+class MockNodeDB : public NodeDB
+{
+};
+
+// The sorted vector MeshPacketQueue used to be, kept as a reference for the expected ordering.
+class ReferenceQueue
+{
+  public:
+    std::vector<meshtastic_MeshPacket *> queue;
+
+    static bool before(const meshtastic_MeshPacket *p1, const meshtastic_MeshPacket *p2)
+    {
+        if ((bool)p1->tx_after != (bool)p2->tx_after)
+            return !p1->tx_after;
+        return (p1->priority != p2->priority) ? (p1->priority > p2->priority) : (!isFromUs(p1) && isFromUs(p2));
+    }
+
+    void insert(meshtastic_MeshPacket *p) { queue.insert(std::upper_bound(queue.begin(), queue.end(), p, before), p); }
+
+    meshtastic_MeshPacket *remove(NodeNum from, PacketId id, bool tx_normal, bool tx_late)
+    {
+        for (auto it = queue.begin(); it != queue.end(); it++) {
+            auto p = *it;
+            if (getFrom(p) == from && p->id == id && ((tx_normal && !p->tx_after) || (tx_late && p->tx_after))) {
+                queue.erase(it);
+                return p;
+            }
+        }
+        return NULL;
+    }
+
+    // Returns the packet that would be evicted to make room for p, or NULL
+    meshtastic_MeshPacket *victimFor(const meshtastic_MeshPacket *p)
+    {
+        for (auto it = queue.rbegin(); it != queue.rend(); it++) {
+            if (!(*it)->tx_after)
+                return (*it)->priority < p->priority ? *it : NULL;
+        }
+        return NULL;
+    }
+};
+
+const meshtastic_MeshPacket_Priority priorities[] = {
+    meshtastic_MeshPacket_Priority_BACKGROUND, meshtastic_MeshPacket_Priority_DEFAULT, meshtastic_MeshPacket_Priority_RELIABLE,
+    meshtastic_MeshPacket_Priority_RESPONSE,   meshtastic_MeshPacket_Priority_HIGH,    meshtastic_MeshPacket_Priority_ACK};
+
+meshtastic_MeshPacket *makePacket(std::mt19937 &rng, PacketId id)
+{
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = (rng() % 4) ? 0x1000 + rng() % 8 : nodeDB->getNodeNum();
+    p->id = id;
+    p->priority = priorities[rng() % (sizeof(priorities) / sizeof(priorities[0]))];
+    p->tx_after = (rng() % 5) ? 0 : 1000;
+    return p;
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_orderMatchesSortedVector(void)
+{
+    const size_t maxLen = 64;
+    MeshPacketQueue queue(maxLen);
+    ReferenceQueue reference;
+    std::mt19937 rng(4);
+    PacketId nextId = 1;
+
+    for (int i = 0; i < 20000; i++) {
+        switch (rng() % 4) {
+        case 0:
+        case 1: {
+            meshtastic_MeshPacket *p = makePacket(rng, nextId++);
+            if (reference.queue.size() < maxLen) {
+                TEST_ASSERT_TRUE(queue.enqueue(p));
+                reference.insert(p);
+            } else {
+                meshtastic_MeshPacket *victim = reference.victimFor(p);
+                if (victim) {
+                    reference.queue.erase(std::find(reference.queue.begin(), reference.queue.end(), victim));
+                    reference.insert(p);
+                    TEST_ASSERT_TRUE(queue.enqueue(p)); // releases victim
+                } else {
+                    TEST_ASSERT_FALSE(queue.enqueue(p));
+                    packetPool.release(p);
+                }
+            }
+            break;
+        }
+        case 2: {
+            meshtastic_MeshPacket *expected = reference.queue.empty() ? NULL : reference.queue.front();
+            if (expected)
+                reference.queue.erase(reference.queue.begin());
+            meshtastic_MeshPacket *p = queue.dequeue();
+            TEST_ASSERT_EQUAL_PTR(expected, p);
+            if (p)
+                packetPool.release(p);
+            break;
+        }
+        default: {
+            // Cancel something recent, it may or may not still be queued
+            PacketId id = nextId - 1 - rng() % 32;
+            NodeNum from = (rng() % 4) ? 0x1000 + rng() % 8 : nodeDB->getNodeNum();
+            bool late = rng() % 2;
+            meshtastic_MeshPacket *expected = reference.remove(from, id, true, late);
+            meshtastic_MeshPacket *p = queue.remove(from, id, true, late);
+            TEST_ASSERT_EQUAL_PTR(expected, p);
+            bool stillQueued = std::any_of(reference.queue.begin(), reference.queue.end(),
+                                           [&](meshtastic_MeshPacket *q) { return getFrom(q) == from && q->id == id; });
+            TEST_ASSERT_EQUAL(stillQueued, queue.find(from, id));
+            if (p)
+                packetPool.release(p);
+        }
+        }
+        TEST_ASSERT_EQUAL(maxLen - reference.queue.size(), queue.getFree());
+        TEST_ASSERT_EQUAL_PTR(reference.queue.empty() ? NULL : reference.queue.front(), queue.getFront());
+    }
+
+    while (meshtastic_MeshPacket *p = queue.dequeue())
+        packetPool.release(p);
+}
+
+// Deep queues are what router nodes with a large TX queue see, every operation should cost the same regardless of depth
+void test_deepQueueBenchmark(void)
+{
+    const size_t depths[] = {16, 256, 4096};
+    std::mt19937 rng(5);
+
+    for (size_t depth : depths) {
+        MeshPacketQueue queue(depth);
+        std::vector<meshtastic_MeshPacket> packets(depth);
+        for (size_t i = 0; i < depth; i++) {
+            packets[i] = meshtastic_MeshPacket_init_zero;
+            packets[i].from = 0x1000 + i;
+            packets[i].id = i + 1;
+            packets[i].priority = priorities[rng() % (sizeof(priorities) / sizeof(priorities[0]))];
+            queue.enqueue(&packets[i]);
+        }
+
+        const size_t ops = 200000;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ops; i++) {
+            meshtastic_MeshPacket &p = packets[(i * 7919) % depth];
+            // cancel + requeue, the pattern cancelSending and clampToLateRebroadcastWindow produce
+            TEST_ASSERT_TRUE(queue.find(p.from, p.id));
+            meshtastic_MeshPacket *removed = queue.remove(p.from, p.id);
+            queue.enqueue(removed);
+            queue.enqueue(queue.dequeue());
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        TEST_ASSERT_EQUAL(0, queue.getFree());
+        printf("MeshPacketQueue: depth %u, %.1f ns per find+remove+enqueue+dequeue+enqueue\n", (unsigned)depth,
+               (double)elapsed.count() / ops);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    const std::unique_ptr<MockNodeDB> mockNodeDB(new MockNodeDB());
+    nodeDB = mockNodeDB.get();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_orderMatchesSortedVector);
+    RUN_TEST(test_deepQueueBenchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,751 @@
+#include "MeshSim.h"
+#include "MeshTypes.h"
+#include "NodeDB.h"
+#include "RadioInterface.h"
+#include "ReliableRouter.h"
+#include "airtime.h"
+#include "mesh-pb-constants.h"
+#include "modules/RoutingModule.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <math.h>
+
+static const NodeNum FIRST_NODE_NUM = 0x53000001;
+
+struct MeshSim::Node {
+    uint32_t index;
+    NodeNum num;
+    meshtastic_Config_DeviceConfig_Role role;
+    float x = 0, y = 0;
+    std::vector<Link> links; // the nodes that hear us
+    PacketHistory history;
+    MeshPacketQueue txQueue = MeshPacketQueue(MAX_TX_QUEUE);
+    std::unordered_map<NodeNum, uint8_t> nextHop; // the next_hop NodeDB keeps for each node
+    std::map<uint64_t, Pending> pending;          // retransmissions by (from, id)
+    meshtastic_MeshPacket *sending = nullptr;
+    uint32_t sendingSince = 0;
+    bool timerPending = false;
+    uint32_t retransmitAt = UINT32_MAX;
+    uint32_t channelUtilization[CHANNEL_UTILIZATION_PERIODS] = {0}; // airtime heard per 10 seconds, as AirTime keeps it
+    uint32_t utilizationPeriod = 0;
+    NodeStats stats = {};
+};
+
+MeshSim::MeshSim(const Config &config) : config(config), rng(config.seed)
+{
+    slotTimeMsec = RadioInterface::computeSlotTimeMsec(config.sf, config.bw, false);
+    maxPacketTimeMsec = RadioInterface::getPacketTime(meshtastic_Constants_DATA_PAYLOAD_LEN + sizeof(PacketHeader), config.sf,
+                                                      config.bw, config.cr, config.preambleLength);
+    // SX126x demodulation floor, -7.5dB at SF7 and 2.5dB lower for each step up
+    snrFloor = -7.5f - 2.5f * (config.sf - 7);
+}
+
+MeshSim::~MeshSim()
+{
+    for (; !events.empty(); events.pop()) {
+        if (events.top().packet)
+            pool.release(events.top().packet);
+    }
+    for (auto &n : nodes) {
+        while (!n->txQueue.empty())
+            pool.release(n->txQueue.dequeue());
+        if (n->sending)
+            pool.release(n->sending);
+        for (auto &pending : n->pending)
+            pool.release(pending.second.packet);
+    }
+}
+
+size_t MeshSim::addNode(meshtastic_Config_DeviceConfig_Role role)
+{
+    std::unique_ptr<Node> n(new Node());
+    n->index = nodes.size();
+    n->num = FIRST_NODE_NUM + n->index;
+    n->role = role;
+    n->history.setOwner(n->num, &nowMsec);
+    n->txQueue.setOwner(n->num, &pool);
+    nodes.push_back(std::move(n));
+    return nodes.size() - 1;
+}
+
+NodeNum MeshSim::getNodeNum(size_t node) const
+{
+    return nodes[node]->num;
+}
+
+size_t MeshSim::indexOf(NodeNum num) const
+{
+    return num - FIRST_NODE_NUM;
+}
+
+void MeshSim::link(size_t a, size_t b, float snr)
+{
+    if (linkSnr.count(key(a, b))) {
+        for (Link &l : nodes[a]->links)
+            l.snr = l.node == b ? snr : l.snr;
+        for (Link &l : nodes[b]->links)
+            l.snr = l.node == a ? snr : l.snr;
+    } else {
+        nodes[a]->links.push_back({(uint32_t)b, snr});
+        nodes[b]->links.push_back({(uint32_t)a, snr});
+    }
+    linkSnr[key(a, b)] = linkSnr[key(b, a)] = snr;
+}
+
+void MeshSim::setPosition(size_t node, float xMeters, float yMeters)
+{
+    nodes[node]->x = xMeters;
+    nodes[node]->y = yMeters;
+}
+
+void MeshSim::connectByDistance()
+{
+    for (size_t a = 0; a < nodes.size(); a++) {
+        for (size_t b = a + 1; b < nodes.size(); b++) {
+            float d = std::max(hypotf(nodes[a]->x - nodes[b]->x, nodes[a]->y - nodes[b]->y), 1.0f);
+            float snr = config.snrAt1km - 10 * config.pathLossExponent * log10f(d / 1000);
+            if (snr >= snrFloor)
+                link(a, b, snr);
+        }
+    }
+}
+
+void MeshSim::placeRandom(size_t numNodes, float sizeMeters)
+{
+    std::uniform_real_distribution<float> coord(0, sizeMeters);
+    for (size_t i = 0; i < numNodes; i++) {
+        size_t n = addNode();
+        float x = coord(rng);
+        setPosition(n, x, coord(rng));
+    }
+    connectByDistance();
+}
+
+size_t MeshSim::send(size_t from, NodeNum to, uint32_t atMsec, uint8_t payloadLen, bool wantAck)
+{
+    Message m = {(uint32_t)from, to, payloadLen, wantAck, randomId(), false, 0, std::vector<bool>(nodes.size())};
+    messages.push_back(m);
+    messageOf[key(nodes[from]->num, m.id)] = messages.size() - 1;
+    schedule(atMsec, EVENT_ORIGINATE, from, messages.size() - 1);
+    return messages.size() - 1;
+}
+
+void MeshSim::run(uint32_t untilMsec)
+{
+    while (!events.empty() && events.top().time <= untilMsec) {
+        Event e = events.top();
+        events.pop();
+        nowMsec = e.time;
+
+        Node &n = *nodes[e.node];
+        auto start = std::chrono::steady_clock::now();
+        handle(e, n);
+        n.stats.cpuNsec +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (!events.empty())
+        nowMsec = untilMsec;
+}
+
+bool MeshSim::wasDelivered(size_t message, size_t node) const
+{
+    const Message &m = messages[message];
+    return node < m.delivered.size() && m.delivered[node];
+}
+
+const MeshSim::NodeStats &MeshSim::getNodeStats(size_t node) const
+{
+    return nodes[node]->stats;
+}
+
+MeshSim::Report MeshSim::report() const
+{
+    Report r = {};
+    for (const Message &m : messages) {
+        if (isBroadcast(m.to)) {
+            r.broadcasts++;
+            r.broadcastTargets += m.delivered.size() - 1;
+            r.broadcastReceivers += std::count(m.delivered.begin(), m.delivered.end(), true);
+        } else {
+            r.directs++;
+            r.directsDelivered += wasDelivered(&m - &messages[0], indexOf(m.to));
+            r.directsAcked += m.acked;
+        }
+    }
+    for (auto &n : nodes) {
+        r.transmissions += n->stats.txPackets;
+        r.relays += n->stats.txRelays;
+        r.airtimeMsec += n->stats.txAirtimeMsec;
+        r.cpuNsec += n->stats.cpuNsec;
+    }
+    r.redundantRelays = redundantRelays;
+    r.collisions = collisions;
+    r.durationMsec = nowMsec;
+    return r;
+}
+
+void MeshSim::schedule(uint32_t time, EventType type, uint32_t node, uint32_t arg, meshtastic_MeshPacket *packet)
+{
+    events.push({time, nextSeq++, type, node, arg, packet});
+}
+
+void MeshSim::handle(const Event &e, Node &n)
+{
+    switch (e.type) {
+    case EVENT_ORIGINATE:
+        originate(n, messages[e.arg]);
+        break;
+    case EVENT_TX_TIMER:
+        // As SimRadio on TRANSMIT_DELAY_COMPLETED
+        n.timerPending = false;
+        if (n.txQueue.empty())
+            break;
+        if (n.sending || isChannelActive(n))
+            setTransmitDelay(n);
+        else
+            startTransmit(n);
+        break;
+    case EVENT_TX_DONE:
+        completeTransmit(n);
+        break;
+    case EVENT_RECEIVE:
+        receive(n, e.packet);
+        break;
+    case EVENT_RETRANSMIT:
+        if (e.time == n.retransmitAt) { // otherwise an earlier retransmission was scheduled since
+            n.retransmitAt = UINT32_MAX;
+            doRetransmissions(n);
+        }
+        break;
+    }
+}
+
+uint32_t MeshSim::randomBelow(uint32_t n)
+{
+    return n ? std::uniform_int_distribution<uint32_t>(0, n - 1)(rng) : 0;
+}
+
+PacketId MeshSim::randomId()
+{
+    return (rng() & 0x7FFFFFFF) | 1;
+}
+
+/// RadioInterface::getPacketTime()
+uint32_t MeshSim::getPacketTime(const meshtastic_MeshPacket *p) const
+{
+    uint8_t bytes[MAX_LORA_PAYLOAD_LEN + 1];
+    size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
+    return RadioInterface::getPacketTime(numbytes + sizeof(PacketHeader), config.sf, config.bw, config.cr,
+                                         config.preambleLength);
+}
+
+bool MeshSim::hears(uint32_t to, uint32_t from, float *snr) const
+{
+    auto it = linkSnr.find(key(from, to));
+    if (it == linkSnr.end() || it->second < snrFloor)
+        return false;
+    if (snr)
+        *snr = it->second;
+    return true;
+}
+
+bool MeshSim::isChannelActive(const Node &n) const
+{
+    for (const Transmission &t : onAir) {
+        if (t.node != n.index && t.start <= nowMsec && nowMsec < t.end && hears(n.index, t.node))
+            return true;
+    }
+    return false;
+}
+
+bool MeshSim::transmittedDuring(const Node &n, const Transmission &t) const
+{
+    for (const Transmission &u : onAir) {
+        if (u.node == n.index && u.start < t.end && u.end > t.start)
+            return true;
+    }
+    return false;
+}
+
+/// Did anything else n heard while t was on air come in within captureDb of it?
+bool MeshSim::collides(const Node &n, const Transmission &t, float snr) const
+{
+    for (const Transmission &u : onAir) {
+        float other;
+        if (u.node != t.node && u.node != n.index && u.start < t.end && u.end > t.start && hears(n.index, u.node, &other) &&
+            other > snr - config.captureDb)
+            return true;
+    }
+    return false;
+}
+
+void MeshSim::logAirtime(Node &n, uint32_t msec)
+{
+    channelUtilizationPercent(n); // age out old periods
+    n.channelUtilization[n.utilizationPeriod % CHANNEL_UTILIZATION_PERIODS] += msec;
+}
+
+float MeshSim::channelUtilizationPercent(Node &n)
+{
+    uint32_t period = nowMsec / (10 * 1000);
+    if (period - n.utilizationPeriod >= CHANNEL_UTILIZATION_PERIODS) {
+        std::fill(n.channelUtilization, n.channelUtilization + CHANNEL_UTILIZATION_PERIODS, 0);
+    } else {
+        for (uint32_t p = n.utilizationPeriod + 1; p <= period; p++)
+            n.channelUtilization[p % CHANNEL_UTILIZATION_PERIODS] = 0;
+    }
+    n.utilizationPeriod = period;
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < CHANNEL_UTILIZATION_PERIODS; i++)
+        sum += n.channelUtilization[i];
+    return float(sum) / (CHANNEL_UTILIZATION_PERIODS * 10 * 1000) * 100;
+}
+
+void MeshSim::startTransmit(Node &n)
+{
+    meshtastic_MeshPacket *p = n.txQueue.dequeue();
+    uint32_t airtime = getPacketTime(p);
+    n.sending = p;
+    n.sendingSince = nowMsec;
+    onAir.push_back({n.index, nowMsec, nowMsec + airtime});
+
+    n.stats.txPackets++;
+    if (p->from != n.num) {
+        n.stats.txRelays++;
+        auto m = messageOf.find(key(p->from, p->id));
+        if (m != messageOf.end())
+            messages[m->second].relays++;
+    }
+    n.stats.txAirtimeMsec += airtime;
+    logAirtime(n, airtime);
+    schedule(nowMsec + airtime, EVENT_TX_DONE, n.index);
+}
+
+void MeshSim::completeTransmit(Node &n)
+{
+    meshtastic_MeshPacket *p = n.sending;
+    n.sending = nullptr;
+    Transmission t = {n.index, n.sendingSince, nowMsec};
+
+    uint32_t reached = 0;
+    for (const Link &l : n.links) {
+        Node &r = *nodes[l.node];
+        float snr = l.snr;
+        if (config.fadingDb > 0)
+            snr += std::normal_distribution<float>(0, config.fadingDb)(rng);
+        if (snr < snrFloor)
+            continue;
+
+        logAirtime(r, t.end - t.start);
+        if (transmittedDuring(r, t)) {
+            r.stats.rxWhileTx++;
+        } else if (collides(r, t, l.snr)) {
+            r.stats.rxCollisions++;
+            collisions++;
+        } else {
+            reached += !r.history.wasSeenRecently(p, false);
+            meshtastic_MeshPacket *copy = pool.allocCopy(*p);
+            copy->rx_snr = snr;
+            copy->rx_rssi = lroundf(snr) - 120; // about the noise floor of a 250kHz channel
+            schedule(nowMsec, EVENT_RECEIVE, r.index, 0, copy);
+        }
+    }
+    if (p->from != n.num && !reached)
+        redundantRelays++;
+    pool.release(p);
+
+    // Nothing that ended before the longest packet could have started can overlap anything still to come
+    onAir.erase(std::remove_if(onAir.begin(), onAir.end(),
+                               [this](const Transmission &u) { return u.end + maxPacketTimeMsec < nowMsec; }),
+                onAir.end());
+
+    startTransmitTimer(n, getTxDelayMsec(n)); // as SimRadio on ISR_TX
+}
+
+/// RadioInterface::getTxDelayMsec(), drawing from the sim's generator
+uint32_t MeshSim::getTxDelayMsec(Node &n)
+{
+    RadioInterface::ContentionWindow cw = RadioInterface::getTxWindow(channelUtilizationPercent(n));
+    return (cw.offset + randomBelow(cw.window)) * slotTimeMsec;
+}
+
+/// RadioInterface::getTxDelayMsecWeighted()
+uint32_t MeshSim::getTxDelayMsecWeighted(const Node &n, float snr)
+{
+    bool isRouter =
+        n.role == meshtastic_Config_DeviceConfig_Role_ROUTER || n.role == meshtastic_Config_DeviceConfig_Role_REPEATER;
+    RadioInterface::ContentionWindow cw = RadioInterface::getTxWindowWeighted(snr, isRouter);
+    return (cw.offset + randomBelow(cw.window)) * slotTimeMsec;
+}
+
+/// RadioInterface::getRetransmissionMsec()
+uint32_t MeshSim::getRetransmissionMsec(Node &n, const meshtastic_MeshPacket *p)
+{
+    return RadioInterface::getRetransmissionMsec(getPacketTime(p), channelUtilizationPercent(n), slotTimeMsec);
+}
+
+/// As SimRadio::setTransmitDelay(), packets we made wait a random delay and relays one weighted by the SNR they came in at
+void MeshSim::setTransmitDelay(Node &n)
+{
+    meshtastic_MeshPacket *p = n.txQueue.getFront();
+    if (p->rx_snr == 0 && p->rx_rssi == 0)
+        startTransmitTimer(n, getTxDelayMsec(n));
+    else
+        startTransmitTimer(n, getTxDelayMsecWeighted(n, p->rx_snr));
+}
+
+/// Like notifyLater() without overwrite, a timer that is already running is left alone
+void MeshSim::startTransmitTimer(Node &n, uint32_t delayMsec)
+{
+    if (n.txQueue.empty() || n.timerPending || n.sending)
+        return;
+    n.timerPending = true;
+    schedule(nowMsec + delayMsec, EVENT_TX_TIMER, n.index);
+}
+
+void MeshSim::originate(Node &n, Message &m)
+{
+    meshtastic_MeshPacket *p = pool.allocZeroed();
+    p->from = n.num;
+    p->to = m.to;
+    p->id = m.id;
+    p->hop_limit = config.hopLimit;
+    p->want_ack = m.wantAck;
+    p->which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    p->decoded.payload.size = m.payloadLen;
+    memset(p->decoded.payload.bytes, 'x', m.payloadLen);
+    reliableSend(n, p);
+}
+
+void MeshSim::receive(Node &n, meshtastic_MeshPacket *p)
+{
+    n.stats.rxPackets++;
+
+    // ReliableRouter::shouldFilterReceived(), someone relaying our packet is an implicit ACK
+    if (p->from == n.num)
+        stopRetransmission(n, p->from, p->id);
+    delayRetransmissions(n, getPacketTime(p));
+
+    bool filtered = isBroadcast(p->to) || !config.nextHopRouting ? floodingFilter(n, p) : nextHopFilter(n, p);
+    if (!filtered) {
+        markDelivered(n, p);
+        sniffReceived(n, p);
+    }
+    pool.release(p);
+
+    startTransmitTimer(n, getTxDelayMsec(n)); // as SimRadio on ISR_RX
+}
+
+/// ReliableRouter::send()
+void MeshSim::reliableSend(Node &n, meshtastic_MeshPacket *p)
+{
+    if (p->want_ack)
+        startRetransmission(n, pool.allocCopy(*p), NextHopRouter::NUM_RELIABLE_RETX);
+    delayRetransmissions(n, getPacketTime(p), p->id);
+
+    if (isBroadcast(p->to) || !config.nextHopRouting)
+        floodingSend(n, p);
+    else
+        nextHopSend(n, p);
+}
+
+/// NextHopRouter::send()
+void MeshSim::nextHopSend(Node &n, meshtastic_MeshPacket *p)
+{
+    p->relay_node = nodeDB->getLastByteOfNodeNum(n.num);
+    n.history.wasSeenRecently(p);
+
+    p->next_hop = getNextHop(n, p->to, p->relay_node);
+    if (NextHopRouter::shouldStartRetransmission(p, isFromUs(n, p)))
+        startRetransmission(n, pool.allocCopy(*p), NextHopRouter::NUM_INTERMEDIATE_RETX);
+
+    routerSend(n, p);
+}
+
+/// FloodingRouter::send()
+void MeshSim::floodingSend(Node &n, meshtastic_MeshPacket *p)
+{
+    p->relay_node = nodeDB->getLastByteOfNodeNum(n.num);
+    n.history.wasSeenRecently(p);
+    routerSend(n, p);
+}
+
+/// Router::send() and SimRadio::send()
+void MeshSim::routerSend(Node &n, meshtastic_MeshPacket *p)
+{
+    if (isBroadcast(p->to))
+        p->want_ack = false;
+    p->relay_node = nodeDB->getLastByteOfNodeNum(n.num);
+    if (isFromUs(n, p))
+        p->hop_start = p->hop_limit;
+    fixPriority(p);
+
+    if (!n.txQueue.enqueue(p)) {
+        n.stats.txQueueFull++;
+        pool.release(p);
+        return;
+    }
+    setTransmitDelay(n);
+}
+
+/// FloodingRouter::shouldFilterReceived()
+bool MeshSim::floodingFilter(Node &n, const meshtastic_MeshPacket *p)
+{
+    if (!n.history.wasSeenRecently(p))
+        return false;
+
+    n.stats.rxDupes++;
+    if (FloodingRouter::floodingDupeAction(p) == FloodingRouter::DUPE_RESEND) {
+        if (!n.txQueue.find(p->from, p->id))
+            perhapsRebroadcast(n, p);
+    } else {
+        perhapsCancelDupe(n, p);
+    }
+    return true;
+}
+
+/// NextHopRouter::shouldFilterReceived()
+bool MeshSim::nextHopFilter(Node &n, const meshtastic_MeshPacket *p)
+{
+    bool wasFallback = false;
+    bool weWereNextHop = false;
+    if (!n.history.wasSeenRecently(p, true, &wasFallback, &weWereNextHop))
+        return false;
+
+    n.stats.rxDupes++;
+    stopRetransmission(n, p->from, p->id);
+    switch (NextHopRouter::nextHopDupeAction(p, wasFallback, weWereNextHop)) {
+    case FloodingRouter::DUPE_RESEND:
+        if (!n.txQueue.find(p->from, p->id))
+            perhapsRelay(n, p);
+        break;
+    case FloodingRouter::DUPE_RESEND_OR_ACK:
+        if (!n.txQueue.find(p->from, p->id) && !perhapsRelay(n, p) && isToUs(n, p) && p->want_ack)
+            sendAck(n, p, 0);
+        break;
+    case FloodingRouter::DUPE_CANCEL_RELAY:
+        perhapsCancelDupe(n, p);
+        break;
+    case FloodingRouter::DUPE_IGNORE:
+        break;
+    }
+    return true;
+}
+
+/// ReliableRouter::sniffReceived() and NextHopRouter::sniffReceived(), or FloodingRouter::sniffReceived()
+void MeshSim::sniffReceived(Node &n, const meshtastic_MeshPacket *p)
+{
+    bool isAckOrReply = FloodingRouter::isAckOrReply(p);
+
+    if (isToUs(n, p)) {
+        uint8_t hopLimit;
+        if (p->want_ack && ReliableRouter::getAckHopLimit(p, config.hopLimit, &hopLimit))
+            sendAck(n, p, hopLimit);
+        if (p->decoded.request_id) {
+            stopRetransmission(n, p->to, p->decoded.request_id);
+            auto m = messageOf.find(key(n.num, p->decoded.request_id));
+            if (m != messageOf.end())
+                messages[m->second].acked = true;
+        }
+    }
+
+    if (!config.nextHopRouting) {
+        if (isAckOrReply && !isToUs(n, p) && !isBroadcast(p->to))
+            cancelSending(n, p->to, p->decoded.request_id);
+        perhapsRebroadcast(n, p);
+        return;
+    }
+
+    if (isAckOrReply) {
+        // Learn the next hop towards whoever sent the ACK, every node is taken to be in everyone's NodeDB
+        if (NextHopRouter::ackConfirmsNextHop(n.history, p, nodeDB->getLastByteOfNodeNum(n.num)))
+            n.nextHop[p->from] = p->relay_node;
+        if (!isToUs(n, p)) {
+            cancelSending(n, p->to, p->decoded.request_id);
+            stopRetransmission(n, p->to, p->decoded.request_id);
+        }
+    }
+    perhapsRelay(n, p);
+}
+
+/// NextHopRouter::perhapsRelay()
+bool MeshSim::perhapsRelay(Node &n, const meshtastic_MeshPacket *p)
+{
+    if (!NextHopRouter::shouldRelay(p, isToUs(n, p), isFromUs(n, p), nodeDB->getLastByteOfNodeNum(n.num)) ||
+        !isRebroadcaster(n))
+        return false;
+
+    meshtastic_MeshPacket *tosend = pool.allocCopy(*p);
+    tosend->hop_limit--;
+    nextHopSend(n, tosend);
+    return true;
+}
+
+/// FloodingRouter::perhapsRebroadcast()
+void MeshSim::perhapsRebroadcast(Node &n, const meshtastic_MeshPacket *p)
+{
+    if (!FloodingRouter::shouldRebroadcast(p, isToUs(n, p), isFromUs(n, p)) || !isRebroadcaster(n))
+        return;
+
+    meshtastic_MeshPacket *tosend = pool.allocCopy(*p);
+    FloodingRouter::prepareRebroadcast(tosend);
+    routerSend(n, tosend);
+}
+
+/// FloodingRouter::perhapsCancelDupe()
+void MeshSim::perhapsCancelDupe(Node &n, const meshtastic_MeshPacket *p)
+{
+    if (!FloodingRouter::isRouterRole(n.role) && cancelSending(n, p->from, p->id))
+        n.stats.relaysCanceled++;
+}
+
+/// Router::cancelSending()
+bool MeshSim::cancelSending(Node &n, NodeNum from, PacketId id)
+{
+    meshtastic_MeshPacket *p = n.txQueue.remove(from, id);
+    if (!p)
+        return false;
+    pool.release(p);
+    n.history.removeRelayer(nodeDB->getLastByteOfNodeNum(n.num), id, from);
+    return true;
+}
+
+/// RoutingModule::sendAckNak() for an ACK
+void MeshSim::sendAck(Node &n, const meshtastic_MeshPacket *p, uint8_t hopLimit)
+{
+    meshtastic_MeshPacket *ack = pool.allocZeroed();
+    ack->from = n.num;
+    ack->to = p->from;
+    ack->id = randomId();
+    ack->hop_limit = hopLimit;
+    ack->which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    ack->decoded.portnum = meshtastic_PortNum_ROUTING_APP;
+    ack->decoded.request_id = p->id;
+    ack->decoded.payload.size = 2; // a Routing with error_reason NONE
+    reliableSend(n, ack);
+}
+
+/// NextHopRouter::getNextHop()
+uint8_t MeshSim::getNextHop(Node &n, NodeNum to, uint8_t relayNode)
+{
+    auto it = n.nextHop.find(to);
+    return NextHopRouter::chooseNextHop(to, it != n.nextHop.end() ? it->second : NO_NEXT_HOP_PREFERENCE, relayNode);
+}
+
+/// NextHopRouter::startRetransmission(), which takes ownership of p
+void MeshSim::startRetransmission(Node &n, meshtastic_MeshPacket *p, uint8_t numReTx)
+{
+    stopRetransmission(n, p->from, p->id);
+    Pending &pending = n.pending[key(p->from, p->id)];
+    pending = {p, (uint8_t)(numReTx - 1), 0};
+    setNextTx(n, pending);
+}
+
+/// NextHopRouter::stopRetransmission()
+bool MeshSim::stopRetransmission(Node &n, NodeNum from, PacketId id)
+{
+    auto it = n.pending.find(key(from, id));
+    if (it == n.pending.end())
+        return false;
+
+    meshtastic_MeshPacket *p = it->second.packet;
+    if (NextHopRouter::cancelsOnStop(it->second.numRetransmissions, isFromUs(n, p), n.role))
+        cancelSending(n, p->from, p->id);
+    n.pending.erase(it);
+    pool.release(p);
+    return true;
+}
+
+void MeshSim::setNextTx(Node &n, Pending &pending)
+{
+    pending.nextTxMsec = nowMsec + getRetransmissionMsec(n, pending.packet);
+    scheduleRetransmissions(n, pending.nextTxMsec);
+}
+
+void MeshSim::scheduleRetransmissions(Node &n, uint32_t atMsec)
+{
+    if (atMsec < n.retransmitAt) {
+        n.retransmitAt = atMsec;
+        schedule(atMsec, EVENT_RETRANSMIT, n.index);
+    }
+}
+
+/// NextHopRouter::doRetransmissions()
+void MeshSim::doRetransmissions(Node &n)
+{
+    std::vector<uint64_t> due;
+    for (auto &pending : n.pending) {
+        if (pending.second.nextTxMsec <= nowMsec)
+            due.push_back(pending.first);
+    }
+
+    for (uint64_t k : due) {
+        auto it = n.pending.find(k);
+        if (it == n.pending.end())
+            continue;
+        meshtastic_MeshPacket *p = it->second.packet;
+        NextHopRouter::RetransmitAction action = NextHopRouter::retransmitAction(p, it->second.numRetransmissions);
+        if (action == NextHopRouter::RETX_GIVE_UP) {
+            stopRetransmission(n, p->from, p->id); // the sender would NAK to its app here
+            continue;
+        }
+
+        n.stats.retransmissions++;
+        if (action == NextHopRouter::RETX_FLOOD_FORGET_HOP) {
+            p->next_hop = NO_NEXT_HOP_PREFERENCE;
+            n.nextHop.erase(p->to);
+            floodingSend(n, pool.allocCopy(*p));
+        } else if (action == NextHopRouter::RETX_NEXT_HOP) {
+            nextHopSend(n, pool.allocCopy(*p));
+        } else {
+            floodingSend(n, pool.allocCopy(*p));
+        }
+
+        // Sending a relayed packet can start its retransmissions over, keep counting down whichever record is there now
+        it = n.pending.find(k);
+        if (it != n.pending.end()) {
+            it->second.numRetransmissions--;
+            setNextTx(n, it->second);
+        }
+    }
+
+    for (auto &pending : n.pending)
+        scheduleRetransmissions(n, pending.second.nextTxMsec);
+}
+
+/// ReliableRouter pushes back its retransmissions by the airtime of each packet sent or heard, no ACK could arrive meanwhile
+void MeshSim::delayRetransmissions(Node &n, uint32_t msec, PacketId except)
+{
+    for (auto &pending : n.pending) {
+        if (pending.second.packet->id != except)
+            pending.second.nextTxMsec += msec;
+    }
+}
+
+bool MeshSim::isToUs(const Node &n, const meshtastic_MeshPacket *p) const
+{
+    return p->to == n.num;
+}
+
+bool MeshSim::isFromUs(const Node &n, const meshtastic_MeshPacket *p) const
+{
+    return p->from == 0 || p->from == n.num;
+}
+
+bool MeshSim::isRebroadcaster(const Node &n) const
+{
+    return FloodingRouter::isRebroadcaster(n.role, meshtastic_Config_DeviceConfig_RebroadcastMode_ALL);
+}
+
+void MeshSim::markDelivered(Node &n, const meshtastic_MeshPacket *p)
+{
+    if (p->from == n.num || (p->to != n.num && !isBroadcast(p->to)))
+        return;
+    auto m = messageOf.find(key(p->from, p->id));
+    if (m != messageOf.end() && n.index < messages[m->second].delivered.size())
+        messages[m->second].delivered[n.index] = true;
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "MemoryPool.h"
+#include "MeshPacketQueue.h"
+#include "PacketHistory.h"
+#include "configuration.h"
+
+#include <memory>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Many virtual nodes in one process on a simulated LoRa channel, for benchmarking how floods and next hop routing behave with
+ * hundreds of nodes.
+ *
+ * Every node has its own PacketHistory, TX queue (a MeshPacketQueue) and table of next hops, and follows the rules of
+ * ReliableRouter and the NextHopRouter and FloodingRouter beneath it: dupes are filtered, a relay is cancelled when someone beats
+ * us to it, next hops are learnt from ACKs and retransmitted DMs fall back to flooding.  Transmitting follows RadioInterface and
+ * SimRadio: an SNR weighted contention window before relaying, waiting while the channel is busy, and no receiving while
+ * sending.
+ *
+ * Router and its subclasses can't be instantiated per node, they reach the modules, MeshService, NodeDB, channels and crypto
+ * through globals.  So the decisions are made by the static rules on the routers, RoutingModule and RadioInterface, the same
+ * functions the firmware calls, and only the event loop and each node's state live here (each function names the method whose
+ * plumbing it stands in for).  PacketHistory and MeshPacketQueue are the real thing, each owned by its node and on the sim's
+ * clock.  Packets come from the sim's own allocator, not packetPool, which a thousand nodes' queues would exhaust.
+ *
+ * The medium is deterministic for a given seed.  Links have a fixed SNR, plus gaussian fading per reception if asked for.  A
+ * packet is heard if its SNR is above the demodulation floor of the spreading factor, and packets that overlap at a receiver are
+ * lost unless one is captureDb stronger than all the others.  Time is virtual and runs as fast as the events can be handled.
+ */
+class MeshSim
+{
+  public:
+    struct Config {
+        uint8_t sf = 11; // modem settings, the default is LongFast
+        float bw = 250;
+        uint8_t cr = 5;
+        uint16_t preambleLength = 16;
+        uint8_t hopLimit = 3;
+        bool nextHopRouting = true; // false floods DMs too, like FloodingRouter
+        float captureDb = 6;        // a packet survives a collision if it is this much stronger than the rest
+        float fadingDb = 0;         // standard deviation of the SNR of each reception
+        float snrAt1km = 10;        // path loss used by connectByDistance()
+        float pathLossExponent = 3;
+        uint32_t seed = 1;
+    };
+
+    /// What one node did during the run
+    struct NodeStats {
+        uint32_t txPackets;
+        uint32_t txRelays; // of txPackets, ones that weren't from us
+        uint32_t txAirtimeMsec;
+        uint32_t rxPackets; // heard and decoded
+        uint32_t rxDupes;
+        uint32_t rxCollisions;  // lost to another packet
+        uint32_t rxWhileTx;     // lost because we were sending
+        uint32_t relaysCanceled;
+        uint32_t retransmissions;
+        uint32_t txQueueFull;
+        uint64_t cpuNsec; // wall time spent handling this node's events
+    };
+
+    /// Totals for the whole run
+    struct Report {
+        uint32_t broadcasts, broadcastReceivers, broadcastTargets; // every other node is a target of a broadcast
+        uint32_t directs, directsDelivered, directsAcked;
+        uint32_t transmissions, relays;
+        uint32_t redundantRelays; // relays that reached no node that didn't have the packet already
+        uint32_t collisions;
+        uint64_t airtimeMsec;
+        uint64_t cpuNsec;
+        uint32_t durationMsec; // virtual time simulated
+
+        float deliveryRatio() const
+        {
+            uint32_t targets = broadcastTargets + directs;
+            return targets ? float(broadcastReceivers + directsDelivered) / targets : 1;
+        }
+    };
+
+    explicit MeshSim(const Config &config);
+    ~MeshSim();
+
+    /// @return the index of the new node, its NodeNum is getNodeNum(index)
+    size_t addNode(meshtastic_Config_DeviceConfig_Role role = meshtastic_Config_DeviceConfig_Role_CLIENT);
+    size_t numNodes() const { return nodes.size(); }
+    NodeNum getNodeNum(size_t node) const;
+
+    /// Let a and b hear each other at this SNR
+    void link(size_t a, size_t b, float snr);
+
+    /// Place a node, for connectByDistance()
+    void setPosition(size_t node, float xMeters, float yMeters);
+
+    /// Link every pair of nodes that can hear each other at their distance, by a log-distance path loss
+    void connectByDistance();
+
+    /// Add numNodes nodes scattered over a square with sides of sizeMeters, and connect them by distance
+    void placeRandom(size_t numNodes, float sizeMeters);
+
+    /**
+     * Have a node send a text message of payloadLen bytes at virtual time atMsec
+     * @param to a NodeNum, or NODENUM_BROADCAST
+     * @return the message number, for wasDelivered()
+     */
+    size_t send(size_t from, NodeNum to, uint32_t atMsec, uint8_t payloadLen = 32, bool wantAck = false);
+
+    /// Run until nothing is left to do or virtual time reaches untilMsec
+    void run(uint32_t untilMsec);
+
+    uint32_t now() const { return nowMsec; }
+    bool wasDelivered(size_t message, size_t node) const;
+    /// Times the message was relayed, not counting the sender's own transmissions
+    uint32_t getRelays(size_t message) const { return messages[message].relays; }
+    const NodeStats &getNodeStats(size_t node) const;
+    Report report() const;
+
+  private:
+    enum EventType : uint8_t { EVENT_ORIGINATE, EVENT_TX_TIMER, EVENT_TX_DONE, EVENT_RECEIVE, EVENT_RETRANSMIT };
+
+    struct Event {
+        uint32_t time;
+        uint32_t seq; // events at the same time run in the order they were made
+        EventType type;
+        uint32_t node;
+        uint32_t arg;                  // the message to originate
+        meshtastic_MeshPacket *packet; // the packet to receive
+
+        bool operator>(const Event &e) const { return time != e.time ? time > e.time : seq > e.seq; }
+    };
+
+    struct Link {
+        uint32_t node;
+        float snr;
+    };
+
+    struct Pending {
+        meshtastic_MeshPacket *packet;
+        uint8_t numRetransmissions;
+        uint32_t nextTxMsec;
+    };
+
+    struct Transmission {
+        uint32_t node;
+        uint32_t start, end;
+    };
+
+    struct Message {
+        uint32_t from;
+        NodeNum to;
+        uint8_t payloadLen;
+        bool wantAck;
+        PacketId id;
+        bool acked;
+        uint32_t relays;
+        std::vector<bool> delivered;
+    };
+
+    struct Node;
+
+    Config config;
+    MemoryDynamic<meshtastic_MeshPacket> pool;
+    uint32_t slotTimeMsec, maxPacketTimeMsec;
+    float snrFloor;
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::unordered_map<uint64_t, float> linkSnr; // by (from, to) node index
+    std::vector<Message> messages;
+    std::unordered_map<uint64_t, uint32_t> messageOf; // by (from, id)
+    std::vector<Transmission> onAir;                  // on air now, or recently enough to collide with anything still on air
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint32_t nowMsec = 0, nextSeq = 0;
+    uint32_t redundantRelays = 0, collisions = 0;
+    std::mt19937 rng;
+
+    void schedule(uint32_t time, EventType type, uint32_t node, uint32_t arg = 0, meshtastic_MeshPacket *packet = nullptr);
+    void handle(const Event &e, Node &n);
+    uint32_t randomBelow(uint32_t n);
+    PacketId randomId();
+
+    // The medium
+    uint32_t getPacketTime(const meshtastic_MeshPacket *p) const;
+    bool hears(uint32_t to, uint32_t from, float *snr = nullptr) const;
+    bool isChannelActive(const Node &n) const;
+    bool transmittedDuring(const Node &n, const Transmission &t) const;
+    bool collides(const Node &n, const Transmission &t, float snr) const;
+    void logAirtime(Node &n, uint32_t msec);
+    float channelUtilizationPercent(Node &n);
+    void startTransmit(Node &n);
+    void completeTransmit(Node &n);
+
+    // RadioInterface
+    uint32_t getTxDelayMsec(Node &n);
+    uint32_t getTxDelayMsecWeighted(const Node &n, float snr);
+    uint32_t getRetransmissionMsec(Node &n, const meshtastic_MeshPacket *p);
+    void setTransmitDelay(Node &n);
+    void startTransmitTimer(Node &n, uint32_t delayMsec);
+
+    // The routers
+    void originate(Node &n, Message &m);
+    void receive(Node &n, meshtastic_MeshPacket *p);
+    void reliableSend(Node &n, meshtastic_MeshPacket *p);
+    void nextHopSend(Node &n, meshtastic_MeshPacket *p);
+    void floodingSend(Node &n, meshtastic_MeshPacket *p);
+    void routerSend(Node &n, meshtastic_MeshPacket *p);
+    bool floodingFilter(Node &n, const meshtastic_MeshPacket *p);
+    bool nextHopFilter(Node &n, const meshtastic_MeshPacket *p);
+    void sniffReceived(Node &n, const meshtastic_MeshPacket *p);
+    bool perhapsRelay(Node &n, const meshtastic_MeshPacket *p);
+    void perhapsRebroadcast(Node &n, const meshtastic_MeshPacket *p);
+    void perhapsCancelDupe(Node &n, const meshtastic_MeshPacket *p);
+    bool cancelSending(Node &n, NodeNum from, PacketId id);
+    void sendAck(Node &n, const meshtastic_MeshPacket *p, uint8_t hopLimit);
+    uint8_t getNextHop(Node &n, NodeNum to, uint8_t relayNode);
+    void startRetransmission(Node &n, meshtastic_MeshPacket *p, uint8_t numReTx);
+    bool stopRetransmission(Node &n, NodeNum from, PacketId id);
+    void setNextTx(Node &n, Pending &pending);
+    void scheduleRetransmissions(Node &n, uint32_t atMsec);
+    void doRetransmissions(Node &n);
+    void delayRetransmissions(Node &n, uint32_t msec, PacketId except = 0);
+
+    bool isToUs(const Node &n, const meshtastic_MeshPacket *p) const;
+    bool isFromUs(const Node &n, const meshtastic_MeshPacket *p) const;
+    bool isRebroadcaster(const Node &n) const;
+    void markDelivered(Node &n, const meshtastic_MeshPacket *p);
+    size_t indexOf(NodeNum num) const;
+
+    static uint64_t key(uint32_t a, uint32_t b) { return ((uint64_t)a << 32) | b; }
+};
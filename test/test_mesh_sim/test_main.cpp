@@ -0,0 +1,197 @@
+#include "MeshTypes.h"
+#include "NodeDB.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "MeshSim.h"
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdio.h>
+
+namespace
+{
+// Minimal NodeDB, each virtual node keeps its own number so this is only here for the helpers on it
+class MockNodeDB : public NodeDB
+{
+};
+
+const uint32_t RUN_MSEC = 10 * 60 * 1000;
+
+MeshSim::Config defaultConfig()
+{
+    MeshSim::Config config;
+    return config;
+}
+
+// Nodes 0..n-1 in a row, each only hearing its neighbours
+void makeLine(MeshSim &sim, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        sim.addNode();
+        if (i)
+            sim.link(i - 1, i, 5);
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_floodStopsAtHopLimit(void)
+{
+    MeshSim sim(defaultConfig()); // hop limit 3
+    makeLine(sim, 6);
+
+    size_t m = sim.send(0, NODENUM_BROADCAST, 0);
+    sim.run(RUN_MSEC);
+
+    for (size_t i = 1; i <= 4; i++)
+        TEST_ASSERT_TRUE(sim.wasDelivered(m, i));
+    TEST_ASSERT_FALSE(sim.wasDelivered(m, 5));
+    TEST_ASSERT_EQUAL_UINT32(0, sim.getNodeStats(4).txPackets); // got it with no hops left
+    TEST_ASSERT_EQUAL_UINT32(3, sim.report().relays);
+}
+
+void test_hiddenNodesCollide(void)
+{
+    // 0 and 2 can't hear each other, so they both send while 1 is listening
+    MeshSim::Config config = defaultConfig();
+    config.hopLimit = 0;
+    MeshSim sim(config);
+    makeLine(sim, 3);
+
+    size_t a = sim.send(0, NODENUM_BROADCAST, 0);
+    size_t b = sim.send(2, NODENUM_BROADCAST, 0);
+    sim.run(RUN_MSEC);
+    TEST_ASSERT_FALSE(sim.wasDelivered(a, 1));
+    TEST_ASSERT_FALSE(sim.wasDelivered(b, 1));
+    TEST_ASSERT_EQUAL_UINT32(2, sim.getNodeStats(1).rxCollisions);
+
+    // Unless one of them is much stronger
+    sim.link(0, 1, 10);
+    sim.link(2, 1, 0);
+    a = sim.send(0, NODENUM_BROADCAST, RUN_MSEC);
+    b = sim.send(2, NODENUM_BROADCAST, RUN_MSEC);
+    sim.run(2 * RUN_MSEC);
+    TEST_ASSERT_TRUE(sim.wasDelivered(a, 1));
+    TEST_ASSERT_FALSE(sim.wasDelivered(b, 1));
+}
+
+void test_nextHopLearntFromAck(void)
+{
+    // 0 reaches 5 through any of 1..4, which can't hear each other.  1 has the weakest links so it relays first.
+    MeshSim sim(defaultConfig());
+    for (int i = 0; i < 6; i++)
+        sim.addNode();
+    for (int i = 1; i <= 4; i++) {
+        sim.link(0, i, i == 1 ? -10 : 10);
+        sim.link(i, 5, i == 1 ? -10 : 10);
+    }
+    NodeNum to = sim.getNodeNum(5);
+
+    size_t first = sim.send(0, to, 0, 32, true);
+    sim.run(RUN_MSEC);
+    TEST_ASSERT_TRUE(sim.wasDelivered(first, 5));
+    TEST_ASSERT_EQUAL_UINT32(1, sim.report().directsAcked);
+    TEST_ASSERT_GREATER_OR_EQUAL(1, sim.getRelays(first));
+
+    // The ACK came back through 1, so 0 asks 1 alone to relay the next message
+    uint32_t relayed = sim.getNodeStats(1).txRelays;
+    size_t second = sim.send(0, to, RUN_MSEC, 32, true);
+    sim.run(2 * RUN_MSEC);
+    TEST_ASSERT_TRUE(sim.wasDelivered(second, 5));
+    TEST_ASSERT_EQUAL_UINT32(2, sim.report().directsAcked);
+    TEST_ASSERT_EQUAL_UINT32(1, sim.getRelays(second));
+    TEST_ASSERT_GREATER_THAN(relayed, sim.getNodeStats(1).txRelays);
+}
+
+void test_sameSeedSameRun(void)
+{
+    MeshSim::Report reports[2];
+    for (int i = 0; i < 2; i++) {
+        MeshSim sim(defaultConfig());
+        sim.placeRandom(50, 20000);
+        for (uint32_t t = 0; t < 10; t++)
+            sim.send(t * 5 % 50, NODENUM_BROADCAST, t * 20000);
+        sim.run(RUN_MSEC);
+        reports[i] = sim.report();
+    }
+    TEST_ASSERT_EQUAL_UINT32(reports[0].transmissions, reports[1].transmissions);
+    TEST_ASSERT_EQUAL_UINT32(reports[0].broadcastReceivers, reports[1].broadcastReceivers);
+    TEST_ASSERT_EQUAL_UINT32(reports[0].collisions, reports[1].collisions);
+    TEST_ASSERT_EQUAL_UINT32(reports[0].durationMsec, reports[1].durationMsec);
+}
+
+// Not a pass/fail test, prints what a flood and DMs cost as the mesh grows so routing changes can be compared
+void test_benchmark(void)
+{
+    const size_t sizes[] = {100, 300, 1000};
+    const uint32_t numMessages = 40;
+
+    for (size_t numNodes : sizes) {
+        for (int nextHop = 1; nextHop >= 0; nextHop--) {
+            MeshSim::Config config = defaultConfig();
+            config.nextHopRouting = nextHop;
+            config.fadingDb = 2;
+            MeshSim sim(config);
+            // The same 25km square every time, so more nodes make a denser mesh
+            sim.placeRandom(numNodes, 25000);
+
+            // Every other message is a DM with an ACK, sent twice so the second can use what the first learnt
+            std::mt19937 rng(7);
+            for (uint32_t i = 0; i < numMessages; i += 2) {
+                size_t from = rng() % numNodes;
+                sim.send(from, NODENUM_BROADCAST, i * 30000);
+                size_t to = rng() % numNodes;
+                if (to != from) {
+                    sim.send(from, sim.getNodeNum(to), i * 30000 + 15000, 32, true);
+                    sim.send(from, sim.getNodeNum(to), (i + 1) * 30000 + 15000, 32, true);
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            sim.run(numMessages * 30000 + RUN_MSEC);
+            auto wall = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+            MeshSim::Report r = sim.report();
+            printf("%4u nodes, %s: delivery %.1f%% (broadcasts %.1f%%, DMs %u/%u, acked %u), %u tx, %u relays, %u redundant, "
+                   "%u collisions, airtime %.0f s, CPU %.1f us/node/s, %lld ms wall\n",
+                   (unsigned)numNodes, nextHop ? "next hop" : "flooding", r.deliveryRatio() * 100,
+                   r.broadcastTargets ? 100.0f * r.broadcastReceivers / r.broadcastTargets : 0.0f, r.directsDelivered,
+                   r.directs, r.directsAcked, r.transmissions, r.relays, r.redundantRelays, r.collisions,
+                   r.airtimeMsec / 1000.0, r.cpuNsec / 1000.0 / numNodes / (r.durationMsec / 1000.0), (long long)wall);
+        }
+    }
+}
+#endif
+
+void setup()
+{
+    initializeTestEnvironment();
+#ifdef ARCH_PORTDUINO
+    const std::unique_ptr<MockNodeDB> mockNodeDB(new MockNodeDB());
+    nodeDB = mockNodeDB.get();
+#endif
+
+    UNITY_BEGIN();
+#ifdef ARCH_PORTDUINO
+    RUN_TEST(test_floodStopsAtHopLimit);
+    RUN_TEST(test_hiddenNodesCollide);
+    RUN_TEST(test_nextHopLearntFromAck);
+    RUN_TEST(test_sameSeedSameRun);
+    RUN_TEST(test_benchmark);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
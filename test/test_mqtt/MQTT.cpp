@@ -11,6 +11,7 @@
 #include "modules/RoutingModule.h"
 #include "mqtt/MQTT.h"
 #include "mqtt/ServiceEnvelope.h"
+#include "serialization/MeshPacketSerializer.h"
 
 #include <PubSubClient.h>
 #include <WiFiClient.h>
@@ -26,6 +27,7 @@
 #include <string_view>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace
 {
@@ -249,7 +251,9 @@ class MQTTUnitTest : public MQTT
     }
     using MQTT::isValidConfig;
     using MQTT::reconnect;
-    int queueSize() { return mqttQueue.numUsed(); }
+    int queueSize() { return mqttQueue.size(); }
+    const QueueStats &getQueueStats() { return queueStats; }
+    const QueueEntry &queueFront() { return *mqttQueue.front(); }
     void reportToMap(std::optional<uint32_t> precision = std::nullopt)
     {
         if (precision.has_value())
@@ -491,6 +495,63 @@ void test_sendQueued(void)
     TEST_ASSERT_EQUAL(decoded.id, env.packet->id);
 }
 
+// Test that a backlog bigger than the RAM queue spills to disk and is published in order once reconnected.
+void test_sendQueuedBacklog(void)
+{
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+
+    const int count = MAX_MQTT_QUEUE + 10;
+    for (int i = 0; i < count; i++) {
+        meshtastic_MeshPacket p = decoded;
+        p.id = 100 + i;
+        mqtt->onSend(encrypted, p, 0);
+    }
+    TEST_ASSERT_EQUAL(MAX_MQTT_QUEUE, unitTest->queueSize());
+#if MQTT_BACKLOG_SEGMENTS
+    TEST_ASSERT_EQUAL(10, unitTest->getQueueStats().spilled);
+    TEST_ASSERT_EQUAL(0, unitTest->getQueueStats().dropped);
+#endif
+
+    pubsub->refuseConnection_ = false;
+#if MQTT_BACKLOG_SEGMENTS
+    const size_t expected = count;
+#else
+    const size_t expected = MAX_MQTT_QUEUE;
+#endif
+    std::vector<uint32_t> ids;
+    TEST_ASSERT_TRUE(loopUntil([&ids, expected] {
+        ids.clear();
+        for (const auto &[topic, payload] : pubsub->published_) {
+            if (topic == "msh/2/e/test/!12345678")
+                ids.push_back(std::get<DecodedServiceEnvelope>(payload).packet->id);
+        }
+        return ids.size() >= expected;
+    }));
+    TEST_ASSERT_EQUAL(0, unitTest->queueSize());
+
+    // Without a backlog the oldest were dropped
+    TEST_ASSERT_EQUAL(expected, ids.size());
+    for (size_t i = 0; i < expected; i++)
+        TEST_ASSERT_EQUAL(100 + count - expected + i, ids[i]);
+}
+
+// Test that the JSON for a queued packet is rendered from the decoded packet when it is queued.
+void test_sendQueuedJson(void)
+{
+    moduleConfig.mqtt.json_enabled = true;
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+
+    mqtt->onSend(encrypted, decoded, 0);
+    TEST_ASSERT_EQUAL(1, unitTest->queueSize());
+    const auto &entry = unitTest->queueFront();
+    TEST_ASSERT_EQUAL_STRING("msh/2/json/test/!12345678", entry.jsonTopic.c_str());
+    TEST_ASSERT_EQUAL_STRING(MeshPacketSerializer::JsonSerialize(&decoded, false).c_str(), entry.json.c_str());
+}
+
 // Verify reconnecting with the proxy enabled does not reconnect to a MQTT server.
 void test_reconnectProxyDoesNotReconnectMqtt(void)
 {
@@ -882,6 +943,8 @@ void setup()
     RUN_TEST(test_noRangeTestAppOnDefaultServer);
     RUN_TEST(test_noDetectionSensorAppOnDefaultServer);
     RUN_TEST(test_sendQueued);
+    RUN_TEST(test_sendQueuedBacklog);
+    RUN_TEST(test_sendQueuedJson);
     RUN_TEST(test_reconnectProxyDoesNotReconnectMqtt);
     RUN_TEST(test_receiveEmptyMeshPacket);
     RUN_TEST(test_receiveDecodedProto);
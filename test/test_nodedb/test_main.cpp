@@ -0,0 +1,444 @@
+#include "NodeDB.h"
+#include "NodeDBStore.h"
+#include "NodeEvictionQueue.h"
+#include "NodeNumIndex.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_findInsertErase(void)
+{
+    NodeNumIndex index;
+    index.reset(8);
+
+    TEST_ASSERT_EQUAL_UINT16(NodeNumIndex::NOT_FOUND, index.find(0x12345678));
+    index.insert(0x12345678, 3);
+    index.insert(0xdeadbeef, 0);
+    TEST_ASSERT_EQUAL_UINT16(3, index.find(0x12345678));
+    TEST_ASSERT_EQUAL_UINT16(0, index.find(0xdeadbeef));
+
+    // Re-inserting moves the mapping instead of adding a second entry
+    index.insert(0x12345678, 5);
+    TEST_ASSERT_EQUAL_UINT16(5, index.find(0x12345678));
+    TEST_ASSERT_EQUAL(2, index.size());
+
+    index.erase(0x12345678);
+    TEST_ASSERT_EQUAL_UINT16(NodeNumIndex::NOT_FOUND, index.find(0x12345678));
+    TEST_ASSERT_EQUAL_UINT16(0, index.find(0xdeadbeef));
+    TEST_ASSERT_EQUAL(1, index.size());
+}
+
+// Random churn against std::unordered_map to exercise backward-shift deletion across wrapped probe chains
+void test_matchesReferenceUnderChurn(void)
+{
+    NodeNumIndex index;
+    index.reset(500);
+    std::unordered_map<NodeNum, uint16_t> reference;
+    std::mt19937 rng(1);
+
+    for (int i = 0; i < 200000; i++) {
+        NodeNum n = rng() % 2000;
+        switch (rng() % 3) {
+        case 0:
+            if (reference.size() < 500 || reference.count(n)) {
+                uint16_t slot = rng() % 500;
+                index.insert(n, slot);
+                reference[n] = slot;
+            }
+            break;
+        case 1:
+            index.erase(n);
+            reference.erase(n);
+            break;
+        default: {
+            auto it = reference.find(n);
+            TEST_ASSERT_EQUAL_UINT16(it == reference.end() ? NodeNumIndex::NOT_FOUND : it->second, index.find(n));
+        }
+        }
+    }
+    TEST_ASSERT_EQUAL(reference.size(), index.size());
+}
+
+// Lookup cost should stay flat as the DB grows, unlike the old linear scan in NodeDB::getMeshNode
+void test_lookupBenchmark(void)
+{
+    const size_t sizes[] = {100, 1000, 5000, 20000};
+    std::mt19937 rng(2);
+
+    for (size_t count : sizes) {
+        NodeNumIndex index;
+        index.reset(count);
+        std::vector<NodeNum> nums(count);
+        for (size_t i = 0; i < count; i++) {
+            nums[i] = rng();
+            index.insert(nums[i], i);
+        }
+
+        const size_t lookups = 1000000;
+        uint32_t hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; i++)
+            hits += index.find(nums[(i * 7919) % count]) != NodeNumIndex::NOT_FOUND;
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        TEST_ASSERT_EQUAL(lookups, hits);
+        printf("NodeNumIndex: %u nodes, %.1f ns/lookup\n", (unsigned)count, (double)elapsed.count() / lookups);
+    }
+}
+
+// The victim the old linear scan in NodeDB::getOrCreateMeshNode would have picked
+static int32_t oldestUnpinnedSlot(const std::vector<meshtastic_NodeInfoLite> &nodes)
+{
+    int32_t best = -1;
+    for (size_t i = 1; i < nodes.size(); i++) {
+        const meshtastic_NodeInfoLite &n = nodes[i];
+        if (n.is_favorite || n.is_ignored || (n.bitfield & NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK))
+            continue;
+        if (best == -1) {
+            best = i;
+            continue;
+        }
+        const meshtastic_NodeInfoLite &b = nodes[best];
+        bool nBoring = n.user.public_key.size == 0, bBoring = b.user.public_key.size == 0;
+        if (nBoring != bBoring ? nBoring : n.last_heard < b.last_heard)
+            best = i;
+    }
+    return best;
+}
+
+// Churn 10k unique senders through a 500 slot DB the same way getOrCreateMeshNode does, checking every eviction against a
+// full scan and that slots are recycled in place
+void test_evictionChurn(void)
+{
+    const size_t slots = 500;
+    const NodeNum senders = 10000;
+    std::vector<meshtastic_NodeInfoLite> nodes(slots);
+    NodeNumIndex index;
+    NodeEvictionQueue queue;
+    std::mt19937 rng(3);
+    uint32_t now = 1000;
+
+    nodes[0].num = 0x1;
+    nodes[0].last_heard = now;
+    index.reset(slots);
+    index.insert(nodes[0].num, 0);
+    queue.rebuild(nodes.data(), 1);
+    size_t used = 1;
+
+    auto start = std::chrono::steady_clock::now();
+    for (NodeNum sender = 0x100; sender < 0x100 + senders; sender++) {
+        size_t slot;
+        if (used < slots) {
+            slot = used++;
+        } else {
+            int32_t expected = oldestUnpinnedSlot(nodes);
+            int32_t victim = queue.pickVictim(nodes.data(), used);
+            TEST_ASSERT_EQUAL(expected, victim);
+            index.erase(nodes[victim].num);
+            slot = victim;
+        }
+        memset(&nodes[slot], 0, sizeof(nodes[slot]));
+        nodes[slot].num = sender;
+        nodes[slot].last_heard = ++now;
+        if (sender % 3 == 0)
+            nodes[slot].user.public_key.size = 32;
+        if (sender % 97 == 0)
+            nodes[slot].is_favorite = true;
+        index.insert(sender, slot);
+        queue.add(nodes.data(), slot);
+
+        // Keep hearing from a few random known nodes, which leaves their heap entries stale
+        for (int i = 0; i < 3; i++) {
+            meshtastic_NodeInfoLite &heard = nodes[1 + rng() % (used - 1)];
+            heard.last_heard = ++now;
+            TEST_ASSERT_EQUAL_UINT16(&heard - nodes.data(), index.find(heard.num));
+        }
+
+        // Now and then a node's clock goes backwards or it loses its key, which leaves its heap entry too large
+        if (sender % 50 == 0) {
+            meshtastic_NodeInfoLite &lowered = nodes[1 + rng() % (used - 1)];
+            lowered.last_heard -= std::min<uint32_t>(lowered.last_heard, 2000);
+            if (sender % 100 == 0)
+                lowered.user.public_key.size = 0;
+            queue.markStale();
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    TEST_ASSERT_EQUAL(slots - 1, queue.size());
+    TEST_ASSERT_EQUAL(slots, index.size());
+    for (size_t i = 0; i < slots; i++)
+        TEST_ASSERT_EQUAL_UINT16(i, index.find(nodes[i].num));
+    printf("NodeEvictionQueue: %u senders through %u slots in %lld us (including reference scans)\n", (unsigned)senders,
+           (unsigned)slots, (long long)elapsed.count());
+}
+
+
+#if defined(FSCom) && NODEDB_JOURNAL
+
+static const char *testSnapshotFile = "/prefs/test_nodes.proto";
+static const char *testJournalFile = "/prefs/test_nodes.journal";
+
+static meshtastic_NodeInfoLite makeNode(NodeNum num, uint32_t lastHeard)
+{
+    meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_zero;
+    node.num = num;
+    node.has_user = true;
+    snprintf(node.user.long_name, sizeof(node.user.long_name), "Node %08x", num);
+    snprintf(node.user.short_name, sizeof(node.user.short_name), "%04x", num & 0xffff);
+    node.user.public_key.size = 32;
+    memset(node.user.public_key.bytes, num & 0xff, 32);
+    node.has_position = true;
+    node.position.latitude_i = num * 13;
+    node.position.longitude_i = num * 7;
+    node.last_heard = lastHeard;
+    node.snr = (num % 40) - 20;
+    return node;
+}
+
+static meshtastic_NodeDatabase makeDatabase(size_t count)
+{
+    meshtastic_NodeDatabase db = {};
+    db.version = 24;
+    for (size_t i = 0; i < count; i++)
+        db.nodes.push_back(makeNode(0x1000 + i, 1000 + i));
+    return db;
+}
+
+// The nodes in a DB by number, encoded, so DBs can be compared whatever slots their nodes ended up in
+static std::map<NodeNum, std::string> contents(const meshtastic_NodeDatabase &db)
+{
+    std::map<NodeNum, std::string> result;
+    uint8_t buf[meshtastic_NodeInfoLite_size];
+    for (const meshtastic_NodeInfoLite &node : db.nodes) {
+        if (node.num)
+            result[node.num] = std::string((char *)buf, pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_NodeInfoLite_msg, &node));
+    }
+    return result;
+}
+
+static std::string readTestFile(const char *name)
+{
+    std::string data;
+    auto f = FSCom.open(name, FILE_O_READ);
+    int c;
+    while (f && (c = f.read()) >= 0)
+        data.push_back(c);
+    f.close();
+    return data;
+}
+
+static void writeTestFile(const char *name, const std::string &data)
+{
+    FSCom.remove(name);
+    auto f = FSCom.open(name, FILE_O_WRITE);
+    f.write((const uint8_t *)data.data(), data.size());
+    f.close();
+}
+
+static std::map<NodeNum, std::string> loadTestFiles()
+{
+    NodeDBStore store(testSnapshotFile, testJournalFile);
+    meshtastic_NodeDatabase db = {};
+    TEST_ASSERT_TRUE(store.load(db, SIZE_MAX));
+    return contents(db);
+}
+
+static void removeTestFiles()
+{
+    FSCom.remove(testSnapshotFile);
+    FSCom.remove(testJournalFile);
+}
+
+void test_journalReplay(void)
+{
+    removeTestFiles();
+    NodeDBStore store(testSnapshotFile, testJournalFile);
+    meshtastic_NodeDatabase db = makeDatabase(50);
+
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    TEST_ASSERT_EQUAL(1, store.getStats().snapshots);
+
+    // Change a few nodes, forget one, hear a new one
+    db.nodes[3].last_heard = 5000;
+    db.nodes[17].snr = 9;
+    db.nodes.erase(db.nodes.begin() + 20);
+    db.nodes.push_back(makeNode(0x9000, 6000));
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    TEST_ASSERT_EQUAL(1, store.getStats().snapshots);
+    TEST_ASSERT_EQUAL(1, store.getStats().journalSaves);
+    TEST_ASSERT_TRUE(contents(db) == loadTestFiles());
+
+    // Nothing changed, nothing written
+    uint64_t written = store.getStats().bytesWritten;
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    TEST_ASSERT_EQUAL(written, store.getStats().bytesWritten);
+
+    // Picking up where another store left off
+    NodeDBStore reloaded(testSnapshotFile, testJournalFile);
+    meshtastic_NodeDatabase db2 = {};
+    TEST_ASSERT_TRUE(reloaded.load(db2, SIZE_MAX));
+    db2.nodes[0].last_heard = 7000;
+    TEST_ASSERT_TRUE(reloaded.save(db2, db2.nodes.size()));
+    TEST_ASSERT_EQUAL(1, reloaded.getStats().journalSaves);
+    TEST_ASSERT_TRUE(contents(db2) == loadTestFiles());
+
+    removeTestFiles();
+}
+
+// Cut the journal short at every byte, as a crash or power loss during a save might.  Loading must always give back the DB as
+// it was after the last save that finished.
+void test_journalCrashConsistency(void)
+{
+    removeTestFiles();
+    NodeDBStore store(testSnapshotFile, testJournalFile);
+    meshtastic_NodeDatabase db = makeDatabase(50);
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    auto state0 = contents(db);
+
+    for (int i = 0; i < 10; i++)
+        db.nodes[i * 4].last_heard += 100;
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    auto state1 = contents(db);
+    size_t size1 = readTestFile(testJournalFile).size();
+
+    db.nodes.erase(db.nodes.begin() + 30, db.nodes.begin() + 35);
+    db.nodes.push_back(makeNode(0x9000, 6000));
+    db.nodes[1].has_position = false;
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    auto state2 = contents(db);
+    std::string journal = readTestFile(testJournalFile);
+    TEST_ASSERT_EQUAL(2, store.getStats().journalSaves);
+
+    for (size_t cut = 0; cut <= journal.size(); cut++) {
+        writeTestFile(testJournalFile, journal.substr(0, cut));
+        auto loaded = loadTestFiles();
+        if (cut < size1)
+            TEST_ASSERT_TRUE(loaded == state0);
+        else if (cut < journal.size())
+            TEST_ASSERT_TRUE(loaded == state1);
+        else
+            TEST_ASSERT_TRUE(loaded == state2);
+    }
+
+    // A flipped bit in the last save drops just that save
+    journal[journal.size() - 20] ^= 1;
+    writeTestFile(testJournalFile, journal);
+    NodeDBStore recovered(testSnapshotFile, testJournalFile);
+    meshtastic_NodeDatabase db2 = {};
+    TEST_ASSERT_TRUE(recovered.load(db2, SIZE_MAX));
+    TEST_ASSERT_TRUE(contents(db2) == state1);
+
+    // and the next save goes to a fresh snapshot rather than after the damage
+    db2.nodes[2].last_heard += 100;
+    TEST_ASSERT_TRUE(recovered.save(db2, db2.nodes.size()));
+    TEST_ASSERT_EQUAL(1, recovered.getStats().snapshots);
+    TEST_ASSERT_TRUE(contents(db2) == loadTestFiles());
+
+    removeTestFiles();
+}
+
+// A crash after a new snapshot is written but before the old journal is deleted leaves a journal for the old snapshot
+void test_staleJournalIgnored(void)
+{
+    removeTestFiles();
+    NodeDBStore store(testSnapshotFile, testJournalFile);
+    meshtastic_NodeDatabase db = makeDatabase(50);
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    db.nodes[5].last_heard += 100;
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size()));
+    std::string staleJournal = readTestFile(testJournalFile);
+
+    db.nodes[5].last_heard += 100;
+    db.nodes[6].last_heard += 100;
+    TEST_ASSERT_TRUE(store.save(db, db.nodes.size(), true));
+    TEST_ASSERT_FALSE(FSCom.exists(testJournalFile));
+    writeTestFile(testJournalFile, staleJournal);
+    TEST_ASSERT_TRUE(contents(db) == loadTestFiles());
+
+    removeTestFiles();
+}
+
+// An hour of a busy mesh: 3000 nodes, 100 of them heard from each minute and the DB saved once a minute, written out in full
+// each time as before or through the journal.  Both the times and the bytes depend on the encoded size of each NodeInfoLite (about
+// 84 bytes for these nodes), so the figures only mean something with the real NodeInfoLite encoding.
+void test_saveBenchmark(void)
+{
+    const size_t numNodes = 3000;
+    const int saves = 60, changesPerSave = 100;
+
+    for (bool journal : {false, true}) {
+        removeTestFiles();
+        NodeDBStore store(testSnapshotFile, testJournalFile);
+        meshtastic_NodeDatabase db = makeDatabase(numNodes);
+        TEST_ASSERT_TRUE(store.save(db, numNodes, true));
+        uint64_t firstWrite = store.getStats().bytesWritten;
+        std::mt19937 rng(4);
+        uint32_t now = 10000;
+
+        std::vector<double> took;
+        for (int i = 0; i < saves; i++) {
+            for (int c = 0; c < changesPerSave; c++) {
+                meshtastic_NodeInfoLite &heard = db.nodes[1 + rng() % (numNodes - 1)];
+                heard.last_heard = ++now;
+                heard.snr = (int)(rng() % 40) - 20;
+            }
+            auto start = std::chrono::steady_clock::now();
+            TEST_ASSERT_TRUE(store.save(db, numNodes, !journal));
+            took.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        TEST_ASSERT_TRUE(contents(db) == loadTestFiles());
+
+        const NodeDBStore::Stats &stats = store.getStats();
+        double total = 0;
+        for (double t : took)
+            total += t;
+        std::sort(took.begin(), took.end());
+        printf("NodeDB save, %s: %.2f ms median, %.2f ms average, %.2f ms worst, %.1f KB written per hour (%u snapshots)\n",
+               journal ? "journal" : "full rewrite", took[saves / 2] * 1e3, total / saves * 1e3, took.back() * 1e3,
+               (stats.bytesWritten - firstWrite) / 1024.0, stats.snapshots - 1);
+    }
+    removeTestFiles();
+}
+
+#endif
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+#ifdef FSCom
+    FSCom.mkdir("/prefs");
+#endif
+    UNITY_BEGIN();
+    RUN_TEST(test_findInsertErase);
+    RUN_TEST(test_matchesReferenceUnderChurn);
+    RUN_TEST(test_lookupBenchmark);
+    RUN_TEST(test_evictionChurn);
+#if defined(FSCom) && NODEDB_JOURNAL
+    RUN_TEST(test_journalReplay);
+    RUN_TEST(test_journalCrashConsistency);
+    RUN_TEST(test_staleJournalIgnored);
+    RUN_TEST(test_saveBenchmark);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
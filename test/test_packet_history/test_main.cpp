@@ -0,0 +1,176 @@
+#include "MeshTypes.h"
+#include "NodeDB.h"
+#include "PacketHistory.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include <chrono>
+#include <memory>
+
+namespace
+{
+// Minimal NodeDB, PacketHistory only needs our own node number from it.
+class MockNodeDB : public NodeDB
+{
+};
+
+meshtastic_MeshPacket makePacket(NodeNum from, PacketId id, uint8_t relayNode = 0)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = from;
+    p.to = NODENUM_BROADCAST;
+    p.id = id;
+    p.relay_node = relayNode;
+    return p;
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_seenOnSecondSighting(void)
+{
+    PacketHistory history;
+    meshtastic_MeshPacket p = makePacket(0x1234, 42);
+
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&p));
+
+    // Same id from someone else is a different packet
+    meshtastic_MeshPacket other = makePacket(0x5678, 42);
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&other, false));
+}
+
+void test_zeroIdIsNeverRecorded(void)
+{
+    PacketHistory history;
+    meshtastic_MeshPacket p = makePacket(0x1234, 0);
+
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+}
+
+void test_relayersUpdatedInPlace(void)
+{
+    PacketHistory history;
+    meshtastic_MeshPacket first = makePacket(0x1234, 7, 0x11);
+    meshtastic_MeshPacket second = makePacket(0x1234, 7, 0x22);
+
+    history.wasSeenRecently(&first);
+    history.wasSeenRecently(&second);
+    TEST_ASSERT_TRUE(history.wasRelayer(0x11, 7, 0x1234));
+    TEST_ASSERT_TRUE(history.wasRelayer(0x22, 7, 0x1234));
+    TEST_ASSERT_FALSE(history.wasRelayer(0x33, 7, 0x1234));
+
+    history.removeRelayer(0x11, 7, 0x1234);
+    TEST_ASSERT_FALSE(history.wasRelayer(0x11, 7, 0x1234));
+    TEST_ASSERT_TRUE(history.wasRelayer(0x22, 7, 0x1234));
+}
+
+void test_oldestDroppedWhenFull(void)
+{
+    PacketHistory history;
+    const uint32_t capacity = PACKETHISTORY_MAX;
+
+    for (uint32_t id = 1; id <= capacity + 1; id++) {
+        meshtastic_MeshPacket p = makePacket(0x1234, id);
+        TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    }
+
+    meshtastic_MeshPacket oldest = makePacket(0x1234, 1);
+    meshtastic_MeshPacket second = makePacket(0x1234, 2);
+    meshtastic_MeshPacket newest = makePacket(0x1234, capacity + 1);
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&oldest, false));
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&second, false));
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&newest, false));
+}
+
+// A record heard again is the last to go, even from the head of a full ring
+void test_refreshedRecordKept(void)
+{
+    PacketHistory history;
+    const uint32_t capacity = PACKETHISTORY_MAX;
+
+    for (uint32_t id = 1; id <= capacity; id++) {
+        meshtastic_MeshPacket p = makePacket(0x1234, id);
+        TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    }
+    meshtastic_MeshPacket oldest = makePacket(0x1234, 1);
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&oldest));
+
+    meshtastic_MeshPacket newest = makePacket(0x1234, capacity + 1);
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&newest));
+
+    meshtastic_MeshPacket second = makePacket(0x1234, 2);
+    meshtastic_MeshPacket third = makePacket(0x1234, 3);
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&oldest, false));
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&second, false));
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&third, false));
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&newest, false));
+}
+
+// A history with its own owner and clock, as MeshSim's nodes have, ages records by that clock alone
+void test_ownerClock(void)
+{
+    PacketHistory history;
+    uint32_t clockMsec = 0;
+    history.setOwner(0x5678, &clockMsec);
+
+    meshtastic_MeshPacket p = makePacket(0x1234, 42);
+    p.next_hop = 0x78;
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    clockMsec = FLOOD_EXPIRE_TIME - 1;
+    bool weWereNextHop = false;
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&p, true, nullptr, &weWereNextHop));
+    TEST_ASSERT_TRUE(weWereNextHop);
+
+    clockMsec += FLOOD_EXPIRE_TIME;
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p, false));
+}
+
+// A flood where every packet is heard three times, as a busy router would see it
+void test_floodBenchmark(void)
+{
+    PacketHistory history;
+    const uint32_t packets = 300000;
+    uint32_t dupes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < packets; i++) {
+        for (uint8_t relay = 1; relay <= 3; relay++) {
+            meshtastic_MeshPacket p = makePacket(0x1000 + (i % 64), i + 1, relay);
+            dupes += history.wasSeenRecently(&p);
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    TEST_ASSERT_EQUAL(packets * 2, dupes);
+    printf("PacketHistory: %u records, %.1f ns/wasSeenRecently\n", (unsigned)PACKETHISTORY_MAX,
+           (double)elapsed.count() / (packets * 3));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    const std::unique_ptr<MockNodeDB> mockNodeDB(new MockNodeDB());
+    nodeDB = mockNodeDB.get();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_seenOnSecondSighting);
+    RUN_TEST(test_zeroIdIsNeverRecorded);
+    RUN_TEST(test_relayersUpdatedInPlace);
+    RUN_TEST(test_oldestDroppedWhenFull);
+    RUN_TEST(test_refreshedRecordKept);
+    RUN_TEST(test_ownerClock);
+    RUN_TEST(test_floodBenchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,208 @@
+#include "TestUtil.h"
+#include "graphics/PageBufferDiff.h"
+#include <unity.h>
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+const uint16_t ON = 0x67F2, OFF = 0x0000;
+
+// What a TFT would show, fed by the spans
+struct FakeScreen {
+    uint16_t width, height;
+    std::vector<uint16_t> pixels;
+    uint32_t spans = 0;
+
+    FakeScreen(uint16_t width, uint16_t height) : width(width), height(height), pixels(width * height, OFF) {}
+
+    PageBufferDiff::PushSpan pusher()
+    {
+        return [this](uint16_t x, uint16_t y, uint16_t w, const uint16_t *line) {
+            TEST_ASSERT_TRUE(x + w <= width && y < height);
+            memcpy(&pixels[y * width + x], line, w * sizeof(uint16_t));
+            spans++;
+        };
+    }
+};
+
+struct Frame {
+    uint16_t width, height;
+    std::vector<uint8_t> buffer;
+
+    Frame(uint16_t width, uint16_t height) : width(width), height(height), buffer(width * ((height + 7) / 8)) {}
+
+    void set(uint16_t x, uint16_t y, bool on)
+    {
+        uint8_t &b = buffer[x + (y / 8) * width];
+        b = on ? b | (1 << (y & 7)) : b & ~(1 << (y & 7));
+    }
+    bool get(uint16_t x, uint16_t y) const { return buffer[x + (y / 8) * width] & (1 << (y & 7)); }
+};
+
+void assertShows(const FakeScreen &screen, const Frame &frame)
+{
+    for (uint16_t y = 0; y < frame.height; y++) {
+        for (uint16_t x = 0; x < frame.width; x++)
+            TEST_ASSERT_EQUAL_HEX16(frame.get(x, y) ? ON : OFF, screen.pixels[y * frame.width + x]);
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_unchangedFramePushesNothing(void)
+{
+    Frame frame(128, 64);
+    std::vector<uint8_t> back(frame.buffer.size());
+    frame.set(10, 10, true);
+    PageBufferDiff diff(128, 64);
+    FakeScreen screen(128, 64);
+
+    TEST_ASSERT_EQUAL_UINT32(1, diff.update(frame.buffer.data(), back.data(), false, ON, OFF, screen.pusher()));
+    TEST_ASSERT_EQUAL_UINT32(0, diff.update(frame.buffer.data(), back.data(), false, ON, OFF, screen.pusher()));
+    TEST_ASSERT_EQUAL_UINT32(1, screen.spans);
+    TEST_ASSERT_EQUAL_MEMORY(frame.buffer.data(), back.data(), back.size());
+}
+
+void test_smallGapsJoinSpans(void)
+{
+    Frame frame(128, 64);
+    std::vector<uint8_t> back(frame.buffer.size());
+    PageBufferDiff diff(128, 64);
+    FakeScreen screen(128, 64);
+
+    frame.set(20, 3, true);
+    frame.set(20 + PageBufferDiff::MAX_GAP + 1, 3, true); // joined, the gap between is sent too
+    frame.set(100, 3, true);                              // too far
+    TEST_ASSERT_EQUAL_UINT32(PageBufferDiff::MAX_GAP + 2 + 1,
+                             diff.update(frame.buffer.data(), back.data(), false, ON, OFF, screen.pusher()));
+    TEST_ASSERT_EQUAL_UINT32(2, screen.spans);
+    assertShows(screen, frame);
+}
+
+void test_randomFramesMatch(void)
+{
+    // Odd sizes, so the last page is partly off screen and rows don't end on a word
+    const uint16_t width = 131, height = 61;
+    Frame frame(width, height);
+    std::vector<uint8_t> back(frame.buffer.size());
+    PageBufferDiff diff(width, height);
+    FakeScreen screen(width, height);
+    std::mt19937 rng(3);
+
+    for (int i = 0; i < 50; i++) {
+        // A few scattered pixels, and sometimes a filled block
+        for (int n = rng() % 40; n; n--)
+            frame.set(rng() % width, rng() % height, rng() & 1);
+        if (i % 5 == 0) {
+            uint16_t x0 = rng() % width, y0 = rng() % height, on = rng() & 1;
+            for (uint16_t y = y0; y < height && y < y0 + 20; y++)
+                for (uint16_t x = x0; x < width && x < x0 + 30; x++)
+                    frame.set(x, y, on);
+        }
+        diff.update(frame.buffer.data(), back.data(), false, ON, OFF, screen.pusher());
+        assertShows(screen, frame);
+        TEST_ASSERT_EQUAL_MEMORY(frame.buffer.data(), back.data(), back.size());
+    }
+}
+
+void test_fromBlankRedrawsLitPixels(void)
+{
+    Frame frame(64, 32);
+    std::vector<uint8_t> back(frame.buffer.size(), 0xff); // whatever was there before, the screen has been cleared
+    PageBufferDiff diff(64, 32);
+    FakeScreen screen(64, 32);
+    frame.set(5, 5, true);
+    frame.set(60, 30, true);
+
+    TEST_ASSERT_EQUAL_UINT32(2, diff.update(frame.buffer.data(), back.data(), true, ON, OFF, screen.pusher()));
+    assertShows(screen, frame);
+    TEST_ASSERT_EQUAL_MEMORY(frame.buffer.data(), back.data(), back.size());
+}
+
+// Not a pass/fail test, prints what a frame costs compared to sending each changed pixel on its own
+void test_benchmark(void)
+{
+    const uint16_t width = 320, height = 240;
+    // On the wire a pixel or span needs its column and row set (2 x 5 bytes) and a write command, then 2 bytes a pixel
+    const uint32_t WINDOW_BYTES = 11;
+    const int FRAMES = 200;
+
+    struct Scene {
+        const char *name;
+        void (*draw)(Frame &f, int frame);
+    } scenes[] = {
+        {"clock tick", [](Frame &f, int n) {
+             for (uint16_t y = 20; y < 44; y++)
+                 for (uint16_t x = 200; x < 260; x++)
+                     f.set(x, y, ((x / 3 + y / 4 + n) % 5) == 0);
+         }},
+        {"text scroll", [](Frame &f, int n) {
+             for (uint16_t y = 0; y < f.height; y++)
+                 for (uint16_t x = 0; x < f.width; x++)
+                     f.set(x, y, ((x / 2) * 7 + (y + n) / 2 * 3) % 11 < 3);
+         }},
+        {"page flip", [](Frame &f, int n) {
+             for (uint16_t y = 0; y < f.height; y++)
+                 for (uint16_t x = 0; x < f.width; x++)
+                     f.set(x, y, n & 1 ? (x * y) % 7 == 0 : (x + y) % 5 == 0);
+         }},
+    };
+
+    for (auto &scene : scenes) {
+        Frame frame(width, height);
+        std::vector<uint8_t> back(frame.buffer.size());
+        PageBufferDiff diff(width, height);
+        uint32_t spans = 0, pixels = 0;
+        uint64_t changedPixels = 0;
+        std::chrono::nanoseconds spent(0);
+
+        for (int n = 0; n < FRAMES; n++) {
+            scene.draw(frame, n);
+            for (uint16_t y = 0; y < height; y++)
+                for (uint16_t x = 0; x < width; x++)
+                    changedPixels += frame.get(x, y) != bool(back[x + (y / 8) * width] & (1 << (y & 7)));
+
+            auto start = std::chrono::steady_clock::now();
+            pixels += diff.update(frame.buffer.data(), back.data(), false, ON, OFF,
+                                  [&spans](uint16_t, uint16_t, uint16_t, const uint16_t *) { spans++; });
+            spent += std::chrono::steady_clock::now() - start;
+        }
+
+        uint64_t spanBytes = (uint64_t)spans * WINDOW_BYTES + (uint64_t)pixels * 2;
+        uint64_t pixelBytes = changedPixels * (WINDOW_BYTES + 2);
+        printf("%-12s %6.0f changed px/frame: %5.0f spans of %4.1f px, %6.1f KB/frame vs %6.1f KB pixel by pixel, "
+               "%.1f us/frame to diff\n",
+               scene.name, (double)changedPixels / FRAMES, (double)spans / FRAMES, spans ? (double)pixels / spans : 0.0,
+               spanBytes / 1024.0 / FRAMES, pixelBytes / 1024.0 / FRAMES,
+               std::chrono::duration<double, std::micro>(spent).count() / FRAMES);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_unchangedFramePushesNothing);
+    RUN_TEST(test_smallGapsJoinSpans);
+    RUN_TEST(test_randomFramesMatch);
+    RUN_TEST(test_fromBlankRedrawsLitPixels);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,172 @@
+#include "TestUtil.h"
+#include "concurrency/OSThread.h"
+#include <unity.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace
+{
+std::vector<int> runOrder;
+
+class TestThread : public concurrency::OSThread
+{
+  public:
+    int id;
+    int32_t nextDelay;
+
+    TestThread(concurrency::Scheduler *scheduler, int _id, uint32_t period, int32_t _nextDelay = RUN_SAME)
+        : OSThread("TestThread", period, scheduler), id(_id), nextDelay(_nextDelay)
+    {
+    }
+
+  protected:
+    int32_t runOnce() override
+    {
+        runOrder.push_back(id);
+        return nextDelay;
+    }
+};
+
+// Busy wait, so the test doesn't depend on how long the host takes to wake us up
+void waitMsec(uint32_t msec)
+{
+    uint32_t start = millis();
+    while (millis() - start < msec)
+        ;
+}
+} // namespace
+
+void setUp(void)
+{
+    runOrder.clear();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_delayIsTimeToEarliestDeadline(void)
+{
+    concurrency::Scheduler scheduler;
+    TestThread slow(&scheduler, 1, 5000);
+    TestThread fast(&scheduler, 2, 1000);
+
+    int32_t delay = scheduler.runOrDelay();
+    TEST_ASSERT_INT32_WITHIN(5, 1000, delay);
+    TEST_ASSERT_EQUAL(0, runOrder.size());
+
+    // Moving a thread earlier must take effect without waiting for the old deadline
+    slow.setIntervalFromNow(100);
+    delay = scheduler.runOrDelay();
+    TEST_ASSERT_INT32_WITHIN(5, 100, delay);
+}
+
+void test_runsInDeadlineOrder(void)
+{
+    concurrency::Scheduler scheduler;
+    TestThread a(&scheduler, 1, 30);
+    TestThread b(&scheduler, 2, 10);
+    TestThread c(&scheduler, 3, 20);
+
+    waitMsec(40);
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(3, runOrder.size());
+    TEST_ASSERT_EQUAL(2, runOrder[0]);
+    TEST_ASSERT_EQUAL(3, runOrder[1]);
+    TEST_ASSERT_EQUAL(1, runOrder[2]);
+
+    // They all asked to be run again after the same period
+    TEST_ASSERT_INT32_WITHIN(5, 10, scheduler.runOrDelay());
+}
+
+// A thread that always wants to run again right away gets one turn per pass, so it can't starve the main loop
+void test_busyThreadRunsOncePerPass(void)
+{
+    concurrency::Scheduler scheduler;
+    TestThread busy(&scheduler, 1, 0, 0);
+
+    TEST_ASSERT_EQUAL(0, scheduler.runOrDelay());
+    TEST_ASSERT_EQUAL(1, runOrder.size());
+    TEST_ASSERT_EQUAL(0, scheduler.runOrDelay());
+    TEST_ASSERT_EQUAL(2, runOrder.size());
+}
+
+void test_disableAndReenable(void)
+{
+    concurrency::Scheduler scheduler;
+    TestThread t(&scheduler, 1, 0);
+
+    t.disable();
+    TEST_ASSERT_EQUAL(INT32_MAX, scheduler.runOrDelay());
+    TEST_ASSERT_EQUAL(0, runOrder.size());
+
+    // Code all over the tree writes enabled directly instead of going through setInterval
+    t.enabled = true;
+    t.setIntervalFromNow(0);
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, runOrder.size());
+
+    // A disabled thread doesn't hold the sleep time down
+    TestThread other(&scheduler, 2, 2000);
+    t.enabled = false;
+    TEST_ASSERT_INT32_WITHIN(5, 2000, scheduler.runOrDelay());
+}
+
+void test_deletedThreadIsForgotten(void)
+{
+    concurrency::Scheduler scheduler;
+    TestThread keep(&scheduler, 1, 500);
+    std::unique_ptr<TestThread> gone(new TestThread(&scheduler, 2, 10));
+    gone->setInterval(20); // leaves it on the rescheduled list
+    gone.reset();
+
+    TEST_ASSERT_INT32_WITHIN(5, 500, scheduler.runOrDelay());
+}
+
+void test_stats(void)
+{
+    concurrency::Scheduler scheduler;
+    TestThread t(&scheduler, 1, 0, 0);
+
+    for (int i = 0; i < 10; i++)
+        scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL_UINT32(10, t.getStats().runs);
+    TEST_ASSERT_TRUE(t.getStats().maxRunMicros >= t.getStats().runMicros / 10);
+}
+
+// Time for one pass of the main loop with many threads registered and only one of them due
+void test_benchmark(void)
+{
+    concurrency::Scheduler scheduler;
+    std::vector<std::unique_ptr<TestThread>> idle;
+    for (int i = 0; i < 40; i++)
+        idle.emplace_back(new TestThread(&scheduler, i, 60 * 1000));
+    TestThread busy(&scheduler, 100, 0, 0);
+
+    const int passes = 200000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++)
+        scheduler.runOrDelay();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("41 threads, 1 due: %.0f ns per pass\n", secs * 1e9 / passes);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_delayIsTimeToEarliestDeadline);
+    RUN_TEST(test_runsInDeadlineOrder);
+    RUN_TEST(test_busyThreadRunsOncePerPass);
+    RUN_TEST(test_disableAndReenable);
+    RUN_TEST(test_deletedThreadIsForgotten);
+    RUN_TEST(test_stats);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,235 @@
+#include "TestUtil.h"
+#include "marauder/StationTable.h"
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+using namespace marauder;
+
+namespace
+{
+// Frames as a busy site would give them to the promiscuous callback: numAps APs, each with a few stations, heard in no
+// particular order
+class FrameGenerator
+{
+  public:
+    FrameGenerator(uint32_t numAps, uint32_t stationsPerAp) : numAps(numAps), stationsPerAp(stationsPerAp) {}
+
+    static std::array<uint8_t, 6> mac(uint8_t kind, uint32_t n)
+    {
+        return {0x02, kind, (uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n};
+    }
+
+    static FrameRecord frame(uint32_t ap, uint32_t station)
+    {
+        FrameRecord r;
+        r.bssid = mac(0xA0, ap);
+        r.station = mac(0x5A, ap * 1000 + station);
+        r.rssi = -40 - (int8_t)(station % 50);
+        r.channel = 1 + ap % 13;
+        return r;
+    }
+
+    FrameRecord next()
+    {
+        seed = seed * 1103515245 + 12345;
+        uint32_t n = seed >> 8;
+        return frame(n % numAps, (n / numAps) % stationsPerAp);
+    }
+
+  private:
+    uint32_t numAps, stationsPerAp;
+    uint32_t seed = 1;
+};
+
+// Every index the table hands out must lead back to the entry it came from
+void checkConsistent(const StationTable &table)
+{
+    const auto &aps = table.getAccessPoints();
+    const auto &stations = table.getStations();
+    size_t listed = 0;
+    for (size_t i = 0; i < aps.size(); i++) {
+        TEST_ASSERT_EQUAL(i, table.findAccessPoint(aps[i].bssid));
+        for (size_t index : aps[i].stationIndices) {
+            TEST_ASSERT_LESS_THAN(stations.size(), index);
+            TEST_ASSERT_TRUE(stations[index].apBssid == aps[i].bssid);
+        }
+        listed += aps[i].stationIndices.size();
+    }
+    TEST_ASSERT_EQUAL(stations.size(), listed);
+    for (size_t i = 0; i < stations.size(); i++)
+        TEST_ASSERT_EQUAL(i, table.findStation(stations[i].mac, stations[i].apBssid));
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_ringDropsWhenFull(void)
+{
+    FrameRing<4> ring;
+    FrameRecord r = FrameGenerator::frame(1, 2), out;
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(ring.push(r));
+    TEST_ASSERT_FALSE(ring.push(r));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.numDropped());
+
+    int popped = 0;
+    while (ring.pop(out))
+        popped++;
+    TEST_ASSERT_EQUAL(4, popped);
+    TEST_ASSERT_TRUE(out.station == r.station);
+
+    TEST_ASSERT_TRUE(ring.push(r));
+    ring.clear();
+    TEST_ASSERT_FALSE(ring.pop(out));
+}
+
+void test_framesCountedOnce(void)
+{
+    StationTable table(8, 32, 60000);
+    table.add(FrameGenerator::frame(0, 0), 100);
+    table.add(FrameGenerator::frame(0, 1), 200);
+    table.add(FrameGenerator::frame(0, 0), 300);
+    table.add(FrameGenerator::frame(1, 0), 400);
+
+    const auto &aps = table.getAccessPoints();
+    const auto &stations = table.getStations();
+    TEST_ASSERT_EQUAL(2, aps.size());
+    TEST_ASSERT_EQUAL(3, stations.size());
+    TEST_ASSERT_EQUAL_UINT32(3, aps[0].packets);
+    TEST_ASSERT_EQUAL_UINT32(300, aps[0].lastSeen);
+    TEST_ASSERT_EQUAL(2, aps[0].stationIndices.size());
+    TEST_ASSERT_EQUAL_UINT32(2, stations[0].packets);
+    TEST_ASSERT_EQUAL_UINT32(300, stations[0].lastSeen);
+    checkConsistent(table);
+}
+
+// A full table makes room by dropping whatever was heard from least recently
+void test_leastRecentlyHeardEvicted(void)
+{
+    StationTable table(2, 3, 60000);
+    table.add(FrameGenerator::frame(0, 0), 100);
+    table.add(FrameGenerator::frame(1, 0), 200);
+    table.add(FrameGenerator::frame(0, 1), 300); // AP 1 is now the oldest
+    table.add(FrameGenerator::frame(2, 0), 400);
+
+    TEST_ASSERT_EQUAL(2, table.getAccessPoints().size());
+    TEST_ASSERT_EQUAL(SIZE_MAX, table.findAccessPoint(FrameGenerator::mac(0xA0, 1)));
+    TEST_ASSERT_EQUAL(3, table.getStations().size()); // AP 1's station went with it
+    checkConsistent(table);
+
+    table.add(FrameGenerator::frame(2, 1), 500); // Station 0 of AP 0 is the oldest
+    TEST_ASSERT_EQUAL(3, table.getStations().size());
+    TEST_ASSERT_EQUAL(SIZE_MAX, table.findStation(FrameGenerator::frame(0, 0).station, FrameGenerator::mac(0xA0, 0)));
+    TEST_ASSERT_EQUAL_UINT32(2, table.numEvicted());
+    checkConsistent(table);
+}
+
+void test_expire(void)
+{
+    StationTable table(8, 32, 1000);
+    table.add(FrameGenerator::frame(0, 0), 0);
+    table.add(FrameGenerator::frame(1, 0), 0);
+    table.add(FrameGenerator::frame(1, 1), 900);
+    table.add(FrameGenerator::frame(2, 0), 1500);
+
+    table.expire(1600);
+    TEST_ASSERT_EQUAL(2, table.getAccessPoints().size());
+    TEST_ASSERT_EQUAL(2, table.getStations().size());
+    TEST_ASSERT_EQUAL(SIZE_MAX, table.findAccessPoint(FrameGenerator::mac(0xA0, 0)));
+    checkConsistent(table);
+
+    table.expire(UINT32_MAX); // Long after everything
+    TEST_ASSERT_EQUAL(0, table.getAccessPoints().size());
+    TEST_ASSERT_EQUAL(0, table.getStations().size());
+}
+
+// Keep filling a table well past its capacity, expiring as the tracker does, and check the indices never go stale
+void test_syntheticTraffic(void)
+{
+    StationTable table(16, 48, 2000);
+    FrameGenerator gen(40, 6);
+    for (uint32_t now = 0; now < 20000; now++) {
+        table.add(gen.next(), now);
+        if (now % 1000 == 0) {
+            table.expire(now);
+            checkConsistent(table);
+        }
+        TEST_ASSERT_LESS_OR_EQUAL(16, table.getAccessPoints().size());
+        TEST_ASSERT_LESS_OR_EQUAL(48, table.getStations().size());
+    }
+    checkConsistent(table);
+}
+
+// Not a pass/fail test, prints what a frame costs the old way (searching the vectors) and through the table
+void test_benchmark(void)
+{
+    const int FRAMES = 200000;
+    FrameGenerator gen(60, 4);
+    std::vector<FrameRecord> frames;
+    for (int i = 0; i < FRAMES; i++)
+        frames.push_back(gen.next());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<TrackedAccessPoint> aps;
+    std::vector<TrackedStation> stations;
+    for (const FrameRecord &r : frames) {
+        auto apIt = std::find_if(aps.begin(), aps.end(), [&](const TrackedAccessPoint &ap) { return ap.bssid == r.bssid; });
+        if (apIt == aps.end()) {
+            TrackedAccessPoint ap;
+            ap.bssid = r.bssid;
+            aps.push_back(ap);
+            apIt = std::prev(aps.end());
+        }
+        auto staIt = std::find_if(stations.begin(), stations.end(), [&](const TrackedStation &sta) {
+            return sta.mac == r.station && sta.apBssid == r.bssid;
+        });
+        if (staIt == stations.end()) {
+            TrackedStation sta;
+            sta.mac = r.station;
+            sta.apBssid = r.bssid;
+            stations.push_back(sta);
+            apIt->stationIndices.push_back(stations.size() - 1);
+        } else {
+            staIt->rssi = r.rssi;
+        }
+    }
+    double searched = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    StationTable table(64, 256, 60000);
+    for (uint32_t i = 0; i < frames.size(); i++)
+        table.add(frames[i], i);
+    double hashed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%zu APs, %zu stations\n", table.getAccessPoints().size(), table.getStations().size());
+    printf("searched %6.1f ns/frame\n", searched / FRAMES);
+    printf("hashed   %6.1f ns/frame\n", hashed / FRAMES);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ringDropsWhenFull);
+    RUN_TEST(test_framesCountedOnce);
+    RUN_TEST(test_leastRecentlyHeardEvicted);
+    RUN_TEST(test_expire);
+    RUN_TEST(test_syntheticTraffic);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}
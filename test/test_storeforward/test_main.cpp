@@ -0,0 +1,180 @@
+#include "StoreForwardHistory.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+PacketHistoryStruct makeRecord(uint32_t time, NodeNum from, NodeNum to)
+{
+    PacketHistoryStruct r = {};
+    r.time = time;
+    r.from = from;
+    r.to = to;
+    r.id = time * 31 + from;
+    r.payload_size = snprintf((char *)r.payload, sizeof(r.payload), "%u from %x", time, from);
+    return r;
+}
+
+// Everything dest would be sent, one next() at a time the way preparePayload walks the history
+std::vector<uint32_t> walk(const StoreForwardHistory &history, NodeNum dest, uint32_t seq, uint32_t afterTime, size_t max)
+{
+    std::vector<uint32_t> seqs;
+    while (seqs.size() < max && history.next(dest, seq, afterTime))
+        seqs.push_back(seq++);
+    return seqs;
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+// The index must give the same answers as a scan, including once the ring has wrapped
+void test_indexMatchesScan(void)
+{
+    StoreForwardHistory indexed, scanned;
+    TEST_ASSERT_TRUE(indexed.begin(1000, true));
+    TEST_ASSERT_TRUE(scanned.begin(1000, false));
+    std::mt19937 rng(1);
+    uint32_t now = 1000;
+
+    for (int i = 0; i < 5000; i++) {
+        NodeNum from = 1 + rng() % 20;
+        NodeNum to = rng() % 3 ? NODENUM_BROADCAST : 1 + rng() % 20;
+        now += rng() % 3;
+        indexed.add(makeRecord(now, from, to));
+        scanned.add(makeRecord(now, from, to));
+
+        if (i % 50 == 0) {
+            NodeNum dest = 1 + rng() % 22; // some never heard from
+            uint32_t seq = rng() % (i + 1);
+            uint32_t afterTime = now - rng() % 1500;
+            TEST_ASSERT_EQUAL(scanned.count(dest, seq, afterTime), indexed.count(dest, seq, afterTime));
+            TEST_ASSERT_TRUE(walk(scanned, dest, seq, afterTime, SIZE_MAX) == walk(indexed, dest, seq, afterTime, SIZE_MAX));
+        }
+    }
+    TEST_ASSERT_EQUAL(1000, indexed.size());
+}
+
+void test_recordsNumberedAcrossWrap(void)
+{
+    StoreForwardHistory history;
+    TEST_ASSERT_TRUE(history.begin(4, true));
+    for (uint32_t t = 1; t <= 6; t++)
+        history.add(makeRecord(t, 0x10, NODENUM_BROADCAST));
+
+    // Records 0 and 1 were overwritten, a client that had them carries on from where it was
+    uint32_t seq = 0;
+    const PacketHistoryStruct *r = history.next(0x20, seq, 0);
+    TEST_ASSERT_NOT_NULL(r);
+    TEST_ASSERT_EQUAL(2, seq);
+    TEST_ASSERT_EQUAL(3, r->time);
+    TEST_ASSERT_EQUAL(4, history.count(0x20, 0, 0));
+    TEST_ASSERT_EQUAL(1, history.count(0x20, 5, 0));
+    TEST_ASSERT_EQUAL(0, history.count(0x10, 0, 0));
+}
+
+#ifdef ARCH_PORTDUINO
+
+static const char *testFile = "/tmp/test_storeforward.dat";
+
+void test_fileSurvivesRestart(void)
+{
+    remove(testFile);
+    {
+        StoreForwardHistory history;
+        TEST_ASSERT_TRUE(history.begin(100, true, testFile));
+        for (uint32_t t = 1; t <= 150; t++)
+            history.add(makeRecord(t, t % 5, t % 4 ? NODENUM_BROADCAST : 7));
+    }
+
+    StoreForwardHistory history;
+    TEST_ASSERT_TRUE(history.begin(100, true, testFile));
+    TEST_ASSERT_EQUAL(100, history.size());
+    uint32_t seq = 0;
+    const PacketHistoryStruct *r = history.next(7, seq, 0);
+    TEST_ASSERT_NOT_NULL(r);
+    TEST_ASSERT_EQUAL(50, seq);
+    TEST_ASSERT_EQUAL_STRING("51 from 1", (const char *)r->payload);
+
+    StoreForwardHistory scanned;
+    TEST_ASSERT_TRUE(scanned.begin(100, false, testFile));
+    TEST_ASSERT_EQUAL(scanned.count(7, 0, 60), history.count(7, 0, 60));
+
+    // A file for another capacity is started over
+    StoreForwardHistory resized;
+    TEST_ASSERT_TRUE(resized.begin(200, true, testFile));
+    TEST_ASSERT_EQUAL(0, resized.size());
+    remove(testFile);
+}
+
+// A history request against a million records: 2000 nodes, a third of the traffic direct, a client asking for the default
+// 25 records of its last 4 hours.  Scanning is what getNumAvailablePackets and preparePayload did before the index.
+void test_benchmark(void)
+{
+    const uint32_t numRecords = 1000000, numNodes = 2000, requests = 200;
+    remove(testFile);
+
+    std::unique_ptr<StoreForwardHistory> history(new StoreForwardHistory());
+    TEST_ASSERT_TRUE(history->begin(numRecords, true, testFile));
+    std::mt19937 rng(2);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < numRecords; i++)
+        history->add(makeRecord(1000000 + i / 10, rng() % numNodes, rng() % 3 ? NODENUM_BROADCAST : rng() % numNodes));
+    double fillSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (bool indexed : {false, true}) {
+        start = std::chrono::steady_clock::now();
+        history.reset(new StoreForwardHistory());
+        TEST_ASSERT_TRUE(history->begin(numRecords, indexed, testFile));
+        double openSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        TEST_ASSERT_EQUAL(numRecords, history->size());
+
+        uint32_t sent = 0;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < requests; i++) {
+            NodeNum dest = rng() % numNodes;
+            uint32_t afterTime = 1000000 + numRecords / 10 - 4 * 3600;
+            uint32_t seq = 0;
+            uint32_t n = std::min(history->count(dest, seq, afterTime), (uint32_t)25);
+            for (uint32_t j = 0; j < n && history->next(dest, seq, afterTime); j++, seq++)
+                sent++;
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        TEST_ASSERT_EQUAL(requests * 25, sent);
+        printf("S&F history of %u records, %s: %.1f us per history request, opened in %.0f ms (filled in %.0f ms)\n",
+               numRecords, indexed ? "indexed" : "scanned", secs / requests * 1e6, openSecs * 1e3, fillSecs * 1e3);
+    }
+    history.reset();
+    remove(testFile);
+}
+
+#endif
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_indexMatchesScan);
+    RUN_TEST(test_recordsNumberedAcrossWrap);
+#ifdef ARCH_PORTDUINO
+    RUN_TEST(test_fileSurvivesRestart);
+    RUN_TEST(test_benchmark);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
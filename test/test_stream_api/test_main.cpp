@@ -0,0 +1,319 @@
+#include "MeshService.h"
+#include "NodeDB.h"
+#include "NodeInfoCache.h"
+#include "StreamAPI.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace
+{
+class MockNodeDB : public NodeDB
+{
+};
+
+// Collects whatever the API writes, optionally taking no more than a few bytes per call like a full socket would
+class MockStream : public Stream
+{
+  public:
+    std::string out;
+    size_t writes = 0;
+    size_t maxPerWrite = SIZE_MAX;
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        writes++;
+        size_t n = size < maxPerWrite ? size : maxPerWrite;
+        out.append((const char *)buffer, n);
+        return n;
+    }
+};
+
+class TestStreamAPI : public StreamAPI
+{
+  public:
+    explicit TestStreamAPI(Stream *stream) : StreamAPI(stream) {}
+
+    void log(const char *format, ...)
+    {
+        va_list arg;
+        va_start(arg, format);
+        emitLogRecord(meshtastic_LogRecord_Level_INFO, "test", format, arg);
+        va_end(arg);
+    }
+
+  protected:
+    bool checkIsConnected() override { return true; }
+};
+
+const int numNodes = 3000;
+
+void addNodes()
+{
+    nodeDB->meshNodes->resize(numNodes + 1);
+    for (int i = 1; i <= numNodes; i++) {
+        meshtastic_NodeInfoLite &n = nodeDB->meshNodes->at(i);
+        n = meshtastic_NodeInfoLite_init_zero;
+        n.num = 0x10000 + i;
+        n.has_user = true;
+        snprintf(n.user.id, sizeof(n.user.id), "!%08x", n.num);
+        snprintf(n.user.long_name, sizeof(n.user.long_name), "Meshtastic node %d", i);
+        snprintf(n.user.short_name, sizeof(n.user.short_name), "%04x", i & 0xffff);
+        n.last_heard = 1700000000 + i;
+        n.snr = 5.5;
+    }
+    nodeDB->numMeshNodes = numNodes + 1;
+}
+
+void requestConfig(StreamAPI &api)
+{
+    meshtastic_ToRadio toRadio = meshtastic_ToRadio_init_zero;
+    toRadio.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+    toRadio.want_config_id = 1234;
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    size_t len = pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_ToRadio_msg, &toRadio);
+    api.handleToRadio(buf, len);
+}
+
+// Split what was written back into frames, failing on any framing error.  @return the number of NodeInfo frames
+size_t checkFrames(const std::string &out, size_t &frames, size_t *logRecords = NULL)
+{
+    size_t nodeInfos = 0;
+    frames = 0;
+    if (logRecords)
+        *logRecords = 0;
+    for (size_t i = 0; i < out.size();) {
+        TEST_ASSERT_TRUE(i + 4 <= out.size());
+        TEST_ASSERT_EQUAL_HEX8(0x94, (uint8_t)out[i]);
+        TEST_ASSERT_EQUAL_HEX8(0xc3, (uint8_t)out[i + 1]);
+        size_t len = ((uint8_t)out[i + 2] << 8) | (uint8_t)out[i + 3];
+        TEST_ASSERT_TRUE(i + 4 + len <= out.size());
+
+        meshtastic_FromRadio fromRadio = meshtastic_FromRadio_init_zero;
+        TEST_ASSERT_TRUE(pb_decode_from_bytes((const uint8_t *)out.data() + i + 4, len, &meshtastic_FromRadio_msg, &fromRadio));
+        if (fromRadio.which_payload_variant == meshtastic_FromRadio_node_info_tag)
+            nodeInfos++;
+        if (logRecords && fromRadio.which_payload_variant == meshtastic_FromRadio_log_record_tag)
+            (*logRecords)++;
+        frames++;
+        i += 4 + len;
+    }
+    return nodeInfos;
+}
+
+// Run the API until it has sent the whole config.  @return the number of passes it took
+int download(StreamAPI &api)
+{
+    requestConfig(api);
+    int passes = 0;
+    do {
+        passes++;
+    } while (api.runOncePart() == 0 || api.available());
+    return passes;
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_configDownloadIsWellFramed(void)
+{
+    MockStream stream;
+    TestStreamAPI api(&stream);
+    download(api);
+
+    size_t frames;
+    TEST_ASSERT_EQUAL(numNodes + 1, checkFrames(stream.out, frames));
+#if STREAM_API_OUT_BUF_SIZE
+    // Many frames per write
+    TEST_ASSERT_TRUE(stream.writes * 10 < frames);
+#endif
+}
+
+#if STREAM_API_OUT_BUF_SIZE
+// A stream that only takes part of each write must still see every byte once, in order
+void test_partialWrites(void)
+{
+    MockStream stream;
+    stream.maxPerWrite = 700;
+    TestStreamAPI api(&stream);
+    download(api);
+
+    size_t frames;
+    TEST_ASSERT_EQUAL(numNodes + 1, checkFrames(stream.out, frames));
+}
+
+// While the stream takes nothing we back off instead of being run again straight away, and pick up where we were after
+void test_stalledStreamBacksOff(void)
+{
+    MockStream stream;
+    stream.maxPerWrite = 0;
+    TestStreamAPI api(&stream);
+    requestConfig(api);
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL(STREAM_API_STALL_MSEC, api.runOncePart());
+    TEST_ASSERT_EQUAL(0, stream.out.size());
+
+    stream.maxPerWrite = SIZE_MAX;
+    while (api.runOncePart() == 0 || api.available())
+        ;
+    size_t frames;
+    TEST_ASSERT_EQUAL(numNodes + 1, checkFrames(stream.out, frames));
+}
+
+// Log records printed while the stream has taken only part of a frame must go after it, not into the middle of it
+void test_logRecordsKeepFraming(void)
+{
+    MockStream stream;
+    stream.maxPerWrite = 10;
+    TestStreamAPI api(&stream);
+    requestConfig(api);
+    api.runOncePart();
+    stream.maxPerWrite = 0;
+    int logs = 0;
+    while (api.getDroppedFrames() == 0 && logs < 10000)
+        api.log("log record %d", logs++);
+    TEST_ASSERT_EQUAL(1, api.getDroppedFrames()); // once there's no more room
+
+    stream.maxPerWrite = SIZE_MAX;
+    while (api.runOncePart() == 0 || api.available())
+        ;
+    size_t frames, logRecords;
+    TEST_ASSERT_EQUAL(numNodes + 1, checkFrames(stream.out, frames, &logRecords));
+    TEST_ASSERT_EQUAL(logs - 1, logRecords);
+}
+#endif
+
+#if PHONEAPI_NODEINFO_CACHE
+// A second client gets the same bytes without anything being encoded again, until a node changes
+void test_nodeInfoCache(void)
+{
+    MockStream first;
+    TestStreamAPI firstAPI(&first);
+    download(firstAPI);
+
+    uint32_t misses = nodeInfoCache.numMisses();
+    uint32_t hits = nodeInfoCache.numHits();
+    MockStream second;
+    TestStreamAPI secondAPI(&second);
+    download(secondAPI);
+    TEST_ASSERT_EQUAL(misses, nodeInfoCache.numMisses());
+    TEST_ASSERT_EQUAL(hits + numNodes, nodeInfoCache.numHits());
+
+    // Everything but the frames with the time in them (our own NodeInfo and the metadata) is the same
+    size_t frames;
+    TEST_ASSERT_EQUAL(numNodes + 1, checkFrames(second.out, frames));
+    TEST_ASSERT_TRUE(second.out.find(first.out.substr(first.out.size() / 2, 4096)) != std::string::npos);
+
+    meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(5);
+    strcpy(node->user.long_name, "Renamed");
+    MockStream third;
+    TestStreamAPI thirdAPI(&third);
+    download(thirdAPI);
+    TEST_ASSERT_EQUAL(misses + 1, nodeInfoCache.numMisses());
+    TEST_ASSERT_TRUE(third.out.find("Renamed") != std::string::npos);
+}
+#endif
+
+// Frames and bytes per second for a full config download with 3000 nodes, and how many writes (syscalls on a socket) it took
+void test_benchmark(void)
+{
+    // The first download after every node changed encodes them all, later ones can reuse that
+    for (int i = 1; i <= numNodes; i++)
+        nodeDB->getMeshNodeByIndex(i)->last_heard++;
+
+    for (const char *kind : {"cold", "warm"}) {
+        MockStream stream;
+        TestStreamAPI api(&stream);
+
+        auto start = std::chrono::steady_clock::now();
+        int passes = download(api);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t frames;
+        checkFrames(stream.out, frames);
+        printf("%u nodes, %s: %u frames, %.1f MB/s, %.0f frames/s, %u writes in %d passes\n", numNodes, kind,
+               (unsigned)frames, stream.out.size() / secs / 1e6, frames / secs, (unsigned)stream.writes, passes);
+    }
+}
+
+// How many HTTP requests a config download takes with one protobuf per request and with batch=0
+void test_httpBatch(void)
+{
+    MockStream stream;
+    TestStreamAPI api(&stream);
+    for (bool batch : {false, true}) {
+        requestConfig(api);
+        std::string out(64 * 1024, '\0');
+        std::string received;
+        size_t requests = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (true) {
+            requests++;
+            size_t len;
+            if (batch) {
+                len = api.getFromRadioFramed((uint8_t *)&out[0], out.size());
+            } else {
+                len = api.getFromRadio((uint8_t *)&out[4]);
+                if (len) {
+                    out[0] = 0x94;
+                    out[1] = 0xc3;
+                    out[2] = len >> 8;
+                    out[3] = len & 0xff;
+                    len += 4;
+                }
+            }
+            if (!len)
+                break;
+            received.append(out.data(), len);
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t frames;
+        TEST_ASSERT_EQUAL(numNodes + 1, checkFrames(received, frames));
+        if (batch)
+            TEST_ASSERT_TRUE(requests * 100 < frames);
+        printf("%u nodes, %s: %u frames in %u requests, %.1f ms\n", numNodes, batch ? "batch" : "single", (unsigned)frames,
+               (unsigned)requests, secs * 1e3);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    const std::unique_ptr<MockNodeDB> mockNodeDB(new MockNodeDB());
+    nodeDB = mockNodeDB.get();
+    addNodes();
+    const std::unique_ptr<MeshService> meshService(new MeshService());
+    service = meshService.get();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_configDownloadIsWellFramed);
+#if STREAM_API_OUT_BUF_SIZE
+    RUN_TEST(test_partialWrites);
+    RUN_TEST(test_stalledStreamBacksOff);
+    RUN_TEST(test_logRecordsKeepFraming);
+#endif
+#if PHONEAPI_NODEINFO_CACHE
+    RUN_TEST(test_nodeInfoCache);
+#endif
+    RUN_TEST(test_httpBatch);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
+
+void loop() {}